@@ -421,6 +421,12 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default=0.01,
     )
 
+    use_light_tree: BoolProperty(
+        name="Light Tree",
+        description="Sample lights using a tree of their bounds and energy, which reduces noise in scenes with many lights, at the cost of slower light sampling",
+        default=False,
+    )
+
     use_adaptive_sampling: BoolProperty(
         name="Use Adaptive Sampling",
         description="Automatically reduce the number of samples per pixel based on estimated noise level",
@@ -695,6 +701,11 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         description="Use compact BVH structure (uses less ram but renders slower)",
         default=False,
     )
+    debug_use_quantized_bvh: BoolProperty(
+        name="Use Quantized BVH",
+        description="Store BVH node bounds with lower precision (uses less ram but renders slower)",
+        default=False,
+    )
     debug_bvh_time_steps: IntProperty(
         name="BVH Time Steps",
         description="Split BVH primitives by this number of time steps to speed up render time in cost of memory",
@@ -794,6 +805,36 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         items=enum_texture_limit
     )
 
+    use_texture_cache: BoolProperty(
+        name="Texture Cache",
+        description="Load tiles of image textures on demand when rendering with SVM on the CPU, instead of loading "
+        "whole images before rendering. Only used for tiled images, like .tx files. Tiles of mipmapped images are read "
+        "at the resolution needed for the ray footprint",
+        default=False,
+    )
+    texture_cache_size: IntProperty(
+        name="Texture Cache Size",
+        description="Maximum memory in megabytes for image textures loaded on demand by the texture cache or by Open "
+        "Shading Language. Tiles of mipmapped images are read at the resolution needed, and the least recently used "
+        "ones are freed when the limit is reached. 0 means no limit",
+        default=0,
+        min=0,
+    )
+
+    use_out_of_core_geometry: BoolProperty(
+        name="Out of Core Geometry",
+        description="Store geometry in temporary files on disk when rendering on the CPU, so that the operating system "
+        "can page it out of memory. Allows rendering scenes that do not fit in memory, at the cost of render time",
+        default=False,
+    )
+    out_of_core_directory: StringProperty(
+        name="Out of Core Directory",
+        description="Directory for the temporary files of out of core geometry, preferably on a fast local disk. "
+        "Leave empty to use the system temporary directory",
+        subtype='DIR_PATH',
+        default="",
+    )
+
     use_fast_gi: BoolProperty(
         name="Fast GI Approximation",
         description="Approximate diffuse indirect light with background tinted ambient occlusion. This provides fast alternative to full global illumination, for interactive viewport rendering or final renders with reduced quality",
@@ -850,6 +891,10 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         items=enum_bvh_layouts,
         default='EMBREE',
     )
+    debug_use_cpu_wavefront: BoolProperty(
+        name="Wavefront",
+        description="Render paths in batches sorted by shader, for better cache coherence in shading heavy scenes",
+        default=False)
 
     debug_use_cuda_adaptive_compile: BoolProperty(name="Adaptive Compile", default=False)
 
@@ -315,6 +315,7 @@ class CYCLES_RENDER_PT_sampling_advanced(CyclesButtonsPanel, Panel):
         col.prop(cscene, "min_light_bounces")
         col.prop(cscene, "min_transparent_bounces")
         col.prop(cscene, "light_sampling_threshold", text="Light Threshold")
+        col.prop(cscene, "use_light_tree")
 
         for view_layer in scene.view_layers:
             if view_layer.samples > 0:
@@ -675,6 +676,20 @@ class CYCLES_RENDER_PT_performance_memory(CyclesButtonsPanel, Panel):
         sub.active = cscene.use_auto_tile
         sub.prop(cscene, "tile_size")
 
+        if use_cpu(context):
+            col = layout.column(heading="Texture Cache")
+            col.prop(cscene, "use_texture_cache", text="SVM")
+            sub = col.column()
+            sub.active = cscene.use_texture_cache or cscene.shading_system
+            sub.prop(cscene, "texture_cache_size", text="Size")
+
+        if use_cpu(context):
+            col = layout.column()
+            col.prop(cscene, "use_out_of_core_geometry")
+            sub = col.column()
+            sub.active = cscene.use_out_of_core_geometry
+            sub.prop(cscene, "out_of_core_directory", text="Directory")
+
 
 class CYCLES_RENDER_PT_performance_acceleration_structure(CyclesButtonsPanel, Panel):
     bl_label = "Acceleration Structure"
@@ -708,6 +723,7 @@ class CYCLES_RENDER_PT_performance_acceleration_structure(CyclesButtonsPanel, Pa
                 sub.prop(cscene, "debug_bvh_time_steps")
 
                 col.prop(cscene, "debug_use_hair_bvh")
+                col.prop(cscene, "debug_use_quantized_bvh")
 
                 sub = col.column(align=True)
                 sub.label(text="Cycles built without Embree support")
@@ -719,6 +735,7 @@ class CYCLES_RENDER_PT_performance_acceleration_structure(CyclesButtonsPanel, Pa
             sub.prop(cscene, "debug_bvh_time_steps")
 
             col.prop(cscene, "debug_use_hair_bvh")
+            col.prop(cscene, "debug_use_quantized_bvh")
 
             # CPU is used in addition to a GPU
             if use_multi_device(context) and use_embree:
@@ -2010,6 +2027,7 @@ class CYCLES_RENDER_PT_debug(CyclesDebugButtonsPanel, Panel):
         row.prop(cscene, "debug_use_cpu_avx", toggle=True)
         row.prop(cscene, "debug_use_cpu_avx2", toggle=True)
         col.prop(cscene, "debug_bvh_layout", text="BVH")
+        col.prop(cscene, "debug_use_cpu_wavefront")
 
         col.separator()
 
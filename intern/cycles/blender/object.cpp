@@ -226,9 +226,13 @@ Object *BlenderSync::sync_object(BL::Depsgraph &b_depsgraph,
     return NULL;
   }
 
-  /* Use task pool only for non-instances, since sync_dupli_particle accesses
-   * geometry. This restriction should be removed for better performance. */
-  TaskPool *object_geom_task_pool = (is_instance) ? NULL : geom_task_pool;
+  /* Don't use task pool for particle instances, since sync_dupli_particle accesses geometry,
+   * and for instances of objects with particle hair, which might be converted to mesh for the
+   * hair at the same time. Geometry of other instances only depends on the real object and object
+   * data, which remain valid after the iterator moved on, so it is synced in parallel. */
+  const bool use_geom_task_pool = !is_instance || (!b_instance.particle_system() &&
+                                                   !object_has_particle_hair(b_ob));
+  TaskPool *object_geom_task_pool = (use_geom_task_pool) ? geom_task_pool : NULL;
 
   /* key to lookup object */
   ObjectKey key(b_parent, persistent_id, b_ob_info.real_object, use_particle_hair);
@@ -341,6 +341,7 @@ void BlenderSync::sync_integrator(BL::ViewLayer &b_view_layer, bool background)
   }
 
   integrator->set_light_sampling_threshold(get_float(cscene, "light_sampling_threshold"));
+  integrator->set_use_light_tree(get_boolean(cscene, "use_light_tree"));
 
   SamplingPattern sampling_pattern = (SamplingPattern)get_enum(
       cscene, "sampling_pattern", SAMPLING_NUM_PATTERNS, SAMPLING_PATTERN_SOBOL);
@@ -801,7 +802,8 @@ void BlenderSync::free_data_after_sync(BL::Depsgraph &b_depsgraph)
 
 /* Scene Parameters */
 
-SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene,
+SceneParams BlenderSync::get_scene_params(BL::BlendData &b_data,
+                                          BL::Scene &b_scene,
                                           const bool background,
                                           const bool use_developer_ui)
 {
@@ -822,6 +824,7 @@ SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene,
   params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
   params.use_bvh_compact_structure = RNA_boolean_get(&cscene, "debug_use_compact_bvh");
   params.use_bvh_unaligned_nodes = RNA_boolean_get(&cscene, "debug_use_hair_bvh");
+  params.use_bvh_quantized_nodes = RNA_boolean_get(&cscene, "debug_use_quantized_bvh");
   params.num_bvh_time_steps = RNA_int_get(&cscene, "debug_bvh_time_steps");
 
   PointerRNA csscene = RNA_pointer_get(&b_scene.ptr, "cycles_curves");
@@ -843,6 +846,13 @@ SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene,
     params.texture_limit = 0;
   }
 
+  params.use_texture_cache = RNA_boolean_get(&cscene, "use_texture_cache");
+  params.texture_cache_size = RNA_int_get(&cscene, "texture_cache_size");
+  params.use_out_of_core_geometry = background &&
+                                    RNA_boolean_get(&cscene, "use_out_of_core_geometry");
+  params.out_of_core_directory = blender_absolute_path(
+      b_data, b_scene, get_string(cscene, "out_of_core_directory"));
+
   params.bvh_layout = DebugFlags().cpu.bvh_layout;
 
   params.background = background;
@@ -84,7 +84,8 @@ class BlenderSync {
   }
 
   /* get parameters */
-  static SceneParams get_scene_params(BL::Scene &b_scene,
+  static SceneParams get_scene_params(BL::BlendData &b_data,
+                                      BL::Scene &b_scene,
                                       const bool background,
                                       const bool use_developer_ui);
   static SessionParams get_session_params(BL::RenderEngine &b_engine,
@@ -10,7 +10,9 @@
 
 #include "util/algorithm.h"
 #include "util/boundbox.h"
+#include "util/tbb.h"
 #include "util/types.h"
+#include "util/vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -83,9 +85,110 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange &job,
   num_bins = min(size_t(MAX_BINS), size_t(4.0f + 0.05f * size()));
   scale = rcp(cent_bounds_.size()) * make_float3((float)num_bins);
 
+  /* map geometry to bins */
+  Bins bins;
+
+  if (size() < BVHParams::PARALLEL_BINNING_MIN_SIZE) {
+    bin_prims(prims, start(), end(), bins);
+  }
+  else {
+    /* Bin blocks of primitives in parallel and merge their bins. Growing bounds and counting
+     * is exact, so the result is the same as when binning all primitives at once. */
+    const size_t block_size = BVHParams::PARALLEL_BINNING_BLOCK_SIZE;
+    const size_t num_blocks = divide_up(size(), block_size);
+    vector<Bins> block_bins(num_blocks);
+
+    parallel_for(blocked_range<size_t>(0, num_blocks, 1), [&](const blocked_range<size_t> &r) {
+      for (size_t block = r.begin(); block != r.end(); block++) {
+        const size_t block_start = start() + block * block_size;
+        const size_t block_end = min(block_start + block_size, size_t(end()));
+        bin_prims(prims, block_start, block_end, block_bins[block]);
+      }
+    });
+
+    bins = block_bins[0];
+    for (size_t block = 1; block < num_blocks; block++) {
+      for (size_t i = 0; i < num_bins; i++) {
+        bins.count[i] = bins.count[i] + block_bins[block].count[i];
+        for (int d = 0; d < 3; d++) {
+          bins.bounds[i][d] = merge(bins.bounds[i][d], block_bins[block].bounds[i][d]);
+        }
+      }
+    }
+  }
+
+  const BoundBox(*bin_bounds)[4] = bins.bounds;
+  const int4 *bin_count = bins.count;
+
+  /* sweep from right to left and compute parallel prefix of merged bounds */
+  float4 r_area[MAX_BINS];  /* area of bounds of primitives on the right */
+  float4 r_count[MAX_BINS]; /* number of primitives on the right */
+  int4 count = make_int4(0);
+
+  BoundBox bx = BoundBox::empty;
+  BoundBox by = BoundBox::empty;
+  BoundBox bz = BoundBox::empty;
+
+  for (size_t i = num_bins - 1; i > 0; i--) {
+    count = count + bin_count[i];
+    r_count[i] = blocks(count);
+
+    bx = merge(bx, bin_bounds[i][0]);
+    r_area[i][0] = bx.half_area();
+    by = merge(by, bin_bounds[i][1]);
+    r_area[i][1] = by.half_area();
+    bz = merge(bz, bin_bounds[i][2]);
+    r_area[i][2] = bz.half_area();
+    r_area[i][3] = r_area[i][2];
+  }
+
+  /* sweep from left to right and compute SAH */
+  int4 ii = make_int4(1);
+  float4 bestSAH = make_float4(FLT_MAX);
+  int4 bestSplit = make_int4(-1);
+
+  count = make_int4(0);
+
+  bx = BoundBox::empty;
+  by = BoundBox::empty;
+  bz = BoundBox::empty;
+
+  for (size_t i = 1; i < num_bins; i++, ii += make_int4(1)) {
+    count = count + bin_count[i - 1];
+
+    bx = merge(bx, bin_bounds[i - 1][0]);
+    float Ax = bx.half_area();
+    by = merge(by, bin_bounds[i - 1][1]);
+    float Ay = by.half_area();
+    bz = merge(bz, bin_bounds[i - 1][2]);
+    float Az = bz.half_area();
+
+    float4 lCount = blocks(count);
+    float4 lArea = make_float4(Ax, Ay, Az, Az);
+    float4 sah = lArea * lCount + r_area[i] * r_count[i];
+
+    bestSplit = select(sah < bestSAH, ii, bestSplit);
+    bestSAH = min(sah, bestSAH);
+  }
+
+  int4 mask = float3_to_float4(cent_bounds_.size()) <= zero_float4();
+  bestSAH = insert<3>(select(mask, make_float4(FLT_MAX), bestSAH), FLT_MAX);
+
+  /* find best dimension */
+  dim = get_best_dimension(bestSAH);
+  splitSAH = bestSAH[dim];
+  pos = bestSplit[dim];
+  leafSAH = bounds_.half_area() * blocks(size());
+}
+
+void BVHObjectBinning::bin_prims(const BVHReference *prims,
+                                 const size_t begin,
+                                 const size_t end,
+                                 Bins &bins) const
+{
   /* initialize binning counter and bounds */
-  BoundBox bin_bounds[MAX_BINS][4]; /* bounds for every bin in every dimension */
-  int4 bin_count[MAX_BINS];         /* number of primitives mapped to bin */
+  BoundBox(*bin_bounds)[4] = bins.bounds; /* bounds for every bin in every dimension */
+  int4 *bin_count = bins.count;           /* number of primitives mapped to bin */
 
   for (size_t i = 0; i < num_bins; i++) {
     bin_count[i] = make_int4(0);
@@ -94,14 +197,14 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange &job,
 
   /* map geometry to bins, unrolled once */
   {
-    int64_t i;
+    size_t i;
 
-    for (i = 0; i < int64_t(size()) - 1; i += 2) {
-      prefetch_L2(&prims[start() + i + 8]);
+    for (i = begin; i + 1 < end; i += 2) {
+      prefetch_L2(&prims[i + 8]);
 
       /* map even and odd primitive to bin */
-      const BVHReference &prim0 = prims[start() + i + 0];
-      const BVHReference &prim1 = prims[start() + i + 1];
+      const BVHReference &prim0 = prims[i + 0];
+      const BVHReference &prim1 = prims[i + 1];
 
       BoundBox bounds0 = get_prim_bounds(prim0);
       BoundBox bounds1 = get_prim_bounds(prim1);
@@ -133,9 +236,9 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange &job,
     }
 
     /* for uneven number of primitives */
-    if (i < int64_t(size())) {
+    if (i < end) {
       /* map primitive to bin */
-      const BVHReference &prim0 = prims[start() + i];
+      const BVHReference &prim0 = prims[i];
       BoundBox bounds0 = get_prim_bounds(prim0);
       int4 bin0 = get_bin(bounds0);
 
@@ -151,66 +254,93 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange &job,
       bin_bounds[b02][2].grow(bounds0);
     }
   }
+}
 
-  /* sweep from right to left and compute parallel prefix of merged bounds */
-  float4 r_area[MAX_BINS];  /* area of bounds of primitives on the right */
-  float4 r_count[MAX_BINS]; /* number of primitives on the right */
-  int4 count = make_int4(0);
-
-  BoundBox bx = BoundBox::empty;
-  BoundBox by = BoundBox::empty;
-  BoundBox bz = BoundBox::empty;
-
-  for (size_t i = num_bins - 1; i > 0; i--) {
-    count = count + bin_count[i];
-    r_count[i] = blocks(count);
-
-    bx = merge(bx, bin_bounds[i][0]);
-    r_area[i][0] = bx.half_area();
-    by = merge(by, bin_bounds[i][1]);
-    r_area[i][1] = by.half_area();
-    bz = merge(bz, bin_bounds[i][2]);
-    r_area[i][2] = bz.half_area();
-    r_area[i][3] = r_area[i][2];
+size_t BVHObjectBinning::partition_parallel(BVHReference *prims,
+                                            BoundBox &lgeom_bounds,
+                                            BoundBox &rgeom_bounds,
+                                            BoundBox &lcent_bounds,
+                                            BoundBox &rcent_bounds) const
+{
+  struct PartitionBlock {
+    BoundBox lgeom_bounds = BoundBox::empty;
+    BoundBox rgeom_bounds = BoundBox::empty;
+    BoundBox lcent_bounds = BoundBox::empty;
+    BoundBox rcent_bounds = BoundBox::empty;
+    size_t num_left = 0;
+    size_t left_offset = 0;
+    size_t right_offset = 0;
+  };
+
+  const size_t N = size();
+  const size_t block_size = BVHParams::PARALLEL_BINNING_BLOCK_SIZE;
+  const size_t num_blocks = divide_up(N, block_size);
+  vector<PartitionBlock> partition_blocks(num_blocks);
+
+  /* count the primitives on the left of every block */
+  parallel_for(blocked_range<size_t>(0, num_blocks, 1), [&](const blocked_range<size_t> &r) {
+    for (size_t block = r.begin(); block != r.end(); block++) {
+      PartitionBlock &b = partition_blocks[block];
+      const size_t block_start = start() + block * block_size;
+      const size_t block_end = min(block_start + block_size, size_t(end()));
+
+      for (size_t i = block_start; i < block_end; i++) {
+        const BVHReference &prim = prims[i];
+        const float3 center = prim.bounds().center2();
+
+        if (is_left(prim)) {
+          b.lgeom_bounds.grow(prim.bounds());
+          b.lcent_bounds.grow(center);
+          b.num_left++;
+        }
+        else {
+          b.rgeom_bounds.grow(prim.bounds());
+          b.rcent_bounds.grow(center);
+        }
+      }
+    }
+  });
+
+  /* prefix sum over the blocks to find where their primitives go */
+  size_t num_left = 0;
+  for (PartitionBlock &b : partition_blocks) {
+    b.left_offset = num_left;
+    num_left += b.num_left;
+
+    lgeom_bounds = merge(lgeom_bounds, b.lgeom_bounds);
+    rgeom_bounds = merge(rgeom_bounds, b.rgeom_bounds);
+    lcent_bounds = merge(lcent_bounds, b.lcent_bounds);
+    rcent_bounds = merge(rcent_bounds, b.rcent_bounds);
   }
 
-  /* sweep from left to right and compute SAH */
-  int4 ii = make_int4(1);
-  float4 bestSAH = make_float4(FLT_MAX);
-  int4 bestSplit = make_int4(-1);
-
-  count = make_int4(0);
-
-  bx = BoundBox::empty;
-  by = BoundBox::empty;
-  bz = BoundBox::empty;
-
-  for (size_t i = 1; i < num_bins; i++, ii += make_int4(1)) {
-    count = count + bin_count[i - 1];
+  size_t right_offset = num_left;
+  for (size_t block = 0; block < num_blocks; block++) {
+    PartitionBlock &b = partition_blocks[block];
+    b.right_offset = right_offset;
+    right_offset += min(block_size, N - block * block_size) - b.num_left;
+  }
 
-    bx = merge(bx, bin_bounds[i - 1][0]);
-    float Ax = bx.half_area();
-    by = merge(by, bin_bounds[i - 1][1]);
-    float Ay = by.half_area();
-    bz = merge(bz, bin_bounds[i - 1][2]);
-    float Az = bz.half_area();
+  /* scatter primitives into partitioned order, and copy them back */
+  vector<BVHReference> partitioned(N);
 
-    float4 lCount = blocks(count);
-    float4 lArea = make_float4(Ax, Ay, Az, Az);
-    float4 sah = lArea * lCount + r_area[i] * r_count[i];
+  parallel_for(blocked_range<size_t>(0, num_blocks, 1), [&](const blocked_range<size_t> &r) {
+    for (size_t block = r.begin(); block != r.end(); block++) {
+      PartitionBlock &b = partition_blocks[block];
+      const size_t block_start = start() + block * block_size;
+      const size_t block_end = min(block_start + block_size, size_t(end()));
 
-    bestSplit = select(sah < bestSAH, ii, bestSplit);
-    bestSAH = min(sah, bestSAH);
-  }
+      for (size_t i = block_start; i < block_end; i++) {
+        const size_t offset = is_left(prims[i]) ? b.left_offset++ : b.right_offset++;
+        partitioned[offset] = prims[i];
+      }
+    }
+  });
 
-  int4 mask = float3_to_float4(cent_bounds_.size()) <= zero_float4();
-  bestSAH = insert<3>(select(mask, make_float4(FLT_MAX), bestSAH), FLT_MAX);
+  parallel_for(blocked_range<size_t>(0, N, block_size), [&](const blocked_range<size_t> &r) {
+    std::copy(&partitioned[r.begin()], &partitioned[r.end() - 1] + 1, &prims[start() + r.begin()]);
+  });
 
-  /* find best dimension */
-  dim = get_best_dimension(bestSAH);
-  splitSAH = bestSAH[dim];
-  pos = bestSplit[dim];
-  leafSAH = bounds_.half_area() * blocks(size());
+  return num_left;
 }
 
 void BVHObjectBinning::split(BVHReference *prims,
@@ -224,34 +354,44 @@ void BVHObjectBinning::split(BVHReference *prims,
   BoundBox lcent_bounds = BoundBox::empty;
   BoundBox rcent_bounds = BoundBox::empty;
 
-  int64_t l = 0, r = N - 1;
-
-  while (l <= r) {
-    prefetch_L2(&prims[start() + l + 8]);
-    prefetch_L2(&prims[start() + r - 8]);
+  size_t num_left;
 
-    BVHReference prim = prims[start() + l];
-    BoundBox unaligned_bounds = get_prim_bounds(prim);
-    float3 unaligned_center = unaligned_bounds.center2();
-    float3 center = prim.bounds().center2();
-
-    if (get_bin(unaligned_center)[dim] < pos) {
-      lgeom_bounds.grow(prim.bounds());
-      lcent_bounds.grow(center);
-      l++;
-    }
-    else {
-      rgeom_bounds.grow(prim.bounds());
-      rcent_bounds.grow(center);
-      swap(prims[start() + l], prims[start() + r]);
-      r--;
+  if (N >= BVHParams::PARALLEL_BINNING_MIN_SIZE) {
+    num_left = partition_parallel(prims, lgeom_bounds, rgeom_bounds, lcent_bounds, rcent_bounds);
+  }
+  else {
+    int64_t l = 0, r = N - 1;
+
+    while (l <= r) {
+      prefetch_L2(&prims[start() + l + 8]);
+      prefetch_L2(&prims[start() + r - 8]);
+
+      BVHReference prim = prims[start() + l];
+      BoundBox unaligned_bounds = get_prim_bounds(prim);
+      float3 unaligned_center = unaligned_bounds.center2();
+      float3 center = prim.bounds().center2();
+
+      if (get_bin(unaligned_center)[dim] < pos) {
+        lgeom_bounds.grow(prim.bounds());
+        lcent_bounds.grow(center);
+        l++;
+      }
+      else {
+        rgeom_bounds.grow(prim.bounds());
+        rcent_bounds.grow(center);
+        swap(prims[start() + l], prims[start() + r]);
+        r--;
+      }
     }
+
+    num_left = l;
   }
+
   /* finish */
-  if (l != 0 && N - 1 - r != 0) {
-    right_o = BVHObjectBinning(BVHRange(rgeom_bounds, rcent_bounds, start() + l, N - 1 - r),
-                               prims);
-    left_o = BVHObjectBinning(BVHRange(lgeom_bounds, lcent_bounds, start(), l), prims);
+  if (num_left != 0 && num_left != N) {
+    right_o = BVHObjectBinning(
+        BVHRange(rgeom_bounds, rcent_bounds, start() + num_left, N - num_left), prims);
+    left_o = BVHObjectBinning(BVHRange(lgeom_bounds, lcent_bounds, start(), num_left), prims);
     return;
   }
 
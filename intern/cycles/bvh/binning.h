@@ -14,12 +14,14 @@ CCL_NAMESPACE_BEGIN
 
 class BVHBuild;
 
-/* Single threaded object binner. Finds the split with the best SAH heuristic
+/* Object binner. Finds the split with the best SAH heuristic
  * by testing for each dimension multiple partitionings for regular spaced
  * partition locations. A partitioning for a partition location is computed,
  * by putting primitives whose centroid is on the left and right of the split
  * location to different sets. The SAH is evaluated by computing the number of
- * blocks occupied by the primitives in the partitions. */
+ * blocks occupied by the primitives in the partitions.
+ *
+ * Large ranges are binned and split in parallel. */
 
 class BVHObjectBinning : public BVHRange {
  public:
@@ -58,6 +60,22 @@ class BVHObjectBinning : public BVHRange {
   enum { MAX_BINS = 32 };
   enum { LOG_BLOCK_SIZE = 2 };
 
+  /* Bounds and number of primitives of every bin in every dimension. */
+  struct Bins {
+    BoundBox bounds[MAX_BINS][4];
+    int4 count[MAX_BINS];
+  };
+
+  /* Map a range of primitives to bins. */
+  void bin_prims(const BVHReference *prims, size_t begin, size_t end, Bins &bins) const;
+
+  /* Partition the primitives in parallel, returns the number of primitives on the left. */
+  size_t partition_parallel(BVHReference *prims,
+                            BoundBox &lgeom_bounds,
+                            BoundBox &rgeom_bounds,
+                            BoundBox &lcent_bounds,
+                            BoundBox &rcent_bounds) const;
+
   /* computes the bin numbers for each dimension for a box. */
   __forceinline int4 get_bin(const BoundBox &box) const
   {
@@ -74,6 +92,12 @@ class BVHObjectBinning : public BVHRange {
     return make_int4((c - cent_bounds_.min) * scale - make_float3(0.5f));
   }
 
+  /* test whether a primitive goes to the left side of the split. */
+  __forceinline bool is_left(const BVHReference &prim) const
+  {
+    return get_bin(get_prim_bounds(prim).center2())[dim] < pos;
+  }
+
   /* compute the number of blocks occupied for each dimension. */
   __forceinline float4 blocks(const int4 &a) const
   {
@@ -14,6 +14,7 @@
 #include "bvh/unaligned.h"
 
 #include "util/foreach.h"
+#include "util/log.h"
 #include "util/progress.h"
 
 CCL_NAMESPACE_BEGIN
@@ -30,7 +31,11 @@ int BVHStackEntry::encodeIdx() const
 BVH2::BVH2(const BVHParams &params_,
            const vector<Geometry *> &geometry_,
            const vector<Object *> &objects_)
-    : BVH(params_, geometry_, objects_)
+    : BVH(params_, geometry_, objects_),
+      build_sah_cost(0.0f),
+      instances_prim_offset(0),
+      instances_nodes_offset(0),
+      instances_leaf_nodes_offset(0)
 {
 }
 
@@ -69,6 +74,8 @@ void BVH2::build(Progress &progress, Stats *)
     return;
   }
 
+  build_sah_cost = root->computeSubtreeSAHCost(params);
+
   /* pack triangles */
   progress.set_substatus("Packing BVH triangles and strands");
   pack_primitives();
@@ -88,14 +95,37 @@ void BVH2::build(Progress &progress, Stats *)
 
 void BVH2::refit(Progress &progress)
 {
+  if (params.top_level) {
+    /* Drop the merged instance BVHs, they are merged again after packing the primitives as
+     * they may have been refitted or rebuilt. */
+    pack.prim_index.resize(instances_prim_offset);
+    pack.prim_type.resize(instances_prim_offset);
+    pack.prim_object.resize(instances_prim_offset);
+    if (pack.prim_time.size()) {
+      pack.prim_time.resize(instances_prim_offset);
+    }
+  }
+
   progress.set_substatus("Packing BVH primitives");
   pack_primitives();
 
+  if (params.top_level) {
+    pack_instances(instances_nodes_offset, instances_leaf_nodes_offset);
+  }
+
   if (progress.get_cancel())
     return;
 
   progress.set_substatus("Refitting BVH nodes");
-  refit_nodes();
+  const float sah_cost = refit_nodes();
+
+  /* Deforming geometry can move primitives of the same leaf far apart, making traversal of
+   * the refitted tree a lot slower than of a rebuilt one. */
+  if (build_sah_cost > 0.0f && sah_cost > build_sah_cost * params.refit_sah_threshold) {
+    VLOG_WORK << "Rebuilding BVH, refitting increased its SAH cost from " << build_sah_cost
+              << " to " << sah_cost;
+    build(progress, NULL);
+  }
 }
 
 BVHNode *BVH2::widen_children_nodes(const BVHNode *root)
@@ -149,6 +179,11 @@ void BVH2::pack_aligned_inner(const BVHStackEntry &e,
                     e1.node->visibility);
 }
 
+int BVH2::aligned_node_size() const
+{
+  return (params.use_quantized_nodes) ? BVH_QUANTIZED_NODE_SIZE : BVH_NODE_SIZE;
+}
+
 void BVH2::pack_aligned_node(int idx,
                              const BoundBox &b0,
                              const BoundBox &b1,
@@ -157,6 +192,11 @@ void BVH2::pack_aligned_node(int idx,
                              uint visibility0,
                              uint visibility1)
 {
+  if (params.use_quantized_nodes) {
+    pack_quantized_node(idx, b0, b1, c0, c1, visibility0, visibility1);
+    return;
+  }
+
   assert(idx + BVH_NODE_SIZE <= pack.nodes.size());
   assert(c0 < 0 || c0 < pack.nodes.size());
   assert(c1 < 0 || c1 < pack.nodes.size());
@@ -181,6 +221,99 @@ void BVH2::pack_aligned_node(int idx,
   memcpy(&pack.nodes[idx], data, sizeof(int4) * BVH_NODE_SIZE);
 }
 
+/* Quantize the bounds of both children along one axis, as offsets from the origin in steps of a
+ * power of two scale. Bounds are rounded outwards, so that the bounds decoded by the kernel
+ * always contain the original bounds. Empty children get inverted bounds, which the kernel does
+ * not intersect. Returns the biased exponent of the scale. */
+static uint quantize_node_axis(const float origin,
+                               const float end,
+                               const float lo[2],
+                               const float hi[2],
+                               const bool empty[2],
+                               uint *r_qbounds)
+{
+  int exponent;
+  frexpf((end - origin) / 255.0f, &exponent);
+  exponent = clamp(exponent, -126, 127);
+  float scale = ldexpf(1.0f, exponent);
+  if (origin + 255.0f * scale < end && exponent < 127) {
+    scale = ldexpf(1.0f, ++exponent);
+  }
+
+  uint qlo[2], qhi[2];
+  for (int i = 0; i < 2; i++) {
+    if (empty[i]) {
+      qlo[i] = 255;
+      qhi[i] = 0;
+      continue;
+    }
+
+    int q = clamp((int)floorf((lo[i] - origin) / scale), 0, 255);
+    while (q > 0 && origin + (float)q * scale > lo[i]) {
+      q--;
+    }
+    qlo[i] = q;
+
+    q = clamp((int)ceilf((hi[i] - origin) / scale), 0, 255);
+    while (q < 255 && origin + (float)q * scale < hi[i]) {
+      q++;
+    }
+    qhi[i] = q;
+  }
+
+  /* Same order as the float bounds of regular nodes. */
+  *r_qbounds = qlo[0] | (qlo[1] << 8) | (qhi[0] << 16) | (qhi[1] << 24);
+  return exponent + 127;
+}
+
+void BVH2::pack_quantized_node(int idx,
+                               const BoundBox &b0,
+                               const BoundBox &b1,
+                               int c0,
+                               int c1,
+                               uint visibility0,
+                               uint visibility1)
+{
+  assert(idx + BVH_QUANTIZED_NODE_SIZE <= pack.nodes.size());
+  assert(c0 < 0 || c0 < pack.nodes.size());
+  assert(c1 < 0 || c1 < pack.nodes.size());
+
+  BoundBox bounds = BoundBox::empty;
+  if (b0.valid()) {
+    bounds.grow(b0);
+  }
+  if (b1.valid()) {
+    bounds.grow(b1);
+  }
+  if (!bounds.valid()) {
+    bounds = BoundBox(zero_float3());
+  }
+
+  const bool empty[2] = {!b0.valid(), !b1.valid()};
+
+  uint exponents = 0;
+  uint qbounds[3];
+  for (int axis = 0; axis < 3; axis++) {
+    const float lo[2] = {b0.min[axis], b1.min[axis]};
+    const float hi[2] = {b0.max[axis], b1.max[axis]};
+    exponents |= quantize_node_axis(
+                     bounds.min[axis], bounds.max[axis], lo, hi, empty, &qbounds[axis])
+                 << (axis * 8);
+  }
+
+  int4 data[BVH_QUANTIZED_NODE_SIZE] = {
+      make_int4(
+          visibility0 & ~PATH_RAY_NODE_UNALIGNED, visibility1 & ~PATH_RAY_NODE_UNALIGNED, c0, c1),
+      make_int4(__float_as_int(bounds.min.x),
+                __float_as_int(bounds.min.y),
+                __float_as_int(bounds.min.z),
+                (int)exponents),
+      make_int4((int)qbounds[0], (int)qbounds[1], (int)qbounds[2], 0),
+  };
+
+  memcpy(&pack.nodes[idx], data, sizeof(int4) * BVH_QUANTIZED_NODE_SIZE);
+}
+
 void BVH2::pack_unaligned_inner(const BVHStackEntry &e,
                                 const BVHStackEntry &e0,
                                 const BVHStackEntry &e1)
@@ -238,16 +371,25 @@ void BVH2::pack_nodes(const BVHNode *root)
   if (params.use_unaligned_nodes) {
     const size_t num_unaligned_nodes = root->getSubtreeSize(BVH_STAT_UNALIGNED_INNER_COUNT);
     node_size = (num_unaligned_nodes * BVH_UNALIGNED_NODE_SIZE) +
-                (num_inner_nodes - num_unaligned_nodes) * BVH_NODE_SIZE;
+                (num_inner_nodes - num_unaligned_nodes) * aligned_node_size();
   }
   else {
-    node_size = num_inner_nodes * BVH_NODE_SIZE;
+    node_size = num_inner_nodes * aligned_node_size();
   }
   /* Resize arrays */
   pack.nodes.clear();
   pack.leaf_nodes.clear();
   /* For top level BVH, first merge existing BVH's so we know the offsets. */
   if (params.top_level) {
+    /* Adjust primitive index to point to the triangle in the global array, for
+     * geometry with transform applied and already in the top level BVH.
+     */
+    for (size_t i = 0; i < pack.prim_index.size(); i++) {
+      if (pack.prim_index[i] != -1) {
+        pack.prim_index[i] += objects[pack.prim_object[i]]->get_geometry()->prim_offset;
+      }
+    }
+
     pack_instances(node_size, num_leaf_nodes * BVH_NODE_LEAF_SIZE);
   }
   else {
@@ -264,7 +406,7 @@ void BVH2::pack_nodes(const BVHNode *root)
   }
   else {
     stack.push_back(BVHStackEntry(root, nextNodeIdx));
-    nextNodeIdx += root->has_unaligned() ? BVH_UNALIGNED_NODE_SIZE : BVH_NODE_SIZE;
+    nextNodeIdx += root->has_unaligned() ? BVH_UNALIGNED_NODE_SIZE : aligned_node_size();
   }
 
   while (stack.size()) {
@@ -286,7 +428,7 @@ void BVH2::pack_nodes(const BVHNode *root)
         else {
           idx[i] = nextNodeIdx;
           nextNodeIdx += e.node->get_child(i)->has_unaligned() ? BVH_UNALIGNED_NODE_SIZE :
-                                                                 BVH_NODE_SIZE;
+                                                                 aligned_node_size();
         }
       }
 
@@ -301,16 +443,19 @@ void BVH2::pack_nodes(const BVHNode *root)
   pack.root_index = (root->is_leaf()) ? -1 : 0;
 }
 
-void BVH2::refit_nodes()
+float BVH2::refit_nodes()
 {
-  assert(!params.top_level);
-
   BoundBox bbox = BoundBox::empty;
   uint visibility = 0;
-  refit_node(0, (pack.root_index == -1) ? true : false, bbox, visibility);
+  float area_cost = 0.0f;
+  refit_node(0, (pack.root_index == -1) ? true : false, bbox, visibility, area_cost);
+
+  /* Same cost as BVHNode::computeSubtreeSAHCost(), for comparing against the built tree. */
+  const float root_area = bbox.safe_area();
+  return (root_area > 0.0f) ? area_cost / root_area : 0.0f;
 }
 
-void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
+void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility, float &area_cost)
 {
   if (leaf) {
     /* refit leaf node */
@@ -319,7 +464,15 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     const int c0 = data[0].x;
     const int c1 = data[0].y;
 
-    refit_primitives(c0, c1, bbox, visibility);
+    if (c0 < 0) {
+      /* Object instance in the top level BVH. */
+      refit_primitives(~c0, ~c0 + 1, bbox, visibility);
+      area_cost += bbox.safe_area() * params.primitive_cost(1);
+    }
+    else {
+      refit_primitives(c0, c1, bbox, visibility);
+      area_cost += bbox.safe_area() * params.primitive_cost(c1 - c0);
+    }
 
     /* TODO(sergey): De-duplicate with pack_leaf(). */
     float4 leaf_data[BVH_NODE_LEAF_SIZE];
@@ -330,7 +483,7 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     memcpy(&pack.leaf_nodes[idx], leaf_data, sizeof(float4) * BVH_NODE_LEAF_SIZE);
   }
   else {
-    assert(idx + BVH_NODE_SIZE <= pack.nodes.size());
+    assert(idx + aligned_node_size() <= pack.nodes.size());
 
     const int4 *data = &pack.nodes[idx];
     const bool is_unaligned = (data[0].x & PATH_RAY_NODE_UNALIGNED) != 0;
@@ -340,8 +493,8 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     BoundBox bbox0 = BoundBox::empty, bbox1 = BoundBox::empty;
     uint visibility0 = 0, visibility1 = 0;
 
-    refit_node((c0 < 0) ? -c0 - 1 : c0, (c0 < 0), bbox0, visibility0);
-    refit_node((c1 < 0) ? -c1 - 1 : c1, (c1 < 0), bbox1, visibility1);
+    refit_node((c0 < 0) ? -c0 - 1 : c0, (c0 < 0), bbox0, visibility0, area_cost);
+    refit_node((c1 < 0) ? -c1 - 1 : c1, (c1 < 0), bbox1, visibility1, area_cost);
 
     if (is_unaligned) {
       Transform aligned_space = transform_identity();
@@ -355,6 +508,7 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     bbox.grow(bbox0);
     bbox.grow(bbox1);
     visibility = visibility0 | visibility1;
+    area_cost += bbox.safe_area() * params.node_cost(2);
   }
 }
 
@@ -474,14 +628,9 @@ void BVH2::pack_primitives()
 
 void BVH2::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 {
-  /* Adjust primitive index to point to the triangle in the global array, for
-   * geometry with transform applied and already in the top level BVH.
-   */
-  for (size_t i = 0; i < pack.prim_index.size(); i++) {
-    if (pack.prim_index[i] != -1) {
-      pack.prim_index[i] += objects[pack.prim_object[i]]->get_geometry()->prim_offset;
-    }
-  }
+  instances_prim_offset = pack.prim_index.size();
+  instances_nodes_offset = nodes_size;
+  instances_leaf_nodes_offset = leaf_nodes_size;
 
   /* track offsets of instanced BVH data in global array */
   size_t prim_offset = pack.prim_index.size();
@@ -615,7 +764,7 @@ void BVH2::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
           nsize_bbox = 0;
         }
         else {
-          nsize = BVH_NODE_SIZE;
+          nsize = aligned_node_size();
           nsize_bbox = 0;
         }
 
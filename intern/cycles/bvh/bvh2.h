@@ -16,6 +16,7 @@ CCL_NAMESPACE_BEGIN
 #define BVH_NODE_SIZE 4
 #define BVH_NODE_LEAF_SIZE 1
 #define BVH_UNALIGNED_NODE_SIZE 7
+#define BVH_QUANTIZED_NODE_SIZE 3
 
 /* Pack Utility */
 struct BVHStackEntry {
@@ -37,6 +38,9 @@ class BVH2 : public BVH {
 
   PackedBVH pack;
 
+  /* SAH cost of the tree when it was last built, to detect refits degrading its quality. */
+  float build_sah_cost;
+
  protected:
   /* constructor */
   friend class BVH;
@@ -50,6 +54,9 @@ class BVH2 : public BVH {
   /* pack */
   void pack_nodes(const BVHNode *root);
 
+  /* Size of aligned inner nodes, depending on whether their bounds are quantized. */
+  int aligned_node_size() const;
+
   void pack_leaf(const BVHStackEntry &e, const LeafNode *leaf);
   void pack_inner(const BVHStackEntry &e, const BVHStackEntry &e0, const BVHStackEntry &e1);
 
@@ -63,6 +70,13 @@ class BVH2 : public BVH {
                          int c1,
                          uint visibility0,
                          uint visibility1);
+  void pack_quantized_node(int idx,
+                           const BoundBox &b0,
+                           const BoundBox &b1,
+                           int c0,
+                           int c1,
+                           uint visibility0,
+                           uint visibility1);
 
   void pack_unaligned_inner(const BVHStackEntry &e,
                             const BVHStackEntry &e0,
@@ -77,9 +91,9 @@ class BVH2 : public BVH {
                            uint visibility0,
                            uint visibility1);
 
-  /* refit */
-  void refit_nodes();
-  void refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility);
+  /* refit, returns the SAH cost of the refitted tree */
+  float refit_nodes();
+  void refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility, float &area_cost);
 
   /* Refit range of primitives. */
   void refit_primitives(int start, int end, BoundBox &bbox, uint &visibility);
@@ -90,6 +104,12 @@ class BVH2 : public BVH {
 
   /* merge instance BVH's */
   void pack_instances(size_t nodes_size, size_t leaf_nodes_size);
+
+  /* Offsets of the merged instance BVHs in the packed arrays of the top level BVH, so they can
+   * be merged again when refitting. */
+  size_t instances_prim_offset;
+  size_t instances_nodes_offset;
+  size_t instances_leaf_nodes_offset;
 };
 
 CCL_NAMESPACE_END
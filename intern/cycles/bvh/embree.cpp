@@ -588,6 +588,10 @@ void BVHEmbree::refit(Progress &progress)
         }
       }
     }
+    else if (ob->is_traceable()) {
+      /* Commit the instance again, so its bounds are updated from the refitted instance BVH. */
+      rtcCommitGeometry(rtcGetGeometry(scene, geom_id));
+    }
     geom_id += 2;
   }
 
@@ -64,6 +64,10 @@ class BVHParams {
   float sah_node_cost;
   float sah_primitive_cost;
 
+  /* Rebuild instead of refitting when refitting increased the SAH cost of the tree by more than
+   * this factor, as happens when deforming geometry moves primitives of a leaf far apart. */
+  float refit_sah_threshold;
+
   /* number of primitives in leaf */
   int min_leaf_size;
   int max_triangle_leaf_size;
@@ -84,6 +88,11 @@ class BVHParams {
    */
   bool use_unaligned_nodes;
 
+  /* Store the child bounds of aligned BVH2 nodes as 8-bit offsets relative to the bounds of
+   * the node, reducing the node size from 64 to 48 bytes in exchange for looser bounds.
+   */
+  bool use_quantized_nodes;
+
   /* Use compact acceleration structure (Embree)*/
   bool use_compact_structure;
 
@@ -107,6 +116,11 @@ class BVHParams {
   /* fixed parameters */
   enum { MAX_DEPTH = 64, MAX_SPATIAL_DEPTH = 48, NUM_SPATIAL_BINS = 32 };
 
+  /* Ranges with at least this many references are binned in parallel, in blocks of
+   * PARALLEL_BINNING_BLOCK_SIZE references. These are the ranges near the root, which can not
+   * be distributed over multiple build tasks yet. */
+  enum { PARALLEL_BINNING_MIN_SIZE = 65536, PARALLEL_BINNING_BLOCK_SIZE = 8192 };
+
   BVHParams()
   {
     use_spatial_split = true;
@@ -119,6 +133,8 @@ class BVHParams {
     sah_node_cost = 1.0f;
     sah_primitive_cost = 1.0f;
 
+    refit_sah_threshold = 1.5f;
+
     min_leaf_size = 1;
     max_triangle_leaf_size = 8;
     max_motion_triangle_leaf_size = 8;
@@ -131,6 +147,7 @@ class BVHParams {
     bvh_layout = BVH_LAYOUT_BVH2;
     use_compact_structure = false;
     use_unaligned_nodes = false;
+    use_quantized_nodes = false;
 
     num_motion_curve_steps = 0;
     num_motion_triangle_steps = 0;
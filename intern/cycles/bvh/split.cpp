@@ -13,6 +13,7 @@
 #include "scene/pointcloud.h"
 
 #include "util/algorithm.h"
+#include "util/tbb.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -147,44 +148,47 @@ BVHSpatialSplit::BVHSpatialSplit(const BVHBuild &builder,
   float3 binSize = (range_bounds.max - origin) * (1.0f / (float)BVHParams::NUM_SPATIAL_BINS);
   float3 invBinSize = 1.0f / binSize;
 
-  for (int dim = 0; dim < 3; dim++) {
-    for (int i = 0; i < BVHParams::NUM_SPATIAL_BINS; i++) {
-      BVHSpatialBin &bin = storage_->bins[dim][i];
-
-      bin.bounds = BoundBox::empty;
-      bin.enter = 0;
-      bin.exit = 0;
-    }
-  }
-
   /* chop references into bins. */
-  for (unsigned int refIdx = range.start(); refIdx < range.end(); refIdx++) {
-    const BVHReference &ref = references_->at(refIdx);
-    BoundBox prim_bounds = get_prim_bounds(ref);
-    float3 firstBinf = (prim_bounds.min - origin) * invBinSize;
-    float3 lastBinf = (prim_bounds.max - origin) * invBinSize;
-    int3 firstBin = make_int3((int)firstBinf.x, (int)firstBinf.y, (int)firstBinf.z);
-    int3 lastBin = make_int3((int)lastBinf.x, (int)lastBinf.y, (int)lastBinf.z);
-
-    firstBin = clamp(firstBin, 0, BVHParams::NUM_SPATIAL_BINS - 1);
-    lastBin = clamp(lastBin, firstBin, BVHParams::NUM_SPATIAL_BINS - 1);
+  if (range.size() < BVHParams::PARALLEL_BINNING_MIN_SIZE) {
+    bin_references(
+        builder, range.start(), range.end(), origin, binSize, invBinSize, storage_->bins);
+  }
+  else {
+    /* Bin blocks of references in parallel and merge their bins. */
+    struct BlockBins {
+      BVHSpatialBin bins[3][BVHParams::NUM_SPATIAL_BINS];
+    };
+
+    const int block_size = BVHParams::PARALLEL_BINNING_BLOCK_SIZE;
+    const int num_blocks = divide_up(range.size(), block_size);
+    vector<BlockBins> block_bins(num_blocks);
+
+    parallel_for(blocked_range<int>(0, num_blocks, 1), [&](const blocked_range<int> &r) {
+      for (int block = r.begin(); block != r.end(); block++) {
+        const int block_start = range.start() + block * block_size;
+        const int block_end = min(block_start + block_size, range.end());
+        bin_references(builder,
+                       block_start,
+                       block_end,
+                       origin,
+                       binSize,
+                       invBinSize,
+                       block_bins[block].bins);
+      }
+    });
 
     for (int dim = 0; dim < 3; dim++) {
-      BVHReference currRef(
-          get_prim_bounds(ref), ref.prim_index(), ref.prim_object(), ref.prim_type());
-
-      for (int i = firstBin[dim]; i < lastBin[dim]; i++) {
-        BVHReference leftRef, rightRef;
-
-        split_reference(
-            builder, leftRef, rightRef, currRef, dim, origin[dim] + binSize[dim] * (float)(i + 1));
-        storage_->bins[dim][i].bounds.grow(leftRef.bounds());
-        currRef = rightRef;
+      for (int i = 0; i < BVHParams::NUM_SPATIAL_BINS; i++) {
+        BVHSpatialBin &bin = storage_->bins[dim][i];
+        bin = block_bins[0].bins[dim][i];
+
+        for (int block = 1; block < num_blocks; block++) {
+          const BVHSpatialBin &other = block_bins[block].bins[dim][i];
+          bin.bounds = merge(bin.bounds, other.bounds);
+          bin.enter += other.enter;
+          bin.exit += other.exit;
+        }
       }
-
-      storage_->bins[dim][lastBin[dim]].bounds.grow(currRef.bounds());
-      storage_->bins[dim][firstBin[dim]].enter++;
-      storage_->bins[dim][lastBin[dim]].exit++;
     }
   }
 
@@ -221,6 +225,59 @@ BVHSpatialSplit::BVHSpatialSplit(const BVHBuild &builder,
   }
 }
 
+void BVHSpatialSplit::bin_references(const BVHBuild &builder,
+                                     const int start,
+                                     const int end,
+                                     const float3 &origin,
+                                     const float3 &bin_size,
+                                     const float3 &inv_bin_size,
+                                     BVHSpatialBin (*bins)[BVHParams::NUM_SPATIAL_BINS])
+{
+  for (int dim = 0; dim < 3; dim++) {
+    for (int i = 0; i < BVHParams::NUM_SPATIAL_BINS; i++) {
+      BVHSpatialBin &bin = bins[dim][i];
+
+      bin.bounds = BoundBox::empty;
+      bin.enter = 0;
+      bin.exit = 0;
+    }
+  }
+
+  for (int refIdx = start; refIdx < end; refIdx++) {
+    const BVHReference &ref = references_->at(refIdx);
+    BoundBox prim_bounds = get_prim_bounds(ref);
+    float3 firstBinf = (prim_bounds.min - origin) * inv_bin_size;
+    float3 lastBinf = (prim_bounds.max - origin) * inv_bin_size;
+    int3 firstBin = make_int3((int)firstBinf.x, (int)firstBinf.y, (int)firstBinf.z);
+    int3 lastBin = make_int3((int)lastBinf.x, (int)lastBinf.y, (int)lastBinf.z);
+
+    firstBin = clamp(firstBin, 0, BVHParams::NUM_SPATIAL_BINS - 1);
+    lastBin = clamp(lastBin, firstBin, BVHParams::NUM_SPATIAL_BINS - 1);
+
+    for (int dim = 0; dim < 3; dim++) {
+      BVHReference currRef(
+          get_prim_bounds(ref), ref.prim_index(), ref.prim_object(), ref.prim_type());
+
+      for (int i = firstBin[dim]; i < lastBin[dim]; i++) {
+        BVHReference leftRef, rightRef;
+
+        split_reference(builder,
+                        leftRef,
+                        rightRef,
+                        currRef,
+                        dim,
+                        origin[dim] + bin_size[dim] * (float)(i + 1));
+        bins[dim][i].bounds.grow(leftRef.bounds());
+        currRef = rightRef;
+      }
+
+      bins[dim][lastBin[dim]].bounds.grow(currRef.bounds());
+      bins[dim][firstBin[dim]].enter++;
+      bins[dim][lastBin[dim]].exit++;
+    }
+  }
+}
+
 void BVHSpatialSplit::split(BVHBuild *builder,
                             BVHRange &left,
                             BVHRange &right,
@@ -90,6 +90,15 @@ class BVHSpatialSplit {
   const BVHUnaligned *unaligned_heuristic_;
   const Transform *aligned_space_;
 
+  /* Chop a range of references into bins. */
+  void bin_references(const BVHBuild &builder,
+                      int start,
+                      int end,
+                      const float3 &origin,
+                      const float3 &bin_size,
+                      const float3 &inv_bin_size,
+                      BVHSpatialBin (*bins)[BVHParams::NUM_SPATIAL_BINS]);
+
   /* Lower-level functions which calculates boundaries of left and right nodes
    * needed for spatial split.
    *
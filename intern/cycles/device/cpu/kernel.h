@@ -26,6 +26,10 @@ class CPUKernels {
                                                             IntegratorStateCPU *state,
                                                             KernelWorkTile *tile,
                                                             ccl_global float *render_buffer)>;
+  using IntegratorPacketFunction = CPUKernelFunction<void (*)(const KernelGlobalsCPU *kg,
+                                                              IntegratorStateCPU **states,
+                                                              const int num_states,
+                                                              ccl_global float *render_buffer)>;
 
   IntegratorInitFunction integrator_init_from_camera;
   IntegratorInitFunction integrator_init_from_bake;
@@ -39,6 +43,7 @@ class CPUKernels {
   IntegratorShadeFunction integrator_shade_surface;
   IntegratorShadeFunction integrator_shade_volume;
   IntegratorShadeFunction integrator_megakernel;
+  IntegratorPacketFunction integrator_wavefront_stage;
 
   /* Shader evaluation. */
 
@@ -4,6 +4,8 @@
 #include "device/memory.h"
 #include "device/device.h"
 
+#include "util/mapped_malloc.h"
+
 CCL_NAMESPACE_BEGIN
 
 /* Device Memory */
@@ -27,7 +29,9 @@ device_memory::device_memory(Device *device, const char *name, MemoryType type)
       original_device_size(0),
       original_device(0),
       need_realloc_(false),
-      modified(false)
+      modified(false),
+      use_host_mapped(false),
+      host_mapped(false)
 {
 }
 
@@ -37,12 +41,23 @@ device_memory::~device_memory()
   assert(shared_counter == 0);
 }
 
-void *device_memory::host_alloc(size_t size)
+void *device_memory::host_alloc(size_t size, bool &mapped)
 {
+  mapped = false;
+
   if (!size) {
     return 0;
   }
 
+  if (use_host_mapped) {
+    void *ptr = util_mapped_malloc(size, host_mapped_directory);
+    if (ptr) {
+      mapped = true;
+      return ptr;
+    }
+    /* Fall back to regular memory if the file could not be created. */
+  }
+
   void *ptr = util_aligned_malloc(size, MIN_ALIGNMENT_CPU_DATA_TYPES);
 
   if (ptr) {
@@ -58,10 +73,23 @@ void *device_memory::host_alloc(size_t size)
 void device_memory::host_free()
 {
   if (host_pointer) {
-    util_guarded_mem_free(memory_size());
-    util_aligned_free((void *)host_pointer);
+    if (host_mapped) {
+      util_mapped_free(host_pointer);
+    }
+    else {
+      util_guarded_mem_free(memory_size());
+      util_aligned_free((void *)host_pointer);
+    }
     host_pointer = 0;
   }
+  host_mapped = false;
+}
+
+void device_memory::set_host_mapped(bool use_host_mapped_, const string &directory)
+{
+  /* Existing allocations remain valid, mapped or not, until they are freed. */
+  use_host_mapped = use_host_mapped_;
+  host_mapped_directory = directory;
 }
 
 void device_memory::device_alloc()
@@ -167,6 +195,7 @@ device_texture::device_texture(Device *device,
     case IMAGE_DATA_TYPE_NANOVDB_FLOAT3:
     case IMAGE_DATA_TYPE_NANOVDB_FPN:
     case IMAGE_DATA_TYPE_NANOVDB_FP16:
+    case IMAGE_DATA_TYPE_TEXTURE_CACHE:
       data_type = TYPE_UCHAR;
       data_elements = 1;
       break;
@@ -211,7 +240,7 @@ void *device_texture::alloc(const size_t width, const size_t height, const size_
   if (new_size != data_size) {
     device_free();
     host_free();
-    host_pointer = host_alloc(data_elements * datatype_size(data_type) * new_size);
+    host_pointer = host_alloc(data_elements * datatype_size(data_type) * new_size, host_mapped);
     assert(device_pointer == 0);
   }
 
@@ -246,6 +246,10 @@ class device_memory {
 
   bool is_resident(Device *sub_device) const;
 
+  /* Allocate host memory in memory mapped files in the given directory, so that it does not
+   * need to stay resident in RAM. Only useful for devices that access host memory directly. */
+  void set_host_mapped(bool use_host_mapped, const string &directory = "");
+
  protected:
   friend class CUDADevice;
   friend class OptiXDevice;
@@ -267,8 +271,9 @@ class device_memory {
 
   /* Host allocation on the device. All host_pointer memory should be
    * allocated with these functions, for devices that support using
-   * the same pointer for host and device. */
-  void *host_alloc(size_t size);
+   * the same pointer for host and device. Sets mapped when the memory was allocated in a memory
+   * mapped file, which host_free() needs to know. */
+  void *host_alloc(size_t size, bool &mapped);
   void host_free();
 
   /* Device memory allocation and copying. */
@@ -285,6 +290,10 @@ class device_memory {
   Device *original_device;
   bool need_realloc_;
   bool modified;
+  bool use_host_mapped;
+  string host_mapped_directory;
+  /* The host pointer was allocated in a memory mapped file. */
+  bool host_mapped;
 };
 
 /* Device Only Memory
@@ -378,7 +387,7 @@ template<typename T> class device_vector : public device_memory {
     if (new_size != data_size) {
       device_free();
       host_free();
-      host_pointer = host_alloc(sizeof(T) * new_size);
+      host_pointer = host_alloc(sizeof(T) * new_size, host_mapped);
       modified = true;
       assert(device_pointer == 0);
     }
@@ -398,7 +407,8 @@ template<typename T> class device_vector : public device_memory {
     size_t new_size = size(width, height, depth);
 
     if (new_size != data_size) {
-      void *new_ptr = host_alloc(sizeof(T) * new_size);
+      bool new_ptr_mapped;
+      void *new_ptr = host_alloc(sizeof(T) * new_size, new_ptr_mapped);
 
       if (new_size && data_size) {
         size_t min_size = ((new_size < data_size) ? new_size : data_size);
@@ -408,6 +418,7 @@ template<typename T> class device_vector : public device_memory {
       device_free();
       host_free();
       host_pointer = new_ptr;
+      host_mapped = new_ptr_mapped;
       assert(device_pointer == 0);
     }
 
@@ -422,6 +433,19 @@ template<typename T> class device_vector : public device_memory {
   /* Take over data from an existing array. */
   void steal_data(array<T> &from)
   {
+    if (use_host_mapped) {
+      /* Copy into mapped memory instead, the array memory would be resident. */
+      device_free();
+      if (from.size()) {
+        memcpy(alloc(from.size()), from.data(), sizeof(T) * from.size());
+      }
+      else {
+        free();
+      }
+      from.clear();
+      return;
+    }
+
     device_free();
     host_free();
 
@@ -437,6 +461,14 @@ template<typename T> class device_vector : public device_memory {
   {
     device_free();
 
+    if (host_mapped) {
+      /* The array can not take over memory mapped files. */
+      to.resize(data_size);
+      memcpy(to.data(), host_pointer, sizeof(T) * data_size);
+      free();
+      return;
+    }
+
     to.set_data((T *)host_pointer, data_size);
     data_size = 0;
     data_width = 0;
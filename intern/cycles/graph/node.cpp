@@ -592,7 +592,7 @@ void float3_array_hash(const Node *node, const SocketType &socket, MD5Hash &md5)
 
 }  // namespace
 
-void Node::hash(MD5Hash &md5)
+void Node::hash(MD5Hash &md5, const bool use_node_sockets)
 {
   md5.append(type->name.string());
 
@@ -639,7 +639,9 @@ void Node::hash(MD5Hash &md5)
         value_hash<Transform>(this, socket, md5);
         break;
       case SocketType::NODE:
-        value_hash<void *>(this, socket, md5);
+        if (use_node_sockets) {
+          value_hash<void *>(this, socket, md5);
+        }
         break;
 
       case SocketType::BOOLEAN_ARRAY:
@@ -673,7 +675,9 @@ void Node::hash(MD5Hash &md5)
         array_hash<Transform>(this, socket, md5);
         break;
       case SocketType::NODE_ARRAY:
-        array_hash<void *>(this, socket, md5);
+        if (use_node_sockets) {
+          array_hash<void *>(this, socket, md5);
+        }
         break;
 
       case SocketType::UNDEFINED:
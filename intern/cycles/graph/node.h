@@ -154,8 +154,9 @@ struct Node {
   /* equals */
   bool equals(const Node &other) const;
 
-  /* compute hash of node and its socket values */
-  void hash(MD5Hash &md5);
+  /* compute hash of node and its socket values, optionally leaving out the nodes it refers to
+   * to compare with nodes of other scenes */
+  void hash(MD5Hash &md5, const bool use_node_sockets = true);
 
   /* Get total size of this node. */
   size_t get_total_size_in_bytes() const;
@@ -64,6 +64,46 @@ bool Denoiser::load_kernels(Progress *progress)
   return true;
 }
 
+bool Denoiser::denoise_buffer_rows(RenderBuffers *render_buffers,
+                                   const int y_begin,
+                                   const int y_end,
+                                   const int overlap)
+{
+  const BufferParams &params = render_buffers->params;
+
+  const int band_y = max(0, y_begin - overlap);
+  const int band_height = min(params.height, y_end + overlap) - band_y;
+
+  BufferParams band_params = params;
+  band_params.height = band_height;
+  band_params.full_y = params.full_y + band_y;
+  band_params.window_x = 0;
+  band_params.window_y = 0;
+  band_params.window_width = band_params.width;
+  band_params.window_height = band_params.height;
+  band_params.update_offset_stride();
+
+  const int64_t row_stride = int64_t(params.width) * params.pass_stride;
+
+  RenderBuffers band_buffers(render_buffers->buffer.device);
+  band_buffers.reset(band_params);
+  memcpy(band_buffers.buffer.data(),
+         render_buffers->buffer.data() + band_y * row_stride,
+         sizeof(float) * band_height * row_stride);
+  band_buffers.copy_to_device();
+
+  /* Number of samples doesn't matter too much, since the samples count pass will be used. */
+  const bool success = denoise_buffer(band_params, &band_buffers, 0, false);
+  band_buffers.copy_from_device();
+
+  /* Only copy the requested rows back, the neighbourhood rows are denoised on their own. */
+  memcpy(render_buffers->buffer.data() + y_begin * row_stride,
+         band_buffers.buffer.data() + (y_begin - band_y) * row_stride,
+         sizeof(float) * (y_end - y_begin) * row_stride);
+
+  return success;
+}
+
 Device *Denoiser::get_denoiser_device() const
 {
   return denoiser_device_;
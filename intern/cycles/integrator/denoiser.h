@@ -72,6 +72,15 @@ class Denoiser {
                               const int num_samples,
                               bool allow_inplace_modification) = 0;
 
+  /* Denoise rows [y_begin, y_end) of the entire buffer, leaving the other rows as they are.
+   *
+   * The rows are denoised in a separate buffer which also contains `overlap` rows around them,
+   * so that there are no seams between rows which are denoised separately. Noisy passes are not
+   * modified, so the neighbourhood of the rows which are denoised next is not affected.
+   *
+   * Returns the result of denoise_buffer() for the separate buffer. */
+  bool denoise_buffer_rows(RenderBuffers *render_buffers, int y_begin, int y_end, int overlap);
+
   /* Get a device which is used to perform actual denoising.
    *
    * Notes:
@@ -955,23 +955,52 @@ void PathTrace::process_full_buffer_from_disk(string_view filename)
   RenderBuffers full_frame_buffers(cpu_device_.get());
 
   DenoiseParams denoise_params;
-  if (!tile_manager_.read_full_buffer_from_disk(filename, &full_frame_buffers, &denoise_params)) {
-    const string error_message = "Error reading tiles from file";
-    if (progress_) {
-      progress_->set_error(error_message);
-      progress_->set_cancel(error_message);
+
+  /* Read the file on a separate thread, so that rows which are read together with their
+   * neighbourhood can be denoised while the rest of the file is still being read. */
+  struct {
+    thread_mutex mutex;
+    thread_condition_variable condition;
+    int num_rows_read = 0;
+    bool finished = false;
+    bool success = false;
+  } read_state;
+
+  thread read_thread([&]() {
+    const bool success = tile_manager_.read_full_buffer_from_disk(
+        filename, &full_frame_buffers, &denoise_params, [&](const int num_rows_read) {
+          {
+            thread_scoped_lock lock(read_state.mutex);
+            read_state.num_rows_read = num_rows_read;
+          }
+          read_state.condition.notify_all();
+        });
+
+    {
+      thread_scoped_lock lock(read_state.mutex);
+      read_state.finished = true;
+      read_state.success = success;
     }
-    else {
-      LOG(ERROR) << error_message;
+    read_state.condition.notify_all();
+  });
+
+  /* Wait for the given number of rows to be read, returns false if reading has failed. */
+  auto wait_for_rows = [&](const int num_rows) {
+    thread_scoped_lock lock(read_state.mutex);
+    while (read_state.num_rows_read < num_rows && !read_state.finished) {
+      read_state.condition.wait(lock);
     }
-    return;
-  }
+    return read_state.num_rows_read >= num_rows;
+  };
 
-  const string layer_view_name = get_layer_view_name(full_frame_buffers);
+  /* Buffer and denoise parameters are known once the first rows are read. */
+  bool success = wait_for_rows(1);
+
+  const string layer_view_name = success ? get_layer_view_name(full_frame_buffers) : "";
 
   render_state_.has_denoised_result = false;
 
-  if (denoise_params.use) {
+  if (success && denoise_params.use) {
     progress_set_status(layer_view_name, "Denoising");
 
     /* Re-use the denoiser as much as possible, avoiding possible device re-initialization.
@@ -982,10 +1011,42 @@ void PathTrace::process_full_buffer_from_disk(string_view filename)
      *    ensure proper denoiser is used. */
     set_denoiser_params(denoise_params);
 
-    /* Number of samples doesn't matter too much, since the samples count pass will be used. */
-    denoiser_->denoise_buffer(full_frame_buffers.params, &full_frame_buffers, 0, false);
+    const int height = full_frame_buffers.params.height;
 
-    render_state_.has_denoised_result = true;
+    for (int y = 0; y < height; y += FULL_FRAME_DENOISE_BAND_HEIGHT) {
+      const int y_end = min(y + FULL_FRAME_DENOISE_BAND_HEIGHT, height);
+
+      if (!wait_for_rows(min(y_end + FULL_FRAME_DENOISE_OVERLAP, height))) {
+        success = false;
+        break;
+      }
+
+      if (y == 0 && y_end == height) {
+        /* Number of samples doesn't matter too much, since the samples count pass will be used. */
+        denoiser_->denoise_buffer(full_frame_buffers.params, &full_frame_buffers, 0, false);
+      }
+      else {
+        denoiser_->denoise_buffer_rows(&full_frame_buffers, y, y_end, FULL_FRAME_DENOISE_OVERLAP);
+      }
+    }
+
+    render_state_.has_denoised_result = success;
+  }
+
+  read_thread.join();
+
+  if (!success || !read_state.success) {
+    render_state_.has_denoised_result = false;
+
+    const string error_message = "Error reading tiles from file";
+    if (progress_) {
+      progress_->set_error(error_message);
+      progress_->set_cancel(error_message);
+    }
+    else {
+      LOG(ERROR) << error_message;
+    }
+    return;
   }
 
   full_frame_state_.render_buffers = &full_frame_buffers;
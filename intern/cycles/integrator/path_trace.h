@@ -37,6 +37,14 @@ class TileManager;
  *  - Adaptive stopping. */
 class PathTrace {
  public:
+  /* Full-frame buffer which is read from disk is denoised in bands of rows of this height, so
+   * that denoising of the read rows overlaps with reading of the rest of the file. */
+  static const int FULL_FRAME_DENOISE_BAND_HEIGHT = 2048;
+
+  /* Number of rows around a band which the denoiser gets to see, so that there are no seams
+   * between the bands. */
+  static const int FULL_FRAME_DENOISE_OVERLAP = 128;
+
   /* Render scheduler is used to report timing information and access things like start/finish
    * sample. */
   PathTrace(Device *device,
@@ -14,12 +14,18 @@
 #include "scene/scene.h"
 #include "session/buffers.h"
 
+#include "util/algorithm.h"
 #include "util/atomic.h"
+#include "util/debug.h"
 #include "util/log.h"
 #include "util/tbb.h"
 
 CCL_NAMESPACE_BEGIN
 
+/* Number of pixels rendered together in a batch of the wavefront mode. Every pixel uses two path
+ * states, for the shadow catcher. */
+static const int CPU_WAVEFRONT_BATCH_SIZE = 64;
+
 /* Create TBB arena for execution of path tracing and rendering tasks. */
 static inline tbb::task_arena local_tbb_arena_create(const Device *device)
 {
@@ -72,31 +78,47 @@ void PathTraceWorkCPU::render_samples(RenderStatistics &statistics,
   }
 
   tbb::task_arena local_arena = local_tbb_arena_create(device_);
-  local_arena.execute([&]() {
-    parallel_for(int64_t(0), total_pixels_num, [&](int64_t work_index) {
-      if (is_cancel_requested()) {
-        return;
-      }
+  if (DebugFlags().cpu.wavefront) {
+    const int64_t batches_num = divide_up(total_pixels_num, CPU_WAVEFRONT_BATCH_SIZE);
+    local_arena.execute([&]() {
+      parallel_for(int64_t(0), batches_num, [&](int64_t batch_index) {
+        if (is_cancel_requested()) {
+          return;
+        }
 
-      const int y = work_index / image_width;
-      const int x = work_index - y * image_width;
+        const int64_t first_work_index = batch_index * CPU_WAVEFRONT_BATCH_SIZE;
+        const int num_pixels = std::min(int64_t(CPU_WAVEFRONT_BATCH_SIZE),
+                                        total_pixels_num - first_work_index);
 
-      KernelWorkTile work_tile;
-      work_tile.x = effective_buffer_params_.full_x + x;
-      work_tile.y = effective_buffer_params_.full_y + y;
-      work_tile.w = 1;
-      work_tile.h = 1;
-      work_tile.start_sample = start_sample;
-      work_tile.sample_offset = sample_offset;
-      work_tile.num_samples = 1;
-      work_tile.offset = effective_buffer_params_.offset;
-      work_tile.stride = effective_buffer_params_.stride;
+        CPUKernelThreadGlobals *kernel_globals = kernel_thread_globals_get(
+            kernel_thread_globals_);
 
-      CPUKernelThreadGlobals *kernel_globals = kernel_thread_globals_get(kernel_thread_globals_);
+        render_samples_wavefront(kernel_globals,
+                                 first_work_index,
+                                 num_pixels,
+                                 start_sample,
+                                 samples_num,
+                                 sample_offset);
+      });
+    });
+  }
+  else {
+    local_arena.execute([&]() {
+      parallel_for(int64_t(0), total_pixels_num, [&](int64_t work_index) {
+        if (is_cancel_requested()) {
+          return;
+        }
+
+        const KernelWorkTile work_tile = get_pixel_work_tile(
+            work_index, start_sample, sample_offset);
+
+        CPUKernelThreadGlobals *kernel_globals = kernel_thread_globals_get(
+            kernel_thread_globals_);
 
-      render_samples_full_pipeline(kernel_globals, work_tile, samples_num);
+        render_samples_full_pipeline(kernel_globals, work_tile, samples_num);
+      });
     });
-  });
+  }
   if (device_->profiler.active()) {
     for (CPUKernelThreadGlobals &kernel_globals : kernel_thread_globals_) {
       kernel_globals.stop_profiling();
@@ -153,6 +175,124 @@ void PathTraceWorkCPU::render_samples_full_pipeline(KernelGlobalsCPU *kernel_glo
   }
 }
 
+void PathTraceWorkCPU::render_samples_wavefront(KernelGlobalsCPU *kernel_globals,
+                                                const int64_t first_work_index,
+                                                const int num_pixels,
+                                                const int start_sample,
+                                                const int samples_num,
+                                                const int sample_offset)
+{
+  const bool has_bake = device_scene_->data.bake.use;
+  const bool has_shadow_catcher = device_scene_->data.integrator.has_shadow_catcher;
+
+  /* The shadow catcher state of a path directly follows its main state. */
+  unique_ptr<IntegratorStateCPU[]> &states = wavefront_states_.local();
+  if (!states) {
+    states.reset(new IntegratorStateCPU[CPU_WAVEFRONT_BATCH_SIZE * 2]);
+  }
+
+  const int num_states = num_pixels * 2;
+  for (int i = 0; i < num_states; i++) {
+    path_state_init_queues(&states[i]);
+  }
+
+  /* Pixels which were not stopped by the initialization kernel. */
+  bool pixel_active[CPU_WAVEFRONT_BATCH_SIZE];
+  std::fill(pixel_active, pixel_active + num_pixels, true);
+
+  /* Sort keys, with the kernel in the highest bits, the shader sort key in the middle, and the
+   * index of the state in the lowest bits. */
+  uint64_t keys[CPU_WAVEFRONT_BATCH_SIZE * 2];
+  IntegratorStateCPU *stage_states[CPU_WAVEFRONT_BATCH_SIZE * 2];
+
+  float *render_buffer = buffers_->buffer.data();
+
+  for (int sample = 0; sample < samples_num; ++sample) {
+    if (is_cancel_requested()) {
+      break;
+    }
+
+    bool any_pixel_active = false;
+    for (int i = 0; i < num_pixels; i++) {
+      if (!pixel_active[i]) {
+        continue;
+      }
+
+      KernelWorkTile work_tile = get_pixel_work_tile(
+          first_work_index + i, start_sample + sample, sample_offset);
+      IntegratorStateCPU *state = &states[i * 2];
+
+      pixel_active[i] = (has_bake) ? kernels_.integrator_init_from_bake(
+                                         kernel_globals, state, &work_tile, render_buffer) :
+                                     kernels_.integrator_init_from_camera(
+                                         kernel_globals, state, &work_tile, render_buffer);
+      any_pixel_active |= pixel_active[i];
+    }
+
+    if (!any_pixel_active) {
+      break;
+    }
+
+    /* Execute kernels until all paths are terminated. */
+    while (true) {
+      int num_keys = 0;
+      for (int i = 0; i < num_states; i++) {
+        if (!has_shadow_catcher && (i & 1)) {
+          continue;
+        }
+
+        const uint64_t queued_kernel = states[i].path.queued_kernel;
+        if (queued_kernel) {
+          const uint64_t sort_key = states[i].path.shader_sort_key;
+          keys[num_keys++] = (queued_kernel << 48) | ((sort_key & 0xffffffff) << 16) | i;
+        }
+      }
+
+      if (num_keys == 0) {
+        break;
+      }
+
+      std::sort(keys, keys + num_keys);
+
+      /* Execute each kernel for all the paths that queued it at once, in shader order. Closest
+       * rays are then traversed through the BVH as packets where they are coherent. */
+      for (int i = 0; i < num_keys;) {
+        const uint64_t queued_kernel = keys[i] >> 48;
+        int num_stage_states = 0;
+        while (i < num_keys && (keys[i] >> 48) == queued_kernel) {
+          stage_states[num_stage_states++] = &states[keys[i] & 0xffff];
+          i++;
+        }
+
+        kernels_.integrator_wavefront_stage(
+            kernel_globals, stage_states, num_stage_states, render_buffer);
+      }
+    }
+  }
+}
+
+KernelWorkTile PathTraceWorkCPU::get_pixel_work_tile(const int64_t work_index,
+                                                     const int start_sample,
+                                                     const int sample_offset) const
+{
+  const int64_t image_width = effective_buffer_params_.width;
+  const int y = work_index / image_width;
+  const int x = work_index - y * image_width;
+
+  KernelWorkTile work_tile;
+  work_tile.x = effective_buffer_params_.full_x + x;
+  work_tile.y = effective_buffer_params_.full_y + y;
+  work_tile.w = 1;
+  work_tile.h = 1;
+  work_tile.start_sample = start_sample;
+  work_tile.sample_offset = sample_offset;
+  work_tile.num_samples = 1;
+  work_tile.offset = effective_buffer_params_.offset;
+  work_tile.stride = effective_buffer_params_.stride;
+
+  return work_tile;
+}
+
 void PathTraceWorkCPU::copy_to_display(PathTraceDisplay *display,
                                        PassMode pass_mode,
                                        int num_samples)
@@ -10,6 +10,8 @@
 
 #include "integrator/path_trace_work.h"
 
+#include "util/tbb.h"
+#include "util/unique_ptr.h"
 #include "util/vector.h"
 
 CCL_NAMESPACE_BEGIN
@@ -56,6 +58,20 @@ class PathTraceWorkCPU : public PathTraceWork {
                                     const KernelWorkTile &work_tile,
                                     const int samples_num);
 
+  /* Path tracing routine of the wavefront mode. Renders the given range of pixels in a batch,
+   * executing one kernel of every path at a time, with the paths sorted by kernel and shader. */
+  void render_samples_wavefront(KernelGlobalsCPU *kernel_globals,
+                                const int64_t first_work_index,
+                                const int num_pixels,
+                                const int start_sample,
+                                const int samples_num,
+                                const int sample_offset);
+
+  /* Get work tile for a single pixel, indexed in the effective buffer. */
+  KernelWorkTile get_pixel_work_tile(const int64_t work_index,
+                                     const int start_sample,
+                                     const int sample_offset) const;
+
   /* CPU kernels. */
   const CPUKernels &kernels_;
 
@@ -65,6 +81,9 @@ class PathTraceWorkCPU : public PathTraceWork {
    * accessing it, but some "localization" is required to decouple from kernel globals stored
    * on the device level. */
   vector<CPUKernelThreadGlobals> kernel_thread_globals_;
+
+  /* Path states of a wavefront batch, allocated on first use by each thread. */
+  enumerable_thread_specific<unique_ptr<IntegratorStateCPU[]>> wavefront_states_;
 };
 
 CCL_NAMESPACE_END
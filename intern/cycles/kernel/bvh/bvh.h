@@ -100,6 +100,62 @@ ccl_device_intersect bool scene_intersect(KernelGlobals kg,
   return bvh_intersect(kg, ray, isect, visibility);
 }
 
+/* Packet traversal of coherent rays, on the CPU. */
+
+#  ifndef __KERNEL_GPU__
+#    define __BVH_PACKET__
+#    include "kernel/bvh/packet.h"
+
+/* Intersect up to BVH_PACKET_SIZE rays with the scene. Rays which are coherent and have the same
+ * visibility are traversed as a packet, the others one by one. */
+ccl_device_intersect void scene_intersect_packet(KernelGlobals kg,
+                                                 ccl_private const Ray *rays,
+                                                 ccl_private const uint *visibility,
+                                                 ccl_private Intersection *isects,
+                                                 ccl_private bool *hits,
+                                                 const int num_rays)
+{
+  kernel_assert(num_rays <= BVH_PACKET_SIZE);
+
+  uint packet_mask = 0;
+  bool use_packet = (num_rays >= BVH_PACKET_MIN_RAYS);
+#    ifdef __EMBREE__
+  use_packet &= !kernel_data.device_bvh;
+#    endif
+  use_packet &= !kernel_data.bvh.have_motion && !kernel_data.bvh.have_curves;
+
+  if (use_packet) {
+    int first_ray = -1;
+    for (int i = 0; i < num_rays; i++) {
+      if (!intersection_ray_valid(&rays[i])) {
+        continue;
+      }
+      if (first_ray == -1) {
+        first_ray = i;
+      }
+      if (visibility[i] == visibility[first_ray]) {
+        packet_mask |= (1u << i);
+      }
+    }
+
+    packet_mask = bvh_packet_coherent_mask(rays, packet_mask);
+    if (popcount(packet_mask) >= BVH_PACKET_MIN_RAYS) {
+      bvh_intersect_packet(kg, rays, isects, hits, packet_mask, visibility[first_ray]);
+    }
+    else {
+      packet_mask = 0;
+    }
+  }
+
+  /* Fall back to single ray traversal for the remaining rays. */
+  for (int i = 0; i < num_rays; i++) {
+    if (!(packet_mask & (1u << i))) {
+      hits[i] = scene_intersect(kg, &rays[i], visibility[i], &isects[i]);
+    }
+  }
+}
+#  endif /* __KERNEL_GPU__ */
+
 /* Single object BVH traversal, for SSS/AO/bevel. */
 
 #  ifdef __BVH_LOCAL__
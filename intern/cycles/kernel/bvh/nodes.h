@@ -15,6 +15,45 @@ ccl_device_forceinline Transform bvh_unaligned_node_fetch_space(KernelGlobals kg
   return space;
 }
 
+/* Decode child bounds along one axis of a quantized node, stored as 8-bit offsets from the
+ * origin of the node in steps of a power of two scale. */
+ccl_device_forceinline float4 bvh_quantized_node_decode(const float origin,
+                                                        const uint exponent,
+                                                        const uint qbounds)
+{
+  const float scale = __uint_as_float(exponent << 23);
+  return make_float4(origin) + make_float4((float)(qbounds & 0xff),
+                                           (float)((qbounds >> 8) & 0xff),
+                                           (float)((qbounds >> 16) & 0xff),
+                                           (float)(qbounds >> 24)) *
+                                   scale;
+}
+
+/* Fetch the bounds of both children of an aligned node, one float4 per axis with the minimum
+ * of both children followed by the maximum of both children. */
+ccl_device_forceinline void bvh_aligned_node_fetch_bounds(KernelGlobals kg,
+                                                          const int node_addr,
+                                                          ccl_private float4 *node0,
+                                                          ccl_private float4 *node1,
+                                                          ccl_private float4 *node2)
+{
+  if (kernel_data.bvh.use_quantized_nodes) {
+    const float4 origin = kernel_data_fetch(bvh_nodes, node_addr + 1);
+    const float4 qbounds = kernel_data_fetch(bvh_nodes, node_addr + 2);
+    const uint exponents = __float_as_uint(origin.w);
+    *node0 = bvh_quantized_node_decode(origin.x, exponents & 0xff, __float_as_uint(qbounds.x));
+    *node1 = bvh_quantized_node_decode(
+        origin.y, (exponents >> 8) & 0xff, __float_as_uint(qbounds.y));
+    *node2 = bvh_quantized_node_decode(
+        origin.z, (exponents >> 16) & 0xff, __float_as_uint(qbounds.z));
+  }
+  else {
+    *node0 = kernel_data_fetch(bvh_nodes, node_addr + 1);
+    *node1 = kernel_data_fetch(bvh_nodes, node_addr + 2);
+    *node2 = kernel_data_fetch(bvh_nodes, node_addr + 3);
+  }
+}
+
 ccl_device_forceinline int bvh_aligned_node_intersect(KernelGlobals kg,
                                                       const float3 P,
                                                       const float3 idir,
@@ -29,9 +68,8 @@ ccl_device_forceinline int bvh_aligned_node_intersect(KernelGlobals kg,
 #ifdef __VISIBILITY_FLAG__
   float4 cnodes = kernel_data_fetch(bvh_nodes, node_addr + 0);
 #endif
-  float4 node0 = kernel_data_fetch(bvh_nodes, node_addr + 1);
-  float4 node1 = kernel_data_fetch(bvh_nodes, node_addr + 2);
-  float4 node2 = kernel_data_fetch(bvh_nodes, node_addr + 3);
+  float4 node0, node1, node2;
+  bvh_aligned_node_fetch_bounds(kg, node_addr, &node0, &node1, &node2);
 
   /* intersect ray against child nodes */
   float c0lox = (node0.x - P.x) * idir.x;
@@ -52,15 +90,19 @@ ccl_device_forceinline int bvh_aligned_node_intersect(KernelGlobals kg,
   float c1min = max4(tmin, min(c1lox, c1hix), min(c1loy, c1hiy), min(c1loz, c1hiz));
   float c1max = min4(tmax, max(c1lox, c1hix), max(c1loy, c1hiy), max(c1loz, c1hiz));
 
+  /* Children with inverted bounds are empty, quantized nodes store empty children this way. */
+  const bool c0hit = (c0max >= c0min) && (node0.x <= node0.z);
+  const bool c1hit = (c1max >= c1min) && (node0.y <= node0.w);
+
   dist[0] = c0min;
   dist[1] = c1min;
 
 #ifdef __VISIBILITY_FLAG__
   /* this visibility test gives a 5% performance hit, how to solve? */
-  return (((c0max >= c0min) && (__float_as_uint(cnodes.x) & visibility)) ? 1 : 0) |
-         (((c1max >= c1min) && (__float_as_uint(cnodes.y) & visibility)) ? 2 : 0);
+  return ((c0hit && (__float_as_uint(cnodes.x) & visibility)) ? 1 : 0) |
+         ((c1hit && (__float_as_uint(cnodes.y) & visibility)) ? 2 : 0);
 #else
-  return ((c0max >= c0min) ? 1 : 0) | ((c1max >= c1min) ? 2 : 0);
+  return (c0hit ? 1 : 0) | (c1hit ? 2 : 0);
 #endif
 }
 
@@ -0,0 +1,415 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+/* Packet BVH Traversal
+ *
+ * Coherent rays, like camera rays of neighboring pixels, mostly visit the same nodes of the BVH.
+ * A packet of rays is traversed together, with a mask of the rays that are still active in the
+ * current subtree, and the node bounds are tested against all rays of the packet at once. With
+ * AVX this is done for eight rays with a single instruction per bounding plane.
+ *
+ * Primitives in leaves are intersected ray by ray with the regular intersection functions. Only
+ * aligned nodes are supported, scenes with hair or motion blur use single ray traversal. */
+
+#define BVH_PACKET_SIZE 8
+
+/* Traverse single rays when fewer rays remain in a packet. */
+#define BVH_PACKET_MIN_RAYS 3
+
+/* Ray data in the current space of the traversal, in structure of arrays layout. */
+typedef struct BVHPacket {
+  ccl_align(32) float P[3][BVH_PACKET_SIZE];
+  ccl_align(32) float idir[3][BVH_PACKET_SIZE];
+  ccl_align(32) float tmin[BVH_PACKET_SIZE];
+  ccl_align(32) float tmax[BVH_PACKET_SIZE];
+} BVHPacket;
+
+typedef struct BVHPacketStackItem {
+  int node_addr;
+  uint mask;
+} BVHPacketStackItem;
+
+ccl_device_inline void bvh_packet_set_ray(ccl_private BVHPacket *packet,
+                                          const int i,
+                                          const float3 P,
+                                          const float3 idir)
+{
+  packet->P[0][i] = P.x;
+  packet->P[1][i] = P.y;
+  packet->P[2][i] = P.z;
+  packet->idir[0][i] = idir.x;
+  packet->idir[1][i] = idir.y;
+  packet->idir[2][i] = idir.z;
+}
+
+/* Intersect the active rays of the packet with both children of the node. Returns the masks of
+ * rays hitting each child, and the distances to the children. */
+ccl_device_forceinline void bvh_packet_aligned_node_intersect(KernelGlobals kg,
+                                                              ccl_private const BVHPacket *packet,
+                                                              const int node_addr,
+                                                              const uint visibility,
+                                                              const uint mask,
+                                                              ccl_private uint *r_mask0,
+                                                              ccl_private uint *r_mask1,
+                                                              float dist0[BVH_PACKET_SIZE],
+                                                              float dist1[BVH_PACKET_SIZE])
+{
+  const float4 cnodes = kernel_data_fetch(bvh_nodes, node_addr + 0);
+  float4 node0, node1, node2;
+  bvh_aligned_node_fetch_bounds(kg, node_addr, &node0, &node1, &node2);
+
+#ifdef __KERNEL_AVX__
+  const avxf Px(_mm256_load_ps(packet->P[0]));
+  const avxf Py(_mm256_load_ps(packet->P[1]));
+  const avxf Pz(_mm256_load_ps(packet->P[2]));
+  const avxf idirx(_mm256_load_ps(packet->idir[0]));
+  const avxf idiry(_mm256_load_ps(packet->idir[1]));
+  const avxf idirz(_mm256_load_ps(packet->idir[2]));
+  const avxf tmin(_mm256_load_ps(packet->tmin));
+  const avxf tmax(_mm256_load_ps(packet->tmax));
+
+  const avxf c0lox = (avxf(node0.x) - Px) * idirx;
+  const avxf c0hix = (avxf(node0.z) - Px) * idirx;
+  const avxf c0loy = (avxf(node1.x) - Py) * idiry;
+  const avxf c0hiy = (avxf(node1.z) - Py) * idiry;
+  const avxf c0loz = (avxf(node2.x) - Pz) * idirz;
+  const avxf c0hiz = (avxf(node2.z) - Pz) * idirz;
+  const avxf c0min = max(max(tmin, min(c0lox, c0hix)), max(min(c0loy, c0hiy), min(c0loz, c0hiz)));
+  const avxf c0max = min(min(tmax, max(c0lox, c0hix)), min(max(c0loy, c0hiy), max(c0loz, c0hiz)));
+
+  const avxf c1lox = (avxf(node0.y) - Px) * idirx;
+  const avxf c1hix = (avxf(node0.w) - Px) * idirx;
+  const avxf c1loy = (avxf(node1.y) - Py) * idiry;
+  const avxf c1hiy = (avxf(node1.w) - Py) * idiry;
+  const avxf c1loz = (avxf(node2.y) - Pz) * idirz;
+  const avxf c1hiz = (avxf(node2.w) - Pz) * idirz;
+  const avxf c1min = max(max(tmin, min(c1lox, c1hix)), max(min(c1loy, c1hiy), min(c1loz, c1hiz)));
+  const avxf c1max = min(min(tmax, max(c1lox, c1hix)), min(max(c1loy, c1hiy), max(c1loz, c1hiz)));
+
+  _mm256_storeu_ps(dist0, c0min);
+  _mm256_storeu_ps(dist1, c1min);
+
+  uint mask0 = movemask(c0min <= c0max) & mask;
+  uint mask1 = movemask(c1min <= c1max) & mask;
+#else
+  uint mask0 = 0;
+  uint mask1 = 0;
+
+  for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+    const float Px = packet->P[0][i], Py = packet->P[1][i], Pz = packet->P[2][i];
+    const float idirx = packet->idir[0][i], idiry = packet->idir[1][i],
+                idirz = packet->idir[2][i];
+
+    const float c0lox = (node0.x - Px) * idirx;
+    const float c0hix = (node0.z - Px) * idirx;
+    const float c0loy = (node1.x - Py) * idiry;
+    const float c0hiy = (node1.z - Py) * idiry;
+    const float c0loz = (node2.x - Pz) * idirz;
+    const float c0hiz = (node2.z - Pz) * idirz;
+    const float c0min = max4(
+        packet->tmin[i], min(c0lox, c0hix), min(c0loy, c0hiy), min(c0loz, c0hiz));
+    const float c0max = min4(
+        packet->tmax[i], max(c0lox, c0hix), max(c0loy, c0hiy), max(c0loz, c0hiz));
+
+    const float c1lox = (node0.y - Px) * idirx;
+    const float c1hix = (node0.w - Px) * idirx;
+    const float c1loy = (node1.y - Py) * idiry;
+    const float c1hiy = (node1.w - Py) * idiry;
+    const float c1loz = (node2.y - Pz) * idirz;
+    const float c1hiz = (node2.w - Pz) * idirz;
+    const float c1min = max4(
+        packet->tmin[i], min(c1lox, c1hix), min(c1loy, c1hiy), min(c1loz, c1hiz));
+    const float c1max = min4(
+        packet->tmax[i], max(c1lox, c1hix), max(c1loy, c1hiy), max(c1loz, c1hiz));
+
+    dist0[i] = c0min;
+    dist1[i] = c1min;
+    mask0 |= (c0max >= c0min) ? (1u << i) : 0;
+    mask1 |= (c1max >= c1min) ? (1u << i) : 0;
+  }
+
+  mask0 &= mask;
+  mask1 &= mask;
+#endif
+
+  /* Children with inverted bounds are empty, see #bvh_aligned_node_intersect. */
+  if (node0.x > node0.z) {
+    mask0 = 0;
+  }
+  if (node0.y > node0.w) {
+    mask1 = 0;
+  }
+
+#ifdef __VISIBILITY_FLAG__
+  if (!(__float_as_uint(cnodes.x) & visibility)) {
+    mask0 = 0;
+  }
+  if (!(__float_as_uint(cnodes.y) & visibility)) {
+    mask1 = 0;
+  }
+#else
+  (void)cnodes;
+  (void)visibility;
+#endif
+
+  *r_mask0 = mask0;
+  *r_mask1 = mask1;
+}
+
+/* Intersect the rays in the mask with the scene, all with the same visibility. The result of
+ * each ray is the same as with single ray traversal. */
+ccl_device_noinline void bvh_intersect_packet(KernelGlobals kg,
+                                              ccl_private const Ray *rays,
+                                              ccl_private Intersection *isects,
+                                              ccl_private bool *hits,
+                                              const uint packet_mask,
+                                              const uint visibility)
+{
+  BVHPacketStackItem traversal_stack[BVH_STACK_SIZE];
+  traversal_stack[0].node_addr = ENTRYPOINT_SENTINEL;
+  traversal_stack[0].mask = 0;
+
+  int stack_ptr = 0;
+  int node_addr = kernel_data.bvh.root;
+  uint mask = packet_mask;
+  /* Rays which found an opaque shadow hit and need no further traversal. */
+  uint done_mask = 0;
+
+  /* Ray data, in the space of the current instance. */
+  BVHPacket packet;
+  float3 P[BVH_PACKET_SIZE];
+  float3 dir[BVH_PACKET_SIZE];
+  float3 idir[BVH_PACKET_SIZE];
+  int object = OBJECT_NONE;
+
+  for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+    if (packet_mask & (1u << i)) {
+      P[i] = rays[i].P;
+      dir[i] = bvh_clamp_direction(rays[i].D);
+      idir[i] = bvh_inverse_direction(dir[i]);
+      packet.tmin[i] = rays[i].tmin;
+      packet.tmax[i] = rays[i].tmax;
+
+      isects[i].t = rays[i].tmax;
+      isects[i].u = 0.0f;
+      isects[i].v = 0.0f;
+      isects[i].prim = PRIM_NONE;
+      isects[i].object = OBJECT_NONE;
+    }
+    else {
+      /* Never intersects anything. */
+      P[i] = zero_float3();
+      dir[i] = make_float3(0.0f, 0.0f, 1.0f);
+      idir[i] = make_float3(0.0f, 0.0f, 1.0f);
+      packet.tmin[i] = FLT_MAX;
+      packet.tmax[i] = -FLT_MAX;
+    }
+    bvh_packet_set_ray(&packet, i, P[i], idir[i]);
+  }
+
+  /* traversal loop */
+  do {
+    do {
+      /* traverse internal nodes */
+      while (node_addr >= 0 && node_addr != ENTRYPOINT_SENTINEL) {
+        mask &= ~done_mask;
+
+        uint mask0, mask1;
+        float dist0[BVH_PACKET_SIZE], dist1[BVH_PACKET_SIZE];
+        bvh_packet_aligned_node_intersect(
+            kg, &packet, node_addr, visibility, mask, &mask0, &mask1, dist0, dist1);
+
+        const float4 cnodes = kernel_data_fetch(bvh_nodes, node_addr + 0);
+        int node_addr_child0 = __float_as_int(cnodes.z);
+        int node_addr_child1 = __float_as_int(cnodes.w);
+
+        if (mask0 && mask1) {
+          /* Both children were intersected, push the farther one. The order is decided by the
+           * first ray intersecting both children, if any. */
+          const uint mask_both = mask0 & mask1;
+          const int i = count_trailing_zeros((mask_both) ? mask_both : mask0);
+          if (mask_both && dist1[i] < dist0[i]) {
+            int tmp = node_addr_child0;
+            node_addr_child0 = node_addr_child1;
+            node_addr_child1 = tmp;
+            uint tmp_mask = mask0;
+            mask0 = mask1;
+            mask1 = tmp_mask;
+          }
+
+          ++stack_ptr;
+          kernel_assert(stack_ptr < BVH_STACK_SIZE);
+          traversal_stack[stack_ptr].node_addr = node_addr_child1;
+          traversal_stack[stack_ptr].mask = mask1;
+
+          node_addr = node_addr_child0;
+          mask = mask0;
+        }
+        else if (mask0) {
+          node_addr = node_addr_child0;
+          mask = mask0;
+        }
+        else if (mask1) {
+          node_addr = node_addr_child1;
+          mask = mask1;
+        }
+        else {
+          /* Neither child was intersected. */
+          node_addr = traversal_stack[stack_ptr].node_addr;
+          mask = traversal_stack[stack_ptr].mask;
+          --stack_ptr;
+        }
+      }
+
+      /* if node is leaf, fetch triangle list */
+      if (node_addr < 0) {
+        float4 leaf = kernel_data_fetch(bvh_leaf_nodes, (-node_addr - 1));
+        int prim_addr = __float_as_int(leaf.x);
+
+        if (prim_addr >= 0) {
+          const int prim_addr2 = __float_as_int(leaf.y);
+          const uint type = __float_as_int(leaf.w);
+          const uint leaf_mask = mask & ~done_mask;
+
+          /* pop */
+          node_addr = traversal_stack[stack_ptr].node_addr;
+          mask = traversal_stack[stack_ptr].mask;
+          --stack_ptr;
+
+          /* primitive intersection */
+          for (; prim_addr < prim_addr2; prim_addr++) {
+            kernel_assert(kernel_data_fetch(prim_type, prim_addr) == type);
+
+            const int prim_object = (object == OBJECT_NONE) ?
+                                        kernel_data_fetch(prim_object, prim_addr) :
+                                        object;
+            const int prim = kernel_data_fetch(prim_index, prim_addr);
+
+            for (uint ray_mask = leaf_mask & ~done_mask; ray_mask; ray_mask &= ray_mask - 1) {
+              const int i = count_trailing_zeros(ray_mask);
+              if (intersection_skip_self_shadow(rays[i].self, prim_object, prim)) {
+                continue;
+              }
+
+              bool hit = false;
+              switch (type & PRIMITIVE_ALL) {
+                case PRIMITIVE_TRIANGLE: {
+                  hit = triangle_intersect(kg,
+                                           &isects[i],
+                                           P[i],
+                                           dir[i],
+                                           packet.tmin[i],
+                                           isects[i].t,
+                                           visibility,
+                                           prim_object,
+                                           prim,
+                                           prim_addr);
+                  break;
+                }
+#ifdef __POINTCLOUD__
+                case PRIMITIVE_POINT: {
+                  const int point_type = kernel_data_fetch(prim_type, prim_addr);
+                  hit = point_intersect(kg,
+                                        &isects[i],
+                                        P[i],
+                                        dir[i],
+                                        packet.tmin[i],
+                                        isects[i].t,
+                                        prim_object,
+                                        prim,
+                                        rays[i].time,
+                                        point_type);
+                  break;
+                }
+#endif /* __POINTCLOUD__ */
+                default:
+                  kernel_assert(0);
+                  break;
+              }
+
+              if (hit) {
+                packet.tmax[i] = isects[i].t;
+                /* shadow ray early termination */
+                if (visibility & PATH_RAY_SHADOW_OPAQUE) {
+                  done_mask |= (1u << i);
+                }
+              }
+            }
+          }
+
+          if (done_mask == packet_mask) {
+            break;
+          }
+        }
+        else {
+          /* instance push */
+          object = kernel_data_fetch(prim_object, -prim_addr - 1);
+
+          for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+            if (packet_mask & (1u << i)) {
+              bvh_instance_push(kg, object, &rays[i], &P[i], &dir[i], &idir[i]);
+              bvh_packet_set_ray(&packet, i, P[i], idir[i]);
+            }
+          }
+
+          ++stack_ptr;
+          kernel_assert(stack_ptr < BVH_STACK_SIZE);
+          traversal_stack[stack_ptr].node_addr = ENTRYPOINT_SENTINEL;
+          traversal_stack[stack_ptr].mask = 0;
+
+          node_addr = kernel_data_fetch(object_node, object);
+        }
+      }
+    } while (node_addr != ENTRYPOINT_SENTINEL);
+
+    if (done_mask == packet_mask) {
+      break;
+    }
+
+    if (stack_ptr >= 0) {
+      kernel_assert(object != OBJECT_NONE);
+
+      /* instance pop */
+      for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+        if (packet_mask & (1u << i)) {
+          bvh_instance_pop(&rays[i], &P[i], &dir[i], &idir[i]);
+          bvh_packet_set_ray(&packet, i, P[i], idir[i]);
+        }
+      }
+
+      object = OBJECT_NONE;
+      node_addr = traversal_stack[stack_ptr].node_addr;
+      mask = traversal_stack[stack_ptr].mask;
+      --stack_ptr;
+    }
+  } while (node_addr != ENTRYPOINT_SENTINEL);
+
+  for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+    if (packet_mask & (1u << i)) {
+      hits[i] = (isects[i].prim != PRIM_NONE);
+    }
+  }
+}
+
+/* Find the rays which are coherent with the first ray in the mask. Rays with directions in the
+ * same octant mostly visit the nodes in the same order. */
+ccl_device_inline uint bvh_packet_coherent_mask(ccl_private const Ray *rays, const uint mask)
+{
+  if (!mask) {
+    return 0;
+  }
+
+  const float3 D = rays[count_trailing_zeros(mask)].D;
+  uint coherent_mask = 0;
+
+  for (uint ray_mask = mask; ray_mask; ray_mask &= ray_mask - 1) {
+    const int i = count_trailing_zeros(ray_mask);
+    const float3 Di = rays[i].D;
+    if ((Di.x < 0.0f) == (D.x < 0.0f) && (Di.y < 0.0f) == (D.y < 0.0f) &&
+        (Di.z < 0.0f) == (D.z < 0.0f)) {
+      coherent_mask |= (1u << i);
+    }
+  }
+
+  return coherent_mask;
+}
@@ -52,7 +52,7 @@ KERNEL_STRUCT_MEMBER(bvh, int, have_curves)
 KERNEL_STRUCT_MEMBER(bvh, int, bvh_layout)
 KERNEL_STRUCT_MEMBER(bvh, int, use_bvh_steps)
 KERNEL_STRUCT_MEMBER(bvh, int, curve_subdivisions)
-KERNEL_STRUCT_MEMBER(bvh, int, pad1)
+KERNEL_STRUCT_MEMBER(bvh, int, use_quantized_nodes)
 KERNEL_STRUCT_MEMBER(bvh, int, pad2)
 KERNEL_STRUCT_END(KernelBVH)
 
@@ -148,6 +148,11 @@ KERNEL_STRUCT_MEMBER(integrator, int, num_all_lights)
 KERNEL_STRUCT_MEMBER(integrator, float, pdf_triangles)
 KERNEL_STRUCT_MEMBER(integrator, float, pdf_lights)
 KERNEL_STRUCT_MEMBER(integrator, float, light_inv_rr_threshold)
+/* Light tree. */
+KERNEL_STRUCT_MEMBER(integrator, int, use_light_tree)
+KERNEL_STRUCT_MEMBER(integrator, int, light_tree_num_emitters)
+KERNEL_STRUCT_MEMBER(integrator, int, light_tree_num_distant)
+KERNEL_STRUCT_MEMBER(integrator, float, light_tree_distant_probability)
 /* Bounces. */
 KERNEL_STRUCT_MEMBER(integrator, int, min_bounce)
 KERNEL_STRUCT_MEMBER(integrator, int, max_bounce)
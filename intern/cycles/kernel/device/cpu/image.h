@@ -9,6 +9,8 @@
 #  include <nanovdb/util/SampleFromVoxels.h>
 #endif
 
+#include "util/texture_cache.h"
+
 CCL_NAMESPACE_BEGIN
 
 /* Make template functions private so symbols don't conflict between kernels with different
@@ -729,6 +731,132 @@ template<typename TexT, typename OutT = float4> struct NanoVDBInterpolator {
 };
 #endif
 
+/* Images read from disk one tile at a time, with optional mip levels. Cubic interpolation is
+ * not supported, linear interpolation is used instead. */
+struct TextureCacheInterpolator {
+  static ccl_always_inline float4 interp_closest(TextureCacheImage &image,
+                                                 const int level,
+                                                 const uint extension,
+                                                 float x,
+                                                 float y)
+  {
+    const int width = image.levels[level].width;
+    const int height = image.levels[level].height;
+    int ix, iy;
+    frac(x * (float)width, &ix);
+    frac(y * (float)height, &iy);
+    switch (extension) {
+      case EXTENSION_REPEAT:
+        ix = TextureInterpolator<float4>::wrap_periodic(ix, width);
+        iy = TextureInterpolator<float4>::wrap_periodic(iy, height);
+        break;
+      case EXTENSION_CLIP:
+        if (ix < 0 || ix >= width || iy < 0 || iy >= height) {
+          return zero_float4();
+        }
+        break;
+      case EXTENSION_EXTEND:
+        ix = TextureInterpolator<float4>::wrap_clamp(ix, width);
+        iy = TextureInterpolator<float4>::wrap_clamp(iy, height);
+        break;
+      default:
+        kernel_assert(0);
+        return zero_float4();
+    }
+
+    return image.texel(level, ix, iy);
+  }
+
+  static ccl_always_inline float4
+  read_clip(TextureCacheImage &image, const int level, int x, int y, int width, int height)
+  {
+    if (x < 0 || x >= width || y < 0 || y >= height) {
+      return zero_float4();
+    }
+    return image.texel(level, x, y);
+  }
+
+  static ccl_always_inline float4 interp_linear(TextureCacheImage &image,
+                                                const int level,
+                                                const uint extension,
+                                                float x,
+                                                float y)
+  {
+    const int width = image.levels[level].width;
+    const int height = image.levels[level].height;
+
+    /* A -0.5 offset is used to center the linear samples around the sample point. */
+    int ix, iy;
+    int nix, niy;
+    const float tx = frac(x * (float)width - 0.5f, &ix);
+    const float ty = frac(y * (float)height - 0.5f, &iy);
+
+    switch (extension) {
+      case EXTENSION_REPEAT:
+        ix = TextureInterpolator<float4>::wrap_periodic(ix, width);
+        nix = TextureInterpolator<float4>::wrap_periodic(ix + 1, width);
+
+        iy = TextureInterpolator<float4>::wrap_periodic(iy, height);
+        niy = TextureInterpolator<float4>::wrap_periodic(iy + 1, height);
+        break;
+      case EXTENSION_CLIP:
+        /* No linear samples are inside the clip region. */
+        if (ix < -1 || ix >= width || iy < -1 || iy >= height) {
+          return zero_float4();
+        }
+        nix = ix + 1;
+        niy = iy + 1;
+        break;
+      case EXTENSION_EXTEND:
+        nix = TextureInterpolator<float4>::wrap_clamp(ix + 1, width);
+        ix = TextureInterpolator<float4>::wrap_clamp(ix, width);
+        niy = TextureInterpolator<float4>::wrap_clamp(iy + 1, height);
+        iy = TextureInterpolator<float4>::wrap_clamp(iy, height);
+        break;
+      default:
+        kernel_assert(0);
+        return zero_float4();
+    }
+
+    return (1.0f - ty) * (1.0f - tx) * read_clip(image, level, ix, iy, width, height) +
+           (1.0f - ty) * tx * read_clip(image, level, nix, iy, width, height) +
+           ty * (1.0f - tx) * read_clip(image, level, ix, niy, width, height) +
+           ty * tx * read_clip(image, level, nix, niy, width, height);
+  }
+
+  /* The level is picked from the texture coordinate differentials, so that a texel of the level
+   * covers about the footprint of the lookup. */
+  static ccl_always_inline float4
+  interp(const TextureInfo &info, float x, float y, float2 duv_dx, float2 duv_dy)
+  {
+    TextureCacheImage &image = **(TextureCacheImage **)info.data;
+    const int num_levels = image.levels.size();
+
+    float lod = 0.0f;
+    if (num_levels > 1) {
+      const float2 size = make_float2((float)image.levels[0].width,
+                                      (float)image.levels[0].height);
+      const float footprint = max(len(duv_dx * size), len(duv_dy * size));
+      if (footprint > 1.0f) {
+        lod = min(log2f(footprint), (float)(num_levels - 1));
+      }
+    }
+
+    if (info.interpolation == INTERPOLATION_CLOSEST) {
+      return interp_closest(image, (int)(lod + 0.5f), info.extension, x, y);
+    }
+
+    /* Trilinear interpolation between the two nearest levels. */
+    const int level = (int)lod;
+    const float t = lod - (float)level;
+    float4 r = interp_linear(image, level, info.extension, x, y);
+    if (t > 0.0f) {
+      r = (1.0f - t) * r + t * interp_linear(image, level + 1, info.extension, x, y);
+    }
+    return r;
+  }
+};
+
 #undef SET_CUBIC_SPLINE_WEIGHTS
 
 ccl_device float4 kernel_tex_image_interp(KernelGlobals kg, int id, float x, float y)
@@ -764,6 +892,8 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals kg, int id, float x, flo
       return TextureInterpolator<ushort4>::interp(info, x, y);
     case IMAGE_DATA_TYPE_FLOAT4:
       return TextureInterpolator<float4>::interp(info, x, y);
+    case IMAGE_DATA_TYPE_TEXTURE_CACHE:
+      return TextureCacheInterpolator::interp(info, x, y, zero_float2(), zero_float2());
     default:
       assert(0);
       return make_float4(
@@ -771,6 +901,19 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals kg, int id, float x, flo
   }
 }
 
+/* Lookup with the differentials of the texture coordinates, for picking a mip level. */
+ccl_device float4 kernel_tex_image_interp_mip(
+    KernelGlobals kg, int id, float x, float y, float2 duv_dx, float2 duv_dy)
+{
+  const TextureInfo &info = kernel_data_fetch(texture_info, id);
+
+  if (info.data && info.data_type == IMAGE_DATA_TYPE_TEXTURE_CACHE) {
+    return TextureCacheInterpolator::interp(info, x, y, duv_dx, duv_dy);
+  }
+
+  return kernel_tex_image_interp(kg, id, x, y);
+}
+
 ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals kg,
                                              int id,
                                              float3 P,
@@ -22,6 +22,12 @@
                                                     KernelWorkTile *tile, \
                                                     ccl_global float *render_buffer)
 
+#define KERNEL_INTEGRATOR_PACKET_FUNCTION(name) \
+  void KERNEL_FUNCTION_FULL_NAME(integrator_##name)(const KernelGlobalsCPU *ccl_restrict kg, \
+                                                    IntegratorStateCPU **states, \
+                                                    const int num_states, \
+                                                    ccl_global float *render_buffer)
+
 KERNEL_INTEGRATOR_INIT_FUNCTION(init_from_camera);
 KERNEL_INTEGRATOR_INIT_FUNCTION(init_from_bake);
 KERNEL_INTEGRATOR_SHADE_FUNCTION(intersect_closest);
@@ -34,10 +40,12 @@ KERNEL_INTEGRATOR_SHADE_FUNCTION(shade_shadow);
 KERNEL_INTEGRATOR_SHADE_FUNCTION(shade_surface);
 KERNEL_INTEGRATOR_SHADE_FUNCTION(shade_volume);
 KERNEL_INTEGRATOR_SHADE_FUNCTION(megakernel);
+KERNEL_INTEGRATOR_PACKET_FUNCTION(wavefront_stage);
 
 #undef KERNEL_INTEGRATOR_FUNCTION
 #undef KERNEL_INTEGRATOR_INIT_FUNCTION
 #undef KERNEL_INTEGRATOR_SHADE_FUNCTION
+#undef KERNEL_INTEGRATOR_PACKET_FUNCTION
 
 #define KERNEL_FILM_CONVERT_FUNCTION(name) \
   void KERNEL_FUNCTION_FULL_NAME(film_convert_##name)(const KernelFilmConvert *kfilm_convert, \
@@ -97,6 +97,15 @@ CCL_NAMESPACE_BEGIN
     KERNEL_INVOKE(name, kg, &state->shadow, render_buffer); \
   }
 
+#define DEFINE_INTEGRATOR_PACKET_KERNEL(name) \
+  void KERNEL_FUNCTION_FULL_NAME(integrator_##name)(const KernelGlobalsCPU *kg, \
+                                                    IntegratorStateCPU **states, \
+                                                    const int num_states, \
+                                                    ccl_global float *render_buffer) \
+  { \
+    KERNEL_INVOKE(name, kg, states, num_states, render_buffer); \
+  }
+
 DEFINE_INTEGRATOR_INIT_KERNEL(init_from_camera)
 DEFINE_INTEGRATOR_INIT_KERNEL(init_from_bake)
 DEFINE_INTEGRATOR_SHADE_KERNEL(intersect_closest)
@@ -107,6 +116,7 @@ DEFINE_INTEGRATOR_SHADE_KERNEL(shade_light)
 DEFINE_INTEGRATOR_SHADE_KERNEL(shade_surface)
 DEFINE_INTEGRATOR_SHADE_KERNEL(shade_volume)
 DEFINE_INTEGRATOR_SHADE_KERNEL(megakernel)
+DEFINE_INTEGRATOR_PACKET_KERNEL(wavefront_stage)
 DEFINE_INTEGRATOR_SHADOW_KERNEL(intersect_shadow)
 DEFINE_INTEGRATOR_SHADOW_SHADE_KERNEL(shade_shadow)
 
@@ -302,6 +312,7 @@ KERNEL_FILM_CONVERT_FUNCTION(float4, false)
 #undef DEFINE_INTEGRATOR_KERNEL
 #undef DEFINE_INTEGRATOR_SHADE_KERNEL
 #undef DEFINE_INTEGRATOR_INIT_KERNEL
+#undef DEFINE_INTEGRATOR_PACKET_KERNEL
 
 #undef KERNEL_STUB
 #undef STUB_ASSERT
@@ -211,6 +211,13 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals kg, int id, float x, flo
   }
 }
 
+/* Mip levels are only used by the texture cache on the CPU. */
+ccl_device float4 kernel_tex_image_interp_mip(
+    KernelGlobals kg, int id, float x, float y, float2 /*duv_dx*/, float2 /*duv_dy*/)
+{
+  return kernel_tex_image_interp(kg, id, x, y);
+}
+
 ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals kg,
                                              int id,
                                              float3 P,
@@ -181,6 +181,13 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals, int id, float x, float
   }
 }
 
+/* Mip levels are only used by the texture cache on the CPU. */
+ccl_device float4 kernel_tex_image_interp_mip(
+    KernelGlobals kg, int id, float x, float y, float2 /*duv_dx*/, float2 /*duv_dy*/)
+{
+  return kernel_tex_image_interp(kg, id, x, y);
+}
+
 #ifdef WITH_NANOVDB
 template<typename T> struct NanoVDBInterpolator {
 
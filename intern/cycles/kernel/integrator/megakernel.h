@@ -16,14 +16,12 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device void integrator_megakernel(KernelGlobals kg,
-                                      IntegratorState state,
-                                      ccl_global float *ccl_restrict render_buffer)
+/* Execute shadow and AO paths of the state until they are done. */
+ccl_device void integrator_megakernel_shadow_paths(KernelGlobals kg,
+                                                   IntegratorState state,
+                                                   ccl_global float *ccl_restrict render_buffer)
 {
-  /* Each kernel indicates the next kernel to execute, so here we simply
-   * have to check what that kernel is and execute it. */
   while (true) {
-    /* Handle any shadow paths before we potentially create more shadow paths. */
     const uint32_t shadow_queued_kernel = INTEGRATOR_STATE(
         &state->shadow, shadow_path, queued_kernel);
     if (shadow_queued_kernel) {
@@ -41,7 +39,6 @@ ccl_device void integrator_megakernel(KernelGlobals kg,
       continue;
     }
 
-    /* Handle any AO paths before we potentially create more AO paths. */
     const uint32_t ao_queued_kernel = INTEGRATOR_STATE(&state->ao, shadow_path, queued_kernel);
     if (ao_queued_kernel) {
       switch (ao_queued_kernel) {
@@ -58,46 +55,173 @@ ccl_device void integrator_megakernel(KernelGlobals kg,
       continue;
     }
 
-    /* Then handle regular path kernels. */
-    const uint32_t queued_kernel = INTEGRATOR_STATE(state, path, queued_kernel);
-    if (queued_kernel) {
-      switch (queued_kernel) {
-        case DEVICE_KERNEL_INTEGRATOR_INTERSECT_CLOSEST:
-          integrator_intersect_closest(kg, state, render_buffer);
-          break;
-        case DEVICE_KERNEL_INTEGRATOR_SHADE_BACKGROUND:
-          integrator_shade_background(kg, state, render_buffer);
-          break;
-        case DEVICE_KERNEL_INTEGRATOR_SHADE_SURFACE:
-          integrator_shade_surface(kg, state, render_buffer);
-          break;
-        case DEVICE_KERNEL_INTEGRATOR_SHADE_VOLUME:
-          integrator_shade_volume(kg, state, render_buffer);
-          break;
-        case DEVICE_KERNEL_INTEGRATOR_SHADE_SURFACE_RAYTRACE:
-          integrator_shade_surface_raytrace(kg, state, render_buffer);
-          break;
-        case DEVICE_KERNEL_INTEGRATOR_SHADE_SURFACE_MNEE:
-          integrator_shade_surface_mnee(kg, state, render_buffer);
-          break;
-        case DEVICE_KERNEL_INTEGRATOR_SHADE_LIGHT:
-          integrator_shade_light(kg, state, render_buffer);
-          break;
-        case DEVICE_KERNEL_INTEGRATOR_INTERSECT_SUBSURFACE:
-          integrator_intersect_subsurface(kg, state);
-          break;
-        case DEVICE_KERNEL_INTEGRATOR_INTERSECT_VOLUME_STACK:
-          integrator_intersect_volume_stack(kg, state);
-          break;
-        default:
-          kernel_assert(0);
-          break;
+    break;
+  }
+}
+
+/* Execute the queued kernel of the main path. Returns false when the path is terminated. */
+ccl_device bool integrator_megakernel_path_step(KernelGlobals kg,
+                                                IntegratorState state,
+                                                ccl_global float *ccl_restrict render_buffer)
+{
+  const uint32_t queued_kernel = INTEGRATOR_STATE(state, path, queued_kernel);
+  switch (queued_kernel) {
+    case 0:
+      return false;
+    case DEVICE_KERNEL_INTEGRATOR_INTERSECT_CLOSEST:
+      integrator_intersect_closest(kg, state, render_buffer);
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_BACKGROUND:
+      integrator_shade_background(kg, state, render_buffer);
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_SURFACE:
+      integrator_shade_surface(kg, state, render_buffer);
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_VOLUME:
+      integrator_shade_volume(kg, state, render_buffer);
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_SURFACE_RAYTRACE:
+      integrator_shade_surface_raytrace(kg, state, render_buffer);
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_SURFACE_MNEE:
+      integrator_shade_surface_mnee(kg, state, render_buffer);
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_LIGHT:
+      integrator_shade_light(kg, state, render_buffer);
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_INTERSECT_SUBSURFACE:
+      integrator_intersect_subsurface(kg, state);
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_INTERSECT_VOLUME_STACK:
+      integrator_intersect_volume_stack(kg, state);
+      break;
+    default:
+      kernel_assert(0);
+      break;
+  }
+  return true;
+}
+
+ccl_device void integrator_megakernel(KernelGlobals kg,
+                                      IntegratorState state,
+                                      ccl_global float *ccl_restrict render_buffer)
+{
+  /* Each kernel indicates the next kernel to execute, so here we simply
+   * have to check what that kernel is and execute it. Handle any shadow paths
+   * before we potentially create more shadow paths. */
+  do {
+    integrator_megakernel_shadow_paths(kg, state, render_buffer);
+  } while (integrator_megakernel_path_step(kg, state, render_buffer));
+}
+
+/* Execute the shadow and AO paths of a batch of states until they are done, one kernel at a time
+ * for all of them. */
+ccl_device void integrator_wavefront_shadow_stages(KernelGlobals kg,
+                                                   IntegratorState *states,
+                                                   const int num_states,
+                                                   ccl_global float *ccl_restrict render_buffer)
+{
+  while (true) {
+    bool any_queued = false;
+
+    for (int i = 0; i < num_states; i++) {
+      if (INTEGRATOR_STATE(&states[i]->shadow, shadow_path, queued_kernel) ==
+          DEVICE_KERNEL_INTEGRATOR_INTERSECT_SHADOW) {
+        integrator_intersect_shadow(kg, &states[i]->shadow);
+      }
+      if (INTEGRATOR_STATE(&states[i]->ao, shadow_path, queued_kernel) ==
+          DEVICE_KERNEL_INTEGRATOR_INTERSECT_SHADOW) {
+        integrator_intersect_shadow(kg, &states[i]->ao);
       }
-      continue;
     }
 
-    break;
+    for (int i = 0; i < num_states; i++) {
+      if (INTEGRATOR_STATE(&states[i]->shadow, shadow_path, queued_kernel) ==
+          DEVICE_KERNEL_INTEGRATOR_SHADE_SHADOW) {
+        integrator_shade_shadow(kg, &states[i]->shadow, render_buffer);
+      }
+      if (INTEGRATOR_STATE(&states[i]->ao, shadow_path, queued_kernel) ==
+          DEVICE_KERNEL_INTEGRATOR_SHADE_SHADOW) {
+        integrator_shade_shadow(kg, &states[i]->ao, render_buffer);
+      }
+
+      any_queued |= INTEGRATOR_STATE(&states[i]->shadow, shadow_path, queued_kernel) ||
+                    INTEGRATOR_STATE(&states[i]->ao, shadow_path, queued_kernel);
+    }
+
+    if (!any_queued) {
+      break;
+    }
   }
 }
 
+/* Execute the queued kernel of the main path for a batch of states that all have the same
+ * queued kernel, and then the shadow paths they created.
+ *
+ * Used by the CPU wavefront, which executes paths one kernel at a time, and sorts them by their
+ * next kernel and shader in between for coherence. */
+ccl_device void integrator_wavefront_stage(KernelGlobals kg,
+                                           IntegratorState *states,
+                                           const int num_states,
+                                           ccl_global float *ccl_restrict render_buffer)
+{
+  const uint32_t queued_kernel = INTEGRATOR_STATE(states[0], path, queued_kernel);
+  switch (queued_kernel) {
+    case DEVICE_KERNEL_INTEGRATOR_INTERSECT_CLOSEST:
+#ifdef __BVH_PACKET__
+      integrator_intersect_closest_packet(kg, states, num_states, render_buffer);
+#else
+      for (int i = 0; i < num_states; i++) {
+        integrator_intersect_closest(kg, states[i], render_buffer);
+      }
+#endif
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_BACKGROUND:
+      for (int i = 0; i < num_states; i++) {
+        integrator_shade_background(kg, states[i], render_buffer);
+      }
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_SURFACE:
+      for (int i = 0; i < num_states; i++) {
+        integrator_shade_surface(kg, states[i], render_buffer);
+      }
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_VOLUME:
+      for (int i = 0; i < num_states; i++) {
+        integrator_shade_volume(kg, states[i], render_buffer);
+      }
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_SURFACE_RAYTRACE:
+      for (int i = 0; i < num_states; i++) {
+        integrator_shade_surface_raytrace(kg, states[i], render_buffer);
+      }
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_SURFACE_MNEE:
+      for (int i = 0; i < num_states; i++) {
+        integrator_shade_surface_mnee(kg, states[i], render_buffer);
+      }
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_SHADE_LIGHT:
+      for (int i = 0; i < num_states; i++) {
+        integrator_shade_light(kg, states[i], render_buffer);
+      }
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_INTERSECT_SUBSURFACE:
+      for (int i = 0; i < num_states; i++) {
+        integrator_intersect_subsurface(kg, states[i]);
+      }
+      break;
+    case DEVICE_KERNEL_INTEGRATOR_INTERSECT_VOLUME_STACK:
+      for (int i = 0; i < num_states; i++) {
+        integrator_intersect_volume_stack(kg, states[i]);
+      }
+      break;
+    default:
+      kernel_assert(0);
+      break;
+  }
+
+  integrator_wavefront_shadow_stages(kg, states, num_states, render_buffer);
+}
+
 CCL_NAMESPACE_END
@@ -111,10 +111,12 @@ ccl_device_inline float mat22_inverse(const float4 m, ccl_private float4 &m_inve
 /* Update light sample */
 ccl_device_forceinline void mnee_update_light_sample(KernelGlobals kg,
                                                      const float3 P,
+                                                     const float3 P_select,
                                                      ccl_private LightSample *ls)
 {
   /* correct light sample position/direction and pdf
-   * NOTE: preserve pdf in area measure */
+   * NOTE: preserve pdf in area measure
+   * P_select is the shading point the light was selected from */
   const ccl_global KernelLight *klight = &kernel_data_fetch(lights, ls->lamp);
 
   if (ls->type == LIGHT_POINT || ls->type == LIGHT_SPOT) {
@@ -147,7 +149,7 @@ ccl_device_forceinline void mnee_update_light_sample(KernelGlobals kg,
     }
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= light_distribution_pdf_lamp(kg, P_select, ls->lamp);
 }
 
 /* Manifold vertex setup from ray and intersection data */
@@ -811,7 +813,7 @@ ccl_device_forceinline bool mnee_path_contribution(KernelGlobals kg,
 
   /* Update light sample with new position / direct.ion
    * and keep pdf in vertex area measure */
-  mnee_update_light_sample(kg, vertices[vertex_count - 1].p, ls);
+  mnee_update_light_sample(kg, vertices[vertex_count - 1].p, sd->P, ls);
 
   /* Save state path bounce info in case a light path node is used in the refractive interface or
    * light shader graph. */
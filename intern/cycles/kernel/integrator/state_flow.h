@@ -145,7 +145,8 @@ ccl_device_forceinline void integrator_path_init_sorted(KernelGlobals kg,
                                                         const uint32_t key)
 {
   INTEGRATOR_STATE_WRITE(state, path, queued_kernel) = next_kernel;
-  (void)key;
+  /* Used for sorting paths by shader in the CPU wavefront. */
+  INTEGRATOR_STATE_WRITE(state, path, shader_sort_key) = key;
 }
 
 ccl_device_forceinline void integrator_path_next(KernelGlobals kg,
@@ -172,7 +173,7 @@ ccl_device_forceinline void integrator_path_next_sorted(KernelGlobals kg,
                                                         const uint32_t key)
 {
   INTEGRATOR_STATE_WRITE(state, path, queued_kernel) = next_kernel;
-  (void)key;
+  INTEGRATOR_STATE_WRITE(state, path, shader_sort_key) = key;
   (void)current_kernel;
 }
 
@@ -5,6 +5,7 @@
 
 #include "kernel/geom/geom.h"
 #include "kernel/light/background.h"
+#include "kernel/light/tree.h"
 #include "kernel/sample/mapping.h"
 
 CCL_NAMESPACE_BEGIN
@@ -27,6 +28,20 @@ typedef struct LightSample {
   LightType type; /* type of light */
 } LightSample;
 
+/* Probability of selecting the lamp for next event estimation from shading point P. */
+ccl_device_inline float light_distribution_pdf_lamp(KernelGlobals kg,
+                                                    const float3 P,
+                                                    const int lamp)
+{
+  if (kernel_data.integrator.use_light_tree) {
+    /* Lamps are stored after the triangles in the distribution. */
+    const int num_triangles = kernel_data.integrator.num_distribution -
+                              kernel_data.integrator.num_all_lights;
+    return light_tree_pdf(kg, P, num_triangles + lamp);
+  }
+  return kernel_data.integrator.pdf_lights;
+}
+
 /* Regular Light */
 
 template<bool in_volume_segment>
@@ -36,6 +51,7 @@ ccl_device_inline bool light_sample(KernelGlobals kg,
                                     const float randv,
                                     const float3 P,
                                     const uint32_t path_flag,
+                                    const float pdf_lights,
                                     ccl_private LightSample *ls)
 {
   const ccl_global KernelLight *klight = &kernel_data_fetch(lights, lamp);
@@ -222,7 +238,7 @@ ccl_device_inline bool light_sample(KernelGlobals kg,
     }
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= pdf_lights;
 
   return in_volume_segment || (ls->pdf > 0.0f);
 }
@@ -428,7 +444,7 @@ ccl_device bool light_sample_from_distant_ray(KernelGlobals kg,
   float invarea = klight->distant.invarea;
   ls->pdf = invarea / (costheta * costheta * costheta);
   ls->eval_fac = ls->pdf;
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= light_distant_pdf(kg);
 
   return true;
 }
@@ -557,7 +573,7 @@ ccl_device bool light_sample_from_intersection(KernelGlobals kg,
     return false;
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= light_distribution_pdf_lamp(kg, ray_P, lamp);
 
   return true;
 }
@@ -594,12 +610,73 @@ ccl_device_inline bool triangle_world_space_vertices(
   return has_motion;
 }
 
+/* Area of the triangle the selection probability of the light tree is relative to. */
+ccl_device_inline float triangle_light_area(KernelGlobals kg, int object, int prim)
+{
+  float3 V[3];
+  triangle_world_space_vertices(kg, object, prim, -1.0f, V);
+  return triangle_area(V[0], V[1], V[2]);
+}
+
+/* Find the triangle in the light distribution, triangles are sorted by object and primitive. */
+ccl_device int light_distribution_triangle_index(KernelGlobals kg, int object, int prim)
+{
+  const int num_triangles = kernel_data.integrator.num_distribution -
+                            kernel_data.integrator.num_all_lights;
+  int first = 0;
+  int len = num_triangles;
+
+  while (len > 0) {
+    const int half_len = len >> 1;
+    const int middle = first + half_len;
+    ccl_global const KernelLightDistribution *kdistribution = &kernel_data_fetch(
+        light_distribution, middle);
+    const int middle_object = kdistribution->mesh_light.object_id;
+
+    if (middle_object < object || (middle_object == object && kdistribution->prim < prim)) {
+      first = middle + 1;
+      len = len - half_len - 1;
+    }
+    else {
+      len = half_len;
+    }
+  }
+
+  if (first < num_triangles) {
+    ccl_global const KernelLightDistribution *kdistribution = &kernel_data_fetch(
+        light_distribution, first);
+    if (kdistribution->mesh_light.object_id == object && kdistribution->prim == prim) {
+      return first;
+    }
+  }
+  return -1;
+}
+
+/* Probability density of selecting the triangle for next event estimation from shading point
+ * P, over the area of the triangle. */
+ccl_device_inline float light_distribution_pdf_triangles(KernelGlobals kg,
+                                                         const float3 P,
+                                                         int object,
+                                                         int prim)
+{
+  if (kernel_data.integrator.use_light_tree) {
+    const int index = light_distribution_triangle_index(kg, object, prim);
+    if (index == -1) {
+      return 0.0f;
+    }
+    const float area = triangle_light_area(kg, object, prim);
+    return (area > 0.0f) ? light_tree_pdf(kg, P, index) / area : 0.0f;
+  }
+  return kernel_data.integrator.pdf_triangles;
+}
+
 ccl_device_inline float triangle_light_pdf_area(KernelGlobals kg,
+                                                const float pdf_triangles,
                                                 const float3 Ng,
                                                 const float3 I,
                                                 float t)
 {
-  float pdf = kernel_data.integrator.pdf_triangles;
+  float pdf = pdf_triangles;
   float cos_pi = fabsf(dot(Ng, I));
 
   if (cos_pi == 0.0f)
@@ -616,6 +693,14 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals kg,
    * and simple area sampling, comparing the distance to the triangle plane
    * to the length of the edges of the triangle. */
 
+  /* sd contains the point on the light source
+   * calculate Px, the point that we're shading */
+  const float3 Px = sd->P + sd->I * t;
+  const float pdf_triangles = light_distribution_pdf_triangles(kg, Px, sd->object, sd->prim);
+  if (pdf_triangles == 0.0f) {
+    return 0.0f;
+  }
+
   float3 V[3];
   bool has_motion = triangle_world_space_vertices(kg, sd->object, sd->prim, sd->time, V);
 
@@ -627,9 +712,6 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals kg,
   const float distance_to_plane = fabsf(dot(N, sd->I * t)) / dot(N, N);
 
   if (longest_edge_squared > distance_to_plane * distance_to_plane) {
-    /* sd contains the point on the light source
-     * calculate Px, the point that we're shading */
-    const float3 Px = sd->P + sd->I * t;
     const float3 v0_p = V[0] - Px;
     const float3 v1_p = V[1] - Px;
     const float3 v2_p = V[2] - Px;
@@ -657,12 +739,12 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals kg,
       else {
         area = 0.5f * len(N);
       }
-      const float pdf = area * kernel_data.integrator.pdf_triangles;
+      const float pdf = area * pdf_triangles;
       return pdf / solid_angle;
     }
   }
   else {
-    float pdf = triangle_light_pdf_area(kg, sd->Ng, sd->I, t);
+    float pdf = triangle_light_pdf_area(kg, pdf_triangles, sd->Ng, sd->I, t);
     if (has_motion) {
       const float area = 0.5f * len(N);
       if (UNLIKELY(area == 0.0f)) {
@@ -687,7 +769,8 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals kg,
                                                   float randv,
                                                   float time,
                                                   ccl_private LightSample *ls,
-                                                  const float3 P)
+                                                  const float3 P,
+                                                  const float pdf_triangles)
 {
   /* A naive heuristic to decide between costly solid angle sampling
    * and simple area sampling, comparing the distance to the triangle plane
@@ -801,7 +884,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals kg,
         triangle_world_space_vertices(kg, object, prim, -1.0f, V);
         area = triangle_area(V[0], V[1], V[2]);
       }
-      const float pdf = area * kernel_data.integrator.pdf_triangles;
+      const float pdf = area * pdf_triangles;
       ls->pdf = pdf / solid_angle;
     }
   }
@@ -823,7 +906,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals kg,
     ls->P = u * V[0] + v * V[1] + t * V[2];
     /* compute incoming direction, distance and pdf */
     ls->D = normalize_len(ls->P - P, &ls->t);
-    ls->pdf = triangle_light_pdf_area(kg, ls->Ng, -ls->D, ls->t);
+    ls->pdf = triangle_light_pdf_area(kg, pdf_triangles, ls->Ng, -ls->D, ls->t);
     if (has_motion && area != 0.0f) {
       /* scale the PDF.
        * area = the area the sample was taken from
@@ -882,18 +965,20 @@ ccl_device_inline bool light_select_reached_max_bounces(KernelGlobals kg, int in
   return (bounce > kernel_data_fetch(lights, index).max_bounces);
 }
 
+/* Sample the light at the index in the light distribution. The probability of selecting it is
+ * given per unit of area for triangles, and as probability for lamps. */
 template<bool in_volume_segment>
-ccl_device_noinline bool light_distribution_sample(KernelGlobals kg,
-                                                   float randu,
-                                                   const float randv,
-                                                   const float time,
-                                                   const float3 P,
-                                                   const int bounce,
-                                                   const uint32_t path_flag,
-                                                   ccl_private LightSample *ls)
+ccl_device_inline bool light_distribution_sample_index(KernelGlobals kg,
+                                                       const int index,
+                                                       const float pdf_selection,
+                                                       float randu,
+                                                       const float randv,
+                                                       const float time,
+                                                       const float3 P,
+                                                       const int bounce,
+                                                       const uint32_t path_flag,
+                                                       ccl_private LightSample *ls)
 {
-  /* Sample light index from distribution. */
-  const int index = light_distribution_sample(kg, &randu);
   ccl_global const KernelLightDistribution *kdistribution = &kernel_data_fetch(light_distribution,
                                                                                index);
   const int prim = kdistribution->prim;
@@ -909,7 +994,8 @@ ccl_device_noinline bool light_distribution_sample(KernelGlobals kg,
     }
 
     const int shader_flag = kdistribution->mesh_light.shader_flag;
-    triangle_light_sample<in_volume_segment>(kg, prim, object, randu, randv, time, ls, P);
+    triangle_light_sample<in_volume_segment>(
+        kg, prim, object, randu, randv, time, ls, P, pdf_selection);
     ls->shader |= shader_flag;
     return (ls->pdf > 0.0f);
   }
@@ -920,7 +1006,59 @@ ccl_device_noinline bool light_distribution_sample(KernelGlobals kg,
     return false;
   }
 
-  return light_sample<in_volume_segment>(kg, lamp, randu, randv, P, path_flag, ls);
+  return light_sample<in_volume_segment>(kg, lamp, randu, randv, P, path_flag, pdf_selection, ls);
+}
+
+template<bool in_volume_segment>
+ccl_device_noinline bool light_distribution_sample(KernelGlobals kg,
+                                                   float randu,
+                                                   const float randv,
+                                                   const float time,
+                                                   const float3 P,
+                                                   const int bounce,
+                                                   const uint32_t path_flag,
+                                                   ccl_private LightSample *ls)
+{
+  /* Sample light index from distribution. */
+  const int index = light_distribution_sample(kg, &randu);
+  const float pdf_selection = (kernel_data_fetch(light_distribution, index).prim >= 0) ?
+                                  kernel_data.integrator.pdf_triangles :
+                                  kernel_data.integrator.pdf_lights;
+
+  return light_distribution_sample_index<in_volume_segment>(
+      kg, index, pdf_selection, randu, randv, time, P, bounce, path_flag, ls);
+}
+
+ccl_device_noinline bool light_tree_sample_from_position(KernelGlobals kg,
+                                                         float randu,
+                                                         const float randv,
+                                                         const float time,
+                                                         const float3 P,
+                                                         const int bounce,
+                                                         const uint32_t path_flag,
+                                                         ccl_private LightSample *ls)
+{
+  /* Sample light index from the tree. */
+  float pdf_selection;
+  const int index = light_tree_sample(kg, P, &randu, &pdf_selection);
+  if (index == -1) {
+    return false;
+  }
+
+  ccl_global const KernelLightDistribution *kdistribution = &kernel_data_fetch(light_distribution,
+                                                                               index);
+  if (kdistribution->prim >= 0) {
+    /* Triangles are sampled relative to their area. */
+    const float area = triangle_light_area(
+        kg, kdistribution->mesh_light.object_id, kdistribution->prim);
+    if (area == 0.0f) {
+      return false;
+    }
+    pdf_selection /= area;
+  }
+
+  return light_distribution_sample_index<false>(
+      kg, index, pdf_selection, randu, randv, time, P, bounce, path_flag, ls);
 }
 
 ccl_device_inline bool light_distribution_sample_from_volume_segment(KernelGlobals kg,
@@ -932,6 +1070,8 @@ ccl_device_inline bool light_distribution_sample_from_volume_segment(KernelGloba
                                                                      const uint32_t path_flag,
                                                                      ccl_private LightSample *ls)
 {
+  /* The light tree is not used here, the light is only used to find a scatter position in the
+   * volume, and gets sampled again from that position. */
   return light_distribution_sample<true>(kg, randu, randv, time, P, bounce, path_flag, ls);
 }
 
@@ -944,6 +1084,9 @@ ccl_device_inline bool light_distribution_sample_from_position(KernelGlobals kg,
                                                                const uint32_t path_flag,
                                                                ccl_private LightSample *ls)
 {
+  if (kernel_data.integrator.use_light_tree) {
+    return light_tree_sample_from_position(kg, randu, randv, time, P, bounce, path_flag, ls);
+  }
   return light_distribution_sample<false>(kg, randu, randv, time, P, bounce, path_flag, ls);
 }
 
@@ -956,11 +1099,20 @@ ccl_device_inline bool light_distribution_sample_new_position(KernelGlobals kg,
 {
   /* Sample a new position on the same light, for volume sampling. */
   if (ls->type == LIGHT_TRIANGLE) {
-    triangle_light_sample<false>(kg, ls->prim, ls->object, randu, randv, time, ls, P);
+    triangle_light_sample<false>(kg,
+                                 ls->prim,
+                                 ls->object,
+                                 randu,
+                                 randv,
+                                 time,
+                                 ls,
+                                 P,
+                                 light_distribution_pdf_triangles(kg, P, ls->object, ls->prim));
     return (ls->pdf > 0.0f);
   }
   else {
-    return light_sample<false>(kg, ls->lamp, randu, randv, P, 0, ls);
+    return light_sample<false>(
+        kg, ls->lamp, randu, randv, P, 0, light_distribution_pdf_lamp(kg, P, ls->lamp), ls);
   }
 }
 
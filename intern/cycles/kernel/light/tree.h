@@ -0,0 +1,250 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+/* Light Tree
+ *
+ * Emissive triangles and lamps are grouped in a binary tree, and a light to sample is found by
+ * walking down the tree, choosing between the children proportional to their importance for the
+ * shading point. The importance is estimated from the energy, the position bounds and the
+ * orientation bounds of the emitters, as described in:
+ *
+ * Alejandro Conty Estevez and Christopher Kulla.
+ * Importance Sampling of Many Lights with Adaptive Tree Splitting.
+ *
+ * Distant and background lights have no position, they are kept out of the tree and are
+ * selected uniformly with a fixed probability. */
+
+#pragma once
+
+CCL_NAMESPACE_BEGIN
+
+ccl_device float light_tree_importance(const float3 P,
+                                       const float3 centroid,
+                                       const float radius,
+                                       const float3 axis,
+                                       const float theta_o,
+                                       const float theta_e,
+                                       const float energy)
+{
+  if (energy == 0.0f) {
+    return 0.0f;
+  }
+
+  float distance;
+  const float3 centroid_to_P = safe_normalize_len(P - centroid, &distance);
+
+  /* Half of the angle subtended by the bounds, as seen from the shading point. */
+  const float theta_u = (distance > radius) ? safe_asinf(radius / distance) : M_PI_F;
+
+  /* Smallest angle between the emission directions and the direction to the shading point. */
+  const float theta = safe_acosf(dot(axis, centroid_to_P));
+  const float theta_prime = fmaxf(theta - theta_o - theta_u, 0.0f);
+  if (theta_prime >= theta_e) {
+    return 0.0f;
+  }
+
+  /* Clamp the distance, the importance would go to infinity close to the emitters. */
+  const float distance_squared = fmaxf(distance * distance, radius * radius);
+  return energy * cosf(theta_prime) / fmaxf(distance_squared, 1e-8f);
+}
+
+ccl_device_inline float light_tree_node_importance(KernelGlobals kg,
+                                                   const float3 P,
+                                                   const int node_index)
+{
+  ccl_global const KernelLightTreeNode *knode = &kernel_data_fetch(light_tree_nodes, node_index);
+  return light_tree_importance(
+      P,
+      make_float3(knode->centroid[0], knode->centroid[1], knode->centroid[2]),
+      knode->radius,
+      make_float3(knode->axis[0], knode->axis[1], knode->axis[2]),
+      knode->theta_o,
+      knode->theta_e,
+      knode->energy);
+}
+
+ccl_device_inline float light_tree_emitter_importance(KernelGlobals kg,
+                                                      const float3 P,
+                                                      const int emitter_index)
+{
+  ccl_global const KernelLightTreeEmitter *kemitter = &kernel_data_fetch(light_tree_emitters,
+                                                                        emitter_index);
+  return light_tree_importance(
+      P,
+      make_float3(kemitter->centroid[0], kemitter->centroid[1], kemitter->centroid[2]),
+      kemitter->radius,
+      make_float3(kemitter->axis[0], kemitter->axis[1], kemitter->axis[2]),
+      kemitter->theta_o,
+      kemitter->theta_e,
+      kemitter->energy);
+}
+
+/* Pick a light for the shading point P. Returns the index of the light in the light
+ * distribution and the probability of picking it, or -1 when no light can contribute.
+ * The random number is rescaled, so that it can be reused for sampling the light. */
+ccl_device int light_tree_sample(KernelGlobals kg,
+                                 const float3 P,
+                                 ccl_private float *randu,
+                                 ccl_private float *pdf)
+{
+  float r = *randu;
+  *pdf = 1.0f;
+
+  /* Distant and background lights. */
+  const int num_distant = kernel_data.integrator.light_tree_num_distant;
+  const float distant_probability = kernel_data.integrator.light_tree_distant_probability;
+  const int num_emitters = kernel_data.integrator.light_tree_num_emitters;
+
+  if (r < distant_probability) {
+    r /= distant_probability;
+    const int distant = min((int)(r * num_distant), num_distant - 1);
+    *randu = r * num_distant - distant;
+    *pdf = distant_probability / num_distant;
+    return kernel_data_fetch(light_tree_emitters, num_emitters + distant).distribution_index;
+  }
+
+  if (distant_probability > 0.0f) {
+    r = (r - distant_probability) / (1.0f - distant_probability);
+    *pdf = 1.0f - distant_probability;
+  }
+
+  /* Walk down to a leaf. */
+  int node_index = 0;
+  ccl_global const KernelLightTreeNode *knode = &kernel_data_fetch(light_tree_nodes, node_index);
+
+  while (knode->num_emitters == 0) {
+    const int left_index = node_index + 1;
+    const int right_index = knode->child_index;
+    const float left_importance = light_tree_node_importance(kg, P, left_index);
+    const float right_importance = light_tree_node_importance(kg, P, right_index);
+    const float total_importance = left_importance + right_importance;
+
+    if (total_importance == 0.0f) {
+      return -1;
+    }
+
+    const float left_probability = left_importance / total_importance;
+    if (r < left_probability) {
+      r /= left_probability;
+      *pdf *= left_probability;
+      node_index = left_index;
+    }
+    else {
+      if (right_importance == 0.0f) {
+        /* Float rounding of the probability. */
+        return -1;
+      }
+      r = (r - left_probability) / (1.0f - left_probability);
+      *pdf *= right_importance / total_importance;
+      node_index = right_index;
+    }
+
+    knode = &kernel_data_fetch(light_tree_nodes, node_index);
+  }
+
+  /* Pick an emitter in the leaf. */
+  const int first_emitter = knode->child_index;
+  const int last_emitter = first_emitter + knode->num_emitters;
+
+  float total_importance = 0.0f;
+  for (int i = first_emitter; i < last_emitter; i++) {
+    total_importance += light_tree_emitter_importance(kg, P, i);
+  }
+
+  if (total_importance == 0.0f) {
+    return -1;
+  }
+
+  r *= total_importance;
+  int selected_emitter = -1;
+  float selected_importance = 0.0f;
+  for (int i = first_emitter; i < last_emitter; i++) {
+    const float importance = light_tree_emitter_importance(kg, P, i);
+    if (importance == 0.0f) {
+      continue;
+    }
+    selected_emitter = i;
+    selected_importance = importance;
+    if (r < importance) {
+      break;
+    }
+    r -= importance;
+  }
+
+  *randu = min(r / selected_importance, 1.0f - FLT_EPSILON);
+  *pdf *= selected_importance / total_importance;
+  return kernel_data_fetch(light_tree_emitters, selected_emitter).distribution_index;
+}
+
+/* Probability of picking the light at the index in the light distribution with
+ * #light_tree_sample, for the shading point P. */
+ccl_device float light_tree_pdf(KernelGlobals kg, const float3 P, const int distribution_index)
+{
+  const int emitter_index = kernel_data_fetch(light_to_tree, distribution_index);
+  const int num_emitters = kernel_data.integrator.light_tree_num_emitters;
+  const float distant_probability = kernel_data.integrator.light_tree_distant_probability;
+
+  if (emitter_index >= num_emitters) {
+    return distant_probability / kernel_data.integrator.light_tree_num_distant;
+  }
+
+  /* Probability of picking the emitter in the leaf. */
+  const int leaf_index = kernel_data_fetch(light_tree_emitters, emitter_index).leaf_index;
+  ccl_global const KernelLightTreeNode *kleaf = &kernel_data_fetch(light_tree_nodes, leaf_index);
+  const int first_emitter = kleaf->child_index;
+  const int last_emitter = first_emitter + kleaf->num_emitters;
+
+  float emitter_importance = 0.0f;
+  float total_importance = 0.0f;
+  for (int i = first_emitter; i < last_emitter; i++) {
+    const float importance = light_tree_emitter_importance(kg, P, i);
+    if (i == emitter_index) {
+      emitter_importance = importance;
+    }
+    total_importance += importance;
+  }
+
+  if (emitter_importance == 0.0f) {
+    return 0.0f;
+  }
+
+  float pdf = (1.0f - distant_probability) * emitter_importance / total_importance;
+
+  /* Probability of walking down to the leaf. */
+  int node_index = leaf_index;
+  float node_importance = light_tree_node_importance(kg, P, node_index);
+
+  while (node_index != 0) {
+    const int parent_index = kernel_data_fetch(light_tree_nodes, node_index).parent_index;
+    const int sibling_index = (node_index == parent_index + 1) ?
+                                  kernel_data_fetch(light_tree_nodes, parent_index).child_index :
+                                  parent_index + 1;
+    const float sibling_importance = light_tree_node_importance(kg, P, sibling_index);
+
+    if (node_importance == 0.0f) {
+      return 0.0f;
+    }
+
+    pdf *= node_importance / (node_importance + sibling_importance);
+    node_index = parent_index;
+    if (node_index != 0) {
+      node_importance = light_tree_node_importance(kg, P, node_index);
+    }
+  }
+
+  return pdf;
+}
+
+/* Probability of picking a distant or background light for next event estimation. */
+ccl_device_inline float light_distant_pdf(KernelGlobals kg)
+{
+  if (kernel_data.integrator.use_light_tree) {
+    const int num_distant = kernel_data.integrator.light_tree_num_distant;
+    return (num_distant) ?
+               kernel_data.integrator.light_tree_distant_probability / num_distant :
+               0.0f;
+  }
+  return kernel_data.integrator.pdf_lights;
+}
+
+CCL_NAMESPACE_END
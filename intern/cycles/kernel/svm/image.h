@@ -5,14 +5,20 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4 svm_image_texture(KernelGlobals kg, int id, float x, float y, uint flags)
+ccl_device float4 svm_image_texture(KernelGlobals kg,
+                                    int id,
+                                    float x,
+                                    float y,
+                                    float2 duv_dx,
+                                    float2 duv_dy,
+                                    uint flags)
 {
   if (id == -1) {
     return make_float4(
         TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
   }
 
-  float4 r = kernel_tex_image_interp(kg, id, x, y);
+  float4 r = kernel_tex_image_interp_mip(kg, id, x, y, duv_dx, duv_dy);
   const float alpha = r.w;
 
   if ((flags & NODE_IMAGE_ALPHA_UNASSOCIATE) && alpha != 1.0f && alpha != 0.0f) {
@@ -33,6 +39,7 @@ ccl_device_inline float3 texco_remap_square(float3 co)
   return (co - make_float3(0.5f, 0.5f, 0.5f)) * 2.0f;
 }
 
+template<uint node_feature_mask>
 ccl_device_noinline int svm_node_tex_image(
     KernelGlobals kg, ccl_private ShaderData *sd, ccl_private float *stack, uint4 node, int offset)
 {
@@ -54,6 +61,21 @@ ccl_device_noinline int svm_node_tex_image(
     tex_co = make_float2(co.x, co.y);
   }
 
+  /* Differentials of flat projected coordinates, for picking a mip level. The shifted
+   * coordinates are computed like for bump mapping, so only when that is enabled. */
+  float2 duv_dx = zero_float2();
+  float2 duv_dy = zero_float2();
+  if (flags & NODE_IMAGE_DIFFERENTIALS) {
+    const uint4 differentials_node = read_node(kg, &offset);
+    IF_KERNEL_NODES_FEATURE(BUMP)
+    {
+      const float3 co_dx = stack_load_float3(stack, differentials_node.x);
+      const float3 co_dy = stack_load_float3(stack, differentials_node.y);
+      duv_dx = make_float2(co_dx.x - co.x, co_dx.y - co.y);
+      duv_dy = make_float2(co_dy.x - co.x, co_dy.y - co.y);
+    }
+  }
+
   /* TODO(lukas): Consider moving tile information out of the SVM node.
    * TextureInfo seems a reasonable candidate. */
   int id = -1;
@@ -97,7 +119,7 @@ ccl_device_noinline int svm_node_tex_image(
     id = -num_nodes;
   }
 
-  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, flags);
+  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, duv_dx, duv_dy, flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -191,15 +213,15 @@ ccl_device_noinline void svm_node_tex_image_box(KernelGlobals kg,
   /* Map so that no textures are flipped, rotation is somewhat arbitrary. */
   if (weight.x > 0.0f) {
     float2 uv = make_float2((signed_N.x < 0.0f) ? 1.0f - co.y : co.y, co.z);
-    f += weight.x * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.x * svm_image_texture(kg, id, uv.x, uv.y, zero_float2(), zero_float2(), flags);
   }
   if (weight.y > 0.0f) {
     float2 uv = make_float2((signed_N.y > 0.0f) ? 1.0f - co.x : co.x, co.z);
-    f += weight.y * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.y * svm_image_texture(kg, id, uv.x, uv.y, zero_float2(), zero_float2(), flags);
   }
   if (weight.z > 0.0f) {
     float2 uv = make_float2((signed_N.z > 0.0f) ? 1.0f - co.y : co.y, co.x);
-    f += weight.z * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.z * svm_image_texture(kg, id, uv.x, uv.y, zero_float2(), zero_float2(), flags);
   }
 
   if (stack_valid(out_offset))
@@ -229,7 +251,7 @@ ccl_device_noinline void svm_node_tex_environment(KernelGlobals kg,
   else
     uv = direction_to_mirrorball(co);
 
-  float4 f = svm_image_texture(kg, id, uv.x, uv.y, flags);
+  float4 f = svm_image_texture(kg, id, uv.x, uv.y, zero_float2(), zero_float2(), flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
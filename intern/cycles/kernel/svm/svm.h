@@ -324,7 +324,7 @@ ccl_device void svm_eval_nodes(KernelGlobals kg,
       offset = svm_node_vector_displacement<node_feature_mask>(kg, sd, stack, node, offset);
       break;
       SVM_CASE(NODE_TEX_IMAGE)
-      offset = svm_node_tex_image(kg, sd, stack, node, offset);
+      offset = svm_node_tex_image<node_feature_mask>(kg, sd, stack, node, offset);
       break;
       SVM_CASE(NODE_TEX_IMAGE_BOX)
       svm_node_tex_image_box(kg, sd, stack, node);
@@ -364,12 +364,18 @@ ccl_device void svm_eval_nodes(KernelGlobals kg,
       {
         offset = svm_node_tex_coord_bump_dx(kg, sd, path_flag, stack, node, offset);
       }
+      else {
+        offset = svm_node_tex_coord_skip(node, offset);
+      }
       break;
       SVM_CASE(NODE_TEX_COORD_BUMP_DY)
       IF_KERNEL_NODES_FEATURE(BUMP)
       {
         offset = svm_node_tex_coord_bump_dy(kg, sd, path_flag, stack, node, offset);
       }
+      else {
+        offset = svm_node_tex_coord_skip(node, offset);
+      }
       break;
       SVM_CASE(NODE_CLOSURE_SET_NORMAL)
       IF_KERNEL_NODES_FEATURE(BUMP)
@@ -92,6 +92,15 @@ ccl_device_noinline int svm_node_tex_coord(KernelGlobals kg,
   return offset;
 }
 
+/* Skip the nodes that follow a texture coordinate node that is not evaluated. */
+ccl_device_inline int svm_node_tex_coord_skip(uint4 node, int offset)
+{
+  if (node.y == NODE_TEXCO_OBJECT && node.w != 0) {
+    return offset + 3;
+  }
+  return offset;
+}
+
 ccl_device_noinline int svm_node_tex_coord_bump_dx(KernelGlobals kg,
                                                    ccl_private ShaderData *sd,
                                                    uint32_t path_flag,
@@ -356,6 +356,9 @@ typedef enum NodeImageProjection {
 typedef enum NodeImageFlags {
   NODE_IMAGE_COMPRESS_AS_SRGB = 1,
   NODE_IMAGE_ALPHA_UNASSOCIATE = 2,
+  /* A node with the stack offsets of the texture coordinates shifted by the ray differentials
+   * follows the image node. */
+  NODE_IMAGE_DIFFERENTIALS = 4,
 } NodeImageFlags;
 
 typedef enum NodeEnvironmentProjection {
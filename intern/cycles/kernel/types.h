@@ -1301,6 +1301,42 @@ typedef struct KernelLightDistribution {
 } KernelLightDistribution;
 static_assert_align(KernelLightDistribution, 16);
 
+/* Light Tree
+ *
+ * Nodes and emitters are bounded by a sphere for positions and by a cone for emission
+ * directions: emission happens within theta_o of the axis, and spreads over theta_e more. */
+
+typedef struct KernelLightTreeNode {
+  float centroid[3];
+  float radius;
+  float axis[3];
+  float theta_o;
+  float theta_e;
+  float energy;
+  /* Number of emitters in a leaf node, zero for inner nodes. */
+  int num_emitters;
+  /* Index of the first emitter for leaf nodes. For inner nodes the first child directly
+   * follows the node, and this is the index of the second child. */
+  int child_index;
+  int parent_index;
+  int pad1, pad2, pad3;
+} KernelLightTreeNode;
+static_assert_align(KernelLightTreeNode, 16);
+
+typedef struct KernelLightTreeEmitter {
+  float centroid[3];
+  float radius;
+  float axis[3];
+  float theta_o;
+  float theta_e;
+  float energy;
+  /* Index in the light distribution. */
+  int distribution_index;
+  /* Leaf node containing the emitter. */
+  int leaf_index;
+} KernelLightTreeEmitter;
+static_assert_align(KernelLightTreeEmitter, 16);
+
 typedef struct KernelParticle {
   int index;
   float age;
@@ -27,6 +27,7 @@
 
 #include "util/foreach.h"
 #include "util/log.h"
+#include "util/md5.h"
 #include "util/progress.h"
 #include "util/task.h"
 
@@ -179,6 +180,25 @@ bool Geometry::has_true_displacement() const
   return false;
 }
 
+/* Parameters of the BVH of a single geometry. */
+static BVHParams geometry_bvh_params(SceneParams *params,
+                                     const DeviceScene *dscene,
+                                     const BVHLayout bvh_layout)
+{
+  BVHParams bparams;
+  bparams.use_spatial_split = params->use_bvh_spatial_split;
+  bparams.use_compact_structure = params->use_bvh_compact_structure;
+  bparams.bvh_layout = bvh_layout;
+  bparams.use_unaligned_nodes = dscene->data.bvh.have_curves && params->use_bvh_unaligned_nodes;
+  bparams.use_quantized_nodes = params->use_bvh_quantized_nodes;
+  bparams.num_motion_triangle_steps = params->num_bvh_time_steps;
+  bparams.num_motion_curve_steps = params->num_bvh_time_steps;
+  bparams.num_motion_point_steps = params->num_bvh_time_steps;
+  bparams.bvh_type = params->bvh_type;
+  bparams.curve_subdivisions = params->curve_subdivisions();
+  return bparams;
+}
+
 void Geometry::compute_bvh(Device *device,
                            DeviceScene *dscene,
                            SceneParams *params,
@@ -224,17 +244,7 @@ void Geometry::compute_bvh(Device *device,
     else {
       progress->set_status(msg, "Building BVH");
 
-      BVHParams bparams;
-      bparams.use_spatial_split = params->use_bvh_spatial_split;
-      bparams.use_compact_structure = params->use_bvh_compact_structure;
-      bparams.bvh_layout = bvh_layout;
-      bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
-                                    params->use_bvh_unaligned_nodes;
-      bparams.num_motion_triangle_steps = params->num_bvh_time_steps;
-      bparams.num_motion_curve_steps = params->num_bvh_time_steps;
-      bparams.num_motion_point_steps = params->num_bvh_time_steps;
-      bparams.bvh_type = params->bvh_type;
-      bparams.curve_subdivisions = params->curve_subdivisions();
+      const BVHParams bparams = geometry_bvh_params(params, dscene, bvh_layout);
 
       delete bvh;
       bvh = BVH::create(bparams, geometry, objects, device);
@@ -300,6 +310,183 @@ GeometryManager::GeometryManager()
 
 GeometryManager::~GeometryManager()
 {
+  free_cached_bvhs();
+}
+
+/* Limit of the memory used by cached BVH2 packs, after which the least recently used ones are
+ * freed. */
+static const size_t geometry_bvh_pack_cache_max_memory = 256 * 1024 * 1024;
+
+map<string, GeometryManager::CachedBVHPack> GeometryManager::bvh_pack_cache;
+size_t GeometryManager::bvh_pack_cache_memory = 0;
+uint64_t GeometryManager::bvh_pack_cache_use_count = 0;
+thread_mutex GeometryManager::bvh_pack_cache_mutex;
+
+/* Key of geometry in the BVH caches, from its content and the BVH parameters. The shaders do not
+ * change the BVH, and are left out to match geometry of other scenes. */
+static string geometry_bvh_cache_key(Geometry *geom, const BVHParams &bparams)
+{
+  MD5Hash md5;
+  geom->hash(md5, false);
+
+  /* Motion blur positions are stored as attribute rather than socket. */
+  if (geom->has_motion_blur()) {
+    const Attribute *attr = geom->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
+    md5.append((const uint8_t *)attr->data(), attr->buffer.size());
+  }
+
+  const int params[10] = {bparams.bvh_layout,
+                          bparams.use_spatial_split,
+                          bparams.use_compact_structure,
+                          bparams.use_unaligned_nodes,
+                          bparams.use_quantized_nodes,
+                          bparams.num_motion_triangle_steps,
+                          bparams.num_motion_curve_steps,
+                          bparams.num_motion_point_steps,
+                          bparams.bvh_type,
+                          bparams.curve_subdivisions};
+  md5.append((const uint8_t *)params, sizeof(params));
+
+  return md5.get_hex();
+}
+
+static size_t packed_bvh_memory(const PackedBVH &pack)
+{
+  return pack.nodes.size() * sizeof(int4) + pack.leaf_nodes.size() * sizeof(int4) +
+         pack.object_node.size() * sizeof(int) + pack.prim_type.size() * sizeof(int) +
+         pack.prim_visibility.size() * sizeof(uint) + pack.prim_index.size() * sizeof(int) +
+         pack.prim_object.size() * sizeof(int) + pack.prim_time.size() * sizeof(float2);
+}
+
+void GeometryManager::cache_bvh(Geometry *geom)
+{
+  if (geom->bvh == NULL) {
+    return;
+  }
+
+  /* Only BVHs built on the CPU can be refitted for other geometry. */
+  const BVHLayout bvh_layout = geom->bvh->params.bvh_layout;
+  if (bvh_layout != BVH_LAYOUT_BVH2 && bvh_layout != BVH_LAYOUT_EMBREE) {
+    return;
+  }
+
+  const string key = geometry_bvh_cache_key(geom, geom->bvh->params);
+
+  thread_scoped_lock cache_lock(bvh_cache_mutex);
+  BVH *&cached_bvh = bvh_cache[key];
+  delete cached_bvh;
+  cached_bvh = geom->bvh;
+  geom->bvh = NULL;
+}
+
+void GeometryManager::cache_bvh_pack(Geometry *geom)
+{
+  /* A BVH of modified geometry does not match its content until it is updated. */
+  if (geom->bvh == NULL || geom->bvh->params.bvh_layout != BVH_LAYOUT_BVH2 ||
+      geom->is_modified())
+  {
+    return;
+  }
+
+  const BVH2 *bvh2 = static_cast<const BVH2 *>(geom->bvh);
+  const size_t memory = packed_bvh_memory(bvh2->pack);
+  if (memory == 0 || memory > geometry_bvh_pack_cache_max_memory) {
+    return;
+  }
+
+  const string key = geometry_bvh_cache_key(geom, bvh2->params);
+
+  thread_scoped_lock cache_lock(bvh_pack_cache_mutex);
+
+  CachedBVHPack &entry = bvh_pack_cache[key];
+  bvh_pack_cache_memory -= entry.memory;
+  entry.pack = bvh2->pack;
+  entry.build_sah_cost = bvh2->build_sah_cost;
+  entry.memory = memory;
+  entry.last_used = ++bvh_pack_cache_use_count;
+  bvh_pack_cache_memory += entry.memory;
+
+  /* Free the least recently used BVHs over the memory limit. */
+  while (bvh_pack_cache_memory > geometry_bvh_pack_cache_max_memory &&
+         bvh_pack_cache.size() > 1)
+  {
+    map<string, CachedBVHPack>::iterator oldest = bvh_pack_cache.begin();
+    for (map<string, CachedBVHPack>::iterator it = bvh_pack_cache.begin();
+         it != bvh_pack_cache.end();
+         ++it)
+    {
+      if (it->second.last_used < oldest->second.last_used) {
+        oldest = it;
+      }
+    }
+
+    bvh_pack_cache_memory -= oldest->second.memory;
+    bvh_pack_cache.erase(oldest);
+  }
+}
+
+bool GeometryManager::bvh_pack_cache_find(const string &key,
+                                          Device *device,
+                                          Geometry *geom,
+                                          const BVHParams &bparams)
+{
+  thread_scoped_lock cache_lock(bvh_pack_cache_mutex);
+
+  map<string, CachedBVHPack>::iterator it = bvh_pack_cache.find(key);
+  if (it == bvh_pack_cache.end()) {
+    return false;
+  }
+
+  CachedBVHPack &cached = it->second;
+  cached.last_used = ++bvh_pack_cache_use_count;
+
+  /* The geometry is set when the BVH is refitted. */
+  BVH2 *bvh2 = static_cast<BVH2 *>(
+      BVH::create(bparams, vector<Geometry *>(), vector<Object *>(), device));
+  bvh2->pack = cached.pack;
+  bvh2->build_sah_cost = cached.build_sah_cost;
+  geom->bvh = bvh2;
+
+  return true;
+}
+
+void GeometryManager::reuse_cached_bvh(Device *device,
+                                       Scene *scene,
+                                       Geometry *geom,
+                                       const BVHParams &bparams)
+{
+  const string key = geometry_bvh_cache_key(geom, bparams);
+
+  /* The BVH is refitted for the new geometry instead of being built. */
+  {
+    thread_scoped_lock cache_lock(bvh_cache_mutex);
+    map<string, BVH *>::iterator it = bvh_cache.find(key);
+    if (it != bvh_cache.end()) {
+      geom->bvh = it->second;
+      bvh_cache.erase(it);
+    }
+  }
+
+  if (geom->bvh == NULL && !(bparams.bvh_layout == BVH_LAYOUT_BVH2 &&
+                             bvh_pack_cache_find(key, device, geom, bparams)))
+  {
+    return;
+  }
+
+  geom->need_update_rebuild = false;
+
+  if (scene->update_stats) {
+    scene->update_stats->geometry_bvhs.num_reused++;
+  }
+}
+
+void GeometryManager::free_cached_bvhs()
+{
+  thread_scoped_lock cache_lock(bvh_cache_mutex);
+  foreach (auto &it, bvh_cache) {
+    delete it.second;
+  }
+  bvh_cache.clear();
 }
 
 void GeometryManager::update_osl_attributes(Device *device,
@@ -1270,14 +1457,26 @@ void GeometryManager::device_update_mesh(Device *,
   }
 }
 
+/* Copy an array of the packed BVH2 to the device. The device takes over the array, unless the
+ * BVH keeps it for refitting. */
+template<typename T>
+static void bvh_pack_to_device(array<T> &data, device_vector<T> &mem, const bool keep)
+{
+  if (keep) {
+    T *mem_data = mem.alloc(data.size());
+    memcpy(mem_data, data.data(), sizeof(T) * data.size());
+  }
+  else {
+    mem.steal_data(data);
+  }
+  mem.copy_to_device();
+}
+
 void GeometryManager::device_update_bvh(Device *device,
                                         DeviceScene *dscene,
                                         Scene *scene,
                                         Progress &progress)
 {
-  /* bvh build */
-  progress.set_status("Updating Scene BVH", "Building");
-
   BVHParams bparams;
   bparams.top_level = true;
   bparams.bvh_layout = BVHParams::best_bvh_layout(scene->params.bvh_layout,
@@ -1285,6 +1484,7 @@ void GeometryManager::device_update_bvh(Device *device,
   bparams.use_spatial_split = scene->params.use_bvh_spatial_split;
   bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
                                 scene->params.use_bvh_unaligned_nodes;
+  bparams.use_quantized_nodes = scene->params.use_bvh_quantized_nodes;
   bparams.num_motion_triangle_steps = scene->params.num_bvh_time_steps;
   bparams.num_motion_curve_steps = scene->params.num_bvh_time_steps;
   bparams.num_motion_point_steps = scene->params.num_bvh_time_steps;
@@ -1293,9 +1493,23 @@ void GeometryManager::device_update_bvh(Device *device,
 
   VLOG_INFO << "Using " << bvh_layout_name(bparams.bvh_layout) << " layout.";
 
+  const bool has_bvh2_layout = (bparams.bvh_layout == BVH_LAYOUT_BVH2);
+
+  /* Keep the packed BVH2 around for refitting it, except for final renders where it would only
+   * double the memory usage of the BVH. */
+  const bool keep_bvh2_pack = has_bvh2_layout && bparams.bvh_type == BVH_TYPE_DYNAMIC;
+
+  /* When the geometry only deformed, the top level tree can be refitted. Moved or hidden
+   * objects change the tree, and topology changes already freed the BVH. */
+  const bool only_deformed = (update_flags & (TRANSFORM_MODIFIED | VISIBILITY_MODIFIED)) == 0;
   const bool can_refit = scene->bvh != nullptr &&
                          (bparams.bvh_layout == BVHLayout::BVH_LAYOUT_OPTIX ||
-                          bparams.bvh_layout == BVHLayout::BVH_LAYOUT_METAL);
+                          bparams.bvh_layout == BVHLayout::BVH_LAYOUT_METAL ||
+                          (only_deformed && (keep_bvh2_pack ||
+                                             bparams.bvh_layout == BVHLayout::BVH_LAYOUT_EMBREE)));
+
+  /* bvh build */
+  progress.set_status("Updating Scene BVH", can_refit ? "Refitting" : "Building");
 
   BVH *bvh = scene->bvh;
   if (!scene->bvh) {
@@ -1308,15 +1522,9 @@ void GeometryManager::device_update_bvh(Device *device,
     return;
   }
 
-  const bool has_bvh2_layout = (bparams.bvh_layout == BVH_LAYOUT_BVH2);
-
-  PackedBVH pack;
-  if (has_bvh2_layout) {
-    pack = std::move(static_cast<BVH2 *>(bvh)->pack);
-  }
-  else {
-    pack.root_index = -1;
-  }
+  PackedBVH empty_pack;
+  empty_pack.root_index = -1;
+  PackedBVH &pack = (has_bvh2_layout) ? static_cast<BVH2 *>(bvh)->pack : empty_pack;
 
   /* copy to device */
   progress.set_status("Updating Scene BVH", "Copying BVH to device");
@@ -1325,41 +1533,34 @@ void GeometryManager::device_update_bvh(Device *device,
    * BVH's leaf nodes which may be different when the objects or vertices move. */
 
   if (pack.nodes.size()) {
-    dscene->bvh_nodes.steal_data(pack.nodes);
-    dscene->bvh_nodes.copy_to_device();
+    bvh_pack_to_device(pack.nodes, dscene->bvh_nodes, keep_bvh2_pack);
   }
   if (pack.leaf_nodes.size()) {
-    dscene->bvh_leaf_nodes.steal_data(pack.leaf_nodes);
-    dscene->bvh_leaf_nodes.copy_to_device();
+    bvh_pack_to_device(pack.leaf_nodes, dscene->bvh_leaf_nodes, keep_bvh2_pack);
   }
   if (pack.object_node.size()) {
-    dscene->object_node.steal_data(pack.object_node);
-    dscene->object_node.copy_to_device();
+    bvh_pack_to_device(pack.object_node, dscene->object_node, keep_bvh2_pack);
   }
   if (pack.prim_type.size()) {
-    dscene->prim_type.steal_data(pack.prim_type);
-    dscene->prim_type.copy_to_device();
+    bvh_pack_to_device(pack.prim_type, dscene->prim_type, keep_bvh2_pack);
   }
   if (pack.prim_visibility.size()) {
-    dscene->prim_visibility.steal_data(pack.prim_visibility);
-    dscene->prim_visibility.copy_to_device();
+    bvh_pack_to_device(pack.prim_visibility, dscene->prim_visibility, keep_bvh2_pack);
   }
   if (pack.prim_index.size()) {
-    dscene->prim_index.steal_data(pack.prim_index);
-    dscene->prim_index.copy_to_device();
+    bvh_pack_to_device(pack.prim_index, dscene->prim_index, keep_bvh2_pack);
   }
   if (pack.prim_object.size()) {
-    dscene->prim_object.steal_data(pack.prim_object);
-    dscene->prim_object.copy_to_device();
+    bvh_pack_to_device(pack.prim_object, dscene->prim_object, keep_bvh2_pack);
   }
   if (pack.prim_time.size()) {
-    dscene->prim_time.steal_data(pack.prim_time);
-    dscene->prim_time.copy_to_device();
+    bvh_pack_to_device(pack.prim_time, dscene->prim_time, keep_bvh2_pack);
   }
 
   dscene->data.bvh.root = pack.root_index;
   dscene->data.bvh.use_bvh_steps = (scene->params.num_bvh_time_steps != 0);
   dscene->data.bvh.curve_subdivisions = scene->params.curve_subdivisions();
+  dscene->data.bvh.use_quantized_nodes = has_bvh2_layout && bparams.use_quantized_nodes;
   /* The scene handle is set in 'CPUDevice::const_copy_to' and 'OptiXDevice::const_copy_to' */
   dscene->data.device_bvh = 0;
 }
@@ -1804,6 +2005,14 @@ void GeometryManager::device_update(Device *device,
 
   VLOG_INFO << "Total " << scene->geometry.size() << " meshes.";
 
+  /* Other devices copy the geometry to device memory, where it must be resident anyway. */
+  const bool use_out_of_core = scene->params.use_out_of_core_geometry &&
+                               device->info.type == DEVICE_CPU;
+  if (use_out_of_core) {
+    VLOG_INFO << "Storing geometry out of core.";
+  }
+  dscene->set_geometry_host_mapped(use_out_of_core, scene->params.out_of_core_directory);
+
   bool true_displacement_used = false;
   bool curve_shadow_transparency_used = false;
   size_t total_tess_needed = 0;
@@ -2019,6 +2228,35 @@ void GeometryManager::device_update(Device *device,
    * change. */
   bool need_update_scene_bvh = (scene->bvh == nullptr ||
                                 (update_flags & (TRANSFORM_MODIFIED | VISIBILITY_MODIFIED)) != 0);
+
+  /* Reuse the BVHs of deleted geometry for added geometry with the same content, and free the
+   * ones that were not reused. BVH2 packs of geometry of other scenes are reused too. */
+  bool use_bvh_pack_cache = false;
+  if (bvh_layout == BVH_LAYOUT_BVH2) {
+    thread_scoped_lock cache_lock(bvh_pack_cache_mutex);
+    use_bvh_pack_cache = !bvh_pack_cache.empty();
+  }
+
+  if (!bvh_cache.empty() || use_bvh_pack_cache) {
+    scoped_callback_timer timer([scene](double time) {
+      if (scene->update_stats) {
+        scene->update_stats->geometry.times.add_entry({"device_update (reuse BVHs)", time});
+      }
+    });
+    const BVHParams bparams = geometry_bvh_params(&scene->params, dscene, bvh_layout);
+    TaskPool pool;
+
+    foreach (Geometry *geom, scene->geometry) {
+      if (geom->is_modified() && geom->bvh == NULL && geom->need_build_bvh(bvh_layout)) {
+        pool.push(function_bind(
+            &GeometryManager::reuse_cached_bvh, this, device, scene, geom, bparams));
+      }
+    }
+
+    pool.wait_work();
+    free_cached_bvhs();
+  }
+
   {
     scoped_callback_timer timer([scene](double time) {
       if (scene->update_stats) {
@@ -2031,6 +2269,10 @@ void GeometryManager::device_update(Device *device,
     foreach (Geometry *geom, scene->geometry) {
       if (geom->is_modified() || geom->need_update_bvh_for_offset) {
         need_update_scene_bvh = true;
+        if (scene->update_stats && geom->need_build_bvh(bvh_layout) &&
+            (geom->bvh == NULL || geom->need_update_rebuild)) {
+          scene->update_stats->geometry_bvhs.num_computed++;
+        }
         pool.push(function_bind(
             &Geometry::compute_bvh, geom, device, dscene, &scene->params, &progress, i, num_bvh));
         if (geom->need_build_bvh(bvh_layout)) {
@@ -2153,6 +2395,10 @@ void GeometryManager::device_update(Device *device,
 
 void GeometryManager::device_free(Device *device, DeviceScene *dscene, bool force_free)
 {
+  if (force_free) {
+    free_cached_bvhs();
+  }
+
   dscene->bvh_nodes.free_if_need_realloc(force_free);
   dscene->bvh_leaf_nodes.free_if_need_realloc(force_free);
   dscene->object_node.free_if_need_realloc(force_free);
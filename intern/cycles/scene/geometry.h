@@ -6,12 +6,15 @@
 
 #include "graph/node.h"
 
+#include "bvh/bvh.h"
 #include "bvh/params.h"
 
 #include "scene/attribute.h"
 
 #include "util/boundbox.h"
+#include "util/map.h"
 #include "util/set.h"
+#include "util/thread.h"
 #include "util/transform.h"
 #include "util/types.h"
 #include "util/vector.h"
@@ -164,6 +167,10 @@ class Geometry : public Node {
 class GeometryManager {
   uint32_t update_flags;
 
+  /* BVHs of deleted geometry, by hash of the geometry content. */
+  map<string, BVH *> bvh_cache;
+  thread_mutex bvh_cache_mutex;
+
  public:
   enum : uint32_t {
     UV_PASS_NEEDED = (1 << 0),
@@ -213,9 +220,43 @@ class GeometryManager {
   /* Statistics */
   void collect_statistics(const Scene *scene, RenderStats *stats);
 
+  /* Keep the BVH of geometry that is about to be deleted, to be reused by geometry with the
+   * same content that is added before the next update. These BVHs are only reused by the scene
+   * they were built for, as Embree BVHs belong to the device. */
+  void cache_bvh(Geometry *geom);
+
+  /* Keep a copy of the BVH2 of geometry deleted with its scene, to be reused by other scenes,
+   * like the scenes of the frames of an animation rendered without persistent data. */
+  static void cache_bvh_pack(Geometry *geom);
+
  protected:
   bool displace(Device *device, Scene *scene, Mesh *mesh, Progress &progress);
 
+  /* BVH cache */
+  void reuse_cached_bvh(Device *device, Scene *scene, Geometry *geom, const BVHParams &bparams);
+  void free_cached_bvhs();
+
+  /* Packed BVH2 of geometry of any scene. Only host data is cached, so that the BVH can be
+   * refitted for geometry with the same content in another scene. */
+  struct CachedBVHPack {
+    PackedBVH pack;
+    float build_sah_cost;
+    size_t memory;
+
+    /* Order of the last use, for freeing the least recently used BVHs. */
+    uint64_t last_used;
+  };
+
+  static bool bvh_pack_cache_find(const string &key,
+                                  Device *device,
+                                  Geometry *geom,
+                                  const BVHParams &bparams);
+
+  static map<string, CachedBVHPack> bvh_pack_cache;
+  static size_t bvh_pack_cache_memory;
+  static uint64_t bvh_pack_cache_use_count;
+  static thread_mutex bvh_pack_cache_mutex;
+
   void create_volume_mesh(const Scene *scene, Volume *volume, Progress &progress);
 
   /* Attributes */
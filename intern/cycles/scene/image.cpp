@@ -8,6 +8,7 @@
 #include "scene/image_vdb.h"
 #include "scene/scene.h"
 #include "scene/stats.h"
+#include "scene/texture_cache.h"
 
 #include "util/foreach.h"
 #include "util/image.h"
@@ -68,6 +69,8 @@ const char *name_from_type(ImageDataType type)
       return "nanovdb_fpn";
     case IMAGE_DATA_TYPE_NANOVDB_FP16:
       return "nanovdb_fp16";
+    case IMAGE_DATA_TYPE_TEXTURE_CACHE:
+      return "texture_cache";
     case IMAGE_DATA_NUM_TYPES:
       assert(!"System enumerator type, should never be used");
       return "";
@@ -324,6 +327,8 @@ ImageManager::ImageManager(const DeviceInfo &info)
 
   /* Set image limits */
   features.has_nanovdb = info.has_nanovdb;
+  /* Kernels read from the texture cache in host memory. */
+  features.has_texture_cache = (info.type == DEVICE_CPU);
 }
 
 ImageManager::~ImageManager()
@@ -337,6 +342,11 @@ void ImageManager::set_osl_texture_system(void *texture_system)
   osl_texture_system = texture_system;
 }
 
+bool ImageManager::use_texture_cache(Scene *scene) const
+{
+  return scene->params.use_texture_cache && features.has_texture_cache;
+}
+
 bool ImageManager::set_animation_frame_update(int frame)
 {
   if (frame != animation_frame) {
@@ -384,9 +394,11 @@ void ImageManager::load_image_metadata(Image *img)
   img->need_metadata = false;
 }
 
-ImageHandle ImageManager::add_image(const string &filename, const ImageParams &params)
+ImageHandle ImageManager::add_image(const string &filename,
+                                    const ImageParams &params,
+                                    const int preferred_slot)
 {
-  const int slot = add_image_slot(new OIIOImageLoader(filename), params, false);
+  const int slot = add_image_slot(new OIIOImageLoader(filename), params, false, preferred_slot);
 
   ImageHandle handle;
   handle.tile_slots.push_back(slot);
@@ -396,12 +408,14 @@ ImageHandle ImageManager::add_image(const string &filename, const ImageParams &p
 
 ImageHandle ImageManager::add_image(const string &filename,
                                     const ImageParams &params,
-                                    const array<int> &tiles)
+                                    const array<int> &tiles,
+                                    const array<int> &preferred_slots)
 {
   ImageHandle handle;
   handle.manager = this;
 
-  foreach (int tile, tiles) {
+  for (size_t i = 0; i < tiles.size(); i++) {
+    const int tile = tiles[i];
     string tile_filename = filename;
 
     /* Since we don't have information about the exact tile format used in this code location,
@@ -413,7 +427,9 @@ ImageHandle ImageManager::add_image(const string &filename,
       int v = ((tile - 1001) / 10);
       string_replace(tile_filename, "<UVTILE>", string_printf("u%d_v%d", u + 1, v + 1));
     }
-    const int slot = add_image_slot(new OIIOImageLoader(tile_filename), params, false);
+    const int preferred_slot = (i < preferred_slots.size()) ? preferred_slots[i] : -1;
+    const int slot = add_image_slot(
+        new OIIOImageLoader(tile_filename), params, false, preferred_slot);
     handle.tile_slots.push_back(slot);
   }
 
@@ -447,7 +463,8 @@ ImageHandle ImageManager::add_image(const vector<ImageLoader *> &loaders,
 
 int ImageManager::add_image_slot(ImageLoader *loader,
                                  const ImageParams &params,
-                                 const bool builtin)
+                                 const bool builtin,
+                                 const int preferred_slot)
 {
   Image *img;
   size_t slot;
@@ -465,13 +482,19 @@ int ImageManager::add_image_slot(ImageLoader *loader,
   }
 
   /* Find free slot. */
-  for (slot = 0; slot < images.size(); slot++) {
-    if (!images[slot])
-      break;
+  if (preferred_slot >= 0 &&
+      ((size_t)preferred_slot >= images.size() || !images[preferred_slot])) {
+    slot = preferred_slot;
+  }
+  else {
+    for (slot = 0; slot < images.size(); slot++) {
+      if (!images[slot])
+        break;
+    }
   }
 
-  if (slot == images.size()) {
-    images.resize(images.size() + 1);
+  if (slot >= images.size()) {
+    images.resize(slot + 1);
   }
 
   /* Add new image. */
@@ -483,6 +506,7 @@ int ImageManager::add_image_slot(ImageLoader *loader,
   img->builtin = builtin;
   img->users = 1;
   img->mem = NULL;
+  img->cache_file = NULL;
 
   images[slot] = img;
 
@@ -525,8 +549,105 @@ static bool image_associate_alpha(ImageManager::Image *img)
            img->params.alpha_type == IMAGE_ALPHA_CHANNEL_PACKED);
 }
 
+/* Loaded Pixels Cache */
+
+/* Limit of the memory used by cached pixels, after which the least recently used images are
+ * freed. */
+static const size_t image_pixels_cache_max_memory = 1024 * 1024 * 1024;
+
+map<string, ImageManager::CachedPixels> ImageManager::pixels_cache;
+size_t ImageManager::pixels_cache_memory = 0;
+uint64_t ImageManager::pixels_cache_use_count = 0;
+thread_mutex ImageManager::pixels_cache_mutex;
+
+/* Key of the image in the cache of loaded pixels, empty if it can not be cached. Only image files
+ * are cached, identified by their path and modification time, and by everything that changes how
+ * their pixels are converted when loading. */
+static string image_pixels_cache_key(ImageManager::Image *img, const int texture_limit)
+{
+  const ustring filepath = img->loader->osl_filepath();
+  if (filepath.empty()) {
+    return "";
+  }
+
+  const ImageMetaData &metadata = img->metadata;
+  return string_printf("%s|%llu|%d|%d|%zu|%zu|%zu|%s|%d|%d|%d|%d",
+                       filepath.c_str(),
+                       (unsigned long long)path_modified_time(filepath.string()),
+                       (int)metadata.type,
+                       metadata.channels,
+                       metadata.width,
+                       metadata.height,
+                       metadata.depth,
+                       metadata.colorspace.c_str(),
+                       (int)metadata.compress_as_srgb,
+                       (int)img->params.alpha_type,
+                       (int)image_associate_alpha(img),
+                       texture_limit);
+}
+
+bool ImageManager::pixels_cache_find(const string &key, Image *img)
+{
+  thread_scoped_lock cache_lock(pixels_cache_mutex);
+
+  map<string, CachedPixels>::iterator it = pixels_cache.find(key);
+  if (it == pixels_cache.end()) {
+    return false;
+  }
+
+  CachedPixels &cached = it->second;
+  cached.last_used = ++pixels_cache_use_count;
+
+  thread_scoped_lock device_lock(device_mutex);
+  void *pixels = img->mem->alloc(cached.width, cached.height, cached.depth);
+  if (pixels == NULL || img->mem->memory_size() != cached.data.size()) {
+    return false;
+  }
+
+  memcpy(pixels, cached.data.data(), cached.data.size());
+  return true;
+}
+
+void ImageManager::pixels_cache_add(const string &key, Image *img)
+{
+  const size_t size = img->mem->memory_size();
+  if (size == 0 || size > image_pixels_cache_max_memory) {
+    return;
+  }
+
+  CachedPixels cached;
+  cached.width = img->mem->data_width;
+  cached.height = img->mem->data_height;
+  cached.depth = img->mem->data_depth;
+  cached.data.resize(size);
+  memcpy(cached.data.data(), img->mem->host_pointer, size);
+
+  thread_scoped_lock cache_lock(pixels_cache_mutex);
+
+  cached.last_used = ++pixels_cache_use_count;
+
+  CachedPixels &entry = pixels_cache[key];
+  pixels_cache_memory -= entry.data.size();
+  entry = std::move(cached);
+  pixels_cache_memory += entry.data.size();
+
+  /* Free the least recently used images over the memory limit. */
+  while (pixels_cache_memory > image_pixels_cache_max_memory && pixels_cache.size() > 1) {
+    map<string, CachedPixels>::iterator oldest = pixels_cache.begin();
+    for (map<string, CachedPixels>::iterator it = pixels_cache.begin(); it != pixels_cache.end();
+         ++it) {
+      if (it->second.last_used < oldest->second.last_used) {
+        oldest = it;
+      }
+    }
+
+    pixels_cache_memory -= oldest->second.data.size();
+    pixels_cache.erase(oldest);
+  }
+}
+
 template<TypeDesc::BASETYPE FileFormat, typename StorageType>
-bool ImageManager::file_load_image(Image *img, int texture_limit)
+bool ImageManager::file_load_image(Image *img, int texture_limit, const string &pixels_key)
 {
   /* Ignore empty images. */
   if (!(img->metadata.channels > 0)) {
@@ -678,6 +799,38 @@ bool ImageManager::file_load_image(Image *img, int texture_limit)
     memcpy(texture_pixels, &scaled_pixels[0], scaled_pixels.size() * sizeof(StorageType));
   }
 
+  if (!pixels_key.empty()) {
+    pixels_cache_add(pixels_key, img);
+  }
+
+  return true;
+}
+
+bool ImageManager::cache_load_image(Image *img)
+{
+  /* Only 2D images from files can be read by the texture cache. */
+  const ustring filepath = img->loader->osl_filepath();
+  if (filepath.empty() || img->metadata.depth > 1 || img->metadata.channels == 0) {
+    return false;
+  }
+
+  img->cache_file = texture_cache->add_image(filepath.string(),
+                                             img->metadata,
+                                             image_associate_alpha(img),
+                                             img->params.alpha_type == IMAGE_ALPHA_IGNORE);
+  if (img->cache_file == NULL) {
+    return false;
+  }
+
+  /* The kernel finds the file from a pointer stored in the texture. */
+  thread_scoped_lock device_lock(device_mutex);
+  TextureCacheImage **data = (TextureCacheImage **)img->mem->alloc(sizeof(TextureCacheImage *),
+                                                                   0);
+  *data = img->cache_file;
+  img->mem->info.width = img->metadata.width;
+  img->mem->info.height = img->metadata.height;
+  img->mem->info.depth = 0;
+
   return true;
 }
 
@@ -706,14 +859,58 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     img->mem = NULL;
   }
 
+  if (img->cache_file) {
+    texture_cache->remove_image(img->cache_file);
+    img->cache_file = NULL;
+  }
+
+  /* Read tiles of the file while rendering if possible. The cache is created by device_update(),
+   * images loaded on their own before that are fully loaded. */
+  if (use_texture_cache(scene) && texture_cache && !img->loader->osl_filepath().empty()) {
+    img->mem = new device_texture(device,
+                                  img->mem_name.c_str(),
+                                  slot,
+                                  IMAGE_DATA_TYPE_TEXTURE_CACHE,
+                                  img->params.interpolation,
+                                  img->params.extension);
+    if (cache_load_image(img)) {
+      if (scene->update_stats) {
+        scene->update_stats->images.num_computed++;
+      }
+      thread_scoped_lock device_lock(device_mutex);
+      img->mem->copy_to_device();
+      img->need_load = false;
+      return;
+    }
+
+    thread_scoped_lock device_lock(device_mutex);
+    delete img->mem;
+    img->mem = NULL;
+  }
+
   img->mem = new device_texture(
       device, img->mem_name.c_str(), slot, type, img->params.interpolation, img->params.extension);
   img->mem->info.use_transform_3d = img->metadata.use_transform_3d;
   img->mem->info.transform_3d = img->metadata.transform_3d;
 
+  /* Reuse the pixels of the same file loaded for any scene before. */
+  const string pixels_key = image_pixels_cache_key(img, texture_limit);
+  const bool pixels_reused = !pixels_key.empty() && pixels_cache_find(pixels_key, img);
+  if (scene->update_stats) {
+    if (pixels_reused) {
+      scene->update_stats->images.num_reused++;
+    }
+    else {
+      scene->update_stats->images.num_computed++;
+    }
+  }
+
   /* Create new texture. */
-  if (type == IMAGE_DATA_TYPE_FLOAT4) {
-    if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit)) {
+  if (pixels_reused) {
+    /* Pixels were copied from the cache. */
+  }
+  else if (type == IMAGE_DATA_TYPE_FLOAT4) {
+    if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit, pixels_key)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
       float *pixels = (float *)img->mem->alloc(1, 1);
@@ -725,7 +922,7 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_FLOAT) {
-    if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit)) {
+    if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit, pixels_key)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
       float *pixels = (float *)img->mem->alloc(1, 1);
@@ -734,7 +931,7 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_BYTE4) {
-    if (!file_load_image<TypeDesc::UINT8, uchar>(img, texture_limit)) {
+    if (!file_load_image<TypeDesc::UINT8, uchar>(img, texture_limit, pixels_key)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
       uchar *pixels = (uchar *)img->mem->alloc(1, 1);
@@ -746,7 +943,7 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_BYTE) {
-    if (!file_load_image<TypeDesc::UINT8, uchar>(img, texture_limit)) {
+    if (!file_load_image<TypeDesc::UINT8, uchar>(img, texture_limit, pixels_key)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
       uchar *pixels = (uchar *)img->mem->alloc(1, 1);
@@ -755,7 +952,7 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_HALF4) {
-    if (!file_load_image<TypeDesc::HALF, half>(img, texture_limit)) {
+    if (!file_load_image<TypeDesc::HALF, half>(img, texture_limit, pixels_key)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
       half *pixels = (half *)img->mem->alloc(1, 1);
@@ -767,7 +964,7 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_USHORT) {
-    if (!file_load_image<TypeDesc::USHORT, uint16_t>(img, texture_limit)) {
+    if (!file_load_image<TypeDesc::USHORT, uint16_t>(img, texture_limit, pixels_key)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
       uint16_t *pixels = (uint16_t *)img->mem->alloc(1, 1);
@@ -776,7 +973,7 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_USHORT4) {
-    if (!file_load_image<TypeDesc::USHORT, uint16_t>(img, texture_limit)) {
+    if (!file_load_image<TypeDesc::USHORT, uint16_t>(img, texture_limit, pixels_key)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
       uint16_t *pixels = (uint16_t *)img->mem->alloc(1, 1);
@@ -788,7 +985,7 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_HALF) {
-    if (!file_load_image<TypeDesc::HALF, half>(img, texture_limit)) {
+    if (!file_load_image<TypeDesc::HALF, half>(img, texture_limit, pixels_key)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
       half *pixels = (half *)img->mem->alloc(1, 1);
@@ -839,6 +1036,10 @@ void ImageManager::device_free_image(Device *, int slot)
     delete img->mem;
   }
 
+  if (img->cache_file) {
+    texture_cache->remove_image(img->cache_file);
+  }
+
   delete img->loader;
   delete img;
   images[slot] = NULL;
@@ -856,6 +1057,13 @@ void ImageManager::device_update(Device *device, Scene *scene, Progress &progres
     }
   });
 
+  if (use_texture_cache(scene)) {
+    if (!texture_cache) {
+      texture_cache = make_unique<TextureCache>();
+    }
+    texture_cache->set_max_memory(((size_t)scene->params.texture_cache_size) * 1024 * 1024);
+  }
+
   TaskPool pool;
   for (size_t slot = 0; slot < images.size(); slot++) {
     Image *img = images[slot];
@@ -866,6 +1074,9 @@ void ImageManager::device_update(Device *device, Scene *scene, Progress &progres
       pool.push(
           function_bind(&ImageManager::device_load_image, this, device, scene, slot, &progress));
     }
+    else if (img && scene->update_stats) {
+      scene->update_stats->images.num_reused++;
+    }
   }
 
   pool.wait_work();
@@ -922,6 +1133,7 @@ void ImageManager::device_free(Device *device)
     device_free_image(device, slot);
   }
   images.clear();
+  texture_cache.reset();
 }
 
 void ImageManager::collect_statistics(RenderStats *stats)
@@ -934,6 +1146,11 @@ void ImageManager::collect_statistics(RenderStats *stats)
     stats->image.textures.add_entry(
         NamedSizeEntry(image->loader->name(), image->mem->memory_size()));
   }
+
+  if (texture_cache) {
+    stats->image.textures.add_entry(
+        NamedSizeEntry("Texture cache tiles", texture_cache->memory_size()));
+  }
 }
 
 void ImageManager::tag_update()
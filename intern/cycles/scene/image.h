@@ -8,6 +8,7 @@
 
 #include "scene/colorspace.h"
 
+#include "util/map.h"
 #include "util/string.h"
 #include "util/thread.h"
 #include "util/transform.h"
@@ -26,6 +27,8 @@ class Progress;
 class RenderStats;
 class Scene;
 class ColorSpaceProcessor;
+class TextureCache;
+class TextureCacheFile;
 class VDBImageLoader;
 
 /* Image Parameters */
@@ -88,6 +91,8 @@ class ImageMetaData {
 class ImageDeviceFeatures {
  public:
   bool has_nanovdb;
+  /* Image files can be read while rendering through the texture cache. */
+  bool has_texture_cache;
 };
 
 /* Image loader base class, that can be subclassed to load image data
@@ -168,10 +173,15 @@ class ImageManager {
   explicit ImageManager(const DeviceInfo &info);
   ~ImageManager();
 
-  ImageHandle add_image(const string &filename, const ImageParams &params);
+  /* A new image is added in the preferred slot if it is free, to match shaders compiled with
+   * another image manager, see #SVMShaderManager. */
   ImageHandle add_image(const string &filename,
                         const ImageParams &params,
-                        const array<int> &tiles);
+                        const int preferred_slot = -1);
+  ImageHandle add_image(const string &filename,
+                        const ImageParams &params,
+                        const array<int> &tiles,
+                        const array<int> &preferred_slots = array<int>());
   ImageHandle add_image(ImageLoader *loader, const ImageParams &params, const bool builtin = true);
   ImageHandle add_image(const vector<ImageLoader *> &loaders, const ImageParams &params);
 
@@ -185,6 +195,9 @@ class ImageManager {
   void set_osl_texture_system(void *texture_system);
   bool set_animation_frame_update(int frame);
 
+  /* Read tiles of image files while rendering, instead of loading the full images. */
+  bool use_texture_cache(Scene *scene) const;
+
   void collect_statistics(RenderStats *stats);
 
   void tag_update();
@@ -203,6 +216,8 @@ class ImageManager {
 
     string mem_name;
     device_texture *mem;
+    /* File read through the texture cache, the memory then only stores a pointer to it. */
+    TextureCacheFile *cache_file;
 
     int users;
     thread_mutex mutex;
@@ -219,19 +234,43 @@ class ImageManager {
 
   vector<Image *> images;
   void *osl_texture_system;
+  unique_ptr<TextureCache> texture_cache;
 
-  int add_image_slot(ImageLoader *loader, const ImageParams &params, const bool builtin);
+  int add_image_slot(ImageLoader *loader,
+                     const ImageParams &params,
+                     const bool builtin,
+                     const int preferred_slot = -1);
   void add_image_user(int slot);
   void remove_image_user(int slot);
 
   void load_image_metadata(Image *img);
 
   template<TypeDesc::BASETYPE FileFormat, typename StorageType>
-  bool file_load_image(Image *img, int texture_limit);
+  bool file_load_image(Image *img, int texture_limit, const string &pixels_key);
+  bool cache_load_image(Image *img);
+
+  /* Pixels of image files loaded by any image manager, reused for images with the same file and
+   * parameters. Only host data is cached, so that images are reused by other scenes too, like the
+   * scenes of the frames of an animation rendered without persistent data. */
+  struct CachedPixels {
+    size_t width, height, depth;
+    vector<uint8_t> data;
+
+    /* Order of the last use, for freeing the least recently used pixels. */
+    uint64_t last_used;
+  };
 
   void device_load_image(Device *device, Scene *scene, int slot, Progress *progress);
   void device_free_image(Device *device, int slot);
 
+  bool pixels_cache_find(const string &key, Image *img);
+  void pixels_cache_add(const string &key, Image *img);
+
+  static map<string, CachedPixels> pixels_cache;
+  static size_t pixels_cache_memory;
+  static uint64_t pixels_cache_use_count;
+  static thread_mutex pixels_cache_mutex;
+
   friend class ImageHandle;
 };
 
@@ -85,6 +85,7 @@ NODE_DEFINE(Integrator)
   SOCKET_INT(adaptive_min_samples, "Adaptive Min Samples", 0);
 
   SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.01f);
+  SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
 
   static NodeEnum sampling_pattern_enum;
   sampling_pattern_enum.insert("sobol", SAMPLING_PATTERN_SOBOL);
@@ -313,6 +314,10 @@ void Integrator::tag_update(Scene *scene, uint32_t flag)
     scene->object_manager->tag_update(scene, ObjectManager::MOTION_BLUR_MODIFIED);
     scene->camera->tag_modified();
   }
+
+  if (use_light_tree_is_modified()) {
+    scene->light_manager->tag_update(scene, LightManager::LIGHT_MODIFIED);
+  }
 }
 
 uint Integrator::get_kernel_features() const
@@ -7,6 +7,7 @@
 #include "scene/film.h"
 #include "scene/integrator.h"
 #include "scene/light.h"
+#include "scene/light_tree.h"
 #include "scene/mesh.h"
 #include "scene/object.h"
 #include "scene/scene.h"
@@ -20,6 +21,7 @@
 #include "util/foreach.h"
 #include "util/hash.h"
 #include "util/log.h"
+#include "util/map.h"
 #include "util/path.h"
 #include "util/progress.h"
 #include "util/task.h"
@@ -519,6 +521,214 @@ void LightManager::device_update_distribution(Device *,
   }
 }
 
+/* Estimate of the emitted energy per unit of area of triangles using the shader. */
+static float light_tree_shader_energy(Shader *shader)
+{
+  float3 emission;
+  if (shader->is_constant_emission(&emission)) {
+    return average(fabs(emission));
+  }
+  /* Emission depends on textures or geometry, no estimate can be made without evaluating it. */
+  return 1.0f;
+}
+
+void LightManager::device_update_tree(Device *,
+                                      DeviceScene *dscene,
+                                      Scene *scene,
+                                      Progress &progress)
+{
+  KernelIntegrator *kintegrator = &dscene->data.integrator;
+
+  kintegrator->use_light_tree = false;
+  kintegrator->light_tree_num_emitters = 0;
+  kintegrator->light_tree_num_distant = 0;
+  kintegrator->light_tree_distant_probability = 0.0f;
+
+  if (!scene->integrator->get_use_light_tree() || !kintegrator->use_direct_light) {
+    dscene->light_tree_nodes.free();
+    dscene->light_tree_emitters.free();
+    dscene->light_to_tree.free();
+    return;
+  }
+
+  const KernelLightDistribution *distribution = dscene->light_distribution.data();
+  const int num_distribution = kintegrator->num_distribution;
+  const int num_triangles = num_distribution - kintegrator->num_all_lights;
+
+  vector<Light *> lights;
+  foreach (Light *light, scene->lights) {
+    if (light->is_enabled) {
+      lights.push_back(light);
+    }
+  }
+
+  /* Bounds and energy of the emitters. */
+  vector<LightTreeEmitter> emitters;
+  vector<LightTreeEmitter> distant_emitters;
+  emitters.reserve(num_distribution);
+
+  unordered_map<Shader *, float> shader_energy;
+
+  for (int index = 0; index < num_triangles; index++) {
+    if (progress.get_cancel()) {
+      return;
+    }
+
+    const Object *object = scene->objects[distribution[index].mesh_light.object_id];
+    const Mesh *mesh = static_cast<const Mesh *>(object->get_geometry());
+    const size_t triangle_index = distribution[index].prim - mesh->prim_offset;
+
+    LightTreeEmitter emitter;
+    emitter.distribution_index = index;
+    emitter.bbox = BoundBox(zero_float3());
+    emitter.bcone = OrientationBounds(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F);
+    emitter.energy = 0.0f;
+
+    const Mesh::Triangle t = mesh->get_triangle(triangle_index);
+    if (t.valid(&mesh->get_verts()[0])) {
+      float3 p[3];
+      for (int i = 0; i < 3; i++) {
+        p[i] = mesh->get_verts()[t.v[i]];
+        if (!mesh->transform_applied) {
+          p[i] = transform_point(&object->get_tfm(), p[i]);
+        }
+      }
+      emitter.bbox = BoundBox(p[0]);
+      emitter.bbox.grow(p[1]);
+      emitter.bbox.grow(p[2]);
+
+      const int shader_index = mesh->get_shader()[triangle_index];
+      Shader *shader = (shader_index < mesh->get_used_shaders().size()) ?
+                           static_cast<Shader *>(mesh->get_used_shaders()[shader_index]) :
+                           scene->default_surface;
+      auto it = shader_energy.find(shader);
+      if (it == shader_energy.end()) {
+        it = shader_energy.insert({shader, light_tree_shader_energy(shader)}).first;
+      }
+
+      /* Emission is on both sides of the triangle, so the orientation is not bounded. */
+      emitter.energy = triangle_area(p[0], p[1], p[2]) * it->second;
+    }
+
+    emitters.push_back(emitter);
+  }
+
+  for (int lamp = 0; lamp < lights.size(); lamp++) {
+    const Light *light = lights[lamp];
+
+    LightTreeEmitter emitter;
+    emitter.distribution_index = num_triangles + lamp;
+    emitter.energy = average(fabs(light->get_strength()));
+    emitter.bbox = BoundBox(light->get_co());
+    emitter.bcone = OrientationBounds(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F);
+
+    const LightType type = light->get_light_type();
+    if (type == LIGHT_DISTANT || type == LIGHT_BACKGROUND) {
+      distant_emitters.push_back(emitter);
+      continue;
+    }
+
+    if (type == LIGHT_POINT || type == LIGHT_SPOT) {
+      emitter.bbox.grow(light->get_co(), light->get_size());
+      if (type == LIGHT_SPOT) {
+        emitter.bcone = OrientationBounds(safe_normalize(light->get_dir()),
+                                          fminf(light->get_spot_angle() * 0.5f, M_PI_F),
+                                          M_PI_2_F);
+      }
+    }
+    else if (type == LIGHT_AREA) {
+      const float3 axisu = light->get_axisu() * (light->get_sizeu() * light->get_size());
+      const float3 axisv = light->get_axisv() * (light->get_sizev() * light->get_size());
+      emitter.bbox = BoundBox(light->get_co() - 0.5f * axisu - 0.5f * axisv);
+      emitter.bbox.grow(light->get_co() + 0.5f * axisu - 0.5f * axisv);
+      emitter.bbox.grow(light->get_co() - 0.5f * axisu + 0.5f * axisv);
+      emitter.bbox.grow(light->get_co() + 0.5f * axisu + 0.5f * axisv);
+      /* Area lights only emit on the front side. */
+      emitter.bcone = OrientationBounds(safe_normalize(light->get_dir()), 0.0f, M_PI_2_F);
+    }
+
+    emitters.push_back(emitter);
+  }
+
+  /* Build tree, which reorders the emitters. */
+  const LightTree tree(emitters, 8);
+  const vector<LightTreeNode> &nodes = tree.get_nodes();
+
+  if (progress.get_cancel()) {
+    return;
+  }
+
+  KernelLightTreeNode *knodes = dscene->light_tree_nodes.alloc(nodes.size());
+  for (int i = 0; i < nodes.size(); i++) {
+    const LightTreeNode &node = nodes[i];
+    const float3 centroid = node.bbox.center();
+    const float3 axis = node.bcone.axis;
+
+    knodes[i].centroid[0] = centroid.x;
+    knodes[i].centroid[1] = centroid.y;
+    knodes[i].centroid[2] = centroid.z;
+    knodes[i].radius = 0.5f * len(node.bbox.size());
+    knodes[i].axis[0] = axis.x;
+    knodes[i].axis[1] = axis.y;
+    knodes[i].axis[2] = axis.z;
+    knodes[i].theta_o = node.bcone.theta_o;
+    knodes[i].theta_e = node.bcone.theta_e;
+    knodes[i].energy = node.energy;
+    knodes[i].num_emitters = node.num_emitters;
+    knodes[i].child_index = node.child_index;
+    knodes[i].parent_index = node.parent_index;
+  }
+
+  /* Distant lights are stored after the emitters in the tree. */
+  const int num_emitters = emitters.size();
+  const int num_distant = distant_emitters.size();
+  emitters.insert(emitters.end(), distant_emitters.begin(), distant_emitters.end());
+
+  KernelLightTreeEmitter *kemitters = dscene->light_tree_emitters.alloc(emitters.size());
+  uint *light_to_tree = dscene->light_to_tree.alloc(num_distribution);
+  for (int i = 0; i < emitters.size(); i++) {
+    const LightTreeEmitter &emitter = emitters[i];
+    const float3 centroid = emitter.centroid();
+    const float3 axis = emitter.bcone.axis;
+
+    kemitters[i].centroid[0] = centroid.x;
+    kemitters[i].centroid[1] = centroid.y;
+    kemitters[i].centroid[2] = centroid.z;
+    kemitters[i].radius = 0.5f * len(emitter.bbox.size());
+    kemitters[i].axis[0] = axis.x;
+    kemitters[i].axis[1] = axis.y;
+    kemitters[i].axis[2] = axis.z;
+    kemitters[i].theta_o = emitter.bcone.theta_o;
+    kemitters[i].theta_e = emitter.bcone.theta_e;
+    kemitters[i].energy = emitter.energy;
+    kemitters[i].distribution_index = emitter.distribution_index;
+    kemitters[i].leaf_index = (i < num_emitters) ? emitter.leaf_index : -1;
+
+    light_to_tree[emitter.distribution_index] = i;
+  }
+
+  VLOG_INFO << "Light tree with " << nodes.size() << " nodes for " << num_emitters
+            << " emitters, and " << num_distant << " distant lights.";
+
+  kintegrator->use_light_tree = true;
+  kintegrator->light_tree_num_emitters = num_emitters;
+  kintegrator->light_tree_num_distant = num_distant;
+  /* Sample one, with 0.5 probability of distant lights or the tree. */
+  if (num_distant == 0) {
+    kintegrator->light_tree_distant_probability = 0.0f;
+  }
+  else if (num_emitters == 0) {
+    kintegrator->light_tree_distant_probability = 1.0f;
+  }
+  else {
+    kintegrator->light_tree_distant_probability = 0.5f;
+  }
+
+  dscene->light_tree_nodes.copy_to_device();
+  dscene->light_tree_emitters.copy_to_device();
+  dscene->light_to_tree.copy_to_device();
+}
+
 static void background_cdf(
     int start, int end, int res_x, int res_y, const vector<float3> *pixels, float2 *cond_cdf)
 {
@@ -994,6 +1204,10 @@ void LightManager::device_update(Device *device,
   if (progress.get_cancel())
     return;
 
+  device_update_tree(device, dscene, scene, progress);
+  if (progress.get_cancel())
+    return;
+
   if (need_update_background) {
     device_update_background(device, dscene, scene, progress);
     if (progress.get_cancel())
@@ -1011,6 +1225,9 @@ void LightManager::device_update(Device *device,
 void LightManager::device_free(Device *, DeviceScene *dscene, const bool free_background)
 {
   dscene->light_distribution.free();
+  dscene->light_tree_nodes.free();
+  dscene->light_tree_emitters.free();
+  dscene->light_to_tree.free();
   dscene->lights.free();
   if (free_background) {
     dscene->light_background_marginal_cdf.free();
@@ -0,0 +1,235 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#include "scene/light_tree.h"
+
+#include "util/algorithm.h"
+#include "util/math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Orientation Bounds */
+
+float OrientationBounds::measure() const
+{
+  const float theta_w = fminf(theta_o + theta_e, M_PI_F);
+  const float cos_theta_o = cosf(theta_o);
+  const float sin_theta_o = sinf(theta_o);
+
+  return M_2PI_F * (1.0f - cos_theta_o) +
+         M_PI_2_F * (2.0f * theta_w * sin_theta_o - cosf(theta_o - 2.0f * theta_w) -
+                     2.0f * theta_o * sin_theta_o + cos_theta_o);
+}
+
+OrientationBounds merge(const OrientationBounds &a, const OrientationBounds &b)
+{
+  if (a.is_empty()) {
+    return b;
+  }
+  if (b.is_empty()) {
+    return a;
+  }
+
+  /* Make sure that a has the widest bounds. */
+  if (a.theta_o < b.theta_o) {
+    return merge(b, a);
+  }
+
+  const float theta_e = fmaxf(a.theta_e, b.theta_e);
+  const float theta_d = safe_acosf(dot(a.axis, b.axis));
+
+  /* Bounds of b are contained in a. */
+  if (fminf(theta_d + b.theta_o, M_PI_F) <= a.theta_o) {
+    return OrientationBounds(a.axis, a.theta_o, theta_e);
+  }
+
+  const float theta_o = (a.theta_o + theta_d + b.theta_o) * 0.5f;
+  if (theta_o >= M_PI_F) {
+    return OrientationBounds(a.axis, M_PI_F, theta_e);
+  }
+
+  /* Rotate the axis of a towards the axis of b. */
+  const float3 ortho = cross(a.axis, b.axis);
+  if (len_squared(ortho) < 1e-12f) {
+    return OrientationBounds(a.axis, M_PI_F, theta_e);
+  }
+
+  const float3 axis = rotate_around_axis(a.axis, normalize(ortho), theta_o - a.theta_o);
+  return OrientationBounds(axis, theta_o, theta_e);
+}
+
+/* Light Tree */
+
+static const int LIGHT_TREE_NUM_BINS = 12;
+
+struct LightTreeBin {
+  BoundBox bbox = BoundBox::empty;
+  OrientationBounds bcone = OrientationBounds::empty;
+  float energy = 0.0f;
+  int num_emitters = 0;
+
+  void add(const BoundBox &bbox_, const OrientationBounds &bcone_, float energy_, int num)
+  {
+    bbox.grow(bbox_);
+    bcone = merge(bcone, bcone_);
+    energy += energy_;
+    num_emitters += num;
+  }
+
+  float cost() const
+  {
+    return energy * bcone.measure() * bbox.area();
+  }
+};
+
+static int light_tree_bin_index(const float3 &centroid,
+                                const BoundBox &centroid_bbox,
+                                const int dim)
+{
+  const float extent = centroid_bbox.max[dim] - centroid_bbox.min[dim];
+  const int bin = (int)((centroid[dim] - centroid_bbox.min[dim]) / extent * LIGHT_TREE_NUM_BINS);
+  return clamp(bin, 0, LIGHT_TREE_NUM_BINS - 1);
+}
+
+LightTree::LightTree(vector<LightTreeEmitter> &emitters, int max_emitters_in_leaf)
+    : emitters_(emitters), max_emitters_in_leaf_(max_emitters_in_leaf)
+{
+  if (emitters_.empty()) {
+    return;
+  }
+
+  nodes_.reserve(emitters_.size() * 2);
+  recursive_build(0, emitters_.size(), -1);
+}
+
+int LightTree::recursive_build(const int start, const int end, const int parent_index)
+{
+  const int node_index = nodes_.size();
+
+  LightTreeNode node;
+  node.bbox = BoundBox::empty;
+  node.bcone = OrientationBounds::empty;
+  node.energy = 0.0f;
+  node.parent_index = parent_index;
+
+  BoundBox centroid_bbox = BoundBox::empty;
+  for (int i = start; i < end; i++) {
+    const LightTreeEmitter &emitter = emitters_[i];
+    node.bbox.grow(emitter.bbox);
+    node.bcone = merge(node.bcone, emitter.bcone);
+    node.energy += emitter.energy;
+    centroid_bbox.grow(emitter.centroid());
+  }
+
+  const int num_emitters = end - start;
+  int split_dim = -1;
+  int split_bin = 0;
+  bool do_split = false;
+
+  if (num_emitters > 1) {
+    do_split = find_split(start, end, centroid_bbox, node, &split_dim, &split_bin);
+    /* Split big leaves even when it is not worth it, leaves are iterated over in the kernel. */
+    do_split |= (num_emitters > max_emitters_in_leaf_);
+  }
+
+  if (!do_split) {
+    node.num_emitters = num_emitters;
+    node.child_index = start;
+    nodes_.push_back(node);
+
+    for (int i = start; i < end; i++) {
+      emitters_[i].leaf_index = node_index;
+    }
+    return node_index;
+  }
+
+  int middle;
+  if (split_dim != -1) {
+    LightTreeEmitter *middle_emitter = std::partition(
+        &emitters_[start], &emitters_[end - 1] + 1, [&](const LightTreeEmitter &emitter) {
+          return light_tree_bin_index(emitter.centroid(), centroid_bbox, split_dim) < split_bin;
+        });
+    middle = middle_emitter - &emitters_[0];
+  }
+  else {
+    /* All centroids are at the same position, split in the middle. */
+    middle = (start + end) / 2;
+  }
+
+  node.num_emitters = 0;
+  node.child_index = -1;
+  nodes_.push_back(node);
+
+  recursive_build(start, middle, node_index);
+  const int right_index = recursive_build(middle, end, node_index);
+  nodes_[node_index].child_index = right_index;
+
+  return node_index;
+}
+
+/* Find the split with the lowest cost, as described in the paper of Conty and Kulla. Returns
+ * false when there is no split with a lower cost than not splitting the node, split_dim is set
+ * to -1 when there is no split at all because the emitter centroids are at the same position. */
+bool LightTree::find_split(const int start,
+                           const int end,
+                           const BoundBox &centroid_bbox,
+                           const LightTreeNode &node,
+                           int *r_split_dim,
+                           int *r_split_bin)
+{
+  const float3 extent = node.bbox.size();
+  const float max_extent = max(extent.x, max(extent.y, extent.z));
+  const float node_cost = node.bcone.measure() * node.bbox.area();
+
+  float min_cost = FLT_MAX;
+
+  for (int dim = 0; dim < 3; dim++) {
+    if (centroid_bbox.max[dim] <= centroid_bbox.min[dim]) {
+      continue;
+    }
+
+    LightTreeBin bins[LIGHT_TREE_NUM_BINS];
+    for (int i = start; i < end; i++) {
+      const LightTreeEmitter &emitter = emitters_[i];
+      const int bin = light_tree_bin_index(emitter.centroid(), centroid_bbox, dim);
+      bins[bin].add(emitter.bbox, emitter.bcone, emitter.energy, 1);
+    }
+
+    /* Cost of the right side for splits before each bin. */
+    float right_costs[LIGHT_TREE_NUM_BINS];
+    int right_num_emitters[LIGHT_TREE_NUM_BINS];
+    LightTreeBin right;
+    for (int bin = LIGHT_TREE_NUM_BINS - 1; bin > 0; bin--) {
+      right.add(bins[bin].bbox, bins[bin].bcone, bins[bin].energy, bins[bin].num_emitters);
+      right_costs[bin] = right.cost();
+      right_num_emitters[bin] = right.num_emitters;
+    }
+
+    /* Regularization, to avoid thin bounds. */
+    const float regularization = max_extent / extent[dim];
+
+    LightTreeBin left;
+    for (int bin = 1; bin < LIGHT_TREE_NUM_BINS; bin++) {
+      left.add(
+          bins[bin - 1].bbox, bins[bin - 1].bcone, bins[bin - 1].energy, bins[bin - 1].num_emitters);
+      if (left.num_emitters == 0 || right_num_emitters[bin] == 0) {
+        continue;
+      }
+
+      float cost = regularization * (left.cost() + right_costs[bin]);
+      if (node_cost > 0.0f) {
+        cost /= node_cost;
+      }
+
+      if (cost < min_cost) {
+        min_cost = cost;
+        *r_split_dim = dim;
+        *r_split_bin = bin;
+      }
+    }
+  }
+
+  return min_cost < node.energy;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "util/boundbox.h"
+#include "util/types.h"
+#include "util/vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Orientation Bounds
+ *
+ * Bounds the directions in which emitters emit light: the emission is within theta_o of the
+ * axis, and spreads over theta_e more. */
+
+struct OrientationBounds {
+  float3 axis;
+  float theta_o;
+  float theta_e;
+
+  enum empty_t { empty = 0 };
+
+  OrientationBounds() = default;
+
+  OrientationBounds(const float3 &axis_, float theta_o_, float theta_e_)
+      : axis(axis_), theta_o(theta_o_), theta_e(theta_e_)
+  {
+  }
+
+  OrientationBounds(empty_t) : axis(make_float3(0.0f, 0.0f, 1.0f)), theta_o(-1.0f), theta_e(0.0f)
+  {
+  }
+
+  bool is_empty() const
+  {
+    return theta_o < 0.0f;
+  }
+
+  /* Solid angle measure of the bounds, used for the cost of splits. */
+  float measure() const;
+};
+
+OrientationBounds merge(const OrientationBounds &a, const OrientationBounds &b);
+
+/* Light Tree Emitter
+ *
+ * Emissive triangle or lamp, referenced by its index in the light distribution. */
+
+struct LightTreeEmitter {
+  BoundBox bbox;
+  OrientationBounds bcone;
+  float energy;
+  int distribution_index;
+  int leaf_index;
+
+  float3 centroid() const
+  {
+    return bbox.center();
+  }
+};
+
+/* Light Tree Node
+ *
+ * The first child of inner nodes directly follows the node, child_index is the index of the
+ * second child. For leaf nodes it is the index of the first emitter. */
+
+struct LightTreeNode {
+  BoundBox bbox;
+  OrientationBounds bcone;
+  float energy;
+  int num_emitters;
+  int child_index;
+  int parent_index;
+};
+
+/* Light Tree
+ *
+ * Binary tree over the emitters, built top-down by binning the emitter centroids and choosing
+ * the split with the lowest cost, which accounts for energy, spatial and orientation bounds.
+ * Building reorders the emitters, so that the emitters of each leaf are consecutive. */
+
+class LightTree {
+ public:
+  LightTree(vector<LightTreeEmitter> &emitters, int max_emitters_in_leaf);
+
+  const vector<LightTreeNode> &get_nodes() const
+  {
+    return nodes_;
+  }
+
+ protected:
+  int recursive_build(int start, int end, int parent_index);
+  bool find_split(int start,
+                  int end,
+                  const BoundBox &centroid_bbox,
+                  const LightTreeNode &node,
+                  int *r_split_dim,
+                  int *r_split_bin);
+
+  vector<LightTreeEmitter> &emitters_;
+  vector<LightTreeNode> nodes_;
+  int max_emitters_in_leaf_;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
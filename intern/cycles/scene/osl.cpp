@@ -35,6 +35,9 @@ CCL_NAMESPACE_BEGIN
 
 /* Shared Texture and Shading System */
 
+/* Size in megabytes of the texture cache when the scene does not limit it. */
+static const float texture_cache_default_size = 16384.0f;
+
 OSL::TextureSystem *OSLShaderManager::ts_shared = NULL;
 int OSLShaderManager::ts_shared_users = 0;
 thread_mutex OSLShaderManager::ts_shared_mutex;
@@ -99,6 +102,13 @@ void OSLShaderManager::device_update_specific(Device *device,
   /* set texture system */
   scene->image_manager->set_osl_texture_system((void *)ts);
 
+  /* Tiles of all resolution levels are loaded on demand, and the least recently used ones are
+   * freed once the cache exceeds its size. The texture system is shared between renders, so the
+   * limit of the most recently updated scene is used. */
+  const int texture_cache_size = scene->params.texture_cache_size;
+  ts->attribute("max_memory_MB",
+                (texture_cache_size > 0) ? (float)texture_cache_size : texture_cache_default_size);
+
   /* create shaders */
   OSLGlobals *og = (OSLGlobals *)device->get_cpu_osl_memory();
   Shader *background_shader = scene->background->get_shader(scene);
@@ -189,8 +199,8 @@ void OSLShaderManager::texture_system_init()
     ts_shared->attribute("autotile", 64);
     ts_shared->attribute("gray_to_rgb", 1);
 
-    /* effectively unlimited for now, until we support proper mipmap lookups */
-    ts_shared->attribute("max_memory_MB", 16384);
+    /* Effectively unlimited unless the scene sets a limit, see #device_update_specific. */
+    ts_shared->attribute("max_memory_MB", texture_cache_default_size);
   }
 
   ts = ts_shared;
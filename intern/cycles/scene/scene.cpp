@@ -71,6 +71,9 @@ DeviceScene::DeviceScene(Device *device)
       lights(device, "lights", MEM_GLOBAL),
       light_background_marginal_cdf(device, "light_background_marginal_cdf", MEM_GLOBAL),
       light_background_conditional_cdf(device, "light_background_conditional_cdf", MEM_GLOBAL),
+      light_tree_nodes(device, "light_tree_nodes", MEM_GLOBAL),
+      light_tree_emitters(device, "light_tree_emitters", MEM_GLOBAL),
+      light_to_tree(device, "light_to_tree", MEM_GLOBAL),
       particles(device, "particles", MEM_GLOBAL),
       svm_nodes(device, "svm_nodes", MEM_GLOBAL),
       shaders(device, "shaders", MEM_GLOBAL),
@@ -81,6 +84,38 @@ DeviceScene::DeviceScene(Device *device)
   memset((void *)&data, 0, sizeof(data));
 }
 
+void DeviceScene::set_geometry_host_mapped(bool use_host_mapped, const string &directory)
+{
+  device_memory *geometry_memory[] = {&bvh_nodes,
+                                      &bvh_leaf_nodes,
+                                      &prim_type,
+                                      &prim_visibility,
+                                      &prim_index,
+                                      &prim_object,
+                                      &prim_time,
+                                      &tri_verts,
+                                      &tri_shader,
+                                      &tri_vnormal,
+                                      &tri_vindex,
+                                      &tri_patch,
+                                      &tri_patch_uv,
+                                      &curves,
+                                      &curve_keys,
+                                      &curve_segments,
+                                      &patches,
+                                      &points,
+                                      &points_shader,
+                                      &attributes_float,
+                                      &attributes_float2,
+                                      &attributes_float3,
+                                      &attributes_float4,
+                                      &attributes_uchar4};
+
+  for (device_memory *mem : geometry_memory) {
+    mem->set_host_mapped(use_host_mapped, directory);
+  }
+}
+
 Scene::Scene(const SceneParams &params_, Device *device)
     : name("Scene"),
       bvh(NULL),
@@ -149,8 +184,10 @@ void Scene::free_memory(bool final)
     delete p;
   foreach (Object *o, objects)
     delete o;
-  foreach (Geometry *g, geometry)
+  foreach (Geometry *g, geometry) {
+    GeometryManager::cache_bvh_pack(g);
     delete g;
+  }
   foreach (ParticleSystem *p, particle_systems)
     delete p;
   foreach (Light *l, lights)
@@ -871,24 +908,28 @@ template<> void Scene::delete_node_impl(Light *node)
 
 template<> void Scene::delete_node_impl(Mesh *node)
 {
+  geometry_manager->cache_bvh(node);
   delete_node_from_array(geometry, static_cast<Geometry *>(node));
   geometry_manager->tag_update(this, GeometryManager::MESH_REMOVED);
 }
 
 template<> void Scene::delete_node_impl(Hair *node)
 {
+  geometry_manager->cache_bvh(node);
   delete_node_from_array(geometry, static_cast<Geometry *>(node));
   geometry_manager->tag_update(this, GeometryManager::HAIR_REMOVED);
 }
 
 template<> void Scene::delete_node_impl(Volume *node)
 {
+  geometry_manager->cache_bvh(node);
   delete_node_from_array(geometry, static_cast<Geometry *>(node));
   geometry_manager->tag_update(this, GeometryManager::MESH_REMOVED);
 }
 
 template<> void Scene::delete_node_impl(PointCloud *node)
 {
+  geometry_manager->cache_bvh(node);
   delete_node_from_array(geometry, static_cast<Geometry *>(node));
   geometry_manager->tag_update(this, GeometryManager::POINT_REMOVED);
 }
@@ -903,6 +944,7 @@ template<> void Scene::delete_node_impl(Geometry *node)
     flag = GeometryManager::MESH_REMOVED;
   }
 
+  geometry_manager->cache_bvh(node);
   delete_node_from_array(geometry, node);
   geometry_manager->tag_update(this, flag);
 }
@@ -979,6 +1021,9 @@ template<> void Scene::delete_nodes(const set<Light *> &nodes, const NodeOwner *
 
 template<> void Scene::delete_nodes(const set<Geometry *> &nodes, const NodeOwner *owner)
 {
+  foreach (Geometry *geom, nodes) {
+    geometry_manager->cache_bvh(geom);
+  }
   remove_nodes_in_set(nodes, geometry, owner);
   geometry_manager->tag_update(this, GeometryManager::GEOMETRY_REMOVED);
 }
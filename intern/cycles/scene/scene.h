@@ -110,6 +110,9 @@ class DeviceScene {
   device_vector<KernelLight> lights;
   device_vector<float2> light_background_marginal_cdf;
   device_vector<float2> light_background_conditional_cdf;
+  device_vector<KernelLightTreeNode> light_tree_nodes;
+  device_vector<KernelLightTreeEmitter> light_tree_emitters;
+  device_vector<uint> light_to_tree;
 
   /* particles */
   device_vector<KernelParticle> particles;
@@ -130,6 +133,9 @@ class DeviceScene {
   KernelData data;
 
   DeviceScene(Device *device);
+
+  /* Allocate geometry and BVH arrays in memory mapped files, see #SceneParams. */
+  void set_geometry_host_mapped(bool use_host_mapped, const string &directory);
 };
 
 /* Scene Parameters */
@@ -149,10 +155,23 @@ class SceneParams {
   bool use_bvh_spatial_split;
   bool use_bvh_compact_structure;
   bool use_bvh_unaligned_nodes;
+  /* Store child bounds of BVH2 nodes quantized, see BVHParams::use_quantized_nodes. */
+  bool use_bvh_quantized_nodes;
   int num_bvh_time_steps;
   int hair_subdivisions;
   CurveShapeType hair_shape;
   int texture_limit;
+  /* Read tiles of image files while rendering on the CPU, see #TextureCache. */
+  bool use_texture_cache;
+  /* Memory limit in megabytes of the texture cache and the OpenImageIO texture cache, zero for
+   * no limit. */
+  int texture_cache_size;
+  /* Store geometry in memory mapped files on CPU devices, so that the operating system can page
+   * it out when the scene does not fit in memory. Only BVH2 nodes are stored this way, an Embree
+   * BVH remains in memory allocated by Embree. An empty directory uses the system temporary
+   * directory. */
+  bool use_out_of_core_geometry;
+  string out_of_core_directory;
 
   bool background;
 
@@ -164,10 +183,14 @@ class SceneParams {
     use_bvh_spatial_split = false;
     use_bvh_compact_structure = true;
     use_bvh_unaligned_nodes = true;
+    use_bvh_quantized_nodes = false;
     num_bvh_time_steps = 0;
     hair_subdivisions = 3;
     hair_shape = CURVE_RIBBON;
     texture_limit = 0;
+    use_texture_cache = false;
+    texture_cache_size = 0;
+    use_out_of_core_geometry = false;
     background = true;
   }
 
@@ -178,9 +201,14 @@ class SceneParams {
              use_bvh_spatial_split == params.use_bvh_spatial_split &&
              use_bvh_compact_structure == params.use_bvh_compact_structure &&
              use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes &&
+             use_bvh_quantized_nodes == params.use_bvh_quantized_nodes &&
              num_bvh_time_steps == params.num_bvh_time_steps &&
              hair_subdivisions == params.hair_subdivisions && hair_shape == params.hair_shape &&
-             texture_limit == params.texture_limit);
+             texture_limit == params.texture_limit &&
+             use_texture_cache == params.use_texture_cache &&
+             texture_cache_size == params.texture_cache_size &&
+             use_out_of_core_geometry == params.use_out_of_core_geometry &&
+             out_of_core_directory == params.out_of_core_directory);
   }
 
   int curve_subdivisions()
@@ -387,6 +387,7 @@ ShaderManager::ShaderManager()
 {
   update_flags = UPDATE_ALL;
   beckmann_table_offset = TABLE_OFFSET_INVALID;
+  next_attribute_id = ATTR_STD_NUM;
 
   init_xyz_transforms();
 }
@@ -424,11 +425,34 @@ uint ShaderManager::get_attribute_id(ustring name)
   if (it != unique_attribute_id.end())
     return it->second;
 
-  uint id = (uint)ATTR_STD_NUM + unique_attribute_id.size();
+  uint id = next_attribute_id++;
   unique_attribute_id[name] = id;
   return id;
 }
 
+bool ShaderManager::claim_attribute_id(ustring name, uint id)
+{
+  thread_scoped_spin_lock lock(attribute_lock_);
+
+  AttributeIDMap::iterator it = unique_attribute_id.find(name);
+  if (it != unique_attribute_id.end()) {
+    return it->second == id;
+  }
+
+  if (id < (uint)ATTR_STD_NUM) {
+    return false;
+  }
+  foreach (const AttributeIDMap::value_type &other, unique_attribute_id) {
+    if (other.second == id) {
+      return false;
+    }
+  }
+
+  unique_attribute_id[name] = id;
+  next_attribute_id = max(next_attribute_id, id + 1);
+  return true;
+}
+
 uint ShaderManager::get_attribute_id(AttributeStandard std)
 {
   return (uint)std;
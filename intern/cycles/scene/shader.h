@@ -194,6 +194,9 @@ class ShaderManager {
   /* get globally unique id for a type of attribute */
   uint get_attribute_id(ustring name);
   uint get_attribute_id(AttributeStandard std);
+  /* Use the given id for an attribute, as in a compiled shader reused from another scene.
+   * Returns false if the attribute or the id are already used otherwise. */
+  bool claim_attribute_id(ustring name, uint id);
 
   /* get shader id for mesh faces */
   int get_shader_id(Shader *shader, bool smooth = false);
@@ -225,6 +228,7 @@ class ShaderManager {
 
   typedef unordered_map<ustring, uint, ustringHash> AttributeIDMap;
   AttributeIDMap unique_attribute_id;
+  uint next_attribute_id;
 
   static thread_mutex lookup_table_mutex;
   static vector<float> beckmann_table;
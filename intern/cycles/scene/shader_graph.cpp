@@ -357,7 +357,11 @@ void ShaderGraph::simplify(Scene *scene)
   }
 }
 
-void ShaderGraph::finalize(Scene *scene, bool do_bump, bool do_simplify, bool bump_in_object_space)
+void ShaderGraph::finalize(Scene *scene,
+                           bool do_bump,
+                           bool do_simplify,
+                           bool bump_in_object_space,
+                           bool do_texture_differentials)
 {
   /* before compiling, the shader graph may undergo a number of modifications.
    * currently we set default geometry shader inputs, and create automatic bump
@@ -370,6 +374,9 @@ void ShaderGraph::finalize(Scene *scene, bool do_bump, bool do_simplify, bool bu
     if (do_bump)
       bump_from_displacement(bump_in_object_space);
 
+    if (do_texture_differentials)
+      image_texture_differentials();
+
     ShaderInput *surface_in = output()->input("Surface");
     ShaderInput *volume_in = output()->input("Volume");
 
@@ -763,6 +770,51 @@ void ShaderGraph::compute_displacement_hash()
   displacement_hash = md5.get_hex();
 }
 
+void ShaderGraph::compute_content_hash()
+{
+  /* Compute hash of all nodes and links in the graph before it is finalized, to find shaders
+   * compiled earlier from a graph with the same content. Graphs with nodes that hold on to scene
+   * resources or depend on scene settings are not hashed, as their compiled shader can not be
+   * reused. */
+  content_hash = "";
+
+  MD5Hash md5;
+  foreach (ShaderNode *node, nodes) {
+    if (node->has_integrator_dependency() ||
+        node->special_type == SHADER_SPECIAL_TYPE_OUTPUT_AOV ||
+        node->special_type == SHADER_SPECIAL_TYPE_OSL ||
+        node->type == SkyTextureNode::get_node_type() ||
+        node->type == PointDensityTextureNode::get_node_type() ||
+        node->type == IESLightNode::get_node_type()) {
+      return;
+    }
+
+    node->hash(md5);
+    foreach (ShaderInput *input, node->inputs) {
+      int link_id = (input->link) ? input->link->parent->id : 0;
+      md5.append((uint8_t *)&link_id, sizeof(link_id));
+      md5.append((input->link) ? input->link->name().c_str() : "");
+    }
+
+    if (node->special_type == SHADER_SPECIAL_TYPE_IMAGE_SLOT) {
+      /* Tiles are culled against the geometry using the image when compiling. */
+      if (node->type == ImageTextureNode::get_node_type() &&
+          static_cast<ImageTextureNode *>(node)->get_tiles().size() > 1) {
+        return;
+      }
+
+      /* Images may be added before compiling, with content not described by the sockets. */
+      const ImageHandle &handle = static_cast<ImageSlotTextureNode *>(node)->handle;
+      for (int i = 0; i < handle.num_tiles(); i++) {
+        const int slot = handle.svm_slot(i);
+        md5.append((uint8_t *)&slot, sizeof(slot));
+      }
+    }
+  }
+
+  content_hash = md5.get_hex();
+}
+
 void ShaderGraph::clean(Scene *scene)
 {
   /* Graph simplification */
@@ -941,6 +993,52 @@ void ShaderGraph::refine_bump_nodes()
   }
 }
 
+void ShaderGraph::image_texture_differentials()
+{
+  /* Image textures read through the texture cache pick the resolution level to sample from the
+   * texture coordinates at the shading point shifted by the ray differentials. Like for bump
+   * nodes, the sub-graph of the "Vector" input is copied to the "VectorDX" and "VectorDY"
+   * inputs, evaluated with the shifted position. Only flat projection is supported, and the
+   * texture coordinates must come from a link since a constant vector does not vary. */
+  vector<ShaderNode *> image_nodes;
+
+  foreach (ShaderNode *node, nodes) {
+    if (node->type == ImageTextureNode::get_node_type() && node->bump == SHADER_BUMP_NONE) {
+      ImageTextureNode *image_node = static_cast<ImageTextureNode *>(node);
+      if (image_node->get_projection() == NODE_IMAGE_PROJ_FLAT &&
+          image_node->input("Vector")->link) {
+        image_nodes.push_back(node);
+      }
+    }
+  }
+
+  foreach (ShaderNode *node, image_nodes) {
+    ShaderInput *vector_input = node->input("Vector");
+    ShaderNodeSet nodes_vector;
+    ShaderNodeMap nodes_dx;
+    ShaderNodeMap nodes_dy;
+
+    find_dependencies(nodes_vector, vector_input);
+
+    copy_nodes(nodes_vector, nodes_dx);
+    copy_nodes(nodes_vector, nodes_dy);
+
+    foreach (NodePair &pair, nodes_dx)
+      pair.second->bump = SHADER_BUMP_DX;
+    foreach (NodePair &pair, nodes_dy)
+      pair.second->bump = SHADER_BUMP_DY;
+
+    ShaderOutput *out = vector_input->link;
+    connect(nodes_dx[out->parent]->output(out->name()), node->input("VectorDX"));
+    connect(nodes_dy[out->parent]->output(out->name()), node->input("VectorDY"));
+
+    foreach (NodePair &pair, nodes_dx)
+      add(pair.second);
+    foreach (NodePair &pair, nodes_dy)
+      add(pair.second);
+  }
+}
+
 void ShaderGraph::bump_from_displacement(bool use_object_space)
 {
   /* generate bump mapping automatically from displacement. bump mapping is
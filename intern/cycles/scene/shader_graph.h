@@ -301,6 +301,7 @@ class ShaderGraph : public NodeOwner {
   bool finalized;
   bool simplified;
   string displacement_hash;
+  string content_hash;
 
   ShaderGraph();
   ~ShaderGraph();
@@ -317,11 +318,13 @@ class ShaderGraph : public NodeOwner {
 
   void remove_proxy_nodes();
   void compute_displacement_hash();
+  void compute_content_hash();
   void simplify(Scene *scene);
   void finalize(Scene *scene,
                 bool do_bump = false,
                 bool do_simplify = false,
-                bool bump_in_object_space = false);
+                bool bump_in_object_space = false,
+                bool do_texture_differentials = false);
 
   int get_num_closures();
 
@@ -355,6 +358,7 @@ class ShaderGraph : public NodeOwner {
   void break_cycles(ShaderNode *node, vector<bool> &visited, vector<bool> &on_stack);
   void bump_from_displacement(bool use_object_space);
   void refine_bump_nodes();
+  void image_texture_differentials();
   void expand();
   void default_inputs(bool do_osl);
   void transform_multi_closure(ShaderNode *node, ShaderOutput *weight_out, bool volume);
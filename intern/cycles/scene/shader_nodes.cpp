@@ -241,6 +241,9 @@ NODE_DEFINE(ImageTextureNode)
   SOCKET_BOOLEAN(animated, "Animated", false);
 
   SOCKET_IN_POINT(vector, "Vector", zero_float3(), SocketType::LINK_TEXTURE_UV);
+  /* Vector shifted by the ray differentials, see ShaderGraph::image_texture_differentials. */
+  SOCKET_IN_POINT(vector_dx, "VectorDX", zero_float3(), SocketType::SVM_INTERNAL);
+  SOCKET_IN_POINT(vector_dy, "VectorDY", zero_float3(), SocketType::SVM_INTERNAL);
 
   SOCKET_OUT_COLOR(color, "Color");
   SOCKET_OUT_FLOAT(alpha, "Alpha");
@@ -335,6 +338,17 @@ void ImageTextureNode::cull_tiles(Scene *scene, ShaderGraph *graph)
   tiles.steal_data(new_tiles);
 }
 
+void ImageTextureNode::add_image(Scene *scene,
+                                 ShaderGraph *graph,
+                                 const array<int> &preferred_slots)
+{
+  if (handle.empty()) {
+    cull_tiles(scene, graph);
+    ImageManager *image_manager = scene->image_manager;
+    handle = image_manager->add_image(filename.string(), image_params(), tiles, preferred_slots);
+  }
+}
+
 void ImageTextureNode::attributes(Shader *shader, AttributeRequestSet *attributes)
 {
 #ifdef WITH_PTEX
@@ -353,14 +367,12 @@ void ImageTextureNode::attributes(Shader *shader, AttributeRequestSet *attribute
 void ImageTextureNode::compile(SVMCompiler &compiler)
 {
   ShaderInput *vector_in = input("Vector");
+  ShaderInput *vector_dx_in = input("VectorDX");
+  ShaderInput *vector_dy_in = input("VectorDY");
   ShaderOutput *color_out = output("Color");
   ShaderOutput *alpha_out = output("Alpha");
 
-  if (handle.empty()) {
-    cull_tiles(compiler.scene, compiler.current_graph);
-    ImageManager *image_manager = compiler.scene->image_manager;
-    handle = image_manager->add_image(filename.string(), image_params(), tiles);
-  }
+  add_image(compiler.scene, compiler.current_graph);
 
   /* All tiles have the same metadata. */
   const ImageMetaData metadata = handle.metadata();
@@ -383,6 +395,17 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
     }
   }
 
+  /* Shifted vectors for picking mip levels of cached images. */
+  const bool use_differentials = projection == NODE_IMAGE_PROJ_FLAT && vector_dx_in->link &&
+                                 vector_dy_in->link;
+  int vector_dx_offset = SVM_STACK_INVALID;
+  int vector_dy_offset = SVM_STACK_INVALID;
+  if (use_differentials) {
+    vector_dx_offset = tex_mapping.compile_begin(compiler, vector_dx_in);
+    vector_dy_offset = tex_mapping.compile_begin(compiler, vector_dy_in);
+    flags |= NODE_IMAGE_DIFFERENTIALS;
+  }
+
   if (projection != NODE_IMAGE_PROJ_BOX) {
     /* If there only is one image (a very common case), we encode it as a negative value. */
     int num_nodes;
@@ -401,6 +424,10 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
                                              flags),
                       projection);
 
+    if (use_differentials) {
+      compiler.add_node(vector_dx_offset, vector_dy_offset, 0, 0);
+    }
+
     if (num_nodes > 0) {
       for (int i = 0; i < num_nodes; i++) {
         int4 node;
@@ -430,6 +457,10 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
   }
 
   tex_mapping.compile_end(compiler, vector_in, vector_offset);
+  if (use_differentials) {
+    tex_mapping.compile_end(compiler, vector_dx_in, vector_dx_offset);
+    tex_mapping.compile_end(compiler, vector_dy_in, vector_dy_offset);
+  }
 }
 
 void ImageTextureNode::compile(OSLCompiler &compiler)
@@ -554,16 +585,25 @@ void EnvironmentTextureNode::attributes(Shader *shader, AttributeRequestSet *att
   ShaderNode::attributes(shader, attributes);
 }
 
+void EnvironmentTextureNode::add_image(Scene *scene,
+                                       ShaderGraph * /*graph*/,
+                                       const array<int> &preferred_slots)
+{
+  if (handle.empty()) {
+    ImageManager *image_manager = scene->image_manager;
+    handle = image_manager->add_image(filename.string(),
+                                      image_params(),
+                                      preferred_slots.empty() ? -1 : preferred_slots[0]);
+  }
+}
+
 void EnvironmentTextureNode::compile(SVMCompiler &compiler)
 {
   ShaderInput *vector_in = input("Vector");
   ShaderOutput *color_out = output("Color");
   ShaderOutput *alpha_out = output("Alpha");
 
-  if (handle.empty()) {
-    ImageManager *image_manager = compiler.scene->image_manager;
-    handle = image_manager->add_image(filename.string(), image_params());
-  }
+  add_image(compiler.scene, compiler.current_graph);
 
   const ImageMetaData metadata = handle.metadata();
   const bool compress_as_srgb = metadata.compress_as_srgb;
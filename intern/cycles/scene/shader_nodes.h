@@ -84,6 +84,12 @@ class ImageSlotTextureNode : public TextureNode {
     return TextureNode::equals(other) && handle == other_node.handle;
   }
 
+  /* Add the image of the node to the image manager if it has no handle yet, like compiling the
+   * node does. New images are added in the preferred slots if they are free. */
+  virtual void add_image(Scene *scene,
+                         ShaderGraph *graph,
+                         const array<int> &preferred_slots = array<int>()) = 0;
+
   ImageHandle handle;
 };
 
@@ -103,6 +109,9 @@ class ImageTextureNode : public ImageSlotTextureNode {
     return ImageSlotTextureNode::equals(other) && animated == other_node.animated;
   }
 
+  void add_image(Scene *scene,
+                 ShaderGraph *graph,
+                 const array<int> &preferred_slots = array<int>());
   ImageParams image_params() const;
 
   /* Parameters. */
@@ -115,6 +124,8 @@ class ImageTextureNode : public ImageSlotTextureNode {
   NODE_SOCKET_API(float, projection_blend)
   NODE_SOCKET_API(bool, animated)
   NODE_SOCKET_API(float3, vector)
+  NODE_SOCKET_API(float3, vector_dx)
+  NODE_SOCKET_API(float3, vector_dy)
   NODE_SOCKET_API_ARRAY(array<int>, tiles)
 
  protected:
@@ -137,6 +148,9 @@ class EnvironmentTextureNode : public ImageSlotTextureNode {
     return ImageSlotTextureNode::equals(other) && animated == other_node.animated;
   }
 
+  void add_image(Scene *scene,
+                 ShaderGraph *graph,
+                 const array<int> &preferred_slots = array<int>());
   ImageParams image_params() const;
 
   /* Parameters. */
@@ -322,6 +322,25 @@ string UpdateTimeStats::full_report(int indent_level)
   return times.full_report(indent_level + 1);
 }
 
+UpdateReuseStats::UpdateReuseStats() : num_reused(0), num_computed(0)
+{
+}
+
+string UpdateReuseStats::full_report(int indent_level)
+{
+  const string indent(indent_level * kIndentNumSpaces, ' ');
+  string result = "";
+  result += string_printf("%sReused: %d\n", indent.c_str(), num_reused.load());
+  result += string_printf("%sComputed: %d\n", indent.c_str(), num_computed.load());
+  return result;
+}
+
+void UpdateReuseStats::clear()
+{
+  num_reused = 0;
+  num_computed = 0;
+}
+
 SceneUpdateStats::SceneUpdateStats()
 {
 }
@@ -344,6 +363,10 @@ string SceneUpdateStats::full_report()
   result += "SVM:\n" + svm.full_report(1);
   result += "Tables:\n" + tables.full_report(1);
   result += "Procedurals:\n" + procedurals.full_report(1);
+  result += "Reuse:\n";
+  result += "  SVM programs:\n" + svm_programs.full_report(2);
+  result += "  Images:\n" + images.full_report(2);
+  result += "  Geometry BVHs:\n" + geometry_bvhs.full_report(2);
   return result;
 }
 
@@ -364,6 +387,10 @@ void SceneUpdateStats::clear()
   svm.times.clear();
   tables.times.clear();
   procedurals.times.clear();
+
+  svm_programs.clear();
+  images.clear();
+  geometry_bvhs.clear();
 }
 
 CCL_NAMESPACE_END
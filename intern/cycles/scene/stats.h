@@ -4,6 +4,8 @@
 #ifndef __RENDER_STATS_H__
 #define __RENDER_STATS_H__
 
+#include <atomic>
+
 #include "scene/scene.h"
 
 #include "util/stats.h"
@@ -188,6 +190,21 @@ class UpdateTimeStats {
   NamedTimeStats times;
 };
 
+/* Number of items reused from an earlier update or another scene instead of being computed
+ * again. */
+class UpdateReuseStats {
+ public:
+  UpdateReuseStats();
+
+  /* Generate full human-readable report. */
+  string full_report(int indent_level = 0);
+
+  void clear();
+
+  std::atomic<int> num_reused;
+  std::atomic<int> num_computed;
+};
+
 class SceneUpdateStats {
  public:
   SceneUpdateStats();
@@ -208,6 +225,10 @@ class SceneUpdateStats {
   UpdateTimeStats tables;
   UpdateTimeStats procedurals;
 
+  UpdateReuseStats svm_programs;
+  UpdateReuseStats images;
+  UpdateReuseStats geometry_bvhs;
+
   string full_report();
 
   void clear();
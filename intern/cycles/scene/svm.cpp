@@ -4,6 +4,7 @@
 #include "device/device.h"
 
 #include "scene/background.h"
+#include "scene/image.h"
 #include "scene/light.h"
 #include "scene/mesh.h"
 #include "scene/scene.h"
@@ -15,6 +16,7 @@
 
 #include "util/foreach.h"
 #include "util/log.h"
+#include "util/md5.h"
 #include "util/progress.h"
 #include "util/task.h"
 
@@ -34,21 +36,252 @@ void SVMShaderManager::reset(Scene * /*scene*/)
 {
 }
 
+/* Compiled Shader Cache */
+
+/* Limit of the memory used by the nodes of cached shaders, after which the least recently used
+ * shaders are freed. */
+static const size_t svm_shader_cache_max_memory = 64 * 1024 * 1024;
+
+map<string, SVMShaderManager::CachedShader> SVMShaderManager::cache;
+size_t SVMShaderManager::cache_memory = 0;
+uint64_t SVMShaderManager::cache_use_count = 0;
+thread_mutex SVMShaderManager::cache_mutex;
+
+/* Key of the shader in the cache of compiled shaders, empty if it can not be cached. */
+static string shader_cache_key(Shader *shader,
+                               const bool background,
+                               const bool texture_differentials)
+{
+  ShaderGraph *graph = shader->graph;
+
+  /* The hash is computed once before the graph is finalized, as finalizing modifies it. */
+  if (graph->content_hash.empty() && !graph->finalized) {
+    graph->compute_content_hash();
+  }
+  if (graph->content_hash.empty()) {
+    return "";
+  }
+
+  MD5Hash md5;
+  md5.append(graph->content_hash);
+  shader->hash(md5);
+
+  /* The background shader, unused shaders and shaders reading images through the texture cache
+   * are compiled differently. */
+  const uint8_t flags[3] = {
+      background, shader->reference_count() != 0, texture_differentials};
+  md5.append(flags, sizeof(flags));
+
+  return md5.get_hex();
+}
+
+static bool shader_cache_image_slots_equal(const ImageHandle &handle, const array<int> &slots)
+{
+  if ((size_t)handle.num_tiles() != slots.size()) {
+    return false;
+  }
+  for (int i = 0; i < handle.num_tiles(); i++) {
+    if (handle.svm_slot(i) != slots[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Find the node of the graph before it was finalized that the node was copied from when
+ * finalizing, so that images of copied nodes can be added for a reused shader. */
+static ShaderNode *shader_cache_original_node(ShaderGraph *graph,
+                                              ShaderNode *node,
+                                              const size_t num_graph_nodes)
+{
+  if ((size_t)node->id < num_graph_nodes) {
+    return node;
+  }
+
+  MD5Hash node_md5;
+  node->hash(node_md5);
+  const string node_hash = node_md5.get_hex();
+
+  foreach (ShaderNode *other, graph->nodes) {
+    if ((size_t)other->id < num_graph_nodes && other->type == node->type) {
+      MD5Hash other_md5;
+      other->hash(other_md5);
+      if (other_md5.get_hex() == node_hash) {
+        return other;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+bool SVMShaderManager::cache_find(const string &key,
+                                  Scene *scene,
+                                  Shader *shader,
+                                  array<int4> *svm_nodes)
+{
+  thread_scoped_lock cache_lock(cache_mutex);
+
+  map<string, CachedShader>::iterator it = cache.find(key);
+  if (it == cache.end()) {
+    return false;
+  }
+
+  CachedShader &cached = it->second;
+
+  /* Attributes and images must get the ids and slots that the compiled nodes refer to. */
+  for (const auto &attribute : cached.attribute_ids) {
+    if (!scene->shader_manager->claim_attribute_id(attribute.first, attribute.second)) {
+      return false;
+    }
+  }
+
+  if (!cached.image_slots.empty()) {
+    map<int, ShaderNode *> nodes_by_id;
+    foreach (ShaderNode *node, shader->graph->nodes) {
+      nodes_by_id[node->id] = node;
+    }
+
+    for (const auto &image : cached.image_slots) {
+      map<int, ShaderNode *>::iterator node = nodes_by_id.find(image.first);
+      if (node == nodes_by_id.end() ||
+          node->second->special_type != SHADER_SPECIAL_TYPE_IMAGE_SLOT) {
+        return false;
+      }
+
+      /* Graph nodes get their images as if they were compiled, as the light and geometry
+       * updates look them up in the graph. */
+      ImageSlotTextureNode *image_node = static_cast<ImageSlotTextureNode *>(node->second);
+      image_node->add_image(scene, shader->graph, image.second);
+      if (!shader_cache_image_slots_equal(image_node->handle, image.second)) {
+        return false;
+      }
+    }
+  }
+
+  cached.last_used = ++cache_use_count;
+  *svm_nodes = cached.svm_nodes;
+
+  shader->has_surface = cached.has_surface;
+  shader->has_surface_emission = cached.has_surface_emission;
+  shader->has_surface_transparent = cached.has_surface_transparent;
+  shader->has_surface_raytrace = cached.has_surface_raytrace;
+  shader->has_surface_bssrdf = cached.has_surface_bssrdf;
+  shader->has_bump = cached.has_bump;
+  shader->has_bssrdf_bump = cached.has_bssrdf_bump;
+  shader->has_volume = cached.has_volume;
+  shader->has_displacement = cached.has_displacement;
+  shader->has_surface_spatial_varying = cached.has_surface_spatial_varying;
+  shader->has_volume_spatial_varying = cached.has_volume_spatial_varying;
+  shader->has_volume_attribute_dependency = cached.has_volume_attribute_dependency;
+  shader->has_integrator_dependency = false;
+
+  return true;
+}
+
+void SVMShaderManager::cache_add(const string &key,
+                                 Shader *shader,
+                                 const size_t num_graph_nodes,
+                                 const map<ustring, uint> &attribute_ids,
+                                 const array<int4> &svm_nodes)
+{
+  CachedShader cached;
+  cached.svm_nodes = svm_nodes;
+  cached.attribute_ids = attribute_ids;
+
+  cached.has_surface = shader->has_surface;
+  cached.has_surface_emission = shader->has_surface_emission;
+  cached.has_surface_transparent = shader->has_surface_transparent;
+  cached.has_surface_raytrace = shader->has_surface_raytrace;
+  cached.has_surface_bssrdf = shader->has_surface_bssrdf;
+  cached.has_bump = shader->has_bump;
+  cached.has_bssrdf_bump = shader->has_bssrdf_bump;
+  cached.has_volume = shader->has_volume;
+  cached.has_displacement = shader->has_displacement;
+  cached.has_surface_spatial_varying = shader->has_surface_spatial_varying;
+  cached.has_volume_spatial_varying = shader->has_volume_spatial_varying;
+  cached.has_volume_attribute_dependency = shader->has_volume_attribute_dependency;
+
+  /* Images by the node that uses them in the graph before it was finalized, as a reused shader
+   * gets a graph that is not finalized. */
+  foreach (ShaderNode *node, shader->graph->nodes) {
+    if (node->special_type != SHADER_SPECIAL_TYPE_IMAGE_SLOT) {
+      continue;
+    }
+
+    const ImageHandle &handle = static_cast<ImageSlotTextureNode *>(node)->handle;
+    if (handle.empty()) {
+      continue;
+    }
+
+    ShaderNode *original = shader_cache_original_node(shader->graph, node, num_graph_nodes);
+    if (original == NULL) {
+      return;
+    }
+
+    array<int> slots;
+    for (int i = 0; i < handle.num_tiles(); i++) {
+      slots.push_back_slow(handle.svm_slot(i));
+    }
+
+    map<int, array<int>>::iterator it = cached.image_slots.find(original->id);
+    if (it == cached.image_slots.end()) {
+      cached.image_slots[original->id] = slots;
+    }
+    else if (it->second != slots) {
+      return;
+    }
+  }
+
+  thread_scoped_lock cache_lock(cache_mutex);
+
+  cached.last_used = ++cache_use_count;
+
+  CachedShader &entry = cache[key];
+  cache_memory -= entry.svm_nodes.size() * sizeof(int4);
+  entry = cached;
+  cache_memory += entry.svm_nodes.size() * sizeof(int4);
+
+  /* Free the least recently used shaders over the memory limit. */
+  while (cache_memory > svm_shader_cache_max_memory && cache.size() > 1) {
+    map<string, CachedShader>::iterator oldest = cache.begin();
+    for (map<string, CachedShader>::iterator it = cache.begin(); it != cache.end(); ++it) {
+      if (it->second.last_used < oldest->second.last_used) {
+        oldest = it;
+      }
+    }
+
+    cache_memory -= oldest->second.svm_nodes.size() * sizeof(int4);
+    cache.erase(oldest);
+  }
+}
+
 void SVMShaderManager::device_update_shader(Scene *scene,
                                             Shader *shader,
                                             Progress *progress,
-                                            array<int4> *svm_nodes)
+                                            array<int4> *svm_nodes,
+                                            const string &cache_key)
 {
   if (progress->get_cancel()) {
     return;
   }
   assert(shader->graph);
 
+  const size_t num_graph_nodes = shader->graph->num_node_ids;
+
   SVMCompiler::Summary summary;
   SVMCompiler compiler(scene);
   compiler.background = (shader == scene->background->get_shader(scene));
   compiler.compile(shader, *svm_nodes, 0, &summary);
 
+  if (!cache_key.empty()) {
+    cache_add(cache_key, shader, num_graph_nodes, compiler.attribute_ids, *svm_nodes);
+  }
+
+  if (scene->update_stats) {
+    scene->update_stats->svm_programs.num_computed++;
+  }
+
   VLOG_WORK << "Compilation summary:\n"
             << "Shader name: " << shader->name << "\n"
             << summary.full_report();
@@ -75,18 +308,42 @@ void SVMShaderManager::device_update_specific(Device *device,
   double start_time = time_dt();
 
   /* test if we need to update */
-  device_free(device, dscene, scene);
+  device_free_common(device, dscene, scene);
+  dscene->svm_nodes.free();
 
-  /* Build all shaders. */
-  TaskPool task_pool;
+  /* Reuse compiled shaders first, in the order of the shaders and before compiling any, so that
+   * the same shaders in another scene get their images and attributes in the same order. */
   vector<array<int4>> shader_svm_nodes(num_shaders);
+  vector<string> cache_keys(num_shaders);
+  vector<bool> reused(num_shaders, false);
   for (int i = 0; i < num_shaders; i++) {
-    task_pool.push(function_bind(&SVMShaderManager::device_update_shader,
-                                 this,
-                                 scene,
-                                 scene->shaders[i],
-                                 &progress,
-                                 &shader_svm_nodes[i]));
+    Shader *shader = scene->shaders[i];
+    const bool background = (shader == scene->background->get_shader(scene));
+    cache_keys[i] = shader_cache_key(
+        shader, background, scene->image_manager->use_texture_cache(scene) && !background);
+
+    if (!cache_keys[i].empty() && cache_find(cache_keys[i], scene, shader, &shader_svm_nodes[i])) {
+      reused[i] = true;
+      if (scene->update_stats) {
+        scene->update_stats->svm_programs.num_reused++;
+      }
+
+      VLOG_WORK << "Reusing compiled shader " << shader->name;
+    }
+  }
+
+  /* Build the other shaders. */
+  TaskPool task_pool;
+  for (int i = 0; i < num_shaders; i++) {
+    if (!reused[i]) {
+      task_pool.push(function_bind(&SVMShaderManager::device_update_shader,
+                                   this,
+                                   scene,
+                                   scene->shaders[i],
+                                   &progress,
+                                   &shader_svm_nodes[i],
+                                   cache_keys[i]));
+    }
   }
   task_pool.wait_work();
 
@@ -398,7 +655,9 @@ void SVMCompiler::add_node(const float4 &f)
 
 uint SVMCompiler::attribute(ustring name)
 {
-  return scene->shader_manager->get_attribute_id(name);
+  const uint id = scene->shader_manager->get_attribute_id(name);
+  attribute_ids[name] = id;
+  return id;
 }
 
 uint SVMCompiler::attribute(AttributeStandard std)
@@ -867,7 +1126,8 @@ void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Sum
     shader->graph->finalize(scene,
                             has_bump,
                             shader->has_integrator_dependency,
-                            shader->get_displacement_method() == DISPLACE_BOTH);
+                            shader->get_displacement_method() == DISPLACE_BOTH,
+                            scene->image_manager->use_texture_cache(scene) && !background);
   }
 
   current_shader = shader;
@@ -9,6 +9,7 @@
 #include "scene/shader_graph.h"
 
 #include "util/array.h"
+#include "util/map.h"
 #include "util/set.h"
 #include "util/string.h"
 #include "util/thread.h"
@@ -40,10 +41,59 @@ class SVMShaderManager : public ShaderManager {
   void device_free(Device *device, DeviceScene *dscene, Scene *scene) override;
 
  protected:
+  /* Shader compiled in an earlier update of any scene, reused for shaders with the same content.
+   * Only host data is cached, so that shaders are reused by other scenes too, like the scenes of
+   * the frames of an animation rendered without persistent data.
+   *
+   * The compiled nodes refer to images by slot and to named attributes by id, which depend on
+   * the scene. A shader is only reused if its images and attributes get the same slots and ids
+   * in the scene it is used for. */
+  struct CachedShader {
+    array<int4> svm_nodes;
+
+    /* Slots of the images used by the compiled nodes, by ID of the graph node using them. */
+    map<int, array<int>> image_slots;
+    /* Ids of the named attributes used by the compiled nodes. */
+    map<ustring, uint> attribute_ids;
+
+    /* Shader flags set by the compilation. */
+    bool has_surface;
+    bool has_surface_emission;
+    bool has_surface_transparent;
+    bool has_surface_raytrace;
+    bool has_surface_bssrdf;
+    bool has_bump;
+    bool has_bssrdf_bump;
+    bool has_volume;
+    bool has_displacement;
+    bool has_surface_spatial_varying;
+    bool has_volume_spatial_varying;
+    bool has_volume_attribute_dependency;
+
+    /* Order of the last use, for freeing the least recently used shaders. */
+    uint64_t last_used;
+  };
+
   void device_update_shader(Scene *scene,
                             Shader *shader,
                             Progress *progress,
-                            array<int4> *svm_nodes);
+                            array<int4> *svm_nodes,
+                            const string &cache_key);
+
+  static bool cache_find(const string &key,
+                         Scene *scene,
+                         Shader *shader,
+                         array<int4> *svm_nodes);
+  static void cache_add(const string &key,
+                        Shader *shader,
+                        const size_t num_graph_nodes,
+                        const map<ustring, uint> &attribute_ids,
+                        const array<int4> &svm_nodes);
+
+  static map<string, CachedShader> cache;
+  static size_t cache_memory;
+  static uint64_t cache_use_count;
+  static thread_mutex cache_mutex;
 };
 
 /* Graph Compiler */
@@ -114,6 +164,8 @@ class SVMCompiler {
   Scene *scene;
   ShaderGraph *current_graph;
   bool background;
+  /* Ids of the named attributes used by the compiled nodes. */
+  map<ustring, uint> attribute_ids;
 
  protected:
   /* stack */
@@ -0,0 +1,381 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#include "scene/texture_cache.h"
+#include "scene/colorspace.h"
+#include "scene/image.h"
+
+#include "util/aligned_malloc.h"
+#include "util/algorithm.h"
+#include "util/log.h"
+#include "util/math.h"
+
+CCL_NAMESPACE_BEGIN
+
+static const size_t texture_cache_tile_bytes = sizeof(float4) * TEXTURE_CACHE_TILE_SIZE *
+                                               TEXTURE_CACHE_TILE_SIZE;
+
+/* Texture Cache File */
+
+TextureCacheFile::TextureCacheFile(TextureCache *cache)
+    : cache(cache),
+      channels(0),
+      associate_alpha(false),
+      ignore_alpha(false),
+      compress_as_srgb(false)
+{
+}
+
+TextureCacheFile::~TextureCacheFile()
+{
+  if (in) {
+    in->close();
+  }
+}
+
+float4 TextureCacheFile::load_texel(const int level, const int x, const int y)
+{
+  return cache->load_texel(this, level, x, y);
+}
+
+bool TextureCacheFile::read_tile(const int level,
+                                 const int tile_x,
+                                 const int tile_y,
+                                 float4 *texels)
+{
+  const TextureCacheLevel &cache_level = levels[level];
+  const int x = tile_x * TEXTURE_CACHE_TILE_SIZE;
+  const int y = tile_y * TEXTURE_CACHE_TILE_SIZE;
+  const int width = min(TEXTURE_CACHE_TILE_SIZE, cache_level.width - x);
+  const int height = min(TEXTURE_CACHE_TILE_SIZE, cache_level.height - y);
+  const size_t num_pixels = ((size_t)width) * height;
+
+  /* Called from multiple threads, reading with an explicit subimage and level is thread-safe. */
+  vector<float> pixels(num_pixels * channels);
+  if (!in->read_tiles(0,
+                      level,
+                      x,
+                      x + width,
+                      y,
+                      y + height,
+                      0,
+                      1,
+                      0,
+                      channels,
+                      TypeDesc::FLOAT,
+                      pixels.data())) {
+    VLOG_WARNING << "Failed to read tile of texture cache: " << in->geterror();
+    return false;
+  }
+
+  /* Convert to RGBA, with the same alpha handling as #OIIOImageLoader. */
+  vector<float4> rgba(num_pixels);
+  for (size_t i = 0; i < num_pixels; i++) {
+    const float *pixel = &pixels[i * channels];
+    switch (channels) {
+      case 1:
+        rgba[i] = make_float4(pixel[0], pixel[0], pixel[0], 1.0f);
+        break;
+      case 2:
+        rgba[i] = make_float4(pixel[0], pixel[0], pixel[0], pixel[1]);
+        break;
+      case 3:
+        rgba[i] = make_float4(pixel[0], pixel[1], pixel[2], 1.0f);
+        break;
+      default:
+        rgba[i] = make_float4(pixel[0], pixel[1], pixel[2], pixel[3]);
+        if (associate_alpha) {
+          rgba[i].x *= rgba[i].w;
+          rgba[i].y *= rgba[i].w;
+          rgba[i].z *= rgba[i].w;
+        }
+        break;
+    }
+
+    if (ignore_alpha) {
+      rgba[i].w = 1.0f;
+    }
+  }
+
+  if (!colorspace.empty()) {
+    ColorSpaceManager::to_scene_linear(
+        colorspace, (float *)rgba.data(), num_pixels, true, compress_as_srgb);
+  }
+
+  /* Copy into the tile, putting all channels to 0 if either of them is not finite like the image
+   * manager does. */
+  for (int row = 0; row < height; row++) {
+    for (int col = 0; col < width; col++) {
+      const float4 texel = rgba[row * width + col];
+      texels[row * TEXTURE_CACHE_TILE_SIZE + col] = isfinite_safe(texel) ? texel : zero_float4();
+    }
+  }
+
+  return true;
+}
+
+/* Texture Cache */
+
+TextureCache::TextureCache() : max_tiles(0), clock_hand(0), next_key(1)
+{
+}
+
+TextureCache::~TextureCache()
+{
+  for (Tile *tile : tiles) {
+    assert(tile->file == NULL);
+    util_aligned_free(tile->tile.texels);
+    delete tile;
+  }
+}
+
+void TextureCache::set_max_memory(const size_t max_memory)
+{
+  thread_scoped_lock cache_lock(mutex);
+
+  max_tiles = (max_memory == 0) ? 0 : max(max_memory / texture_cache_tile_bytes, (size_t)1);
+
+  /* Free the tiles over the limit. */
+  while (max_tiles != 0 && tiles.size() > max_tiles) {
+    Tile *tile = tiles.back();
+    tiles.pop_back();
+
+    if (tile->file) {
+      tile->file->levels[tile->level].tiles[tile->index].store(NULL, std::memory_order_relaxed);
+    }
+    else {
+      free_tiles.erase(std::find(free_tiles.begin(), free_tiles.end(), tile));
+    }
+
+    util_aligned_free(tile->tile.texels);
+    delete tile;
+  }
+
+  clock_hand = 0;
+}
+
+TextureCacheFile *TextureCache::add_image(const string &filepath,
+                                          const ImageMetaData &metadata,
+                                          const bool associate_alpha,
+                                          const bool ignore_alpha)
+{
+  unique_ptr<ImageInput> in(ImageInput::create(filepath));
+  if (!in) {
+    return NULL;
+  }
+
+  ImageSpec spec = ImageSpec();
+  ImageSpec config = ImageSpec();
+
+  /* Load without automatic OIIO alpha conversion, like #OIIOImageLoader. */
+  config.attribute("oiio:UnassociatedAlpha", 1);
+
+  if (!in->open(filepath, spec, config)) {
+    return NULL;
+  }
+
+  unique_ptr<TextureCacheFile> file = make_unique<TextureCacheFile>(this);
+
+  /* Tiles of the file must fit in the tiles of the cache, so that they can be read as a whole.
+   * This is the case for the default tile size of .tx and tiled EXR files. */
+  for (int level = 0; in->seek_subimage(0, level); level++) {
+    const ImageSpec &level_spec = in->spec();
+    if (level_spec.tile_width == 0 || level_spec.tile_height == 0 ||
+        TEXTURE_CACHE_TILE_SIZE % level_spec.tile_width != 0 ||
+        TEXTURE_CACHE_TILE_SIZE % level_spec.tile_height != 0 || level_spec.depth > 1 ||
+        level_spec.x != 0 || level_spec.y != 0) {
+      VLOG_WORK << "Not using texture cache for " << filepath
+                << ", the image is not tiled or its tile size is not supported.";
+      return NULL;
+    }
+
+    TextureCacheLevel cache_level;
+    cache_level.width = level_spec.width;
+    cache_level.height = level_spec.height;
+    cache_level.tiles_x = divide_up(level_spec.width, TEXTURE_CACHE_TILE_SIZE);
+    cache_level.tiles_y = divide_up(level_spec.height, TEXTURE_CACHE_TILE_SIZE);
+    cache_level.first_key = 0;
+    cache_level.tiles = make_unique<std::atomic<TextureCacheTile *>[]>(cache_level.tiles_x *
+                                                                        cache_level.tiles_y);
+    file->levels.push_back(std::move(cache_level));
+  }
+
+  if (file->levels.empty()) {
+    return NULL;
+  }
+
+  file->in = std::move(in);
+  file->channels = min(spec.nchannels, 4);
+  file->associate_alpha = associate_alpha && spec.get_int_attribute("oiio:UnassociatedAlpha", 0);
+  file->ignore_alpha = ignore_alpha;
+  if (metadata.colorspace != u_colorspace_raw && metadata.colorspace != u_colorspace_srgb) {
+    file->colorspace = metadata.colorspace;
+    file->compress_as_srgb = metadata.compress_as_srgb;
+  }
+
+  VLOG_WORK << "Using texture cache for " << filepath << " with " << file->levels.size()
+            << " resolution levels.";
+
+  thread_scoped_lock cache_lock(mutex);
+  for (TextureCacheLevel &cache_level : file->levels) {
+    cache_level.first_key = next_key;
+    next_key += cache_level.tiles_x * cache_level.tiles_y;
+  }
+
+  return file.release();
+}
+
+void TextureCache::remove_image(TextureCacheFile *file)
+{
+  {
+    thread_scoped_lock cache_lock(mutex);
+    for (Tile *tile : tiles) {
+      if (tile->file == file) {
+        free_tile(tile);
+      }
+    }
+  }
+
+  delete file;
+}
+
+size_t TextureCache::memory_size()
+{
+  thread_scoped_lock cache_lock(mutex);
+  return tiles.size() * texture_cache_tile_bytes;
+}
+
+float4 TextureCache::load_texel(TextureCacheFile *file,
+                                const int level,
+                                const int x,
+                                const int y)
+{
+  thread_scoped_lock cache_lock(mutex);
+
+  TextureCacheLevel &cache_level = file->levels[level];
+  const int tile_x = x >> TEXTURE_CACHE_TILE_SHIFT;
+  const int tile_y = y >> TEXTURE_CACHE_TILE_SHIFT;
+  const int index = tile_y * cache_level.tiles_x + tile_x;
+  const int texel_index = (y & (TEXTURE_CACHE_TILE_SIZE - 1)) * TEXTURE_CACHE_TILE_SIZE +
+                          (x & (TEXTURE_CACHE_TILE_SIZE - 1));
+
+  /* Another thread may have loaded the tile while waiting for the lock, or be loading it. Tiles
+   * are only replaced with the lock held, so the texels can be read without checking the
+   * version. */
+  while (true) {
+    TextureCacheTile *tile = cache_level.tiles[index].load(std::memory_order_relaxed);
+    if (tile) {
+      return tile->texels[texel_index];
+    }
+
+    if (!is_loading(file, level, index) && can_acquire_tile()) {
+      break;
+    }
+
+    tile_loaded_cond.wait(cache_lock);
+  }
+
+  /* Claim a tile for loading, so that other threads don't load it as well or recycle it. */
+  Tile *cache_tile = acquire_tile();
+  cache_tile->file = file;
+  cache_tile->level = level;
+  cache_tile->index = index;
+  cache_tile->loading = true;
+  loading_tiles.push_back(cache_tile);
+
+  /* Lookups that read the texels while they are replaced see an odd or changed version. */
+  TextureCacheTile *tile = &cache_tile->tile;
+  const uint32_t version = tile->version.load(std::memory_order_relaxed);
+  tile->version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  /* Read from disk without the lock, so that other threads can use the cache meanwhile. */
+  cache_lock.unlock();
+
+  if (!file->read_tile(level, tile_x, tile_y, tile->texels)) {
+    const float4 missing = make_float4(
+        TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
+    std::fill_n(tile->texels, TEXTURE_CACHE_TILE_SIZE * TEXTURE_CACHE_TILE_SIZE, missing);
+  }
+
+  cache_lock.lock();
+
+  tile->key.store(cache_level.first_key + index, std::memory_order_relaxed);
+  tile->referenced.store(true, std::memory_order_relaxed);
+  tile->version.store(version + 2, std::memory_order_release);
+
+  cache_tile->loading = false;
+  loading_tiles.erase(std::find(loading_tiles.begin(), loading_tiles.end(), cache_tile));
+  cache_level.tiles[index].store(tile, std::memory_order_release);
+
+  tile_loaded_cond.notify_all();
+
+  return tile->texels[texel_index];
+}
+
+bool TextureCache::is_loading(const TextureCacheFile *file, const int level, const int index)
+{
+  for (const Tile *tile : loading_tiles) {
+    if (tile->file == file && tile->level == level && tile->index == index) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TextureCache::can_acquire_tile()
+{
+  /* Once the limit is reached, tiles that are being loaded can't be recycled. */
+  return !free_tiles.empty() || max_tiles == 0 || tiles.size() < max_tiles ||
+         loading_tiles.size() < tiles.size();
+}
+
+TextureCache::Tile *TextureCache::acquire_tile()
+{
+  if (!free_tiles.empty()) {
+    Tile *tile = free_tiles.back();
+    free_tiles.pop_back();
+    return tile;
+  }
+
+  if (max_tiles == 0 || tiles.size() < max_tiles) {
+    Tile *tile = new Tile();
+    tile->tile.texels = (float4 *)util_aligned_malloc(texture_cache_tile_bytes, alignof(float4));
+    tile->file = NULL;
+    tile->level = 0;
+    tile->index = 0;
+    tile->loading = false;
+    tiles.push_back(tile);
+    return tile;
+  }
+
+  /* Recycle the first tile that was not used since the clock hand last passed it. */
+  while (true) {
+    Tile *tile = tiles[clock_hand];
+    clock_hand = (clock_hand + 1) % tiles.size();
+
+    if (tile->loading) {
+      continue;
+    }
+
+    if (tile->tile.referenced.load(std::memory_order_relaxed)) {
+      tile->tile.referenced.store(false, std::memory_order_relaxed);
+      continue;
+    }
+
+    assert(tile->file != NULL);
+    tile->file->levels[tile->level].tiles[tile->index].store(NULL, std::memory_order_relaxed);
+    tile->file = NULL;
+    return tile;
+  }
+}
+
+void TextureCache::free_tile(Tile *tile)
+{
+  tile->file = NULL;
+  tile->tile.key.store(0, std::memory_order_relaxed);
+  tile->tile.referenced.store(false, std::memory_order_relaxed);
+  free_tiles.push_back(tile);
+}
+
+CCL_NAMESPACE_END
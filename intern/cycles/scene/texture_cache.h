@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#ifndef __TEXTURE_CACHE_H__
+#define __TEXTURE_CACHE_H__
+
+#include "util/image.h"
+#include "util/string.h"
+#include "util/texture_cache.h"
+#include "util/thread.h"
+#include "util/unique_ptr.h"
+#include "util/vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class ImageMetaData;
+class TextureCache;
+
+/* Tiled image file, with optional mip levels like in .tx files, whose tiles are read while
+ * rendering. */
+class TextureCacheFile : public TextureCacheImage {
+ public:
+  TextureCacheFile(TextureCache *cache);
+  ~TextureCacheFile();
+
+  float4 load_texel(const int level, const int x, const int y) override;
+
+  /* Read the texels of a tile, converted the way the image manager converts images it loads. */
+  bool read_tile(const int level, const int tile_x, const int tile_y, float4 *texels);
+
+ protected:
+  TextureCache *cache;
+
+  unique_ptr<ImageInput> in;
+  int channels;
+  bool associate_alpha;
+  bool ignore_alpha;
+  ustring colorspace;
+  bool compress_as_srgb;
+
+  friend class TextureCache;
+};
+
+/* Texture Cache
+ *
+ * Images are read from disk one tile at a time, at the resolution level that lookups need,
+ * instead of being fully loaded before rendering. Tiles are stored in a pool whose size can be
+ * limited. Once the limit is reached, the least recently used tile is recycled for the next tile
+ * that is read, using the clock algorithm. Tiles are only freed while not rendering.
+ *
+ * Tiles are read from disk without holding the lock of the cache, so threads that miss the cache
+ * only wait for each other when they need the same tile. */
+class TextureCache {
+ public:
+  TextureCache();
+  ~TextureCache();
+
+  /* Limit of the memory used by tiles in bytes, zero for no limit. Must not be called while
+   * rendering. */
+  void set_max_memory(const size_t max_memory);
+
+  /* Add an image file, or return null if it is not tiled in a way that the cache supports, in
+   * which case it should be fully loaded instead. */
+  TextureCacheFile *add_image(const string &filepath,
+                              const ImageMetaData &metadata,
+                              const bool associate_alpha,
+                              const bool ignore_alpha);
+  /* Must not be called while rendering. */
+  void remove_image(TextureCacheFile *file);
+
+  size_t memory_size();
+
+ protected:
+  struct Tile {
+    TextureCacheTile tile;
+    /* Image, level and index in the level of the tile, if it is in use. */
+    TextureCacheFile *file;
+    int level;
+    int index;
+    /* Texels are being read from disk, without the lock held. */
+    bool loading;
+  };
+
+  float4 load_texel(TextureCacheFile *file, const int level, const int x, const int y);
+  bool is_loading(const TextureCacheFile *file, const int level, const int index);
+  bool can_acquire_tile();
+  Tile *acquire_tile();
+  void free_tile(Tile *tile);
+
+  thread_mutex mutex;
+  /* Notified when a tile finished loading. */
+  thread_condition_variable tile_loaded_cond;
+  vector<Tile *> tiles;
+  vector<Tile *> free_tiles;
+  vector<Tile *> loading_tiles;
+  size_t max_tiles;
+  size_t clock_hand;
+  uint64_t next_key;
+
+  friend class TextureCacheFile;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __TEXTURE_CACHE_H__ */
@@ -320,6 +320,8 @@ TileManager::TileManager()
 
 TileManager::~TileManager()
 {
+  /* Make sure the write thread is not left running. */
+  close_tile_output();
 }
 
 int TileManager::compute_render_tile_size(const int suggested_tile_size) const
@@ -468,6 +470,8 @@ bool TileManager::open_tile_output()
 
   VLOG_WORK << "Opened tile file " << write_state_.filename;
 
+  start_write_thread();
+
   return true;
 }
 
@@ -477,7 +481,9 @@ bool TileManager::close_tile_output()
     return true;
   }
 
-  const bool success = write_state_.tile_out->close();
+  const bool write_success = stop_write_thread();
+
+  const bool success = write_state_.tile_out->close() && write_success;
   write_state_.tile_out = nullptr;
 
   if (!success) {
@@ -490,53 +496,75 @@ bool TileManager::close_tile_output()
   return true;
 }
 
-bool TileManager::write_tile(const RenderBuffers &tile_buffers)
+void TileManager::start_write_thread()
 {
-  if (!write_state_.tile_out) {
-    if (!open_tile_output()) {
-      return false;
-    }
-  }
+  DCHECK(!write_state_.write_thread);
 
-  const double time_start = time_dt();
+  write_state_.queue.clear();
+  write_state_.stop_requested = false;
+  write_state_.write_failed = false;
 
-  DCHECK_EQ(tile_buffers.params.pass_stride, buffer_params_.pass_stride);
+  write_state_.write_thread = make_unique<thread>(
+      function_bind(&TileManager::write_thread_run, this));
+}
 
-  const BufferParams &tile_params = tile_buffers.params;
+bool TileManager::stop_write_thread()
+{
+  if (!write_state_.write_thread) {
+    return !write_state_.write_failed;
+  }
 
-  const int tile_x = tile_params.full_x - buffer_params_.full_x + tile_params.window_x;
-  const int tile_y = tile_params.full_y - buffer_params_.full_y + tile_params.window_y;
+  {
+    thread_scoped_lock lock(write_state_.mutex);
+    write_state_.stop_requested = true;
+  }
+  write_state_.condition.notify_all();
 
-  const int64_t pass_stride = tile_params.pass_stride;
-  const int64_t tile_row_stride = tile_params.width * pass_stride;
+  write_state_.write_thread->join();
+  write_state_.write_thread = nullptr;
 
-  vector<float> pixel_storage;
-  const float *pixels = tile_buffers.buffer.data() + tile_params.window_x * pass_stride +
-                        tile_params.window_y * tile_row_stride;
+  return !write_state_.write_failed;
+}
 
-  /* If there is an overscan used for the tile copy pixels into single continuous block of memory
-   * without any "gaps".
-   * This is a workaround for bug in OIIO (https://github.com/OpenImageIO/oiio/pull/3176).
-   * Our task reference: T93008. */
-  if (tile_params.window_x || tile_params.window_y ||
-      tile_params.window_width != tile_params.width ||
-      tile_params.window_height != tile_params.height) {
-    pixel_storage.resize(pass_stride * tile_params.window_width * tile_params.window_height);
-    float *pixels_continuous = pixel_storage.data();
-
-    const int64_t pixels_row_stride = pass_stride * tile_params.width;
-    const int64_t pixels_continuous_row_stride = pass_stride * tile_params.window_width;
-
-    for (int i = 0; i < tile_params.window_height; ++i) {
-      memcpy(pixels_continuous, pixels, sizeof(float) * pixels_continuous_row_stride);
-      pixels += pixels_row_stride;
-      pixels_continuous += pixels_continuous_row_stride;
+void TileManager::write_thread_run()
+{
+  thread_scoped_lock lock(write_state_.mutex);
+
+  while (true) {
+    while (write_state_.queue.empty() && !write_state_.stop_requested) {
+      write_state_.condition.wait(lock);
     }
 
-    pixels = pixel_storage.data();
+    /* Stop is only handled once all queued tiles are written. */
+    if (write_state_.queue.empty()) {
+      break;
+    }
+
+    WriteTile tile = std::move(write_state_.queue.front());
+    write_state_.queue.pop_front();
+
+    /* Let the render thread queue the next tile while this one is being written. */
+    lock.unlock();
+    write_state_.condition.notify_all();
+
+    const bool success = write_tile_pixels(tile);
+
+    lock.lock();
+
+    if (!success) {
+      /* The file is unusable after an error, no need to write the rest of the tiles. */
+      write_state_.write_failed = true;
+      write_state_.queue.clear();
+      write_state_.condition.notify_all();
+    }
   }
+}
 
-  VLOG_WORK << "Write tile at " << tile_x << ", " << tile_y;
+bool TileManager::write_tile_pixels(const WriteTile &tile)
+{
+  const double time_start = time_dt();
+
+  VLOG_WORK << "Write tile at " << tile.x << ", " << tile.y;
 
   /* The image tile sizes in the OpenEXR file are different from the size of our big tiles. The
    * write_tiles() method expects a contiguous image region that will be split into tiles
@@ -544,20 +572,24 @@ bool TileManager::write_tile(const RenderBuffers &tile_buffers)
    * however OpenImageIO automatically adds the required padding.
    *
    * The only thing we have to ensure is that the tile_x and tile_y are a multiple of the
-   * image tile size, which happens in compute_render_tile_size. */
+   * image tile size, which happens in compute_render_tile_size.
+   *
+   * All image tiles of the region are passed in a single call, which allows OpenEXR to compress
+   * them in parallel using its thread pool. */
 
+  const int64_t pass_stride = buffer_params_.pass_stride;
   const int64_t xstride = pass_stride * sizeof(float);
-  const int64_t ystride = xstride * tile_params.window_width;
-  const int64_t zstride = ystride * tile_params.window_height;
+  const int64_t ystride = xstride * tile.width;
+  const int64_t zstride = ystride * tile.height;
 
-  if (!write_state_.tile_out->write_tiles(tile_x,
-                                          tile_x + tile_params.window_width,
-                                          tile_y,
-                                          tile_y + tile_params.window_height,
+  if (!write_state_.tile_out->write_tiles(tile.x,
+                                          tile.x + tile.width,
+                                          tile.y,
+                                          tile.y + tile.height,
                                           0,
                                           1,
                                           TypeDesc::FLOAT,
-                                          pixels,
+                                          tile.pixels.data(),
                                           xstride,
                                           ystride,
                                           zstride)) {
@@ -565,13 +597,72 @@ bool TileManager::write_tile(const RenderBuffers &tile_buffers)
     return false;
   }
 
-  ++write_state_.num_tiles_written;
-
   VLOG_WORK << "Tile written in " << time_dt() - time_start << " seconds.";
 
   return true;
 }
 
+bool TileManager::write_tile(const RenderBuffers &tile_buffers)
+{
+  if (!write_state_.tile_out) {
+    if (!open_tile_output()) {
+      return false;
+    }
+  }
+
+  DCHECK_EQ(tile_buffers.params.pass_stride, buffer_params_.pass_stride);
+
+  const BufferParams &tile_params = tile_buffers.params;
+
+  WriteTile tile;
+  tile.x = tile_params.full_x - buffer_params_.full_x + tile_params.window_x;
+  tile.y = tile_params.full_y - buffer_params_.full_y + tile_params.window_y;
+  tile.width = tile_params.window_width;
+  tile.height = tile_params.window_height;
+
+  /* Copy pixels of the tile window into single continuous block of memory without any "gaps"
+   * from the overscan. The copy is needed anyway since the render buffers are re-used for the
+   * next tile while this one is being written.
+   * Continuous pixels also avoid a bug in OIIO (https://github.com/OpenImageIO/oiio/pull/3176).
+   * Our task reference: T93008. */
+  const int64_t pass_stride = tile_params.pass_stride;
+  const int64_t pixels_row_stride = pass_stride * tile_params.width;
+  const int64_t pixels_continuous_row_stride = pass_stride * tile.width;
+
+  tile.pixels.resize(pixels_continuous_row_stride * tile.height);
+
+  const float *pixels = tile_buffers.buffer.data() + tile_params.window_x * pass_stride +
+                        tile_params.window_y * pixels_row_stride;
+  float *pixels_continuous = tile.pixels.data();
+
+  for (int i = 0; i < tile.height; ++i) {
+    memcpy(pixels_continuous, pixels, sizeof(float) * pixels_continuous_row_stride);
+    pixels += pixels_row_stride;
+    pixels_continuous += pixels_continuous_row_stride;
+  }
+
+  VLOG_WORK << "Queue tile at " << tile.x << ", " << tile.y << " for writing";
+
+  {
+    thread_scoped_lock lock(write_state_.mutex);
+
+    while (write_state_.queue.size() >= MAX_QUEUED_WRITE_TILES && !write_state_.write_failed) {
+      write_state_.condition.wait(lock);
+    }
+
+    if (write_state_.write_failed) {
+      return false;
+    }
+
+    write_state_.queue.push_back(std::move(tile));
+  }
+  write_state_.condition.notify_all();
+
+  ++write_state_.num_tiles_written;
+
+  return true;
+}
+
 void TileManager::finish_write_tiles()
 {
   if (!write_state_.tile_out) {
@@ -580,6 +671,11 @@ void TileManager::finish_write_tiles()
     return;
   }
 
+  /* Write the tiles which are still queued, so that the tile output can be accessed directly. */
+  if (!stop_write_thread()) {
+    LOG(ERROR) << "Error writing queued tiles.";
+  }
+
   /* EXR expects all tiles to present in file. So explicitly write missing tiles as all-zero. */
   if (write_state_.num_tiles_written < tile_state_.num_tiles) {
     vector<float> pixel_storage(tile_size_.x * tile_size_.y * buffer_params_.pass_stride);
@@ -623,7 +719,8 @@ void TileManager::finish_write_tiles()
 
 bool TileManager::read_full_buffer_from_disk(const string_view filename,
                                              RenderBuffers *buffers,
-                                             DenoiseParams *denoise_params)
+                                             DenoiseParams *denoise_params,
+                                             const function<void(int)> &rows_read_cb)
 {
   unique_ptr<ImageInput> in(ImageInput::open(filename));
   if (!in) {
@@ -643,9 +740,29 @@ bool TileManager::read_full_buffer_from_disk(const string_view filename,
     return false;
   }
 
-  if (!in->read_image(TypeDesc::FLOAT, buffers->buffer.data())) {
-    LOG(ERROR) << "Error reading pixels from the tile file " << in->geterror();
-    return false;
+  /* Read whole rows of image tiles at a time, so that no tile is decompressed more than once. */
+  const int band_height = align_up(READ_BAND_HEIGHT, max(image_spec.tile_height, 1));
+  const int64_t row_stride = int64_t(buffer_params.width) * buffer_params.pass_stride;
+
+  for (int y = 0; y < buffer_params.height; y += band_height) {
+    const int band_end = min(y + band_height, buffer_params.height);
+
+    if (!in->read_scanlines(0,
+                            0,
+                            y,
+                            band_end,
+                            0,
+                            0,
+                            image_spec.nchannels,
+                            TypeDesc::FLOAT,
+                            buffers->buffer.data() + y * row_stride)) {
+      LOG(ERROR) << "Error reading pixels from the tile file " << in->geterror();
+      return false;
+    }
+
+    if (rows_read_cb) {
+      rows_read_cb(band_end);
+    }
   }
 
   if (!in->close()) {
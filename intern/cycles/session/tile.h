@@ -4,9 +4,13 @@
 #pragma once
 
 #include "session/buffers.h"
+#include "util/deque.h"
+#include "util/function.h"
 #include "util/image.h"
 #include "util/string.h"
+#include "util/thread.h"
 #include "util/unique_ptr.h"
+#include "util/vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -85,11 +89,17 @@ class TileManager {
    *
    * Opens file for write when first tile is written.
    *
-   * Returns true on success. */
+   * The pixels are copied and queued for the write thread, so that the render buffers can be
+   * re-used for the next tile while the tile is being compressed and written. Blocks when there
+   * are already MAX_QUEUED_WRITE_TILES tiles waiting to be written.
+   *
+   * Returns true on success. An error of writing previously queued tiles is reported by the next
+   * call. */
   bool write_tile(const RenderBuffers &tile_buffers);
 
   /* Inform the tile manager that no more tiles will be written to disk.
-   * The file will be considered final, all handles to it will be closed. */
+   * Waits for all queued tiles to be written. The file will be considered final, all handles to
+   * it will be closed. */
   void finish_write_tiles();
 
   /* Check whether any tile has been written to disk. */
@@ -99,11 +109,17 @@ class TileManager {
   }
 
   /* Read full frame render buffer from tiles file on disk.
+   *
+   * The file is read in bands of rows. After every band the rows_read_cb is invoked with the
+   * number of rows at the top of the buffer which are fully read, so that the caller can process
+   * them while the rest of the file is still being read. The buffer parameters and the denoise
+   * parameters are known by the time of the first call.
    *
    * Returns true on success. */
   bool read_full_buffer_from_disk(string_view filename,
                                   RenderBuffers *buffers,
-                                  DenoiseParams *denoise_params);
+                                  DenoiseParams *denoise_params,
+                                  const function<void(int)> &rows_read_cb = function_null);
 
   /* Compute valid tile size compatible with image saving. */
   int compute_render_tile_size(const int suggested_tile_size) const;
@@ -117,7 +133,23 @@ class TileManager {
    * Use conservative value which is safe for most of OpenGL drivers and GPUs. */
   static const int MAX_TILE_SIZE = 8192;
 
+  /* Maximum number of tiles which are waiting to be written to disk, in addition to the one which
+   * is currently being written.
+   * Every queued tile holds a copy of its pixels, so keep it low to bound the memory usage. */
+  static const int MAX_QUEUED_WRITE_TILES = 1;
+
+  /* Height of the bands of rows in which the full frame buffer is read from disk. */
+  static const int READ_BAND_HEIGHT = IMAGE_TILE_SIZE * 4;
+
  protected:
+  /* Pixels of a tile which is queued for writing to the file on disk. */
+  struct WriteTile {
+    int x = 0, y = 0;
+    int width = 0, height = 0;
+
+    /* Continuous pixels of the tile window, without overscan. */
+    vector<float> pixels;
+  };
   /* Get tile configuration for its index.
    * The tile index must be within [0, state_.tile_state_). */
   Tile get_tile_for_index(int index) const;
@@ -125,6 +157,17 @@ class TileManager {
   bool open_tile_output();
   bool close_tile_output();
 
+  /* Start the thread which writes queued tiles to the opened tile output. */
+  void start_write_thread();
+
+  /* Wait for all queued tiles to be written, and stop the write thread.
+   * Returns false if writing any of the tiles has failed. */
+  bool stop_write_thread();
+
+  void write_thread_run();
+
+  bool write_tile_pixels(const WriteTile &tile);
+
   string temp_dir_;
 
   /* Part of an on-disk tile file name which avoids conflicts between several Cycles instances or
@@ -169,10 +212,26 @@ class TileManager {
     /* Output handle for the tile file.
      *
      * This file can not be closed until all tiles has been provided, so the handle is stored in
-     * the state and is created whenever writing is requested. */
+     * the state and is created whenever writing is requested.
+     *
+     * While the write thread is running it is the only one accessing the output. */
     unique_ptr<ImageOutput> tile_out;
 
+    /* Number of tiles which were written or queued for writing. */
     int num_tiles_written = 0;
+
+    /* Thread which writes queued tiles, so that rendering of the next tile does not wait for the
+     * compression and file I/O of the previous one. */
+    unique_ptr<thread> write_thread;
+
+    /* Synchronization of the queue between the render thread and the write thread.
+     * The condition is notified whenever the queue or the state of the thread changes. */
+    thread_mutex mutex;
+    thread_condition_variable condition;
+
+    deque<WriteTile> queue;
+    bool stop_requested = false;
+    bool write_failed = false;
   } write_state_;
 };
 
@@ -0,0 +1,155 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#include "testing/testing.h"
+
+#include "bvh/build.h"
+#include "bvh/node.h"
+#include "bvh/params.h"
+
+#include "scene/mesh.h"
+#include "scene/object.h"
+
+#include "util/hash.h"
+#include "util/progress.h"
+#include "util/task.h"
+#include "util/time.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Soup of small triangles at random positions in the unit cube. */
+static void fill_triangle_soup(Mesh *mesh, const int num_triangles)
+{
+  mesh->reserve_mesh(num_triangles * 3, num_triangles);
+
+  for (int i = 0; i < num_triangles; i++) {
+    const float3 P = make_float3(
+        hash_uint2_to_float(i, 0), hash_uint2_to_float(i, 1), hash_uint2_to_float(i, 2));
+    for (int v = 0; v < 3; v++) {
+      const float3 offset = make_float3(hash_uint3_to_float(i, v, 0),
+                                        hash_uint3_to_float(i, v, 1),
+                                        hash_uint3_to_float(i, v, 2));
+      mesh->add_vertex(P + offset * 0.01f);
+    }
+    mesh->add_triangle(i * 3, i * 3 + 1, i * 3 + 2, 0, false);
+  }
+}
+
+class BVHBuildSoup {
+ public:
+  explicit BVHBuildSoup(const int num_triangles)
+  {
+    fill_triangle_soup(&mesh, num_triangles);
+    object.set_geometry(&mesh);
+    objects.push_back(&object);
+
+    params.use_spatial_split = false;
+  }
+
+  /* Build the tree, returns its root node. */
+  BVHNode *build()
+  {
+    Progress progress;
+    BVHBuild bvh_build(objects, prim_type, prim_index, prim_object, prim_time, params, progress);
+    return bvh_build.run();
+  }
+
+  Mesh mesh;
+  Object object;
+  vector<Object *> objects;
+  BVHParams params;
+
+  array<int> prim_type;
+  array<int> prim_index;
+  array<int> prim_object;
+  array<float2> prim_time;
+};
+
+static bool bounds_contain(const BoundBox &bounds, const BoundBox &other)
+{
+  return bounds.min.x <= other.min.x && bounds.min.y <= other.min.y &&
+         bounds.min.z <= other.min.z && bounds.max.x >= other.max.x &&
+         bounds.max.y >= other.max.y && bounds.max.z >= other.max.z;
+}
+
+/* Check that the bounds of every node contain the bounds of its triangles. */
+static void check_bounds(const BVHBuildSoup &soup, const BVHNode *node, vector<int> &prim_count)
+{
+  if (node->is_leaf()) {
+    const LeafNode *leaf = static_cast<const LeafNode *>(node);
+    const float3 *verts = soup.mesh.get_verts().data();
+
+    for (int i = leaf->lo; i < leaf->hi; i++) {
+      BoundBox bounds = BoundBox::empty;
+      soup.mesh.get_triangle(soup.prim_index[i]).bounds_grow(verts, bounds);
+      EXPECT_TRUE(bounds_contain(leaf->bounds, bounds));
+
+      prim_count[soup.prim_index[i]]++;
+    }
+    return;
+  }
+
+  for (int i = 0; i < node->num_children(); i++) {
+    const BVHNode *child = node->get_child(i);
+    EXPECT_TRUE(bounds_contain(node->bounds, child->bounds));
+
+    check_bounds(soup, child, prim_count);
+  }
+}
+
+TEST(bvh_build, parallel_binning)
+{
+  /* Enough triangles for the root nodes to be binned and split in parallel. */
+  const int num_triangles = 300000;
+  BVHBuildSoup soup(num_triangles);
+
+  BVHNode *root = soup.build();
+  ASSERT_NE(root, nullptr);
+
+  /* Every triangle is in exactly one leaf. */
+  vector<int> prim_count(num_triangles, 0);
+  check_bounds(soup, root, prim_count);
+  for (int i = 0; i < num_triangles; i++) {
+    EXPECT_EQ(prim_count[i], 1);
+  }
+
+  /* Parallel binning does not depend on scheduling, building again results in the same tree. */
+  BVHNode *other_root = soup.build();
+  ASSERT_NE(other_root, nullptr);
+  EXPECT_EQ(root->computeSubtreeSAHCost(soup.params),
+            other_root->computeSubtreeSAHCost(soup.params));
+  EXPECT_EQ(root->getSubtreeSize(BVH_STAT_NODE_COUNT),
+            other_root->getSubtreeSize(BVH_STAT_NODE_COUNT));
+
+  root->deleteSubtree();
+  other_root->deleteSubtree();
+}
+
+/* Set this to 1 to activate the benchmark, comparing build times for a number of threads. */
+#if 0
+TEST(bvh_build, benchmark)
+{
+  BVHBuildSoup soup(4000000);
+
+  for (const bool use_spatial_split : {false, true}) {
+    soup.params.use_spatial_split = use_spatial_split;
+
+    for (const int num_threads : {1, 2, 4, 8, 16, 32, 64}) {
+      TaskScheduler::init(num_threads);
+
+      double time = 0.0;
+      {
+        scoped_timer timer(&time);
+        soup.build()->deleteSubtree();
+      }
+
+      TaskScheduler::exit();
+
+      std::cout << (use_spatial_split ? "Spatial splits" : "Binning") << ", " << num_threads
+                << " threads: " << time << " s\n";
+    }
+  }
+}
+#endif
+
+CCL_NAMESPACE_END
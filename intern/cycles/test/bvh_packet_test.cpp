@@ -0,0 +1,6 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#define TEST_CATEGORY_NAME bvh_packet
+
+#include "bvh_packet_test.h"
@@ -0,0 +1,225 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#include "testing/testing.h"
+
+#include "util/system.h"
+#include "util/time.h"
+
+#include "scene_test.h"
+
+// clang-format off
+#include "kernel/device/cpu/compat.h"
+#include "kernel/device/cpu/globals.h"
+#include "kernel/device/cpu/image.h"
+
+#include "kernel/integrator/state.h"
+#include "kernel/util/differential.h"
+#include "kernel/geom/geom.h"
+#include "kernel/bvh/bvh.h"
+// clang-format on
+
+CCL_NAMESPACE_BEGIN
+
+static bool validate_cpu_capabilities()
+{
+#ifdef __KERNEL_AVX2__
+  return system_cpu_support_avx2();
+#else
+  return true;
+#endif
+}
+
+/* Scene with a BVH2 over a noisy height field, for comparing packet traversal against the
+ * traversal of single rays. */
+class BVHPacketScene : public TestScene {
+ public:
+  BVHPacketScene(const int resolution, const bool use_quantized_nodes = false)
+      : TestScene(scene_params(use_quantized_nodes))
+  {
+    Mesh *mesh = add_height_field(resolution, 0.2f, scene->default_surface);
+    add_object(mesh, transform_identity());
+    update();
+  }
+
+  static SceneParams scene_params(const bool use_quantized_nodes)
+  {
+    SceneParams scene_params;
+    scene_params.bvh_layout = BVH_LAYOUT_BVH2;
+    scene_params.use_bvh_quantized_nodes = use_quantized_nodes;
+    return scene_params;
+  }
+
+  /* Ray from above the height field towards it, jittered around the given target. */
+  static Ray make_ray(const float3 origin, const float x, const float y, const float jitter)
+  {
+    Ray ray;
+    ray.P = origin;
+    ray.D = normalize(make_float3(x, y, 0.1f) - origin);
+    ray.D.x += jitter;
+    ray.D = normalize(ray.D);
+    ray.tmin = 0.0f;
+    ray.tmax = FLT_MAX;
+    ray.time = 0.5f;
+    ray.dP = differential_zero_compact();
+    ray.dD = differential_zero_compact();
+    ray.self.object = OBJECT_NONE;
+    ray.self.prim = PRIM_NONE;
+    ray.self.light_object = OBJECT_NONE;
+    ray.self.light_prim = PRIM_NONE;
+    return ray;
+  }
+};
+
+/* Intersect the rays as a packet and one by one, and check that the results match. Single rays
+ * are traced in the reference scene, which may use a different BVH of the same geometry. */
+static void compare_packet_intersect(KernelGlobals kg,
+                                     KernelGlobals reference_kg,
+                                     const Ray *rays,
+                                     const uint *visibility,
+                                     const int num_rays)
+{
+  Intersection packet_isects[BVH_PACKET_SIZE];
+  bool packet_hits[BVH_PACKET_SIZE];
+  for (int i = 0; i < num_rays; i++) {
+    packet_isects[i].object = OBJECT_NONE;
+    packet_isects[i].prim = PRIM_NONE;
+  }
+  scene_intersect_packet(kg, rays, visibility, packet_isects, packet_hits, num_rays);
+
+  for (int i = 0; i < num_rays; i++) {
+    Intersection isect;
+    isect.object = OBJECT_NONE;
+    isect.prim = PRIM_NONE;
+    const bool hit = scene_intersect(reference_kg, &rays[i], visibility[i], &isect);
+
+    EXPECT_EQ(packet_hits[i], hit);
+    if (hit && packet_hits[i]) {
+      EXPECT_EQ(packet_isects[i].prim, isect.prim);
+      EXPECT_EQ(packet_isects[i].object, isect.object);
+      EXPECT_FLOAT_EQ(packet_isects[i].t, isect.t);
+      EXPECT_FLOAT_EQ(packet_isects[i].u, isect.u);
+      EXPECT_FLOAT_EQ(packet_isects[i].v, isect.v);
+    }
+  }
+}
+
+/* Quantized nodes are compared against a full precision BVH, to check that the quantized bounds
+ * contain the original bounds. */
+static void test_coherent(const bool use_quantized_nodes)
+{
+  BVHPacketScene scene(32, use_quantized_nodes);
+  BVHPacketScene reference_scene(32);
+  const float3 origin = make_float3(0.5f, 0.5f, 2.0f);
+
+  for (int y = 0; y < 64; y++) {
+    for (int x = 0; x < 64; x += BVH_PACKET_SIZE) {
+      Ray rays[BVH_PACKET_SIZE];
+      uint visibility[BVH_PACKET_SIZE];
+      for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+        /* Some of the rays miss the height field. */
+        rays[i] = BVHPacketScene::make_ray(
+            origin, (x + i) / 48.0f - 0.15f, y / 48.0f - 0.15f, 0.0f);
+        visibility[i] = PATH_RAY_CAMERA;
+      }
+      compare_packet_intersect(
+          scene.kg(), reference_scene.kg(), rays, visibility, BVH_PACKET_SIZE);
+    }
+  }
+}
+
+TEST(TEST_CATEGORY_NAME, coherent)
+{
+  if (!validate_cpu_capabilities()) {
+    return;
+  }
+
+  test_coherent(false);
+}
+
+TEST(TEST_CATEGORY_NAME, coherent_quantized_nodes)
+{
+  if (!validate_cpu_capabilities()) {
+    return;
+  }
+
+  test_coherent(true);
+}
+
+TEST(TEST_CATEGORY_NAME, incoherent)
+{
+  if (!validate_cpu_capabilities()) {
+    return;
+  }
+
+  BVHPacketScene scene(32);
+
+  for (int n = 0; n < 64; n++) {
+    Ray rays[BVH_PACKET_SIZE];
+    uint visibility[BVH_PACKET_SIZE];
+    for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+      const uint seed = n * BVH_PACKET_SIZE + i;
+      /* Rays pointing up and down, falling back to single ray traversal. */
+      const float3 origin = make_float3(hash_uint2_to_float(seed, 0),
+                                        hash_uint2_to_float(seed, 1),
+                                        (i & 1) ? -1.0f : 1.0f);
+      rays[i] = BVHPacketScene::make_ray(origin,
+                                         hash_uint2_to_float(seed, 2),
+                                         hash_uint2_to_float(seed, 3),
+                                         hash_uint2_to_float(seed, 4) * 0.1f);
+      visibility[i] = (i % 3) ? PATH_RAY_CAMERA : PATH_RAY_DIFFUSE;
+    }
+    compare_packet_intersect(
+        scene.kg(), scene.kg(), rays, visibility, (n % BVH_PACKET_SIZE) + 1);
+  }
+}
+
+/* Set this to 1 to activate the benchmark, comparing packet traversal against single rays. */
+#if 0
+TEST(TEST_CATEGORY_NAME, benchmark)
+{
+  if (!validate_cpu_capabilities()) {
+    return;
+  }
+
+  BVHPacketScene scene(512);
+  KernelGlobals kg = scene.kg();
+  const float3 origin = make_float3(0.5f, 0.5f, 2.0f);
+  const int resolution = 1024;
+
+  vector<Ray> rays(resolution * resolution);
+  for (int y = 0; y < resolution; y++) {
+    for (int x = 0; x < resolution; x++) {
+      rays[y * resolution + x] = BVHPacketScene::make_ray(
+          origin, float(x) / resolution, float(y) / resolution, 0.0f);
+    }
+  }
+
+  uint visibility[BVH_PACKET_SIZE];
+  std::fill(visibility, visibility + BVH_PACKET_SIZE, PATH_RAY_CAMERA);
+  Intersection isects[BVH_PACKET_SIZE];
+  bool hits[BVH_PACKET_SIZE];
+
+  for (int iteration = 0; iteration < 5; iteration++) {
+    double single_time = 0.0;
+    {
+      scoped_timer timer(&single_time);
+      for (const Ray &ray : rays) {
+        scene_intersect(kg, &ray, PATH_RAY_CAMERA, &isects[0]);
+      }
+    }
+
+    double packet_time = 0.0;
+    {
+      scoped_timer timer(&packet_time);
+      for (int i = 0; i < rays.size(); i += BVH_PACKET_SIZE) {
+        scene_intersect_packet(kg, &rays[i], visibility, isects, hits, BVH_PACKET_SIZE);
+      }
+    }
+
+    std::cout << "Single: " << single_time << " s, packet: " << packet_time << " s\n";
+  }
+}
+#endif
+
+CCL_NAMESPACE_END
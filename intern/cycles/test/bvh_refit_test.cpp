@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#include "testing/testing.h"
+
+#include "bvh/bvh.h"
+#include "bvh/bvh2.h"
+
+#include "scene_test.h"
+
+// clang-format off
+#include "kernel/device/cpu/compat.h"
+#include "kernel/device/cpu/globals.h"
+#include "kernel/device/cpu/image.h"
+
+#include "kernel/integrator/state.h"
+#include "kernel/util/differential.h"
+#include "kernel/geom/geom.h"
+#include "kernel/bvh/bvh.h"
+// clang-format on
+
+CCL_NAMESPACE_BEGIN
+
+static const int RESOLUTION = 16;
+
+/* Scene with a BVH2 over a height field that can be deformed. With more than one object, the
+ * height field is instanced side by side along the X axis. */
+class BVHRefitScene : public TestScene {
+ public:
+  BVHRefitScene(const float amplitude, const int num_objects) : TestScene(scene_params())
+  {
+    mesh = add_height_field(RESOLUTION, amplitude, scene->default_surface);
+    for (int i = 0; i < num_objects; i++) {
+      add_object(mesh, transform_translate(float(i), 0.0f, 0.0f));
+    }
+
+    update();
+  }
+
+  static SceneParams scene_params()
+  {
+    SceneParams scene_params;
+    scene_params.bvh_layout = BVH_LAYOUT_BVH2;
+    scene_params.bvh_type = BVH_TYPE_DYNAMIC;
+    return scene_params;
+  }
+
+  /* Move the vertices without changing the topology, so the BVH is refitted. */
+  void deform(const float amplitude)
+  {
+    deform_height_field(mesh, RESOLUTION, amplitude);
+    update();
+  }
+
+  /* SAH cost of the scene BVH when it was last built. */
+  float build_sah_cost() const
+  {
+    return static_cast<const BVH2 *>(scene->bvh)->build_sah_cost;
+  }
+
+  /* Intersect a ray pointing down onto the height field. */
+  bool intersect(const float x, const float y, Intersection *isect) const
+  {
+    Ray ray;
+    ray.P = make_float3(x, y, 100.0f);
+    ray.D = make_float3(0.0f, 0.0f, -1.0f);
+    ray.tmin = 0.0f;
+    ray.tmax = FLT_MAX;
+    ray.time = 0.5f;
+    ray.dP = differential_zero_compact();
+    ray.dD = differential_zero_compact();
+    ray.self.object = OBJECT_NONE;
+    ray.self.prim = PRIM_NONE;
+    ray.self.light_object = OBJECT_NONE;
+    ray.self.light_prim = PRIM_NONE;
+
+    isect->object = OBJECT_NONE;
+    isect->prim = PRIM_NONE;
+    return scene_intersect(kg(), &ray, PATH_RAY_CAMERA, isect);
+  }
+
+  Mesh *mesh;
+};
+
+/* Deform a scene and check that it intersects the same as a scene built with the deformation. */
+static void test_deform(const float amplitude, const int num_objects, const bool expect_rebuild)
+{
+  BVHRefitScene refit_scene(0.1f, num_objects);
+  const BVH *bvh = refit_scene.scene->bvh;
+  const BVH *mesh_bvh = refit_scene.mesh->bvh;
+  const float sah_cost = refit_scene.build_sah_cost();
+  refit_scene.deform(amplitude);
+
+  /* The scene BVH is kept, and refitted instead of being built from scratch. */
+  EXPECT_EQ(refit_scene.scene->bvh, bvh);
+  EXPECT_EQ(refit_scene.mesh->bvh, mesh_bvh);
+
+  BVHRefitScene built_scene(amplitude, num_objects);
+
+  /* A refit that degrades the tree too much builds it again, the same as from scratch. */
+  if (expect_rebuild) {
+    EXPECT_NE(refit_scene.build_sah_cost(), sah_cost);
+    EXPECT_FLOAT_EQ(refit_scene.build_sah_cost(), built_scene.build_sah_cost());
+  }
+  else {
+    EXPECT_EQ(refit_scene.build_sah_cost(), sah_cost);
+  }
+
+  const int samples = 32 * num_objects;
+  for (int y = 0; y < 32; y++) {
+    for (int x = 0; x < samples; x++) {
+      const float u = (x + 0.5f) / 32.0f;
+      const float v = (y + 0.5f) / 32.0f;
+
+      Intersection refit_isect, built_isect;
+      const bool refit_hit = refit_scene.intersect(u, v, &refit_isect);
+      const bool built_hit = built_scene.intersect(u, v, &built_isect);
+
+      EXPECT_TRUE(refit_hit);
+      EXPECT_EQ(refit_hit, built_hit);
+      if (refit_hit && built_hit) {
+        EXPECT_EQ(refit_isect.object, built_isect.object);
+        EXPECT_EQ(refit_isect.prim, built_isect.prim);
+        EXPECT_FLOAT_EQ(refit_isect.t, built_isect.t);
+      }
+    }
+  }
+}
+
+TEST(bvh_refit, deform)
+{
+  test_deform(0.2f, 1, false);
+}
+
+TEST(bvh_refit, deform_large)
+{
+  /* Large enough for the refitted BVH to exceed the SAH threshold and be rebuilt. */
+  test_deform(50.0f, 1, true);
+}
+
+TEST(bvh_refit, deform_instanced)
+{
+  /* The mesh BVH is refitted and merged into the refitted scene BVH again. */
+  test_deform(0.2f, 2, false);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+
+#include "integrator/denoiser.h"
+#include "integrator/path_trace.h"
+
+#include "session/buffers.h"
+
+#include "util/hash.h"
+#include "util/stats.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Stand-in for a denoiser, which averages the noisy combined pass over a neighbourhood of pixels.
+ * Like with a real denoiser, the result of a pixel depends on the rows around it. */
+class BoxFilterDenoiser : public Denoiser {
+ public:
+  static const int RADIUS = 16;
+
+  explicit BoxFilterDenoiser(Device *device) : Denoiser(device, denoise_params())
+  {
+  }
+
+  static DenoiseParams denoise_params()
+  {
+    DenoiseParams params;
+    params.use = true;
+    return params;
+  }
+
+  bool denoise_buffer(const BufferParams &buffer_params,
+                      RenderBuffers *render_buffers,
+                      const int /*num_samples*/,
+                      bool /*allow_inplace_modification*/) override
+  {
+    const int noisy_offset = buffer_params.get_pass_offset(PASS_COMBINED);
+    const int denoised_offset = buffer_params.get_pass_offset(PASS_COMBINED, PassMode::DENOISED);
+    const int width = buffer_params.width;
+    const int height = buffer_params.height;
+    const int pass_stride = buffer_params.pass_stride;
+    float *buffer = render_buffers->buffer.data();
+
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        float4 sum = zero_float4();
+        int num = 0;
+        for (int dy = max(y - RADIUS, 0); dy <= min(y + RADIUS, height - 1); dy++) {
+          for (int dx = max(x - RADIUS, 0); dx <= min(x + RADIUS, width - 1); dx++) {
+            const float *noisy = buffer + (int64_t(dy) * width + dx) * pass_stride + noisy_offset;
+            sum += make_float4(noisy[0], noisy[1], noisy[2], noisy[3]);
+            num++;
+          }
+        }
+
+        const float4 average = sum / (float)num;
+        float *denoised = buffer + (int64_t(y) * width + x) * pass_stride + denoised_offset;
+        denoised[0] = average.x;
+        denoised[1] = average.y;
+        denoised[2] = average.z;
+        denoised[3] = average.w;
+      }
+    }
+
+    return true;
+  }
+
+ protected:
+  uint get_device_type_mask() const override
+  {
+    return DEVICE_MASK_CPU;
+  }
+};
+
+/* Buffer with a noisy and a denoised combined pass, filled with noise. */
+static void denoiser_test_buffers_reset(RenderBuffers *buffers, const int width, const int height)
+{
+  BufferParams params;
+  params.width = params.window_width = params.full_width = width;
+  params.height = params.window_height = params.full_height = height;
+
+  BufferPass noisy_pass;
+  noisy_pass.type = PASS_COMBINED;
+  noisy_pass.name = ustring("Combined");
+  noisy_pass.offset = 0;
+
+  BufferPass denoised_pass = noisy_pass;
+  denoised_pass.mode = PassMode::DENOISED;
+  denoised_pass.name = ustring("Combined Denoised");
+
+  params.passes.push_back(noisy_pass);
+  params.passes.push_back(denoised_pass);
+  params.update_passes();
+
+  buffers->reset(params);
+
+  float *buffer = buffers->buffer.data();
+  const int64_t size = int64_t(width) * height * params.pass_stride;
+  for (int64_t i = 0; i < size; i++) {
+    buffer[i] = hash_uint2_to_float(uint(i), uint(i >> 32));
+  }
+}
+
+TEST(integrator_denoiser, buffer_rows)
+{
+  Stats stats;
+  Profiler profiler;
+  DeviceInfo device_info;
+  unique_ptr<Device> device(Device::create(device_info, stats, profiler));
+  BoxFilterDenoiser denoiser(device.get());
+
+  /* Tall enough for a full frame to be denoised in more than one band, with a band which is
+   * shorter than the overlap at the bottom. */
+  const int width = 8;
+  const int height = PathTrace::FULL_FRAME_DENOISE_BAND_HEIGHT +
+                     PathTrace::FULL_FRAME_DENOISE_OVERLAP / 2;
+
+  RenderBuffers buffers(device.get());
+  denoiser_test_buffers_reset(&buffers, width, height);
+  EXPECT_TRUE(denoiser.denoise_buffer(buffers.params, &buffers, 0, false));
+
+  RenderBuffers band_buffers(device.get());
+  denoiser_test_buffers_reset(&band_buffers, width, height);
+  for (int y = 0; y < height; y += PathTrace::FULL_FRAME_DENOISE_BAND_HEIGHT) {
+    const int y_end = min(y + PathTrace::FULL_FRAME_DENOISE_BAND_HEIGHT, height);
+    EXPECT_TRUE(denoiser.denoise_buffer_rows(
+        &band_buffers, y, y_end, PathTrace::FULL_FRAME_DENOISE_OVERLAP));
+  }
+
+  /* The overlap covers the neighbourhood the denoiser looks at, so the bands match denoising of
+   * the whole buffer at once, including the noisy pass which is left as is. */
+  const int64_t size = int64_t(width) * height * buffers.params.pass_stride;
+  for (int64_t i = 0; i < size; i++) {
+    EXPECT_NEAR(band_buffers.buffer.data()[i], buffers.buffer.data()[i], 1e-6f);
+  }
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,199 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#include "testing/testing.h"
+
+#include "scene/shader_graph.h"
+#include "scene/shader_nodes.h"
+#include "scene/stats.h"
+
+#include "util/foreach.h"
+
+#include "scene_test.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Scene with a shader and a mesh, that can be synchronized again with the same content as a
+ * render of the next frame of an animation does. BVHs are cached for all scenes of the process,
+ * tests use a different mesh resolution to not reuse BVHs of other tests. */
+class SceneCacheScene : public TestScene {
+ public:
+  explicit SceneCacheScene(const int mesh_resolution = 1)
+      : TestScene(scene_params()), mesh_resolution(mesh_resolution)
+  {
+    scene->enable_update_stats();
+
+    shader = scene->create_node<Shader>();
+    shader->set_graph(create_graph(make_float3(0.8f, 0.8f, 0.8f)));
+    shader->tag_update(scene);
+
+    add_mesh();
+    update();
+  }
+
+  static SceneParams scene_params()
+  {
+    SceneParams scene_params;
+    scene_params.bvh_layout = BVH_LAYOUT_BVH2;
+    scene_params.bvh_type = BVH_TYPE_DYNAMIC;
+    return scene_params;
+  }
+
+  ShaderGraph *create_graph(const float3 color)
+  {
+    ShaderGraph *graph = new ShaderGraph();
+
+    DiffuseBsdfNode *diffuse = graph->create_node<DiffuseBsdfNode>();
+    diffuse->set_color(color);
+    graph->add(diffuse);
+    graph->connect(diffuse->output("BSDF"), graph->output()->input("Surface"));
+
+    return graph;
+  }
+
+  /* Graph with an image texture and a named attribute, which compiled shaders refer to by image
+   * slot and attribute id. */
+  ShaderGraph *create_textured_graph()
+  {
+    ShaderGraph *graph = new ShaderGraph();
+
+    AttributeNode *attribute = graph->create_node<AttributeNode>();
+    attribute->set_attribute(ustring("scene_cache_test_uv"));
+    graph->add(attribute);
+
+    ImageTextureNode *image = graph->create_node<ImageTextureNode>();
+    image->set_filename(ustring("scene_cache_test.png"));
+    array<int> tiles;
+    tiles.push_back_slow(1001);
+    image->set_tiles(tiles);
+    graph->add(image);
+    graph->connect(attribute->output("Vector"), image->input("Vector"));
+
+    DiffuseBsdfNode *diffuse = graph->create_node<DiffuseBsdfNode>();
+    graph->add(diffuse);
+    graph->connect(image->output("Color"), diffuse->input("Color"));
+    graph->connect(diffuse->output("BSDF"), graph->output()->input("Surface"));
+
+    return graph;
+  }
+
+  int image_slot() const
+  {
+    foreach (ShaderNode *node, shader->graph->nodes) {
+      if (node->type == ImageTextureNode::get_node_type()) {
+        return static_cast<ImageTextureNode *>(node)->handle.svm_slot();
+      }
+    }
+    return -1;
+  }
+
+  /* Single quad mesh, with its own BVH as it is instanced. */
+  void add_mesh()
+  {
+    mesh = add_height_field(mesh_resolution, 0.0f, shader);
+    object = add_object(mesh, transform_identity());
+  }
+
+  void remove_mesh()
+  {
+    scene->delete_node(object);
+    scene->delete_node(mesh);
+  }
+
+  SceneUpdateStats *update_stats() const
+  {
+    return scene->update_stats;
+  }
+
+  int mesh_resolution;
+  Shader *shader;
+  Mesh *mesh;
+  Object *object;
+};
+
+TEST(scene_cache, shader_same_graph)
+{
+  SceneCacheScene cache_scene;
+
+  /* A new graph with the same content reuses the compiled shader. */
+  cache_scene.shader->set_graph(cache_scene.create_graph(make_float3(0.8f, 0.8f, 0.8f)));
+  cache_scene.shader->tag_update(cache_scene.scene);
+  cache_scene.update();
+
+  EXPECT_EQ(cache_scene.update_stats()->svm_programs.num_computed.load(), 0);
+  EXPECT_EQ(cache_scene.update_stats()->svm_programs.num_reused.load(),
+            (int)cache_scene.scene->shaders.size());
+}
+
+TEST(scene_cache, shader_modified_graph)
+{
+  SceneCacheScene cache_scene;
+
+  /* Only the shader with a modified graph is compiled again. */
+  cache_scene.shader->set_graph(cache_scene.create_graph(make_float3(0.2f, 0.4f, 0.8f)));
+  cache_scene.shader->tag_update(cache_scene.scene);
+  cache_scene.update();
+
+  EXPECT_EQ(cache_scene.update_stats()->svm_programs.num_computed.load(), 1);
+  EXPECT_EQ(cache_scene.update_stats()->svm_programs.num_reused.load(),
+            (int)cache_scene.scene->shaders.size() - 1);
+}
+
+TEST(scene_cache, shader_other_scene)
+{
+  SceneCacheScene first_scene;
+  first_scene.shader->set_graph(first_scene.create_textured_graph());
+  first_scene.shader->tag_update(first_scene.scene);
+  first_scene.update();
+
+  /* A separate scene with the same shaders reuses the shaders compiled for the first scene, like
+   * the frames of an animation rendered without persistent data. */
+  SceneCacheScene second_scene;
+  second_scene.shader->set_graph(second_scene.create_textured_graph());
+  second_scene.shader->tag_update(second_scene.scene);
+  second_scene.update();
+
+  EXPECT_EQ(second_scene.update_stats()->svm_programs.num_computed.load(), 0);
+  EXPECT_EQ(second_scene.update_stats()->svm_programs.num_reused.load(),
+            (int)second_scene.scene->shaders.size());
+
+  /* The image and the attribute get the slot and id that the reused shader refers to. */
+  EXPECT_NE(second_scene.image_slot(), -1);
+  EXPECT_EQ(second_scene.image_slot(), first_scene.image_slot());
+  const ustring attribute("scene_cache_test_uv");
+  EXPECT_EQ(second_scene.scene->shader_manager->get_attribute_id(attribute),
+            first_scene.scene->shader_manager->get_attribute_id(attribute));
+}
+
+TEST(scene_cache, geometry_bvh)
+{
+  SceneCacheScene cache_scene(2);
+  EXPECT_EQ(cache_scene.update_stats()->geometry_bvhs.num_computed.load(), 1);
+
+  /* Geometry deleted and added again with the same content reuses its BVH. */
+  cache_scene.remove_mesh();
+  cache_scene.add_mesh();
+  cache_scene.update();
+
+  EXPECT_EQ(cache_scene.update_stats()->geometry_bvhs.num_computed.load(), 0);
+  EXPECT_EQ(cache_scene.update_stats()->geometry_bvhs.num_reused.load(), 1);
+  EXPECT_NE(cache_scene.mesh->bvh, nullptr);
+}
+
+TEST(scene_cache, geometry_bvh_other_scene)
+{
+  {
+    SceneCacheScene first_scene(3);
+    EXPECT_EQ(first_scene.update_stats()->geometry_bvhs.num_computed.load(), 1);
+  }
+
+  /* A separate scene with the same mesh refits the BVH2 of the deleted first scene, like the
+   * frames of an animation rendered without persistent data. */
+  SceneCacheScene second_scene(3);
+
+  EXPECT_EQ(second_scene.update_stats()->geometry_bvhs.num_computed.load(), 0);
+  EXPECT_EQ(second_scene.update_stats()->geometry_bvhs.num_reused.load(), 1);
+  EXPECT_NE(second_scene.mesh->bvh, nullptr);
+}
+
+CCL_NAMESPACE_END
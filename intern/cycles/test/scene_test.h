@@ -0,0 +1,118 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#pragma once
+
+#include "device/device.h"
+#include "device/cpu/kernel_thread_globals.h"
+
+#include "scene/mesh.h"
+#include "scene/object.h"
+#include "scene/scene.h"
+#include "scene/shader.h"
+
+#include "util/hash.h"
+#include "util/progress.h"
+#include "util/stats.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Scene on a CPU device, built from geometry that tests add and then traced through the kernel
+ * globals of the device. */
+class TestScene {
+ public:
+  explicit TestScene(const SceneParams &scene_params)
+  {
+    device = Device::create(device_info, stats, profiler);
+    scene = new Scene(scene_params, device);
+  }
+
+  ~TestScene()
+  {
+    kernel_thread_globals.clear();
+    delete scene;
+    delete device;
+  }
+
+  /* Mesh of resolution by resolution quads over the unit square, each split into two triangles.
+   * The heights of the vertices are noise scaled by the amplitude. */
+  Mesh *add_height_field(const int resolution, const float amplitude, Shader *shader)
+  {
+    Mesh *mesh = scene->create_node<Mesh>();
+    mesh->reserve_mesh((resolution + 1) * (resolution + 1), resolution * resolution * 2);
+
+    for (int y = 0; y <= resolution; y++) {
+      for (int x = 0; x <= resolution; x++) {
+        mesh->add_vertex(make_float3(
+            float(x) / resolution, float(y) / resolution, height(x, y, amplitude)));
+      }
+    }
+
+    for (int y = 0; y < resolution; y++) {
+      for (int x = 0; x < resolution; x++) {
+        const int v0 = y * (resolution + 1) + x;
+        const int v1 = v0 + 1;
+        const int v2 = v0 + resolution + 1;
+        const int v3 = v2 + 1;
+        mesh->add_triangle(v0, v1, v3, 0, false);
+        mesh->add_triangle(v0, v3, v2, 0, false);
+      }
+    }
+
+    array<Node *> used_shaders;
+    used_shaders.push_back_slow(shader);
+    mesh->set_used_shaders(used_shaders);
+
+    return mesh;
+  }
+
+  /* Move the vertices of a height field to the heights for another amplitude, without changing
+   * its topology. */
+  void deform_height_field(Mesh *mesh, const int resolution, const float amplitude)
+  {
+    array<float3> verts = mesh->get_verts();
+    for (int y = 0; y <= resolution; y++) {
+      for (int x = 0; x <= resolution; x++) {
+        verts[y * (resolution + 1) + x].z = height(x, y, amplitude);
+      }
+    }
+    mesh->set_verts(verts);
+    mesh->tag_update(scene, false);
+  }
+
+  Object *add_object(Geometry *geometry, const Transform &tfm)
+  {
+    Object *object = scene->create_node<Object>();
+    object->set_geometry(geometry);
+    object->set_tfm(tfm);
+    return object;
+  }
+
+  void update()
+  {
+    Progress progress;
+    scene->update(progress);
+
+    device->get_cpu_kernel_thread_globals(kernel_thread_globals);
+  }
+
+  KernelGlobals kg() const
+  {
+    return &kernel_thread_globals[0];
+  }
+
+  Stats stats;
+  Profiler profiler;
+  DeviceInfo device_info;
+  Device *device;
+  Scene *scene;
+  vector<CPUKernelThreadGlobals> kernel_thread_globals;
+
+ protected:
+  static float height(const int x, const int y, const float amplitude)
+  {
+    return hash_uint2_to_float(x, y) * amplitude;
+  }
+};
+
+CCL_NAMESPACE_END
@@ -0,0 +1,163 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#include "testing/testing.h"
+
+#include <OpenImageIO/filesystem.h>
+
+#include "session/buffers.h"
+#include "session/tile.h"
+
+#include "util/path.h"
+
+#include "scene_test.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Value of a channel of a pixel in the full frame. */
+static float tile_test_pixel_value(const int x, const int y, const int channel)
+{
+  return float(x) + float(y) * 0.001f + float(channel) * 0.1f;
+}
+
+static BufferParams tile_test_buffer_params(const int width, const int height)
+{
+  BufferParams params;
+  params.width = params.window_width = params.full_width = width;
+  params.height = params.window_height = params.full_height = height;
+
+  BufferPass pass;
+  pass.type = PASS_COMBINED;
+  pass.name = ustring("Combined");
+  pass.offset = 0;
+
+  params.passes.push_back(pass);
+  params.update_passes();
+
+  return params;
+}
+
+/* Scene with a tile manager which writes the tiles of a full frame to a file in the temporary
+ * directory. */
+class TileTestScene : public TestScene {
+ public:
+  TileTestScene(const int width, const int height)
+      : TestScene(SceneParams()), params(tile_test_buffer_params(width, height))
+  {
+    tile_manager.set_temp_dir(OIIO::Filesystem::temp_directory_path());
+    tile_manager.full_buffer_written_cb = [this](string_view written_filename) {
+      filename = string(written_filename);
+    };
+
+    const int tile_size = tile_manager.compute_render_tile_size(TileManager::IMAGE_TILE_SIZE);
+    tile_manager.reset_scheduling(params, make_int2(tile_size, tile_size));
+    tile_manager.update(params, scene);
+  }
+
+  ~TileTestScene()
+  {
+    if (!filename.empty()) {
+      path_remove(filename);
+    }
+  }
+
+  /* Write the current tile, with its pixels filled from the full frame.
+   * The tile is moved by the given offset in the frame. */
+  bool write_current_tile(const int2 offset = make_int2(0, 0))
+  {
+    const Tile &tile = tile_manager.get_current_tile();
+
+    BufferParams tile_params = params;
+    tile_params.width = tile.width;
+    tile_params.height = tile.height;
+    tile_params.full_x = params.full_x + tile.x + offset.x;
+    tile_params.full_y = params.full_y + tile.y + offset.y;
+    tile_params.window_x = tile.window_x;
+    tile_params.window_y = tile.window_y;
+    tile_params.window_width = tile.window_width;
+    tile_params.window_height = tile.window_height;
+    tile_params.update_offset_stride();
+
+    RenderBuffers tile_buffers(device);
+    tile_buffers.reset(tile_params);
+
+    float *pixel = tile_buffers.buffer.data();
+    for (int y = 0; y < tile.height; y++) {
+      for (int x = 0; x < tile.width; x++) {
+        for (int channel = 0; channel < params.pass_stride; channel++) {
+          *pixel++ = tile_test_pixel_value(tile.x + x, tile.y + y, channel);
+        }
+      }
+    }
+
+    return tile_manager.write_tile(tile_buffers);
+  }
+
+  BufferParams params;
+  TileManager tile_manager;
+  string filename;
+};
+
+TEST(session_tile, write_read)
+{
+  /* Not a multiple of the tile size, so that the tiles at the border are partial. */
+  const int width = TileManager::IMAGE_TILE_SIZE * 2 + 17;
+  const int height = TileManager::IMAGE_TILE_SIZE * 3 + 5;
+
+  TileTestScene tile_scene(width, height);
+  ASSERT_TRUE(tile_scene.tile_manager.has_multiple_tiles());
+
+  while (tile_scene.tile_manager.next()) {
+    EXPECT_TRUE(tile_scene.write_current_tile());
+  }
+  tile_scene.tile_manager.finish_write_tiles();
+  ASSERT_FALSE(tile_scene.filename.empty());
+
+  RenderBuffers buffers(tile_scene.device);
+  DenoiseParams denoise_params;
+  vector<int> rows_read;
+  ASSERT_TRUE(tile_scene.tile_manager.read_full_buffer_from_disk(
+      tile_scene.filename, &buffers, &denoise_params, [&](const int num_rows_read) {
+        rows_read.push_back(num_rows_read);
+      }));
+
+  /* Rows are reported in increasing bands, up to the full frame. */
+  ASSERT_FALSE(rows_read.empty());
+  for (size_t i = 1; i < rows_read.size(); i++) {
+    EXPECT_GT(rows_read[i], rows_read[i - 1]);
+  }
+  EXPECT_EQ(rows_read.back(), height);
+
+  ASSERT_EQ(buffers.params.width, width);
+  ASSERT_EQ(buffers.params.height, height);
+  ASSERT_EQ(buffers.params.pass_stride, tile_scene.params.pass_stride);
+
+  const float *pixel = buffers.buffer.data();
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      for (int channel = 0; channel < buffers.params.pass_stride; channel++) {
+        EXPECT_EQ(*pixel++, tile_test_pixel_value(x, y, channel));
+      }
+    }
+  }
+}
+
+TEST(session_tile, write_error)
+{
+  TileTestScene tile_scene(TileManager::IMAGE_TILE_SIZE * 2, TileManager::IMAGE_TILE_SIZE * 2);
+  ASSERT_TRUE(tile_scene.tile_manager.next());
+
+  /* A tile outside of the frame fails to be written on the write thread. The failure is reported
+   * by a following call once the write thread got to the tile, at the latest when the queue is
+   * full again. */
+  const int2 outside = make_int2(TileManager::IMAGE_TILE_SIZE * 2, 0);
+  bool success = true;
+  for (int i = 0; i < TileManager::MAX_QUEUED_WRITE_TILES + 2 && success; i++) {
+    success = tile_scene.write_current_tile(outside);
+  }
+  EXPECT_FALSE(success);
+
+  tile_scene.tile_manager.finish_write_tiles();
+}
+
+CCL_NAMESPACE_END
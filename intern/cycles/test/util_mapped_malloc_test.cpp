@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#include "testing/testing.h"
+
+#include "util/aligned_malloc.h"
+#include "util/mapped_malloc.h"
+
+CCL_NAMESPACE_BEGIN
+
+TEST(util_mapped_malloc, read_write)
+{
+  const size_t num = 1024 * 1024;
+  int *mem = (int *)util_mapped_malloc(sizeof(int) * num, "");
+  ASSERT_NE(mem, nullptr);
+  EXPECT_EQ((size_t)mem % MIN_ALIGNMENT_CPU_DATA_TYPES, 0);
+
+  for (size_t i = 0; i < num; i++) {
+    mem[i] = (int)i;
+  }
+  for (size_t i = 0; i < num; i++) {
+    EXPECT_EQ(mem[i], (int)i);
+  }
+
+  EXPECT_TRUE(util_mapped_free(mem));
+}
+
+TEST(util_mapped_malloc, free_other_memory)
+{
+  int *mem = (int *)util_aligned_malloc(sizeof(int), 16);
+  EXPECT_FALSE(util_mapped_free(mem));
+  util_aligned_free(mem);
+}
+
+CCL_NAMESPACE_END
@@ -38,6 +38,7 @@ void DebugFlags::CPU::reset()
 #undef CHECK_CPU_FLAGS
 
   bvh_layout = BVH_LAYOUT_AUTO;
+  wavefront = (getenv("CYCLES_CPU_WAVEFRONT") != NULL);
 }
 
 DebugFlags::CUDA::CUDA()
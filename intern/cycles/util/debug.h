@@ -61,6 +61,10 @@ class DebugFlags {
      * CPUs and GPUs can be selected here instead.
      */
     BVHLayout bvh_layout = BVH_LAYOUT_AUTO;
+
+    /* Render paths in batches one kernel at a time, sorted by kernel and shader for
+     * coherence, instead of rendering every path to completion with the megakernel. */
+    bool wavefront = false;
   };
 
   /* Descriptor of CUDA feature-set to be used. */
@@ -0,0 +1,145 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#include "util/mapped_malloc.h"
+#include "util/log.h"
+#include "util/map.h"
+#include "util/path.h"
+#include "util/thread.h"
+
+#ifdef _WIN32
+#  include "util/windows.h"
+#else
+#  include <cstdlib>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+CCL_NAMESPACE_BEGIN
+
+/* Size of mapped blocks, needed for unmapping and to tell them apart from other allocations. */
+static thread_mutex mapped_blocks_mutex;
+static unordered_map<void *, size_t> mapped_blocks;
+
+static string mapped_directory(const string &directory)
+{
+  if (!directory.empty()) {
+    return directory;
+  }
+#ifdef _WIN32
+  char temp_path[MAX_PATH];
+  if (GetTempPathA(MAX_PATH, temp_path)) {
+    return temp_path;
+  }
+  return ".";
+#else
+  const char *temp_path = getenv("TMPDIR");
+  return (temp_path) ? temp_path : "/tmp";
+#endif
+}
+
+#ifdef _WIN32
+static void *mapped_file_create(size_t size, const string &directory)
+{
+  char filepath[MAX_PATH];
+  if (!GetTempFileNameA(directory.c_str(), "cyc", 0, filepath)) {
+    return NULL;
+  }
+
+  /* The file is deleted once the mapping is closed. */
+  HANDLE file = CreateFileA(filepath,
+                            GENERIC_READ | GENERIC_WRITE,
+                            0,
+                            NULL,
+                            CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                            NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    DeleteFileA(filepath);
+    return NULL;
+  }
+
+  HANDLE mapping = CreateFileMappingA(
+      file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+  void *ptr = (mapping) ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : NULL;
+
+  if (mapping) {
+    CloseHandle(mapping);
+  }
+  CloseHandle(file);
+
+  return ptr;
+}
+
+static void mapped_file_free(void *ptr, size_t /*size*/)
+{
+  UnmapViewOfFile(ptr);
+}
+#else
+static void *mapped_file_create(size_t size, const string &directory)
+{
+  string filepath = path_join(directory, "cycles_XXXXXX");
+  const int fd = mkstemp(&filepath[0]);
+  if (fd == -1) {
+    return NULL;
+  }
+
+  /* Remove the file right away, it remains until the mapping is closed. */
+  unlink(filepath.c_str());
+
+  void *ptr = NULL;
+  if (ftruncate(fd, size) == 0) {
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      ptr = NULL;
+    }
+  }
+
+  close(fd);
+  return ptr;
+}
+
+static void mapped_file_free(void *ptr, size_t size)
+{
+  munmap(ptr, size);
+}
+#endif
+
+void *util_mapped_malloc(size_t size, const string &directory)
+{
+  if (size == 0) {
+    return NULL;
+  }
+
+  const string dir = mapped_directory(directory);
+  void *ptr = mapped_file_create(size, dir);
+  if (ptr == NULL) {
+    LOG(WARNING) << "Failed to create memory mapped file of " << string_human_readable_size(size)
+                 << " in " << dir;
+    return NULL;
+  }
+
+  thread_scoped_lock lock(mapped_blocks_mutex);
+  mapped_blocks[ptr] = size;
+  return ptr;
+}
+
+bool util_mapped_free(void *ptr)
+{
+  size_t size;
+  {
+    thread_scoped_lock lock(mapped_blocks_mutex);
+    unordered_map<void *, size_t>::iterator it = mapped_blocks.find(ptr);
+    if (it == mapped_blocks.end()) {
+      return false;
+    }
+    size = it->second;
+    mapped_blocks.erase(it);
+  }
+
+  mapped_file_free(ptr, size);
+  return true;
+}
+
+CCL_NAMESPACE_END
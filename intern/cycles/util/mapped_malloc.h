@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#ifndef __UTIL_MAPPED_MALLOC_H__
+#define __UTIL_MAPPED_MALLOC_H__
+
+#include "util/string.h"
+#include "util/types.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Allocate block of size bytes backed by a temporary file in the given directory, or the system
+ * temporary directory if empty. The operating system can then page the memory out to disk and
+ * read it back on demand, instead of requiring it to be resident in RAM. The file is removed
+ * when the memory is freed.
+ *
+ * Returns NULL when the file could not be created or mapped. */
+void *util_mapped_malloc(size_t size, const string &directory);
+
+/* Free memory allocated by util_mapped_malloc. Returns false when the memory was not allocated
+ * by util_mapped_malloc, in which case nothing is done. */
+bool util_mapped_free(void *ptr);
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_MAPPED_MALLOC_H__ */
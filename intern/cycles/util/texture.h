@@ -39,6 +39,8 @@ typedef enum ImageDataType {
   IMAGE_DATA_TYPE_NANOVDB_FLOAT3 = 9,
   IMAGE_DATA_TYPE_NANOVDB_FPN = 10,
   IMAGE_DATA_TYPE_NANOVDB_FP16 = 11,
+  /* Tiles read while rendering on the CPU, see #TextureCacheImage. */
+  IMAGE_DATA_TYPE_TEXTURE_CACHE = 12,
 
   IMAGE_DATA_NUM_TYPES
 } ImageDataType;
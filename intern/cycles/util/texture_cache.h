@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: Apache-2.0
+ * Copyright 2011-2022 Blender Foundation */
+
+#ifndef __UTIL_TEXTURE_CACHE_H__
+#define __UTIL_TEXTURE_CACHE_H__
+
+/* Images that are read from disk one tile at a time while rendering on the CPU.
+ *
+ * This is the part of the texture cache that kernels access: the tiles that are in memory are
+ * found through a table per resolution level of the image, without locking. Tiles that are not
+ * in memory are loaded by the host side of the cache, see `scene/texture_cache.h`, which also
+ * recycles the least recently used tiles when the cache is full. */
+
+#include <atomic>
+
+#include "util/types.h"
+#include "util/unique_ptr.h"
+#include "util/vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Size in texels of the square tiles in the cache. Files are read in tiles of this size, so
+ * only files with a tile size that divides it can be cached. */
+#define TEXTURE_CACHE_TILE_SIZE 64
+#define TEXTURE_CACHE_TILE_SHIFT 6
+
+/* Texels of a tile of one resolution level of an image, converted to RGBA float.
+ *
+ * Tiles are recycled for other images and levels rather than freed while rendering, so a lookup
+ * that found the tile in a table can always read the texels. It then checks that the tile was
+ * not recycled while reading them, like a sequence lock. */
+struct TextureCacheTile {
+  /* Odd while the texels are being replaced. */
+  std::atomic<uint32_t> version;
+  /* Unique key of the tile whose texels are stored, see #TextureCacheLevel. */
+  std::atomic<uint64_t> key;
+  /* Set by lookups and cleared by the eviction clock, for a least recently used order. */
+  std::atomic<bool> referenced;
+
+  float4 *texels;
+};
+
+/* Resolution level of an image, level zero being the full resolution. */
+struct TextureCacheLevel {
+  int width, height;
+  int tiles_x, tiles_y;
+  /* Key of the first tile of the level, the keys of the other tiles follow in row order. */
+  uint64_t first_key;
+  /* Tiles in memory, or null. */
+  unique_ptr<std::atomic<TextureCacheTile *>[]> tiles;
+};
+
+class TextureCacheImage {
+ public:
+  virtual ~TextureCacheImage()
+  {
+  }
+
+  /* Read a texel from a tile that is not in the cache, loading the tile. Coordinates are in
+   * file order, with the first row at the top. */
+  virtual float4 load_texel(const int level, const int x, const int y) = 0;
+
+  /* Texel of the given level. Coordinates are in texture order, with the first row at the
+   * bottom, and must be inside the level. */
+  ccl_always_inline float4 texel(const int level, const int x, const int texture_y)
+  {
+    const TextureCacheLevel &cache_level = levels[level];
+    const int y = cache_level.height - 1 - texture_y;
+    const int tile_index = (y >> TEXTURE_CACHE_TILE_SHIFT) * cache_level.tiles_x +
+                           (x >> TEXTURE_CACHE_TILE_SHIFT);
+
+    TextureCacheTile *tile = cache_level.tiles[tile_index].load(std::memory_order_acquire);
+    if (tile) {
+      const uint32_t version = tile->version.load(std::memory_order_acquire);
+      const uint64_t key = tile->key.load(std::memory_order_relaxed);
+      const int texel_index = (y & (TEXTURE_CACHE_TILE_SIZE - 1)) * TEXTURE_CACHE_TILE_SIZE +
+                              (x & (TEXTURE_CACHE_TILE_SIZE - 1));
+      const float4 value = tile->texels[texel_index];
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if ((version & 1) == 0 && key == cache_level.first_key + tile_index &&
+          tile->version.load(std::memory_order_relaxed) == version) {
+        /* Avoid writing to memory shared between threads when the flag is already set. */
+        if (!tile->referenced.load(std::memory_order_relaxed)) {
+          tile->referenced.store(true, std::memory_order_relaxed);
+        }
+        return value;
+      }
+    }
+
+    return load_texel(level, x, y);
+  }
+
+  vector<TextureCacheLevel> levels;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_TEXTURE_CACHE_H__ */
@@ -10,6 +10,9 @@
 /* defines BLI_INLINE */
 #include "BLI_compiler_compat.h"
 
+/* declares normal_short_to_float_v3() and normal_float_to_short_v3() */
+#include "BLI_math_vector.h"
+
 /* declares fprintf() and abort(), needed for BLI_assert */
 #include <stdio.h>
 #include <stdlib.h>
@@ -53,6 +56,10 @@ typedef struct CCGKey {
 
   int has_normals;
   int has_mask;
+
+  /* normals are stored as normalized shorts instead of floats, so
+   * they are only to be accessed via CCG_elem_no_get/set */
+  int has_compact_normals;
 } CCGKey;
 
 /* initialize 'key' at the specified level */
@@ -64,6 +71,11 @@ BLI_INLINE float *CCG_elem_co(const CCGKey *key, CCGElem *elem);
 BLI_INLINE float *CCG_elem_no(const CCGKey *key, CCGElem *elem);
 BLI_INLINE float *CCG_elem_mask(const CCGKey *key, CCGElem *elem);
 
+/* get or set the normal, regardless of how it is stored */
+BLI_INLINE void CCG_elem_no_get(const CCGKey *key, CCGElem *elem, float r_no[3]);
+BLI_INLINE void CCG_elem_no_set(const CCGKey *key, CCGElem *elem, const float no[3]);
+BLI_INLINE void CCG_elem_no_short_get(const CCGKey *key, CCGElem *elem, short r_no[3]);
+
 /* get the element at 'offset' in an array */
 BLI_INLINE CCGElem *CCG_elem_offset(const CCGKey *key, CCGElem *elem, int offset);
 
@@ -77,6 +89,8 @@ BLI_INLINE float *CCG_grid_elem_mask(const CCGKey *key, CCGElem *elem, int x, in
 BLI_INLINE float *CCG_elem_offset_co(const CCGKey *key, CCGElem *elem, int offset);
 BLI_INLINE float *CCG_elem_offset_no(const CCGKey *key, CCGElem *elem, int offset);
 BLI_INLINE float *CCG_elem_offset_mask(const CCGKey *key, CCGElem *elem, int offset);
+BLI_INLINE void CCG_grid_elem_no_get(
+    const CCGKey *key, CCGElem *elem, int x, int y, float r_no[3]);
 
 /* for iteration, get a pointer to the next element in an array */
 BLI_INLINE CCGElem *CCG_elem_next(const CCGKey *key, CCGElem *elem);
@@ -91,15 +105,49 @@ BLI_INLINE float *CCG_elem_co(const CCGKey *UNUSED(key), CCGElem *elem)
 BLI_INLINE float *CCG_elem_no(const CCGKey *key, CCGElem *elem)
 {
   BLI_assert(key->has_normals);
+  BLI_assert(!key->has_compact_normals);
   return (float *)((char *)elem + key->normal_offset);
 }
 
+BLI_INLINE void CCG_elem_no_get(const CCGKey *key, CCGElem *elem, float r_no[3])
+{
+  BLI_assert(key->has_normals);
+  if (key->has_compact_normals) {
+    normal_short_to_float_v3(r_no, (const short *)((char *)elem + key->normal_offset));
+  }
+  else {
+    copy_v3_v3(r_no, (const float *)((char *)elem + key->normal_offset));
+  }
+}
+
+BLI_INLINE void CCG_elem_no_set(const CCGKey *key, CCGElem *elem, const float no[3])
+{
+  BLI_assert(key->has_normals);
+  if (key->has_compact_normals) {
+    normal_float_to_short_v3((short *)((char *)elem + key->normal_offset), no);
+  }
+  else {
+    copy_v3_v3((float *)((char *)elem + key->normal_offset), no);
+  }
+}
+
 BLI_INLINE float *CCG_elem_mask(const CCGKey *key, CCGElem *elem)
 {
   BLI_assert(key->has_mask);
   return (float *)((char *)elem + (key->mask_offset));
 }
 
+BLI_INLINE void CCG_elem_no_short_get(const CCGKey *key, CCGElem *elem, short r_no[3])
+{
+  BLI_assert(key->has_normals);
+  if (key->has_compact_normals) {
+    copy_v3_v3_short(r_no, (const short *)((char *)elem + key->normal_offset));
+  }
+  else {
+    normal_float_to_short_v3(r_no, (const float *)((char *)elem + key->normal_offset));
+  }
+}
+
 BLI_INLINE CCGElem *CCG_elem_offset(const CCGKey *key, CCGElem *elem, int offset)
 {
   return (CCGElem *)(((char *)elem) + key->elem_size * offset);
@@ -141,6 +189,12 @@ BLI_INLINE float *CCG_elem_offset_mask(const CCGKey *key, CCGElem *elem, int off
   return CCG_elem_mask(key, CCG_elem_offset(key, elem, offset));
 }
 
+BLI_INLINE void CCG_grid_elem_no_get(
+    const CCGKey *key, CCGElem *elem, int x, int y, float r_no[3])
+{
+  CCG_elem_no_get(key, CCG_grid_elem(key, elem, x, y), r_no);
+}
+
 BLI_INLINE CCGElem *CCG_elem_next(const CCGKey *key, CCGElem *elem)
 {
   return CCG_elem_offset(key, elem, 1);
@@ -556,6 +556,14 @@ typedef struct PBVHVertexIter {
   float *fno;
   float *mask;
   bool visible;
+
+  /* Grid element of the current vertex. */
+  struct CCGElem *elem;
+
+  /* Storage for the normal of grids with compact normals, which is pointed to by `fno`.
+   * Modifications of it are not written back to the grid, use BKE_pbvh_vertex_iter_fno_set() for
+   * that. */
+  float fno_decoded[3];
 } PBVHVertexIter;
 
 void pbvh_vertex_iter_init(PBVH *pbvh, PBVHNode *node, PBVHVertexIter *vi, int mode);
@@ -581,8 +589,15 @@ void pbvh_vertex_iter_init(PBVH *pbvh, PBVHNode *node, PBVHVertexIter *vi, int m
     for (vi.gy = 0; vi.gy < vi.height; vi.gy++) { \
       for (vi.gx = 0; vi.gx < vi.width; vi.gx++, vi.i++) { \
         if (vi.grid) { \
+          vi.elem = vi.grid; \
           vi.co = CCG_elem_co(&vi.key, vi.grid); \
-          vi.fno = CCG_elem_no(&vi.key, vi.grid); \
+          if (vi.key.has_compact_normals) { \
+            CCG_elem_no_get(&vi.key, vi.grid, vi.fno_decoded); \
+            vi.fno = vi.fno_decoded; \
+          } \
+          else { \
+            vi.fno = CCG_elem_no(&vi.key, vi.grid); \
+          } \
           vi.mask = vi.key.has_mask ? CCG_elem_mask(&vi.key, vi.grid) : NULL; \
           vi.grid = CCG_elem_next(&vi.key, vi.grid); \
           vi.index++; \
@@ -638,6 +653,16 @@ void pbvh_vertex_iter_init(PBVH *pbvh, PBVHNode *node, PBVHVertexIter *vi, int m
   } \
   ((void)0)
 
+/* Set the `fno` normal of the current vertex, writing it back to the grid when the grid stores
+ * compact normals. */
+BLI_INLINE void BKE_pbvh_vertex_iter_fno_set(PBVHVertexIter *vi, const float no[3])
+{
+  copy_v3_v3(vi->fno, no);
+  if (vi->fno == vi->fno_decoded) {
+    CCG_elem_no_set(&vi->key, vi->elem, no);
+  }
+}
+
 void BKE_pbvh_node_get_proxies(PBVHNode *node, PBVHProxyNode **proxies, int *proxy_count);
 void BKE_pbvh_node_free_proxies(PBVHNode *node);
 PBVHProxyNode *BKE_pbvh_node_add_proxy(PBVH *pbvh, PBVHNode *node);
@@ -168,6 +168,10 @@ typedef struct Subdiv {
   struct SubdivDisplacement *displacement_evaluator;
   /* Statistics for debugging. */
   SubdivStats stats;
+  /* Hash of the coarse topology this descriptor was created for, see
+   * BKE_subdiv_topology_hash_from_mesh(). Zero when not known, in which case the descriptor is
+   * never stored in the descriptor cache. */
+  uint32_t topology_hash;
 
   /* Cached values, are not supposed to be accessed directly. */
   struct {
@@ -250,6 +254,38 @@ Subdiv *BKE_subdiv_update_from_mesh(Subdiv *subdiv,
 
 void BKE_subdiv_free(Subdiv *subdiv);
 
+/* --------------------------------------------------------------------
+ * Descriptor cache.
+ *
+ * Allows to re-use topology refiner and evaluator (with its stencil tables) across dependency
+ * graph evaluations and across objects sharing the same mesh topology.
+ */
+
+/* Hash of everything in the mesh which affects topology refiner. Never returns zero. */
+uint32_t BKE_subdiv_topology_hash_from_mesh(const struct Mesh *mesh);
+
+/* Get descriptor which was previously released to the cache for the same settings and topology.
+ * The caller becomes the owner of the descriptor. Returns NULL if there is no such descriptor. */
+Subdiv *BKE_subdiv_cache_acquire(const SubdivSettings *settings,
+                                 const struct Mesh *mesh,
+                                 uint32_t topology_hash);
+
+/* Give up ownership of the descriptor, keeping it alive for a future acquire.
+ * Descriptors which can not be cached (unknown topology hash, GPU evaluator) are freed. */
+void BKE_subdiv_cache_release(Subdiv *subdiv);
+
+/* Free all descriptors which are stored in the cache. */
+void BKE_subdiv_cache_clear(void);
+
+/* Upper bound of the estimated memory used by descriptors stored in the cache. Least recently
+ * released descriptors are freed when the limit is exceeded. */
+void BKE_subdiv_cache_memory_limit_set(size_t memory_limit);
+size_t BKE_subdiv_cache_memory_limit_get(void);
+
+/* Estimated memory used by descriptors stored in the cache, and their number. */
+size_t BKE_subdiv_cache_memory_get(void);
+int BKE_subdiv_cache_num_entries_get(void);
+
 /* --------------------------------------------------------------------
  * Displacement API.
  */
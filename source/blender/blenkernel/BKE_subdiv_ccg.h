@@ -77,6 +77,9 @@ typedef struct SubdivToCCGSettings {
   /* Denotes which extra layers to be added to CCG elements. */
   bool need_normal;
   bool need_mask;
+  /* Store normals as normalized shorts rather than floats, making every element smaller and
+   * grids more cache friendly at the cost of normal precision. */
+  bool use_compact_normal;
 } SubdivToCCGSettings;
 
 typedef struct SubdivCCGCoord {
@@ -155,6 +158,8 @@ typedef struct SubdivCCG {
    */
   bool has_normal;
   bool has_mask;
+  /* Normals are stored as normalized shorts, see #CCGKey.has_compact_normals. */
+  bool has_compact_normal;
   /* Offsets of corresponding data layers in the elements. */
   int normal_offset;
   int mask_offset;
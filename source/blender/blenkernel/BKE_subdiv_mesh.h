@@ -29,6 +29,27 @@ typedef struct SubdivToMeshSettings {
   bool use_optimal_display;
 } SubdivToMeshSettings;
 
+/* Settings to choose subdivision level from the screen-space size of the coarse mesh faces. */
+typedef struct SubdivToMeshAdaptiveSettings {
+  /* Transformation from the coarse mesh space to the clip space of the camera. */
+  float object_to_clip[4][4];
+  /* Size of the render in pixels. */
+  int winx, winy;
+  /* Desired length of a subdivided edge in pixels. */
+  float dicing_rate;
+  /* Subdivision level used for the faces which need the most refinement. */
+  int max_level;
+} SubdivToMeshAdaptiveSettings;
+
+/* Get subdivision level at which the edges of the coarse faces which are visible by the camera
+ * are subdivided to be no longer than the dicing rate on screen.
+ *
+ * The level is the same for all faces, so that the subdivided mesh is crack-free: it is chosen by
+ * the face which needs the most refinement. Faces outside of the view are ignored, and the result
+ * is never lower than one (unless the maximum level is). */
+int BKE_subdiv_mesh_adaptive_level_get(const struct Mesh *coarse_mesh,
+                                       const SubdivToMeshAdaptiveSettings *settings);
+
 /* Create real hi-res mesh from subdivision, all geometry is "real". */
 struct Mesh *BKE_subdiv_to_mesh(struct Subdiv *subdiv,
                                 const SubdivToMeshSettings *settings,
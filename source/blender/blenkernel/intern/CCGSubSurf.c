@@ -1514,6 +1514,7 @@ void CCG_key(CCGKey *key, const CCGSubSurf *ss, int level)
 
   key->elem_size = ss->meshIFC.vertDataSize;
   key->has_normals = ss->calcVertNormals;
+  key->has_compact_normals = false;
 
   /* if normals are present, always the last three floats of an
    * element */
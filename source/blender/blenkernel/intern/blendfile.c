@@ -46,6 +46,7 @@
 #include "BKE_scene.h"
 #include "BKE_screen.h"
 #include "BKE_studiolight.h"
+#include "BKE_subdiv.h"
 #include "BKE_undo_system.h"
 #include "BKE_workspace.h"
 
@@ -290,6 +291,11 @@ static void setup_app_data(bContext *C,
   //  CTX_wm_manager_set(C, NULL);
   BKE_blender_globals_clear();
 
+  if (mode != LOAD_UNDO) {
+    /* Subdivision descriptors of the previous file are unlikely to be useful for the new one. */
+    BKE_subdiv_cache_clear();
+  }
+
   bmain = G_MAIN = bfd->main;
   bfd->main = NULL;
 
@@ -820,7 +820,7 @@ static void grid_tangent_matrix(float mat[3][3], const CCGKey *key, int x, int y
   grid_tangent(key, x, y, 1, grid, mat[1]);
   normalize_v3(mat[1]);
 
-  copy_v3_v3(mat[2], CCG_grid_elem_no(key, grid, x, y));
+  CCG_grid_elem_no_get(key, grid, x, y, mat[2]);
 }
 
 typedef struct MultiresThreadedData {
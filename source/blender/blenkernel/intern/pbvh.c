@@ -260,6 +260,13 @@ static int map_insert_vert(
   return POINTER_AS_INT(*value_p);
 }
 
+static int index_cmp(const void *a_p, const void *b_p)
+{
+  const int a = *(const int *)a_p;
+  const int b = *(const int *)b_p;
+  return (a > b) - (a < b);
+}
+
 /* Find vertices used by the faces in this node and update the draw buffers */
 static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
 {
@@ -268,6 +275,10 @@ static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
   node->uniq_verts = node->face_verts = 0;
   const int totface = node->totprim;
 
+  /* Partitioning leaves the primitives in a scattered order, sort them so that the mesh data of
+   * the node is accessed in increasing memory order. */
+  qsort(node->prim_indices, totface, sizeof(int), index_cmp);
+
   /* reserve size is rough guess */
   GHash *map = BLI_ghash_int_new_ex("build_mesh_leaf_node gh", 2 * totface);
 
@@ -310,13 +321,25 @@ static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
     vert_indices[ndx] = POINTER_AS_INT(BLI_ghashIterator_getKey(&gh_iter));
   }
 
+  /* Sort the unique and the other vertices by index too. Brushes loop over the vertices of the
+   * node, so this keeps accessing vertex data (coordinates, normals, masks, ...) in increasing
+   * memory order instead of jumping around the whole mesh. */
+  qsort(vert_indices, node->uniq_verts, sizeof(int), index_cmp);
+  qsort(vert_indices + node->uniq_verts, node->face_verts, sizeof(int), index_cmp);
+
+  const int totvert = (int)(node->uniq_verts + node->face_verts);
+  for (int i = 0; i < totvert; i++) {
+    void **value_p = BLI_ghash_lookup_p(map, POINTER_FROM_INT(vert_indices[i]));
+    *value_p = POINTER_FROM_INT(i);
+  }
+
   for (int i = 0; i < totface; i++) {
+    const MLoopTri *lt = &pbvh->looptri[node->prim_indices[i]];
     const int sides = 3;
 
     for (int j = 0; j < sides; j++) {
-      if (face_vert_indices[i][j] < 0) {
-        face_vert_indices[i][j] = -face_vert_indices[i][j] + node->uniq_verts - 1;
-      }
+      face_vert_indices[i][j] = POINTER_AS_INT(
+          BLI_ghash_lookup(map, POINTER_FROM_INT(pbvh->mloop[lt->tri[j]].v)));
     }
   }
 
@@ -991,15 +1014,36 @@ static void BKE_pbvh_search_callback_occluded(PBVH *pbvh,
   }
 }
 
-static bool update_search_cb(PBVHNode *node, void *data_v)
+/**
+ * Gather the leaf nodes which have any of the update flags in \a flag set.
+ *
+ * Update flags are only ever set on leaves, so the nodes array is scanned directly instead of
+ * traversing the tree with #BKE_pbvh_search_gather. This is done several times for every brush
+ * step, and the result usually only has a few nodes.
+ */
+static void pbvh_gather_update_nodes(PBVH *pbvh, int flag, PBVHNode ***r_array, int *r_tot)
 {
-  int flag = POINTER_AS_INT(data_v);
+  PBVHNode **array = NULL;
+  int tot = 0;
 
-  if (node->flag & PBVH_Leaf) {
-    return (node->flag & flag) != 0;
+  for (int n = 0; n < pbvh->totnode; n++) {
+    if ((pbvh->nodes[n].flag & PBVH_Leaf) && (pbvh->nodes[n].flag & flag)) {
+      tot++;
+    }
   }
 
-  return true;
+  if (tot != 0) {
+    array = MEM_mallocN(sizeof(PBVHNode *) * tot, __func__);
+    int i = 0;
+    for (int n = 0; n < pbvh->totnode; n++) {
+      if ((pbvh->nodes[n].flag & PBVH_Leaf) && (pbvh->nodes[n].flag & flag)) {
+        array[i++] = &pbvh->nodes[n];
+      }
+    }
+  }
+
+  *r_array = array;
+  *r_tot = tot;
 }
 
 typedef struct PBVHUpdateData {
@@ -1111,6 +1155,72 @@ static void pbvh_update_normals_store_task_cb(void *__restrict userdata,
   }
 }
 
+/**
+ * Calculate normals of the tagged vertices owned by the node (the unique vertices) from the
+ * faces around them, in the same way as #BKE_mesh_calc_normals_poly_and_vertex does.
+ * Every vertex is only written by the node that owns it, so no atomics or clearing pass are
+ * needed, and only the tagged vertices are processed instead of all faces of the node.
+ */
+static void pbvh_update_normals_from_pmap_task_cb(void *__restrict userdata,
+                                                  const int n,
+                                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHUpdateData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  PBVHNode *node = data->nodes[n];
+  float(*vnors)[3] = data->vnors;
+
+  if (node->flag & PBVH_UpdateNormals) {
+    const int *verts = node->vert_indices;
+    const int totvert = node->uniq_verts;
+
+    for (int i = 0; i < totvert; i++) {
+      const int v = verts[i];
+      if (!pbvh->vert_bitmap[v]) {
+        continue;
+      }
+
+      const MeshElemMap *vert_polys = &pbvh->pmap[v];
+      const float *co = pbvh->verts[v].co;
+      float no[3] = {0.0f, 0.0f, 0.0f};
+
+      for (int j = 0; j < vert_polys->count; j++) {
+        const MPoly *mp = &pbvh->mpoly[vert_polys->indices[j]];
+        const MLoop *ml = &pbvh->mloop[mp->loopstart];
+
+        int corner = 0;
+        while (corner < mp->totloop && ml[corner].v != v) {
+          corner++;
+        }
+        if (UNLIKELY(corner == mp->totloop)) {
+          continue;
+        }
+        const int corner_prev = (corner == 0) ? mp->totloop - 1 : corner - 1;
+        const int corner_next = (corner == mp->totloop - 1) ? 0 : corner + 1;
+
+        float fn[3];
+        BKE_mesh_calc_poly_normal(mp, ml, pbvh->verts, fn);
+
+        /* Weight by the angle of the face at the vertex. */
+        float edvec_prev[3], edvec_next[3];
+        sub_v3_v3v3(edvec_prev, pbvh->verts[ml[corner_prev].v].co, co);
+        sub_v3_v3v3(edvec_next, pbvh->verts[ml[corner_next].v].co, co);
+        normalize_v3(edvec_prev);
+        normalize_v3(edvec_next);
+        madd_v3_v3fl(no, fn, saacos(dot_v3v3(edvec_prev, edvec_next)));
+      }
+
+      if (UNLIKELY(normalize_v3_v3(vnors[v], no) == 0.0f)) {
+        /* Following Mesh convention; we use vertex coordinate itself for normal in this case. */
+        normalize_v3_v3(vnors[v], co);
+      }
+      pbvh->vert_bitmap[v] = false;
+    }
+
+    node->flag &= ~PBVH_UpdateNormals;
+  }
+}
+
 static void pbvh_faces_update_normals(PBVH *pbvh, PBVHNode **nodes, int totnode)
 {
   /* subtle assumptions:
@@ -1132,6 +1242,11 @@ static void pbvh_faces_update_normals(PBVH *pbvh, PBVHNode **nodes, int totnode)
   TaskParallelSettings settings;
   BKE_pbvh_parallel_range_settings(&settings, true, totnode);
 
+  if (pbvh->pmap) {
+    BLI_task_parallel_range(0, totnode, &data, pbvh_update_normals_from_pmap_task_cb, &settings);
+    return;
+  }
+
   /* Zero normals before accumulation. */
   BLI_task_parallel_range(0, totnode, &data, pbvh_update_normals_clear_task_cb, &settings);
   BLI_task_parallel_range(0, totnode, &data, pbvh_update_normals_accum_task_cb, &settings);
@@ -1541,7 +1656,7 @@ void BKE_pbvh_update_bounds(PBVH *pbvh, int flag)
   PBVHNode **nodes;
   int totnode;
 
-  BKE_pbvh_search_gather(pbvh, update_search_cb, POINTER_FROM_INT(flag), &nodes, &totnode);
+  pbvh_gather_update_nodes(pbvh, flag, &nodes, &totnode);
 
   if (flag & (PBVH_UpdateBB | PBVH_UpdateOriginalBB | PBVH_UpdateRedraw)) {
     pbvh_update_BB_redraw(pbvh, nodes, totnode, flag);
@@ -1563,7 +1678,7 @@ void BKE_pbvh_update_vertex_data(PBVH *pbvh, int flag)
   PBVHNode **nodes;
   int totnode;
 
-  BKE_pbvh_search_gather(pbvh, update_search_cb, POINTER_FROM_INT(flag), &nodes, &totnode);
+  pbvh_gather_update_nodes(pbvh, flag, &nodes, &totnode);
 
   if (flag & (PBVH_UpdateMask)) {
     pbvh_update_mask_redraw(pbvh, nodes, totnode, flag);
@@ -1710,8 +1825,7 @@ void BKE_pbvh_update_visibility(PBVH *pbvh)
   PBVHNode **nodes;
   int totnode;
 
-  BKE_pbvh_search_gather(
-      pbvh, update_search_cb, POINTER_FROM_INT(PBVH_UpdateVisibility), &nodes, &totnode);
+  pbvh_gather_update_nodes(pbvh, PBVH_UpdateVisibility, &nodes, &totnode);
   pbvh_update_visibility(pbvh, nodes, totnode);
 
   if (nodes) {
@@ -2798,8 +2912,7 @@ void BKE_pbvh_update_normals(PBVH *pbvh, struct SubdivCCG *subdiv_ccg)
   PBVHNode **nodes;
   int totnode;
 
-  BKE_pbvh_search_gather(
-      pbvh, update_search_cb, POINTER_FROM_INT(PBVH_UpdateNormals), &nodes, &totnode);
+  pbvh_gather_update_nodes(pbvh, PBVH_UpdateNormals, &nodes, &totnode);
 
   if (totnode > 0) {
     if (pbvh->header.type == PBVH_BMESH) {
@@ -2872,8 +2985,7 @@ void BKE_pbvh_draw_cb(PBVH *pbvh,
   else {
     /* Get all nodes with draw updates, also those outside the view. */
     const int search_flag = PBVH_RebuildDrawBuffers | PBVH_UpdateDrawBuffers;
-    BKE_pbvh_search_gather(
-        pbvh, update_search_cb, POINTER_FROM_INT(search_flag), &nodes, &totnode);
+    pbvh_gather_update_nodes(pbvh, search_flag, &nodes, &totnode);
     update_flag = PBVH_RebuildDrawBuffers | PBVH_UpdateDrawBuffers;
   }
 
@@ -11,6 +11,7 @@
 #include "BLI_heap_simple.h"
 #include "BLI_math.h"
 #include "BLI_memarena.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_DerivedMesh.h"
@@ -928,54 +929,133 @@ static void short_edge_queue_edge_add(EdgeQueueContext *eq_ctx, BMEdge *e)
   }
 }
 
-static void long_edge_queue_face_add(EdgeQueueContext *eq_ctx, BMFace *f)
+/* Return true if the edges of the face are to be checked for the queue. */
+static bool edge_queue_face_test(const EdgeQueue *q, BMFace *f)
 {
 #ifdef USE_EDGEQUEUE_FRONTFACE
-  if (eq_ctx->q->use_view_normal) {
-    if (dot_v3v3(f->no, eq_ctx->q->view_normal) < 0.0f) {
-      return;
+  if (q->use_view_normal) {
+    if (dot_v3v3(f->no, q->view_normal) < 0.0f) {
+      return false;
     }
   }
 #endif
 
-  if (eq_ctx->q->edge_queue_tri_in_range(eq_ctx->q, f)) {
-    /* Check each edge of the face */
-    BMLoop *l_first = BM_FACE_FIRST_LOOP(f);
-    BMLoop *l_iter = l_first;
-    do {
+  return q->edge_queue_tri_in_range(q, f);
+}
+
+static void long_edge_queue_face_edges_add(EdgeQueueContext *eq_ctx, BMFace *f)
+{
+  /* Check each edge of the face */
+  BMLoop *l_first = BM_FACE_FIRST_LOOP(f);
+  BMLoop *l_iter = l_first;
+  do {
 #ifdef USE_EDGEQUEUE_EVEN_SUBDIV
-      const float len_sq = BM_edge_calc_length_squared(l_iter->e);
-      if (len_sq > eq_ctx->q->limit_len_squared) {
-        long_edge_queue_edge_add_recursive(
-            eq_ctx, l_iter->radial_next, l_iter, len_sq, eq_ctx->q->limit_len);
-      }
+    const float len_sq = BM_edge_calc_length_squared(l_iter->e);
+    if (len_sq > eq_ctx->q->limit_len_squared) {
+      long_edge_queue_edge_add_recursive(
+          eq_ctx, l_iter->radial_next, l_iter, len_sq, eq_ctx->q->limit_len);
+    }
 #else
-      long_edge_queue_edge_add(eq_ctx, l_iter->e);
+    long_edge_queue_edge_add(eq_ctx, l_iter->e);
 #endif
-    } while ((l_iter = l_iter->next) != l_first);
+  } while ((l_iter = l_iter->next) != l_first);
+}
+
+static void long_edge_queue_face_add(EdgeQueueContext *eq_ctx, BMFace *f)
+{
+  if (edge_queue_face_test(eq_ctx->q, f)) {
+    long_edge_queue_face_edges_add(eq_ctx, f);
   }
 }
 
-static void short_edge_queue_face_add(EdgeQueueContext *eq_ctx, BMFace *f)
+static void short_edge_queue_face_edges_add(EdgeQueueContext *eq_ctx, BMFace *f)
 {
-#ifdef USE_EDGEQUEUE_FRONTFACE
-  if (eq_ctx->q->use_view_normal) {
-    if (dot_v3v3(f->no, eq_ctx->q->view_normal) < 0.0f) {
-      return;
+  BMLoop *l_iter;
+  BMLoop *l_first;
+
+  /* Check each edge of the face */
+  l_iter = l_first = BM_FACE_FIRST_LOOP(f);
+  do {
+    short_edge_queue_edge_add(eq_ctx, l_iter->e);
+  } while ((l_iter = l_iter->next) != l_first);
+}
+
+typedef struct EdgeQueueNodeFaces {
+  BMFace **faces;
+  int totface;
+} EdgeQueueNodeFaces;
+
+typedef struct EdgeQueueGatherData {
+  const EdgeQueue *q;
+  PBVHNode **nodes;
+  EdgeQueueNodeFaces *nodes_faces;
+} EdgeQueueGatherData;
+
+static void edge_queue_gather_faces_task_cb(void *__restrict userdata,
+                                            const int n,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  EdgeQueueGatherData *data = userdata;
+  PBVHNode *node = data->nodes[n];
+  EdgeQueueNodeFaces *node_faces = &data->nodes_faces[n];
+
+  node_faces->faces = MEM_mallocN(sizeof(BMFace *) * BLI_gset_len(node->bm_faces), __func__);
+  node_faces->totface = 0;
+
+  GSetIterator gs_iter;
+  GSET_ITER (gs_iter, node->bm_faces) {
+    BMFace *f = BLI_gsetIterator_getKey(&gs_iter);
+    if (edge_queue_face_test(data->q, f)) {
+      node_faces->faces[node_faces->totface++] = f;
     }
   }
-#endif
+}
 
-  if (eq_ctx->q->edge_queue_tri_in_range(eq_ctx->q, f)) {
-    BMLoop *l_iter;
-    BMLoop *l_first;
+/* Add the edges of faces in range of the queue, for leaf nodes marked for topology update.
+ *
+ * Testing faces against the brush is the expensive part and only reads the mesh, so it's done
+ * for all nodes in parallel. Adding edges to the queue tags them, so that happens afterwards,
+ * in the same order as when testing the faces one by one. */
+static void edge_queue_nodes_faces_add(EdgeQueueContext *eq_ctx,
+                                       PBVH *pbvh,
+                                       void (*face_edges_add_fn)(EdgeQueueContext *eq_ctx,
+                                                                 BMFace *f))
+{
+  PBVHNode **nodes = MEM_mallocN(sizeof(PBVHNode *) * pbvh->totnode, __func__);
+  int totnode = 0;
 
-    /* Check each edge of the face */
-    l_iter = l_first = BM_FACE_FIRST_LOOP(f);
-    do {
-      short_edge_queue_edge_add(eq_ctx, l_iter->e);
-    } while ((l_iter = l_iter->next) != l_first);
+  for (int n = 0; n < pbvh->totnode; n++) {
+    PBVHNode *node = &pbvh->nodes[n];
+
+    /* Check leaf nodes marked for topology update */
+    if ((node->flag & PBVH_Leaf) && (node->flag & PBVH_UpdateTopology) &&
+        !(node->flag & PBVH_FullyHidden)) {
+      nodes[totnode++] = node;
+    }
   }
+
+  EdgeQueueNodeFaces *nodes_faces = MEM_mallocN(sizeof(EdgeQueueNodeFaces) * max_ii(totnode, 1),
+                                                __func__);
+  EdgeQueueGatherData data = {
+      .q = eq_ctx->q,
+      .nodes = nodes,
+      .nodes_faces = nodes_faces,
+  };
+
+  TaskParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, totnode);
+  BLI_task_parallel_range(0, totnode, &data, edge_queue_gather_faces_task_cb, &settings);
+
+  for (int n = 0; n < totnode; n++) {
+    EdgeQueueNodeFaces *node_faces = &nodes_faces[n];
+    for (int i = 0; i < node_faces->totface; i++) {
+      face_edges_add_fn(eq_ctx, node_faces->faces[i]);
+    }
+    MEM_freeN(node_faces->faces);
+  }
+
+  MEM_freeN(nodes_faces);
+  MEM_freeN(nodes);
 }
 
 /* Create a priority queue containing vertex pairs connected by a long
@@ -1023,22 +1103,7 @@ static void long_edge_queue_create(EdgeQueueContext *eq_ctx,
   pbvh_bmesh_edge_tag_verify(pbvh);
 #endif
 
-  for (int n = 0; n < pbvh->totnode; n++) {
-    PBVHNode *node = &pbvh->nodes[n];
-
-    /* Check leaf nodes marked for topology update */
-    if ((node->flag & PBVH_Leaf) && (node->flag & PBVH_UpdateTopology) &&
-        !(node->flag & PBVH_FullyHidden)) {
-      GSetIterator gs_iter;
-
-      /* Check each face */
-      GSET_ITER (gs_iter, node->bm_faces) {
-        BMFace *f = BLI_gsetIterator_getKey(&gs_iter);
-
-        long_edge_queue_face_add(eq_ctx, f);
-      }
-    }
-  }
+  edge_queue_nodes_faces_add(eq_ctx, pbvh, long_edge_queue_face_edges_add);
 }
 
 /* Create a priority queue containing vertex pairs connected by a
@@ -1082,22 +1147,7 @@ static void short_edge_queue_create(EdgeQueueContext *eq_ctx,
     eq_ctx->q->edge_queue_tri_in_range = edge_queue_tri_in_sphere;
   }
 
-  for (int n = 0; n < pbvh->totnode; n++) {
-    PBVHNode *node = &pbvh->nodes[n];
-
-    /* Check leaf nodes marked for topology update */
-    if ((node->flag & PBVH_Leaf) && (node->flag & PBVH_UpdateTopology) &&
-        !(node->flag & PBVH_FullyHidden)) {
-      GSetIterator gs_iter;
-
-      /* Check each face */
-      GSET_ITER (gs_iter, node->bm_faces) {
-        BMFace *f = BLI_gsetIterator_getKey(&gs_iter);
-
-        short_edge_queue_face_add(eq_ctx, f);
-      }
-    }
-  }
+  edge_queue_nodes_faces_add(eq_ctx, pbvh, short_edge_queue_face_edges_add);
 }
 
 /*************************** Topology update **************************/
@@ -36,6 +36,7 @@ void BKE_subdiv_init()
 
 void BKE_subdiv_exit()
 {
+  BKE_subdiv_cache_clear();
   openSubdiv_cleanup();
 }
 
@@ -119,6 +120,7 @@ Subdiv *BKE_subdiv_new_from_converter(const SubdivSettings *settings,
   subdiv->topology_refiner = osd_topology_refiner;
   subdiv->evaluator = NULL;
   subdiv->displacement_evaluator = NULL;
+  subdiv->topology_hash = 0;
   BKE_subdiv_stats_end(&stats, SUBDIV_STATS_TOPOLOGY_REFINER_CREATION_TIME);
   subdiv->stats = stats;
   return subdiv;
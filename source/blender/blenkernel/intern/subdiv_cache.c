@@ -0,0 +1,272 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022 Blender Foundation. All rights reserved. */
+
+/** \file
+ * \ingroup bke
+ *
+ * Process-wide cache of subdivision surface descriptors.
+ *
+ * Creating topology refiner and evaluator (which includes stencil and patch tables) is the most
+ * expensive part of subdivision surface evaluation when only positions of the coarse mesh change.
+ * The modifier runtime keeps its descriptor for as long as the evaluated object lives, but a new
+ * dependency graph (which is the case for every frame of a non-persistent render) or another
+ * object using the same mesh starts from scratch.
+ *
+ * Descriptors released by their owner are kept here, keyed by the settings and a hash of the
+ * coarse topology, and handed out to the next owner whose topology matches. The actual match is
+ * verified against the topology refiner, the hash is only used to avoid expensive comparison.
+ *
+ * The cache is bounded by an estimate of the memory used by the descriptors, and is cleared when
+ * another file is loaded.
+ */
+
+#include "BKE_subdiv.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BLI_hash_mm2a.h"
+#include "BLI_listbase.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "subdiv_converter.h"
+
+#include "opensubdiv_converter_capi.h"
+#include "opensubdiv_evaluator_capi.h"
+#include "opensubdiv_topology_refiner_capi.h"
+
+/* Default upper bound of memory used by descriptors which are kept alive without an owner. When
+ * the limit is reached the least recently released descriptors are freed. */
+#define SUBDIV_CACHE_DEFAULT_MEMORY_LIMIT ((size_t)512 * 1024 * 1024)
+
+typedef struct SubdivCacheEntry {
+  struct SubdivCacheEntry *next, *prev;
+  Subdiv *subdiv;
+  /* Estimated memory used by the descriptor, see subdiv_cache_memory_estimate(). */
+  size_t memory;
+} SubdivCacheEntry;
+
+typedef struct SubdivCache {
+  /* Most recently released entries are at the end of the list. */
+  ListBase entries;
+  int num_entries;
+  size_t memory;
+  size_t memory_limit;
+} SubdivCache;
+
+static SubdivCache subdiv_cache = {{NULL, NULL}, 0, 0, SUBDIV_CACHE_DEFAULT_MEMORY_LIMIT};
+static ThreadMutex subdiv_cache_lock = BLI_MUTEX_INITIALIZER;
+
+/* --------------------------------------------------------------------
+ * Topology hash.
+ */
+
+uint32_t BKE_subdiv_topology_hash_from_mesh(const Mesh *mesh)
+{
+  BLI_HashMurmur2A mm2;
+  BLI_hash_mm2a_init(&mm2, 0);
+  BLI_hash_mm2a_add_int(&mm2, mesh->totvert);
+  BLI_hash_mm2a_add_int(&mm2, mesh->totedge);
+  BLI_hash_mm2a_add_int(&mm2, mesh->totpoly);
+  BLI_hash_mm2a_add_int(&mm2, mesh->totloop);
+  for (int poly_index = 0; poly_index < mesh->totpoly; poly_index++) {
+    BLI_hash_mm2a_add_int(&mm2, mesh->mpoly[poly_index].totloop);
+  }
+  for (int loop_index = 0; loop_index < mesh->totloop; loop_index++) {
+    BLI_hash_mm2a_add_int(&mm2, mesh->mloop[loop_index].v);
+  }
+  for (int edge_index = 0; edge_index < mesh->totedge; edge_index++) {
+    const MEdge *edge = &mesh->medge[edge_index];
+    BLI_hash_mm2a_add_int(&mm2, edge->v1);
+    BLI_hash_mm2a_add_int(&mm2, edge->v2);
+    BLI_hash_mm2a_add_int(&mm2, edge->crease);
+  }
+  /* Never return zero, it is used to indicate that the hash is not known. */
+  const uint32_t hash = BLI_hash_mm2a_end(&mm2);
+  return (hash != 0) ? hash : 1;
+}
+
+/* --------------------------------------------------------------------
+ * Cache.
+ */
+
+static bool subdiv_cache_can_store(const Subdiv *subdiv)
+{
+  if (subdiv->topology_hash == 0 || subdiv->topology_refiner == NULL) {
+    return false;
+  }
+  /* GPU evaluators are to be freed by the draw code, where the drawing context is known to be
+   * valid, so they can not be kept alive here. */
+  if (subdiv->evaluator != NULL && subdiv->evaluator->type != OPENSUBDIV_EVALUATOR_CPU) {
+    return false;
+  }
+  return true;
+}
+
+/* OpenSubdiv does not report memory used by its tables, so estimate it from the size of the coarse
+ * topology. The topology refiner stores a few arrays per coarse element, while the patch and
+ * stencil tables of the evaluator are proportional to the number of ptex faces and grow with the
+ * isolation level. */
+static size_t subdiv_cache_memory_estimate(const Subdiv *subdiv)
+{
+  const OpenSubdiv_TopologyRefiner *refiner = subdiv->topology_refiner;
+  const size_t num_vertices = refiner->getNumVertices(refiner);
+  const size_t num_edges = refiner->getNumEdges(refiner);
+  const size_t num_faces = refiner->getNumFaces(refiner);
+  const size_t num_ptex_faces = refiner->getNumPtexFaces(refiner);
+  const size_t level = refiner->getSubdivisionLevel(refiner);
+
+  size_t memory = sizeof(Subdiv);
+  memory += (num_vertices + num_edges + num_faces) * 8 * sizeof(int);
+  if (subdiv->evaluator != NULL) {
+    memory += num_ptex_faces * (level + 1) * 16 * (sizeof(int) + sizeof(float));
+  }
+  return memory;
+}
+
+static void subdiv_cache_entry_free(SubdivCacheEntry *entry)
+{
+  BKE_subdiv_free(entry->subdiv);
+  MEM_freeN(entry);
+}
+
+static void subdiv_cache_entry_remove(SubdivCacheEntry *entry)
+{
+  BLI_remlink(&subdiv_cache.entries, entry);
+  subdiv_cache.num_entries--;
+  subdiv_cache.memory -= entry->memory;
+}
+
+/* Move least recently released entries which do not fit into the memory limit to the given list.
+ * Must be called with the cache locked. */
+static void subdiv_cache_evict(ListBase *r_evicted)
+{
+  while (subdiv_cache.memory > subdiv_cache.memory_limit) {
+    SubdivCacheEntry *entry = subdiv_cache.entries.first;
+    subdiv_cache_entry_remove(entry);
+    BLI_addtail(r_evicted, entry);
+  }
+}
+
+static void subdiv_cache_entries_free(ListBase *entries)
+{
+  LISTBASE_FOREACH_MUTABLE (SubdivCacheEntry *, entry, entries) {
+    subdiv_cache_entry_free(entry);
+  }
+  BLI_listbase_clear(entries);
+}
+
+Subdiv *BKE_subdiv_cache_acquire(const SubdivSettings *settings,
+                                 const Mesh *mesh,
+                                 const uint32_t topology_hash)
+{
+  if (mesh->totvert == 0) {
+    return NULL;
+  }
+
+  /* Take candidate out of the cache, so that the expensive comparison happens without lock. */
+  Subdiv *subdiv = NULL;
+  BLI_mutex_lock(&subdiv_cache_lock);
+  LISTBASE_FOREACH_BACKWARD (SubdivCacheEntry *, entry, &subdiv_cache.entries) {
+    if (entry->subdiv->topology_hash == topology_hash &&
+        BKE_subdiv_settings_equal(&entry->subdiv->settings, settings)) {
+      subdiv = entry->subdiv;
+      subdiv_cache_entry_remove(entry);
+      MEM_freeN(entry);
+      break;
+    }
+  }
+  BLI_mutex_unlock(&subdiv_cache_lock);
+
+  if (subdiv == NULL) {
+    return NULL;
+  }
+
+  OpenSubdiv_Converter converter;
+  BKE_subdiv_converter_init_for_mesh(&converter, settings, mesh);
+  BKE_subdiv_stats_begin(&subdiv->stats, SUBDIV_STATS_TOPOLOGY_COMPARE);
+  const bool is_equal = openSubdiv_topologyRefinerCompareWithConverter(subdiv->topology_refiner,
+                                                                       &converter);
+  BKE_subdiv_stats_end(&subdiv->stats, SUBDIV_STATS_TOPOLOGY_COMPARE);
+  BKE_subdiv_converter_free(&converter);
+
+  if (!is_equal) {
+    /* Hash collision, the descriptor is unlikely to be useful for anyone else. */
+    BKE_subdiv_free(subdiv);
+    return NULL;
+  }
+  return subdiv;
+}
+
+void BKE_subdiv_cache_release(Subdiv *subdiv)
+{
+  if (!subdiv_cache_can_store(subdiv)) {
+    BKE_subdiv_free(subdiv);
+    return;
+  }
+
+  /* Displacement refers to data of the previous owner. */
+  BKE_subdiv_displacement_detach(subdiv);
+
+  SubdivCacheEntry *entry = MEM_callocN(sizeof(SubdivCacheEntry), "subdiv cache entry");
+  entry->subdiv = subdiv;
+  entry->memory = subdiv_cache_memory_estimate(subdiv);
+
+  /* Free evicted descriptors outside of the lock, freeing evaluator is not cheap. */
+  ListBase evicted = {NULL, NULL};
+  BLI_mutex_lock(&subdiv_cache_lock);
+  BLI_addtail(&subdiv_cache.entries, entry);
+  subdiv_cache.num_entries++;
+  subdiv_cache.memory += entry->memory;
+  subdiv_cache_evict(&evicted);
+  BLI_mutex_unlock(&subdiv_cache_lock);
+
+  subdiv_cache_entries_free(&evicted);
+}
+
+void BKE_subdiv_cache_clear(void)
+{
+  BLI_mutex_lock(&subdiv_cache_lock);
+  ListBase entries = subdiv_cache.entries;
+  BLI_listbase_clear(&subdiv_cache.entries);
+  subdiv_cache.num_entries = 0;
+  subdiv_cache.memory = 0;
+  BLI_mutex_unlock(&subdiv_cache_lock);
+
+  subdiv_cache_entries_free(&entries);
+}
+
+void BKE_subdiv_cache_memory_limit_set(const size_t memory_limit)
+{
+  ListBase evicted = {NULL, NULL};
+  BLI_mutex_lock(&subdiv_cache_lock);
+  subdiv_cache.memory_limit = memory_limit;
+  subdiv_cache_evict(&evicted);
+  BLI_mutex_unlock(&subdiv_cache_lock);
+
+  subdiv_cache_entries_free(&evicted);
+}
+
+size_t BKE_subdiv_cache_memory_limit_get(void)
+{
+  return subdiv_cache.memory_limit;
+}
+
+size_t BKE_subdiv_cache_memory_get(void)
+{
+  BLI_mutex_lock(&subdiv_cache_lock);
+  const size_t memory = subdiv_cache.memory;
+  BLI_mutex_unlock(&subdiv_cache_lock);
+  return memory;
+}
+
+int BKE_subdiv_cache_num_entries_get(void)
+{
+  BLI_mutex_lock(&subdiv_cache_lock);
+  const int num_entries = subdiv_cache.num_entries;
+  BLI_mutex_unlock(&subdiv_cache_lock);
+  return num_entries;
+}
@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022 Blender Foundation. */
+#include "testing/testing.h"
+
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_subdiv.h"
+#include "BKE_subdiv_eval.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#ifdef WITH_OPENSUBDIV
+
+namespace blender::bke::tests {
+
+class SubdivCacheTest : public testing::Test {
+ public:
+  static void SetUpTestSuite()
+  {
+    BKE_idtype_init();
+    BKE_subdiv_init();
+  }
+
+  static void TearDownTestSuite()
+  {
+    BKE_subdiv_exit();
+  }
+
+  void SetUp() override
+  {
+    memory_limit_ = BKE_subdiv_cache_memory_limit_get();
+  }
+
+  void TearDown() override
+  {
+    BKE_subdiv_cache_clear();
+    BKE_subdiv_cache_memory_limit_set(memory_limit_);
+  }
+
+ private:
+  size_t memory_limit_ = 0;
+};
+
+/* Grid of the given number of quads on each side. */
+static Mesh *grid_mesh_new(const int size)
+{
+  const int verts_len = (size + 1) * (size + 1);
+  const int edges_len = 2 * size * (size + 1);
+  const int polys_len = size * size;
+  Mesh *mesh = BKE_mesh_new_nomain(verts_len, edges_len, 0, polys_len * 4, polys_len);
+
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      float *co = mesh->mvert[y * (size + 1) + x].co;
+      co[0] = float(x);
+      co[1] = float(y);
+      co[2] = 0.0f;
+    }
+  }
+
+  int edge_index = 0;
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x < size; x++) {
+      mesh->medge[edge_index].v1 = y * (size + 1) + x;
+      mesh->medge[edge_index].v2 = y * (size + 1) + x + 1;
+      edge_index++;
+    }
+  }
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x <= size; x++) {
+      mesh->medge[edge_index].v1 = y * (size + 1) + x;
+      mesh->medge[edge_index].v2 = (y + 1) * (size + 1) + x;
+      edge_index++;
+    }
+  }
+
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const int poly_index = y * size + x;
+      const int v0 = y * (size + 1) + x;
+      MLoop *loops = &mesh->mloop[poly_index * 4];
+      loops[0].v = v0;
+      loops[1].v = v0 + 1;
+      loops[2].v = v0 + size + 2;
+      loops[3].v = v0 + size + 1;
+      loops[0].e = y * size + x;
+      loops[1].e = (size + 1) * size + y * (size + 1) + x + 1;
+      loops[2].e = (y + 1) * size + x;
+      loops[3].e = (size + 1) * size + y * (size + 1) + x;
+      mesh->mpoly[poly_index].loopstart = poly_index * 4;
+      mesh->mpoly[poly_index].totloop = 4;
+    }
+  }
+
+  return mesh;
+}
+
+static SubdivSettings subdiv_settings(const int level)
+{
+  SubdivSettings settings = {};
+  settings.is_simple = false;
+  settings.is_adaptive = true;
+  settings.level = level;
+  settings.use_creases = true;
+  settings.vtx_boundary_interpolation = SUBDIV_VTX_BOUNDARY_EDGE_ONLY;
+  settings.fvar_linear_interpolation = SUBDIV_FVAR_LINEAR_INTERPOLATION_BOUNDARIES;
+  return settings;
+}
+
+/* Descriptor with an evaluator, ready to be released to the cache. */
+static Subdiv *subdiv_new(const SubdivSettings &settings, const Mesh *mesh)
+{
+  Subdiv *subdiv = BKE_subdiv_new_from_mesh(&settings, mesh);
+  EXPECT_NE(subdiv, nullptr);
+  EXPECT_TRUE(
+      BKE_subdiv_eval_begin_from_mesh(subdiv, mesh, nullptr, SUBDIV_EVALUATOR_TYPE_CPU, nullptr));
+  subdiv->topology_hash = BKE_subdiv_topology_hash_from_mesh(mesh);
+  return subdiv;
+}
+
+TEST_F(SubdivCacheTest, hit)
+{
+  Mesh *mesh = grid_mesh_new(4);
+  const SubdivSettings settings = subdiv_settings(3);
+
+  Subdiv *subdiv = subdiv_new(settings, mesh);
+  BKE_subdiv_cache_release(subdiv);
+  EXPECT_EQ(BKE_subdiv_cache_num_entries_get(), 1);
+  EXPECT_GT(BKE_subdiv_cache_memory_get(), 0);
+
+  /* The same topology with different coordinates re-uses the descriptor. */
+  mesh->mvert[0].co[2] = 1.0f;
+  const uint32_t topology_hash = BKE_subdiv_topology_hash_from_mesh(mesh);
+  EXPECT_EQ(BKE_subdiv_cache_acquire(&settings, mesh, topology_hash), subdiv);
+  EXPECT_EQ(BKE_subdiv_cache_num_entries_get(), 0);
+  EXPECT_EQ(BKE_subdiv_cache_memory_get(), 0);
+
+  BKE_subdiv_free(subdiv);
+  BKE_id_free(nullptr, mesh);
+}
+
+TEST_F(SubdivCacheTest, miss)
+{
+  Mesh *mesh = grid_mesh_new(4);
+  Mesh *other_mesh = grid_mesh_new(5);
+  const SubdivSettings settings = subdiv_settings(3);
+  const SubdivSettings other_settings = subdiv_settings(2);
+
+  BKE_subdiv_cache_release(subdiv_new(settings, mesh));
+
+  /* Different settings. */
+  EXPECT_EQ(BKE_subdiv_cache_acquire(
+                &other_settings, mesh, BKE_subdiv_topology_hash_from_mesh(mesh)),
+            nullptr);
+
+  /* Different topology. */
+  EXPECT_EQ(BKE_subdiv_cache_acquire(
+                &settings, other_mesh, BKE_subdiv_topology_hash_from_mesh(other_mesh)),
+            nullptr);
+
+  /* Topology which does not match the hash is detected by the comparison. */
+  EXPECT_EQ(BKE_subdiv_cache_acquire(
+                &settings, other_mesh, BKE_subdiv_topology_hash_from_mesh(mesh)),
+            nullptr);
+  EXPECT_EQ(BKE_subdiv_cache_num_entries_get(), 0);
+
+  BKE_id_free(nullptr, mesh);
+  BKE_id_free(nullptr, other_mesh);
+}
+
+TEST_F(SubdivCacheTest, eviction)
+{
+  Mesh *mesh = grid_mesh_new(4);
+  Mesh *other_mesh = grid_mesh_new(5);
+  const SubdivSettings settings = subdiv_settings(3);
+
+  BKE_subdiv_cache_release(subdiv_new(settings, mesh));
+  const size_t memory = BKE_subdiv_cache_memory_get();
+
+  /* Only leave room for one descriptor, the least recently released one is freed. */
+  BKE_subdiv_cache_memory_limit_set(memory * 2 - 1);
+  Subdiv *other_subdiv = subdiv_new(settings, other_mesh);
+  BKE_subdiv_cache_release(other_subdiv);
+  EXPECT_EQ(BKE_subdiv_cache_num_entries_get(), 1);
+  EXPECT_LE(BKE_subdiv_cache_memory_get(), memory * 2 - 1);
+
+  EXPECT_EQ(BKE_subdiv_cache_acquire(&settings, mesh, BKE_subdiv_topology_hash_from_mesh(mesh)),
+            nullptr);
+  EXPECT_EQ(BKE_subdiv_cache_acquire(
+                &settings, other_mesh, BKE_subdiv_topology_hash_from_mesh(other_mesh)),
+            other_subdiv);
+  BKE_subdiv_free(other_subdiv);
+
+  /* Lowering the limit evicts stored descriptors. */
+  BKE_subdiv_cache_release(subdiv_new(settings, mesh));
+  EXPECT_EQ(BKE_subdiv_cache_num_entries_get(), 1);
+  BKE_subdiv_cache_memory_limit_set(0);
+  EXPECT_EQ(BKE_subdiv_cache_num_entries_get(), 0);
+  EXPECT_EQ(BKE_subdiv_cache_memory_get(), 0);
+
+  BKE_id_free(nullptr, mesh);
+  BKE_id_free(nullptr, other_mesh);
+}
+
+}  // namespace blender::bke::tests
+
+#endif
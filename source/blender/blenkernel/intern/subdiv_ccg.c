@@ -47,24 +47,20 @@ void subdiv_ccg_average_faces_boundaries_and_corners(SubdivCCG *subdiv_ccg,
 /** \name Generally useful internal helpers
  * \{ */
 
-/* Number of floats in per-vertex elements. */
-static int num_element_float_get(const SubdivCCG *subdiv_ccg)
+/* Per-vertex element size in bytes. */
+static int element_size_bytes_get(const SubdivCCG *subdiv_ccg)
 {
   /* We always have 3 floats for coordinate. */
-  int num_floats = 3;
+  int num_bytes = sizeof(float[3]);
   if (subdiv_ccg->has_normal) {
-    num_floats += 3;
+    num_bytes += subdiv_ccg->has_compact_normal ? sizeof(short[3]) : sizeof(float[3]);
   }
   if (subdiv_ccg->has_mask) {
-    num_floats += 1;
+    num_bytes += sizeof(float);
   }
-  return num_floats;
-}
-
-/* Per-vertex element size in bytes. */
-static int element_size_bytes_get(const SubdivCCG *subdiv_ccg)
-{
-  return sizeof(float) * num_element_float_get(subdiv_ccg);
+  /* Keep coordinates of every element aligned for float access. */
+  const int alignment = sizeof(float);
+  return (num_bytes + alignment - 1) / alignment * alignment;
 }
 
 /** \} */
@@ -93,11 +89,13 @@ static void subdiv_ccg_init_layers(SubdivCCG *subdiv_ccg, const SubdivToCCGSetti
    * here, but some other area might in theory depend memory layout. */
   if (settings->need_normal) {
     subdiv_ccg->has_normal = true;
+    subdiv_ccg->has_compact_normal = settings->use_compact_normal;
     subdiv_ccg->normal_offset = layer_offset;
-    layer_offset += sizeof(float[3]);
+    layer_offset += subdiv_ccg->has_compact_normal ? sizeof(short[3]) : sizeof(float[3]);
   }
   else {
     subdiv_ccg->has_normal = false;
+    subdiv_ccg->has_compact_normal = false;
     subdiv_ccg->normal_offset = -1;
   }
 }
@@ -178,6 +176,12 @@ static void subdiv_ccg_eval_grid_element_limit(CCGEvalGridsData *data,
   if (subdiv->displacement_evaluator != NULL) {
     BKE_subdiv_eval_final_point(subdiv, ptex_face_index, u, v, (float *)element);
   }
+  else if (subdiv_ccg->has_compact_normal) {
+    float normal[3];
+    BKE_subdiv_eval_limit_point_and_normal(
+        subdiv, ptex_face_index, u, v, (float *)element, normal);
+    normal_float_to_short_v3((short *)(element + subdiv_ccg->normal_offset), normal);
+  }
   else if (subdiv_ccg->has_normal) {
     BKE_subdiv_eval_limit_point_and_normal(subdiv,
                                            ptex_face_index,
@@ -663,6 +667,7 @@ void BKE_subdiv_ccg_key(CCGKey *key, const SubdivCCG *subdiv_ccg, int level)
 
   key->has_normals = subdiv_ccg->has_normal;
   key->has_mask = subdiv_ccg->has_mask;
+  key->has_compact_normals = subdiv_ccg->has_compact_normal;
 }
 
 void BKE_subdiv_ccg_key_top_level(CCGKey *key, const SubdivCCG *subdiv_ccg)
@@ -757,7 +762,8 @@ static void subdiv_ccg_average_inner_face_normals(SubdivCCG *subdiv_ccg,
         counter++;
       }
       /* Normalize and store. */
-      mul_v3_v3fl(CCG_grid_elem_no(key, grid, x, y), normal_acc, 1.0f / counter);
+      mul_v3_fl(normal_acc, 1.0f / counter);
+      CCG_elem_no_set(key, CCG_grid_elem(key, grid, x, y), normal_acc);
     }
   }
 }
@@ -914,8 +920,12 @@ static void average_grid_element(SubdivCCG *subdiv_ccg,
   average_grid_element_value_v3(CCG_elem_co(key, grid_element_a),
                                 CCG_elem_co(key, grid_element_b));
   if (subdiv_ccg->has_normal) {
-    average_grid_element_value_v3(CCG_elem_no(key, grid_element_a),
-                                  CCG_elem_no(key, grid_element_b));
+    float no_a[3], no_b[3];
+    CCG_elem_no_get(key, grid_element_a, no_a);
+    CCG_elem_no_get(key, grid_element_b, no_b);
+    average_grid_element_value_v3(no_a, no_b);
+    CCG_elem_no_set(key, grid_element_a, no_a);
+    CCG_elem_no_set(key, grid_element_b, no_b);
   }
   if (subdiv_ccg->has_mask) {
     float mask = (*CCG_elem_mask(key, grid_element_a) + *CCG_elem_mask(key, grid_element_b)) *
@@ -946,7 +956,9 @@ static void element_accumulator_add(GridElementAccumulator *accumulator,
 {
   add_v3_v3(accumulator->co, CCG_elem_co(key, grid_element));
   if (subdiv_ccg->has_normal) {
-    add_v3_v3(accumulator->no, CCG_elem_no(key, grid_element));
+    float no[3];
+    CCG_elem_no_get(key, grid_element, no);
+    add_v3_v3(accumulator->no, no);
   }
   if (subdiv_ccg->has_mask) {
     accumulator->mask += *CCG_elem_mask(key, grid_element);
@@ -967,7 +979,7 @@ static void element_accumulator_copy(SubdivCCG *subdiv_ccg,
 {
   copy_v3_v3(CCG_elem_co(key, destination), accumulator->co);
   if (subdiv_ccg->has_normal) {
-    copy_v3_v3(CCG_elem_no(key, destination), accumulator->no);
+    CCG_elem_no_set(key, destination, accumulator->no);
   }
   if (subdiv_ccg->has_mask) {
     *CCG_elem_mask(key, destination) = accumulator->mask;
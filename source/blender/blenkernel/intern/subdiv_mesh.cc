@@ -13,7 +13,11 @@
 
 #include "BLI_array.hh"
 #include "BLI_bitmap.h"
+#include "BLI_math_base.h"
+#include "BLI_math_matrix.h"
 #include "BLI_math_vector.h"
+#include "BLI_math_vector.hh"
+#include "BLI_task.hh"
 
 #include "BKE_customdata.h"
 #include "BKE_key.h"
@@ -1153,6 +1157,97 @@ static void setup_foreach_callbacks(const SubdivMeshContext *subdiv_context,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Adaptive level
+ * \{ */
+
+enum {
+  CLIP_OUTSIDE_LEFT = (1 << 0),
+  CLIP_OUTSIDE_RIGHT = (1 << 1),
+  CLIP_OUTSIDE_BOTTOM = (1 << 2),
+  CLIP_OUTSIDE_TOP = (1 << 3),
+  CLIP_OUTSIDE_NEAR = (1 << 4),
+};
+
+static int clip_outside_flag_get(const blender::float4 &co)
+{
+  int flag = 0;
+  flag |= (co.x < -co.w) ? CLIP_OUTSIDE_LEFT : 0;
+  flag |= (co.x > co.w) ? CLIP_OUTSIDE_RIGHT : 0;
+  flag |= (co.y < -co.w) ? CLIP_OUTSIDE_BOTTOM : 0;
+  flag |= (co.y > co.w) ? CLIP_OUTSIDE_TOP : 0;
+  flag |= (co.w <= FLT_EPSILON) ? CLIP_OUTSIDE_NEAR : 0;
+  return flag;
+}
+
+int BKE_subdiv_mesh_adaptive_level_get(const Mesh *coarse_mesh,
+                                       const SubdivToMeshAdaptiveSettings *settings)
+{
+  using namespace blender;
+  const int max_level = settings->max_level;
+  if (max_level <= 1 || coarse_mesh->totpoly == 0) {
+    return max_level;
+  }
+
+  const MVert *mvert = coarse_mesh->mvert;
+  const MLoop *mloop = coarse_mesh->mloop;
+  const MPoly *mpoly = coarse_mesh->mpoly;
+
+  Array<float4> clip_co(coarse_mesh->totvert);
+  threading::parallel_for(clip_co.index_range(), 4096, [&](IndexRange range) {
+    for (const int vertex_index : range) {
+      mul_v4_m4v3(clip_co[vertex_index], settings->object_to_clip, mvert[vertex_index].co);
+    }
+  });
+
+  const float2 half_win_size(0.5f * settings->winx, 0.5f * settings->winy);
+  auto screen_co = [&](const float4 &co) -> float2 {
+    return float2(co.x / co.w, co.y / co.w) * half_win_size;
+  };
+
+  /* Longest edge in pixels of the faces which are visible by the camera. */
+  const float max_edge_length = threading::parallel_reduce(
+      IndexRange(coarse_mesh->totpoly),
+      1024,
+      0.0f,
+      [&](IndexRange range, float edge_length) {
+        for (const int poly_index : range) {
+          const MPoly &poly = mpoly[poly_index];
+          /* Face is outside of the view when all of its vertices are outside of the same
+           * clipping plane. */
+          int outside_flag = ~0;
+          for (int corner = 0; corner < poly.totloop; corner++) {
+            outside_flag &= clip_outside_flag_get(clip_co[mloop[poly.loopstart + corner].v]);
+          }
+          if (outside_flag != 0) {
+            continue;
+          }
+          for (int corner = 0; corner < poly.totloop; corner++) {
+            const float4 &co_a = clip_co[mloop[poly.loopstart + corner].v];
+            const float4 &co_b = clip_co[mloop[poly.loopstart + (corner + 1) % poly.totloop].v];
+            /* Edges crossing the camera plane can not be measured in screen space, the rest of
+             * the face is used instead. */
+            if (co_a.w <= FLT_EPSILON || co_b.w <= FLT_EPSILON) {
+              continue;
+            }
+            edge_length = max_ff(edge_length, math::distance(screen_co(co_a), screen_co(co_b)));
+          }
+        }
+        return edge_length;
+      },
+      [](const float a, const float b) { return max_ff(a, b); });
+
+  const float dicing_rate = max_ff(settings->dicing_rate, 0.1f);
+  if (max_edge_length <= dicing_rate) {
+    return 1;
+  }
+  /* Every level halves length of the edges. */
+  const int level = int(ceilf(log2f(max_edge_length / dicing_rate)));
+  return clamp_i(level, 1, max_level);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Public entry point
  * \{ */
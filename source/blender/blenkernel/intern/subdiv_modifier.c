@@ -157,8 +157,22 @@ Subdiv *BKE_subsurf_modifier_subdiv_descriptor_ensure(SubsurfRuntimeData *runtim
     BKE_subdiv_free(runtime_data->subdiv);
     runtime_data->subdiv = NULL;
   }
-  Subdiv *subdiv = BKE_subdiv_update_from_mesh(
-      runtime_data->subdiv, &runtime_data->settings, mesh);
+  Subdiv *subdiv = NULL;
+  uint32_t topology_hash = 0;
+  if (runtime_data->subdiv == NULL && !for_draw_code) {
+    /* Evaluation in a new dependency graph, or of another object using the same mesh: re-use the
+     * topology refiner and evaluator created by a previous evaluation. */
+    topology_hash = BKE_subdiv_topology_hash_from_mesh(mesh);
+    subdiv = BKE_subdiv_cache_acquire(&runtime_data->settings, mesh, topology_hash);
+  }
+  if (subdiv == NULL) {
+    subdiv = BKE_subdiv_update_from_mesh(runtime_data->subdiv, &runtime_data->settings, mesh);
+  }
+  if (subdiv != NULL && !for_draw_code && subdiv->topology_hash == 0) {
+    /* Descriptors created for the draw code might get GPU evaluator, so they are never cached. */
+    subdiv->topology_hash = (topology_hash != 0) ? topology_hash :
+                                                   BKE_subdiv_topology_hash_from_mesh(mesh);
+  }
   runtime_data->subdiv = subdiv;
   runtime_data->set_by_draw_code = for_draw_code;
   return subdiv;
@@ -39,6 +39,8 @@ enum class BoolOpType {
  * Same goes for the pm_triangulated argument.
  * The output #IMesh will have faces whose orig fields map back to faces and edges in
  * the input mesh.
+ * Unions of many shapes are done as a balanced tree of smaller unions, unless use_union_tree is
+ * false. The result is the same, so that is mainly useful for testing.
  */
 IMesh boolean_mesh(IMesh &imesh,
                    BoolOpType op,
@@ -47,7 +49,8 @@ IMesh boolean_mesh(IMesh &imesh,
                    bool use_self,
                    bool hole_tolerant,
                    IMesh *imesh_triangulated,
-                   IMeshArena *arena);
+                   IMeshArena *arena,
+                   bool use_union_tree = true);
 
 /**
  * This is like boolean, but operates on #IMesh's whose faces are all triangles.
@@ -60,7 +63,8 @@ IMesh boolean_trimesh(IMesh &tm_in,
                       std::function<int(int)> shape_fn,
                       bool use_self,
                       bool hole_tolerant,
-                      IMeshArena *arena);
+                      IMeshArena *arena,
+                      bool use_union_tree = true);
 
 }  // namespace blender::meshintersect
 
@@ -3531,6 +3531,70 @@ static IMesh polymesh_from_trimesh_with_dissolve(const IMesh &tm_out,
   return imesh_out;
 }
 
+/**
+ * Union of this many operands or more is done as a balanced tree of smaller unions.
+ */
+constexpr int union_tree_min_shapes = 4;
+
+/**
+ * Do a union of `nshapes` operands by splitting them into two halves, doing the union of each
+ * half (recursively, and in parallel), and then doing a binary union of the two results.
+ *
+ * Each of the half unions removes the geometry that ends up inside of the other operands in that
+ * half, so the final union only has to intersect what is left of the surfaces, instead of every
+ * pair of overlapping triangles of all operands. The output triangles keep the `orig` of the
+ * input triangles they came from, so the result can be used the same way as the result of the
+ * non-hierarchical union.
+ *
+ * Returns false if some triangle is not in the range of shapes, in which case the caller should
+ * do the union in one step.
+ */
+static bool boolean_trimesh_union_tree(IMesh &tm_in,
+                                       int nshapes,
+                                       std::function<int(int)> shape_fn,
+                                       bool use_self,
+                                       IMeshArena *arena,
+                                       IMesh *r_tm_out)
+{
+  const int mid = nshapes / 2;
+  Vector<Face *> faces_a;
+  Vector<Face *> faces_b;
+  for (Face *f : tm_in.faces()) {
+    const int shape = shape_fn(f->orig);
+    if (shape < 0 || shape >= nshapes) {
+      return false;
+    }
+    if (shape < mid) {
+      faces_a.append(f);
+    }
+    else {
+      faces_b.append(f);
+    }
+  }
+  IMesh tm_a(faces_a);
+  IMesh tm_b(faces_b);
+  auto shape_fn_b = [shape_fn, mid](int f) { return shape_fn(f) - mid; };
+  IMesh tm_out_a;
+  IMesh tm_out_b;
+  threading::parallel_invoke(
+      [&]() {
+        tm_out_a = boolean_trimesh(tm_a, BoolOpType::Union, mid, shape_fn, use_self, false, arena);
+      },
+      [&]() {
+        tm_out_b = boolean_trimesh(
+            tm_b, BoolOpType::Union, nshapes - mid, shape_fn_b, use_self, false, arena);
+      });
+
+  Vector<Face *> faces_ab;
+  faces_ab.reserve(tm_out_a.face_size() + tm_out_b.face_size());
+  faces_ab.extend(tm_out_a.faces());
+  faces_ab.extend(tm_out_b.faces());
+  IMesh tm_ab(faces_ab);
+  auto shape_fn_ab = [shape_fn, mid](int f) { return shape_fn(f) < mid ? 0 : 1; };
+  *r_tm_out = boolean_trimesh(tm_ab, BoolOpType::Union, 2, shape_fn_ab, use_self, false, arena);
+  return true;
+}
+
 /**
  * This function does a boolean operation on a TriMesh with nshapes inputs.
  * All the shapes are combined in tm_in.
@@ -3543,7 +3607,8 @@ IMesh boolean_trimesh(IMesh &tm_in,
                       std::function<int(int)> shape_fn,
                       bool use_self,
                       bool hole_tolerant,
-                      IMeshArena *arena)
+                      IMeshArena *arena,
+                      bool use_union_tree)
 {
   constexpr int dbg_level = 0;
   if (dbg_level > 0) {
@@ -3558,6 +3623,15 @@ IMesh boolean_trimesh(IMesh &tm_in,
   if (tm_in.face_size() == 0) {
     return IMesh(tm_in);
   }
+  /* The hole tolerant method decides per triangle, so the intermediate unions are not closed
+   * and the result of a union tree would not match the result of the union in one step. */
+  if (use_union_tree && op == BoolOpType::Union && nshapes >= union_tree_min_shapes &&
+      !hole_tolerant) {
+    IMesh tm_out;
+    if (boolean_trimesh_union_tree(tm_in, nshapes, shape_fn, use_self, arena, &tm_out)) {
+      return tm_out;
+    }
+  }
 #  ifdef PERFDEBUG
   double start_time = PIL_check_seconds_timer();
   std::cout << "  boolean_trimesh, timing begins\n";
@@ -3692,7 +3766,8 @@ IMesh boolean_mesh(IMesh &imesh,
                    bool use_self,
                    bool hole_tolerant,
                    IMesh *imesh_triangulated,
-                   IMeshArena *arena)
+                   IMeshArena *arena,
+                   bool use_union_tree)
 {
   constexpr int dbg_level = 0;
   if (dbg_level > 0) {
@@ -3724,7 +3799,8 @@ IMesh boolean_mesh(IMesh &imesh,
   if (dbg_level > 1) {
     write_obj_mesh(*tm_in, "boolean_tm_in");
   }
-  IMesh tm_out = boolean_trimesh(*tm_in, op, nshapes, shape_fn, use_self, hole_tolerant, arena);
+  IMesh tm_out = boolean_trimesh(
+      *tm_in, op, nshapes, shape_fn, use_self, hole_tolerant, arena, use_union_tree);
 #  ifdef PERFDEBUG
   double bool_tri_time = PIL_check_seconds_timer();
   std::cout << "boolean_trimesh done, time = " << bool_tri_time - tri_time << "\n";
@@ -2,6 +2,7 @@
 
 #include "testing/testing.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -955,5 +956,139 @@ TEST(boolean_polymesh, CubePlane)
   }
 }
 
+static bool mpq3_less(const mpq3 &a, const mpq3 &b)
+{
+  for (int i = 0; i < 3; i++) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i];
+    }
+  }
+  return false;
+}
+
+/**
+ * Faces of the mesh as lists of exact vertex coordinates, each list starting at the smallest
+ * coordinate, in sorted order. Allows to compare the geometry of meshes regardless of the order
+ * of their vertices and faces.
+ */
+static Vector<Vector<mpq3>> canonical_faces(const IMesh &mesh)
+{
+  Vector<Vector<mpq3>> faces;
+  for (const Face *f : mesh.faces()) {
+    int start = 0;
+    for (int i = 1; i < f->size(); i++) {
+      if (mpq3_less((*f)[i]->co_exact, (*f)[start]->co_exact)) {
+        start = i;
+      }
+    }
+    Vector<mpq3> face;
+    for (int i = 0; i < f->size(); i++) {
+      face.append((*f)[(start + i) % f->size()]->co_exact);
+    }
+    faces.append(face);
+  }
+  std::sort(faces.begin(), faces.end(), [](const Vector<mpq3> &a, const Vector<mpq3> &b) {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), mpq3_less);
+  });
+  return faces;
+}
+
+TEST(boolean_polymesh, CubeChainUnion)
+{
+  /* Four cubes, each one overlapping the next, so that the union is done as a union tree. */
+  const char *spec = R"(32 24
+  -1 -1 -1
+  -1 -1 1
+  -1 1 -1
+  -1 1 1
+  1 -1 -1
+  1 -1 1
+  1 1 -1
+  1 1 1
+  1/2 -3/4 -7/8
+  1/2 -3/4 9/8
+  1/2 5/4 -7/8
+  1/2 5/4 9/8
+  5/2 -3/4 -7/8
+  5/2 -3/4 9/8
+  5/2 5/4 -7/8
+  5/2 5/4 9/8
+  2 -1/2 -3/4
+  2 -1/2 5/4
+  2 3/2 -3/4
+  2 3/2 5/4
+  4 -1/2 -3/4
+  4 -1/2 5/4
+  4 3/2 -3/4
+  4 3/2 5/4
+  7/2 -1/4 -5/8
+  7/2 -1/4 11/8
+  7/2 7/4 -5/8
+  7/2 7/4 11/8
+  11/2 -1/4 -5/8
+  11/2 -1/4 11/8
+  11/2 7/4 -5/8
+  11/2 7/4 11/8
+  0 1 3 2
+  2 3 7 6
+  6 7 5 4
+  4 5 1 0
+  2 6 4 0
+  7 3 1 5
+  8 9 11 10
+  10 11 15 14
+  14 15 13 12
+  12 13 9 8
+  10 14 12 8
+  15 11 9 13
+  16 17 19 18
+  18 19 23 22
+  22 23 21 20
+  20 21 17 16
+  18 22 20 16
+  23 19 17 21
+  24 25 27 26
+  26 27 31 30
+  30 31 29 28
+  28 29 25 24
+  26 30 28 24
+  31 27 25 29
+)";
+
+  IMeshBuilder mb(spec);
+  IMesh out = boolean_mesh(
+      mb.imesh,
+      BoolOpType::Union,
+      4,
+      [](int t) { return t / 6; },
+      false,
+      false,
+      nullptr,
+      &mb.arena);
+  out.populate_vert();
+  EXPECT_EQ(out.vert_size(), 44);
+  EXPECT_EQ(out.face_size(), 24);
+  if (DO_OBJ) {
+    write_obj_mesh(out, "cubechain_union");
+  }
+
+  /* The n-ary union of all operands in one step has to give the same geometry. */
+  IMeshBuilder mb2(spec);
+  IMesh out2 = boolean_mesh(
+      mb2.imesh,
+      BoolOpType::Union,
+      4,
+      [](int t) { return t / 6; },
+      false,
+      false,
+      nullptr,
+      &mb2.arena,
+      false);
+  out2.populate_vert();
+  EXPECT_EQ(out2.vert_size(), out.vert_size());
+  EXPECT_EQ(out2.face_size(), out.face_size());
+  EXPECT_EQ(canonical_faces(out2), canonical_faces(out));
+}
+
 }  // namespace blender::meshintersect::tests
 #endif
@@ -3332,5 +3332,17 @@ void blo_do_versions_300(FileData *fd, Library *UNUSED(lib), Main *bmain)
         }
       }
     }
+
+    if (!DNA_struct_elem_find(
+            fd->filesdna, "SubsurfModifierData", "float", "render_dicing_rate")) {
+      LISTBASE_FOREACH (Object *, ob, &bmain->objects) {
+        LISTBASE_FOREACH (ModifierData *, md, &ob->modifiers) {
+          if (md->type == eModifierType_Subsurf) {
+            SubsurfModifierData *smd = (SubsurfModifierData *)md;
+            smd->render_dicing_rate = 1.0f;
+          }
+        }
+      }
+    }
   }
 }
@@ -52,6 +52,17 @@ void DEG_debug_stats_gnuplot(const struct Depsgraph *graph,
                              const char *label,
                              const char *output_filename);
 
+/* ************************************************ */
+/* Evaluation Tracing */
+
+/**
+ * Record begin and end time, thread and owner of every evaluated operation of all dependency
+ * graphs. The most recent evaluations are written to the given file in Chrome trace format by
+ * #DEG_debug_trace_end, or on exit.
+ */
+void DEG_debug_trace_begin(const char *filepath);
+void DEG_debug_trace_end(void);
+
 /* ************************************************ */
 
 /** Compare two dependency graphs. */
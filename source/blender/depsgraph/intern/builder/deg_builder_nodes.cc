@@ -388,6 +388,7 @@ void DepsgraphNodeBuilder::begin_build()
   graph_->clear_all_nodes();
   graph_->operations.clear();
   graph_->entry_tags.clear();
+  graph_->tagged_operations.clear();
 }
 
 /* Util callbacks for `BKE_library_foreach_ID_link`, used to detect when a COW ID is using ID
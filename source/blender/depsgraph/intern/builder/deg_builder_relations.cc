@@ -16,6 +16,7 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_task.hh"
 #include "BLI_utildefines.h"
 
 #include "DNA_action_types.h"
@@ -3073,8 +3074,15 @@ void DepsgraphRelationBuilder::build_vfont(VFont *vfont)
 
 void DepsgraphRelationBuilder::build_copy_on_write_relations()
 {
+  /* Relations added for an ID only connect nodes of that ID, so IDs are handled in parallel. */
+  threading::parallel_for(graph_->id_nodes.index_range(), 64, [&](const IndexRange range) {
+    for (const int i : range) {
+      build_copy_on_write_relations(graph_->id_nodes[i]);
+    }
+  });
+  /* Relations between copy-on-write operations of different IDs modify nodes of both IDs. */
   for (IDNode *id_node : graph_->id_nodes) {
-    build_copy_on_write_relations(id_node);
+    build_object_data_copy_on_write_relation(id_node);
   }
 }
 
@@ -3209,23 +3217,6 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
      * evaluation step needs geometry, it will have transitive dependency
      * to Mesh copy-on-write already. */
   }
-  /* TODO(sergey): This solves crash for now, but causes too many
-   * updates potentially. */
-  if (GS(id_orig->name) == ID_OB) {
-    Object *object = (Object *)id_orig;
-    ID *object_data_id = (ID *)object->data;
-    if (object_data_id != nullptr) {
-      if (deg_copy_on_write_is_needed(object_data_id)) {
-        OperationKey data_copy_on_write_key(
-            object_data_id, NodeType::COPY_ON_WRITE, OperationCode::COPY_ON_WRITE);
-        add_relation(
-            data_copy_on_write_key, copy_on_write_key, "Eval Order", RELATION_FLAG_GODMODE);
-      }
-    }
-    else {
-      BLI_assert(object->type == OB_EMPTY);
-    }
-  }
 
 #if 0
   /* NOTE: Relation is disabled since AnimationBackup() is disabled.
@@ -3248,6 +3239,30 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
 #endif
 }
 
+void DepsgraphRelationBuilder::build_object_data_copy_on_write_relation(IDNode *id_node)
+{
+  ID *id_orig = id_node->id_orig;
+  /* TODO(sergey): This solves crash for now, but causes too many
+   * updates potentially. */
+  if (GS(id_orig->name) == ID_OB) {
+    Object *object = (Object *)id_orig;
+    ID *object_data_id = (ID *)object->data;
+    if (object_data_id != nullptr) {
+      if (deg_copy_on_write_is_needed(object_data_id)) {
+        OperationKey copy_on_write_key(
+            id_orig, NodeType::COPY_ON_WRITE, OperationCode::COPY_ON_WRITE);
+        OperationKey data_copy_on_write_key(
+            object_data_id, NodeType::COPY_ON_WRITE, OperationCode::COPY_ON_WRITE);
+        add_relation(
+            data_copy_on_write_key, copy_on_write_key, "Eval Order", RELATION_FLAG_GODMODE);
+      }
+    }
+    else {
+      BLI_assert(object->type == OB_EMPTY);
+    }
+  }
+}
+
 /* **** ID traversal callbacks functions **** */
 
 void DepsgraphRelationBuilder::modifier_walk(void *user_data,
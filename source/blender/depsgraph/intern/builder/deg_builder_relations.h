@@ -362,6 +362,7 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
 
   virtual void build_copy_on_write_relations();
   virtual void build_copy_on_write_relations(IDNode *id_node);
+  virtual void build_object_data_copy_on_write_relation(IDNode *id_node);
   virtual void build_driver_relations();
   virtual void build_driver_relations(IDNode *id_node);
 
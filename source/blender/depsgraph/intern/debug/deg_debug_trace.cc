@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022 Blender Foundation. All rights reserved. */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/debug/deg_debug_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+
+#include "BKE_blender.h"
+
+#include "DNA_ID.h"
+
+#include "DEG_depsgraph_debug.h"
+
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
+
+namespace blender::deg {
+namespace {
+
+/* Number of the most recent operation evaluations which are kept, older ones are overwritten. */
+constexpr int64_t trace_capacity = 1 << 17;
+
+struct TraceEvent {
+  double start_time;
+  double end_time;
+  int thread_id;
+  const char *component_type;
+  const char *opcode;
+  char id_name[MAX_ID_NAME];
+  char component_name[64];
+  char operation_name[64];
+};
+
+struct TraceState {
+  char filepath[FILE_MAX];
+  /* Point in time all the event times are relative to. */
+  double start_time;
+  TraceEvent *events;
+  /* Total number of recorded events, including the overwritten ones. */
+  std::atomic<int64_t> num_events;
+  std::atomic<int> num_threads;
+};
+
+TraceState *trace_state = nullptr;
+
+int trace_thread_id()
+{
+  static thread_local int thread_id = -1;
+  if (thread_id == -1) {
+    thread_id = trace_state->num_threads.fetch_add(1);
+  }
+  return thread_id;
+}
+
+void trace_write_string(FILE *file, const char *str)
+{
+  fputc('"', file);
+  for (const char *c = str; *c != '\0'; c++) {
+    if (ELEM(*c, '"', '\\')) {
+      fputc('\\', file);
+      fputc(*c, file);
+    }
+    else if (uchar(*c) < 0x20) {
+      fprintf(file, "\\u%04x", uchar(*c));
+    }
+    else {
+      fputc(*c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+void trace_write_event(FILE *file, const TraceEvent &event)
+{
+  fputs("{\"name\":", file);
+  trace_write_string(file, event.opcode);
+  fputs(",\"cat\":", file);
+  trace_write_string(file, event.component_type);
+  fprintf(file,
+          ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%d,\"args\":{\"id\":",
+          (event.start_time - trace_state->start_time) * 1e6,
+          (event.end_time - event.start_time) * 1e6,
+          event.thread_id);
+  trace_write_string(file, event.id_name);
+  fputs(",\"component\":", file);
+  trace_write_string(file, event.component_name);
+  fputs(",\"operation\":", file);
+  trace_write_string(file, event.operation_name);
+  fputs("}}", file);
+}
+
+void trace_write_file()
+{
+  FILE *file = BLI_fopen(trace_state->filepath, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Error writing depsgraph trace to '%s'\n", trace_state->filepath);
+    return;
+  }
+
+  const int64_t num_events = trace_state->num_events.load();
+  const int64_t first_event = std::max(int64_t(0), num_events - trace_capacity);
+
+  fputs("{\"traceEvents\":[\n", file);
+  for (int64_t i = first_event; i < num_events; i++) {
+    trace_write_event(file, trace_state->events[i % trace_capacity]);
+    fputs((i + 1 < num_events) ? ",\n" : "\n", file);
+  }
+  fputs("],\"displayTimeUnit\":\"ms\"}\n", file);
+
+  fclose(file);
+  printf("Depsgraph trace with %" PRId64 " operations written to '%s'\n",
+         num_events - first_event,
+         trace_state->filepath);
+}
+
+void trace_write_and_free()
+{
+  if (trace_state == nullptr) {
+    return;
+  }
+  trace_write_file();
+
+  MEM_freeN(trace_state->events);
+  MEM_delete(trace_state);
+  trace_state = nullptr;
+}
+
+void trace_atexit(void * /*user_data*/)
+{
+  trace_write_and_free();
+}
+
+}  // namespace
+
+bool deg_debug_trace_is_enabled()
+{
+  return trace_state != nullptr;
+}
+
+void deg_debug_trace_operation(const OperationNode *operation_node,
+                               const double start_time,
+                               const double end_time)
+{
+  const ComponentNode *comp_node = operation_node->owner;
+  const IDNode *id_node = comp_node->owner;
+
+  const int64_t index = trace_state->num_events.fetch_add(1);
+  TraceEvent &event = trace_state->events[index % trace_capacity];
+  event.start_time = start_time;
+  event.end_time = end_time;
+  event.thread_id = trace_thread_id();
+  event.component_type = nodeTypeAsString(comp_node->type);
+  event.opcode = operationCodeAsString(operation_node->opcode);
+  STRNCPY(event.id_name, id_node->id_orig->name);
+  STRNCPY(event.component_name, comp_node->name.c_str());
+  STRNCPY(event.operation_name, operation_node->name.c_str());
+}
+
+}  // namespace blender::deg
+
+namespace deg = blender::deg;
+
+void DEG_debug_trace_begin(const char *filepath)
+{
+  if (deg::trace_state != nullptr) {
+    STRNCPY(deg::trace_state->filepath, filepath);
+    return;
+  }
+  deg::TraceState *state = MEM_new<deg::TraceState>(__func__);
+  STRNCPY(state->filepath, filepath);
+  state->start_time = PIL_check_seconds_timer();
+  state->events = static_cast<deg::TraceEvent *>(
+      MEM_malloc_arrayN(deg::trace_capacity, sizeof(deg::TraceEvent), __func__));
+  state->num_events = 0;
+  state->num_threads = 0;
+  deg::trace_state = state;
+
+  BKE_blender_atexit_register(deg::trace_atexit, nullptr);
+}
+
+void DEG_debug_trace_end()
+{
+  if (deg::trace_state == nullptr) {
+    return;
+  }
+  BKE_blender_atexit_unregister(deg::trace_atexit, nullptr);
+  deg::trace_write_and_free();
+}
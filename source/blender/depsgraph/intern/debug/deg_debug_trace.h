@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2022 Blender Foundation. All rights reserved. */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Recording of operation evaluations, which is written to a file in Chrome trace format.
+ */
+
+#pragma once
+
+namespace blender::deg {
+
+struct OperationNode;
+
+/* Is true when evaluation of operations is to be recorded, see #DEG_debug_trace_begin. */
+bool deg_debug_trace_is_enabled();
+
+/* Record evaluation of the operation, times are as returned by #PIL_check_seconds_timer.
+ * Can be called from any thread. */
+void deg_debug_trace_operation(const OperationNode *operation_node,
+                               double start_time,
+                               double end_time);
+
+}  // namespace blender::deg
@@ -113,6 +113,10 @@ struct Depsgraph {
   /* Nodes which have been tagged as "directly modified". */
   Set<OperationNode *> entry_tags;
 
+  /* Operations which got tagged for update by the last flush. Used to only visit the tagged part
+   * of the graph when preparing its evaluation. Can contain the same operation more than once. */
+  Vector<OperationNode *> tagged_operations;
+
   /* Convenience Data ................... */
 
   /* XXX: should be collected after building (if actually needed?) */
@@ -31,6 +31,7 @@
 
 #include "atomic_ops.h"
 
+#include "intern/debug/deg_debug_trace.h"
 #include "intern/depsgraph.h"
 #include "intern/depsgraph_relation.h"
 #include "intern/depsgraph_tag.h"
@@ -63,6 +64,22 @@ void schedule_node_to_pool(OperationNode *node, const int UNUSED(thread_id), Tas
   BLI_task_pool_push(pool, deg_task_run_func, node, false, nullptr);
 }
 
+/* Operations which became ready for evaluation after an operation of a task is finished. */
+using ReadyOperations = Vector<OperationNode *, 16>;
+
+void schedule_node_to_vector(OperationNode *node,
+                             const int /*thread_id*/,
+                             ReadyOperations *ready_operations)
+{
+  ready_operations->append(node);
+}
+
+/* Operations which are known to take less time than this (together with all operations which are
+ * waiting for them) are evaluated in the task which made them ready, up to this much time per
+ * task. This avoids overhead of scheduling a task for every cheap operation like drivers and
+ * transforms. */
+constexpr float batch_time_threshold = 0.00005f;
+
 /* Denotes which part of dependency graph is being evaluated. */
 enum class EvaluationStage {
   /* Stage 1: Only  Copy-on-Write operations are to be evaluated, prior to anything else.
@@ -86,6 +103,7 @@ enum class EvaluationStage {
 struct DepsgraphEvalState {
   Depsgraph *graph;
   bool do_stats;
+  bool do_trace;
   EvaluationStage stage;
   bool need_update_pending_parents = true;
   bool need_single_thread_pass = false;
@@ -97,14 +115,18 @@ void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_nod
 
   /* Sanity checks. */
   BLI_assert_msg(!operation_node->is_noop(), "NOOP nodes should not actually be scheduled");
-  /* Perform operation. */
+  /* Perform operation. The time is always measured, it is used for scheduling the next
+   * evaluation. */
+  const double start_time = PIL_check_seconds_timer();
+  operation_node->evaluate(depsgraph);
+  const double end_time = PIL_check_seconds_timer();
+  const double eval_time = end_time - start_time;
+  operation_node->eval_time = float(eval_time);
   if (state->do_stats) {
-    const double start_time = PIL_check_seconds_timer();
-    operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += PIL_check_seconds_timer() - start_time;
+    operation_node->stats.current_time += eval_time;
   }
-  else {
-    operation_node->evaluate(depsgraph);
+  if (state->do_trace) {
+    deg_debug_trace_operation(operation_node, start_time, end_time);
   }
 
   /* Clear the flag early on, allowing partial updates without re-evaluating the same node multiple
@@ -120,12 +142,51 @@ void deg_task_run_func(TaskPool *pool, void *taskdata)
   void *userdata_v = BLI_task_pool_user_data(pool);
   DepsgraphEvalState *state = (DepsgraphEvalState *)userdata_v;
 
-  /* Evaluate node. */
-  OperationNode *operation_node = reinterpret_cast<OperationNode *>(taskdata);
-  evaluate_node(state, operation_node);
+  /* Operations to be evaluated by this task. The one with the most expensive chain of operations
+   * waiting for it is evaluated first, and the task continues with the most expensive child
+   * instead of scheduling it, so that the critical path is never waiting in the pool. */
+  ReadyOperations task_operations;
+  float task_batch_time = 0.0f;
+  task_operations.append(reinterpret_cast<OperationNode *>(taskdata));
+
+  ReadyOperations ready_operations;
+  while (!task_operations.is_empty()) {
+    int64_t next_index = 0;
+    for (const int64_t i : task_operations.index_range().drop_front(1)) {
+      if (task_operations[i]->critical_path_time >
+          task_operations[next_index]->critical_path_time) {
+        next_index = i;
+      }
+    }
+    OperationNode *operation_node = task_operations[next_index];
+    task_operations.remove_and_reorder(next_index);
+
+    /* Evaluate node. */
+    evaluate_node(state, operation_node);
 
-  /* Schedule children. */
-  schedule_children(state, operation_node, schedule_node_to_pool, pool);
+    /* Schedule children. */
+    ready_operations.clear();
+    schedule_children(state, operation_node, schedule_node_to_vector, &ready_operations);
+    if (ready_operations.is_empty()) {
+      continue;
+    }
+    std::sort(ready_operations.begin(),
+              ready_operations.end(),
+              [](const OperationNode *a, const OperationNode *b) {
+                return a->critical_path_time > b->critical_path_time;
+              });
+    /* Other threads can pick up the scheduled operations while this one continues. */
+    for (OperationNode *child : ready_operations.as_span().drop_front(1)) {
+      if (task_batch_time + child->critical_path_time < batch_time_threshold) {
+        task_batch_time += child->critical_path_time;
+        task_operations.append(child);
+      }
+      else {
+        schedule_node_to_pool(child, 0, pool);
+      }
+    }
+    task_operations.append(ready_operations.first());
+  }
 }
 
 bool check_operation_node_visible(const DepsgraphEvalState *state, OperationNode *op_node)
@@ -178,6 +239,68 @@ void calculate_pending_parents_for_node(const DepsgraphEvalState *state, Operati
   }
 }
 
+float operation_cost(const OperationNode *operation_node)
+{
+  if (operation_node->is_noop()) {
+    return 0.0f;
+  }
+  /* Operations which were never evaluated are not to be batched. */
+  if (operation_node->eval_time < 0.0f) {
+    return batch_time_threshold;
+  }
+  return operation_node->eval_time;
+}
+
+bool is_relation_to_tagged_operation(const Relation *rel)
+{
+  if ((rel->flag & RELATION_FLAG_CYCLIC) != 0) {
+    return false;
+  }
+  const OperationNode *to = (const OperationNode *)rel->to;
+  return (to->flag & DEPSOP_FLAG_NEEDS_UPDATE) != 0;
+}
+
+/* Calculate critical path time of all operations tagged for update, based on the time their
+ * previous evaluation took. Operations which are not tagged will not be evaluated, so they don't
+ * add to the time.
+ *
+ * Only the operations tagged by the last flush are visited, they were marked as not visited yet by
+ * the flush. Operations which stayed tagged from a previous evaluation (because they were not
+ * visible) keep the time calculated back then. */
+void calculate_critical_path_times(Depsgraph *graph)
+{
+  /* Depth-first traversal, an operation's time is known once all of its children are visited. */
+  Vector<pair<OperationNode *, int64_t>> stack;
+  for (OperationNode *root : graph->tagged_operations) {
+    if (root->critical_path_time >= 0.0f) {
+      continue;
+    }
+    root->critical_path_time = 0.0f;
+    stack.append(std::make_pair(root, 0));
+    while (!stack.is_empty()) {
+      OperationNode *node = stack.last().first;
+      const int64_t link_index = stack.last().second++;
+      if (link_index < node->outlinks.size()) {
+        const Relation *rel = node->outlinks[link_index];
+        OperationNode *child = (OperationNode *)rel->to;
+        if (is_relation_to_tagged_operation(rel) && child->critical_path_time < 0.0f) {
+          child->critical_path_time = 0.0f;
+          stack.append(std::make_pair(child, 0));
+        }
+        continue;
+      }
+      float children_time = 0.0f;
+      for (const Relation *rel : node->outlinks) {
+        if (is_relation_to_tagged_operation(rel)) {
+          children_time = max(children_time, ((OperationNode *)rel->to)->critical_path_time);
+        }
+      }
+      node->critical_path_time = operation_cost(node) + children_time;
+      stack.remove_last();
+    }
+  }
+}
+
 void calculate_pending_parents_if_needed(DepsgraphEvalState *state)
 {
   if (!state->need_update_pending_parents) {
@@ -412,9 +535,11 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   DepsgraphEvalState state;
   state.graph = graph;
   state.do_stats = graph->debug.do_time_debug();
+  state.do_trace = deg_debug_trace_is_enabled();
 
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
+  calculate_critical_path_times(graph);
 
   /* Evaluation happens in several incremental steps:
    *
@@ -109,13 +109,22 @@ inline void flush_schedule_entrypoints(Depsgraph *graph, FlushQueue *queue)
   }
 }
 
+inline void flush_tag_operation(Depsgraph *graph, OperationNode *op_node)
+{
+  op_node->flag |= DEPSOP_FLAG_NEEDS_UPDATE;
+  /* Denotes that the critical path time is to be calculated for this evaluation. */
+  op_node->critical_path_time = -1.0f;
+  graph->tagged_operations.append(op_node);
+}
+
 inline void flush_handle_id_node(IDNode *id_node)
 {
   id_node->custom_flags = ID_STATE_MODIFIED;
 }
 
 /* TODO(sergey): We can reduce number of arguments here. */
-inline void flush_handle_component_node(IDNode *id_node,
+inline void flush_handle_component_node(Depsgraph *graph,
+                                        IDNode *id_node,
                                         ComponentNode *comp_node,
                                         FlushQueue *queue)
 {
@@ -130,7 +139,7 @@ inline void flush_handle_component_node(IDNode *id_node,
    * TODO(sergey): Make this a more generic solution. */
   if (!ELEM(comp_node->type, NodeType::PARTICLE_SETTINGS, NodeType::PARTICLE_SYSTEM)) {
     for (OperationNode *op : comp_node->operations) {
-      op->flag |= DEPSOP_FLAG_NEEDS_UPDATE;
+      flush_tag_operation(graph, op);
     }
   }
   /* when some target changes bone, we might need to re-run the
@@ -359,12 +368,12 @@ void deg_graph_flush_updates(Depsgraph *graph)
     queue.pop_front();
     while (op_node != nullptr) {
       /* Tag operation as required for update. */
-      op_node->flag |= DEPSOP_FLAG_NEEDS_UPDATE;
+      flush_tag_operation(graph, op_node);
       /* Inform corresponding ID and component nodes about the change. */
       ComponentNode *comp_node = op_node->owner;
       IDNode *id_node = comp_node->owner;
       flush_handle_id_node(id_node);
-      flush_handle_component_node(id_node, comp_node, &queue);
+      flush_handle_component_node(graph, id_node, comp_node, &queue);
       /* Flush to nodes along links. */
       op_node = flush_schedule_children(op_node, &queue);
     }
@@ -380,6 +389,7 @@ void deg_graph_clear_tags(Depsgraph *graph)
 {
   /* Clear any entry tags which haven't been flushed. */
   graph->entry_tags.clear();
+  graph->tagged_operations.clear();
 
   graph->time_source->tagged_for_update = false;
 }
@@ -267,6 +267,13 @@ struct OperationNode : public Node {
   uint32_t num_links_pending;
   bool scheduled;
 
+  /* Time in seconds the last evaluation of this operation took, negative if it was never
+   * evaluated. Used by the evaluator to prioritize and batch operations. */
+  float eval_time;
+  /* Evaluation time of this operation and the most expensive chain of operations which are waiting
+   * for it, calculated before every evaluation of the graph. */
+  float critical_path_time;
+
   /* Identifier for the operation being performed. */
   OperationCode opcode;
   int name_tag;
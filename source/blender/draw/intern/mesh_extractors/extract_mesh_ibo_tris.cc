@@ -165,36 +165,57 @@ static void extract_tris_single_mat_init(const MeshRenderData *mr,
   GPU_indexbuf_init(elb, GPU_PRIM_TRIS, mr->tri_len, mr->loop_len);
 }
 
-static void extract_tris_single_mat_iter_looptri_bm(const MeshRenderData *UNUSED(mr),
-                                                    BMLoop **elt,
-                                                    const int elt_index,
-                                                    void *_data)
+/* Triangles are iterated per polygon rather than per #MLoopTri, so that when positions and normals
+ * are requested as well (which is the common case) all of them are filled in a single pass over
+ * the polygons instead of two separate passes over the mesh. */
+
+static void extract_tris_single_mat_iter_poly_bm(const MeshRenderData *mr,
+                                                 const BMFace *f,
+                                                 const int f_index,
+                                                 void *_data)
 {
   GPUIndexBufBuilder *elb = static_cast<GPUIndexBufBuilder *>(_data);
-  if (!BM_elem_flag_test(elt[0]->f, BM_ELEM_HIDDEN)) {
+  const int tri_first_index = poly_to_tri_count(f_index, BM_elem_index_get(f->l_first));
+  const int tri_len = f->len - 2;
+
+  if (BM_elem_flag_test(f, BM_ELEM_HIDDEN)) {
+    for (int offs = 0; offs < tri_len; offs++) {
+      GPU_indexbuf_set_tri_restart(elb, tri_first_index + offs);
+    }
+    return;
+  }
+
+  struct BMLoop *(*looptris)[3] = mr->edit_bmesh->looptris;
+  for (int offs = 0; offs < tri_len; offs++) {
+    BMLoop **elt = looptris[tri_first_index + offs];
     GPU_indexbuf_set_tri_verts(elb,
-                               elt_index,
+                               tri_first_index + offs,
                                BM_elem_index_get(elt[0]),
                                BM_elem_index_get(elt[1]),
                                BM_elem_index_get(elt[2]));
   }
-  else {
-    GPU_indexbuf_set_tri_restart(elb, elt_index);
-  }
 }
 
-static void extract_tris_single_mat_iter_looptri_mesh(const MeshRenderData *mr,
-                                                      const MLoopTri *mlt,
-                                                      const int mlt_index,
-                                                      void *_data)
+static void extract_tris_single_mat_iter_poly_mesh(const MeshRenderData *mr,
+                                                   const MPoly *mp,
+                                                   const int mp_index,
+                                                   void *_data)
 {
   GPUIndexBufBuilder *elb = static_cast<GPUIndexBufBuilder *>(_data);
-  const bool hidden = mr->use_hide && mr->hide_poly && mr->hide_poly[mlt->poly];
+  const int tri_first_index = poly_to_tri_count(mp_index, mp->loopstart);
+  const int tri_len = mp->totloop - 2;
+
+  const bool hidden = mr->use_hide && mr->hide_poly && mr->hide_poly[mp_index];
   if (hidden) {
-    GPU_indexbuf_set_tri_restart(elb, mlt_index);
+    for (int offs = 0; offs < tri_len; offs++) {
+      GPU_indexbuf_set_tri_restart(elb, tri_first_index + offs);
+    }
+    return;
   }
-  else {
-    GPU_indexbuf_set_tri_verts(elb, mlt_index, mlt->tri[0], mlt->tri[1], mlt->tri[2]);
+
+  for (int offs = 0; offs < tri_len; offs++) {
+    const MLoopTri *mlt = &mr->mlooptri[tri_first_index + offs];
+    GPU_indexbuf_set_tri_verts(elb, tri_first_index + offs, mlt->tri[0], mlt->tri[1], mlt->tri[2]);
   }
 }
 
@@ -228,11 +249,11 @@ constexpr MeshExtract create_extractor_tris_single_mat()
   MeshExtract extractor = {nullptr};
   extractor.init = extract_tris_single_mat_init;
   extractor.init_subdiv = extract_tris_init_subdiv;
-  extractor.iter_looptri_bm = extract_tris_single_mat_iter_looptri_bm;
-  extractor.iter_looptri_mesh = extract_tris_single_mat_iter_looptri_mesh;
+  extractor.iter_poly_bm = extract_tris_single_mat_iter_poly_bm;
+  extractor.iter_poly_mesh = extract_tris_single_mat_iter_poly_mesh;
   extractor.task_reduce = extract_tris_mat_task_reduce;
   extractor.finish = extract_tris_single_mat_finish;
-  extractor.data_type = MR_DATA_NONE;
+  extractor.data_type = MR_DATA_LOOPTRI;
   extractor.data_size = sizeof(GPUIndexBufBuilder);
   extractor.use_threading = true;
   extractor.mesh_buffer_offset = offsetof(MeshBufferList, ibo.tris);
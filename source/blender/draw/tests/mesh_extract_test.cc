@@ -0,0 +1,225 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
+#include "BLI_math_base.h"
+#include "BLI_math_matrix.h"
+#include "BLI_task.hh"
+#include "BLI_timeit.hh"
+
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+#include "GPU_index_buffer.h"
+
+#include "intern/mesh_extractors/extract_mesh.hh"
+
+namespace blender::draw {
+
+/* Same value as the restart index of the GPU module. */
+static constexpr uint32_t mesh_extract_test_restart_index = 0xFFFFFFFF;
+
+/* Grid of `size` by `size` quads in the XY plane, followed by an n-gon with `ngon_len` sides. */
+static Mesh *mesh_extract_test_mesh_create(const int size, const int ngon_len)
+{
+  const int grid_verts_len = (size + 1) * (size + 1);
+  const int grid_polys_len = size * size;
+  Mesh *mesh = BKE_mesh_new_nomain(grid_verts_len + ngon_len,
+                                   0,
+                                   0,
+                                   grid_polys_len * 4 + ngon_len,
+                                   grid_polys_len + 1);
+
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      MVert &vert = mesh->mvert[y * (size + 1) + x];
+      vert.co[0] = float(x) / size;
+      vert.co[1] = float(y) / size;
+      vert.co[2] = 0.0f;
+    }
+  }
+  for (int i = 0; i < ngon_len; i++) {
+    MVert &vert = mesh->mvert[grid_verts_len + i];
+    const float angle = 2.0f * float(M_PI) * i / ngon_len;
+    vert.co[0] = cosf(angle);
+    vert.co[1] = sinf(angle);
+    vert.co[2] = 1.0f;
+  }
+
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const int poly_index = y * size + x;
+      const int loopstart = poly_index * 4;
+      MPoly &poly = mesh->mpoly[poly_index];
+      poly.loopstart = loopstart;
+      poly.totloop = 4;
+      mesh->mloop[loopstart + 0].v = y * (size + 1) + x;
+      mesh->mloop[loopstart + 1].v = y * (size + 1) + x + 1;
+      mesh->mloop[loopstart + 2].v = (y + 1) * (size + 1) + x + 1;
+      mesh->mloop[loopstart + 3].v = (y + 1) * (size + 1) + x;
+    }
+  }
+  MPoly &ngon = mesh->mpoly[grid_polys_len];
+  ngon.loopstart = grid_polys_len * 4;
+  ngon.totloop = ngon_len;
+  for (int i = 0; i < ngon_len; i++) {
+    mesh->mloop[ngon.loopstart + i].v = grid_verts_len + i;
+  }
+
+  BKE_mesh_calc_edges(mesh, false, false);
+  return mesh;
+}
+
+/**
+ * Run the single material triangles extractor over the polygons of the mesh, on the CPU only:
+ * the index buffer builder is filled, but no index buffer is created from it. The polygons are
+ * split in two ranges with their own builder, which are joined afterwards, like the threaded
+ * extraction does.
+ */
+static void mesh_extract_test_tris_single_mat(const MeshRenderData *mr, GPUIndexBufBuilder *elb)
+{
+  const MeshExtract &extractor = extract_tris_single_mat;
+  extractor.init(mr, nullptr, nullptr, elb);
+
+  GPUIndexBufBuilder elb_second = *elb;
+  const int split = mr->poly_len / 2;
+  for (int i = 0; i < mr->poly_len; i++) {
+    extractor.iter_poly_mesh(mr, &mr->mpoly[i], i, (i < split) ? elb : &elb_second);
+  }
+  extractor.task_reduce(elb, &elb_second);
+}
+
+TEST(draw_mesh_extract, tris_single_mat)
+{
+  BKE_idtype_init();
+
+  Mesh *mesh = mesh_extract_test_mesh_create(8, 7);
+  bool *hide_poly = static_cast<bool *>(CustomData_add_layer_named(
+      &mesh->pdata, CD_PROP_BOOL, CD_CALLOC, nullptr, mesh->totpoly, ".hide_poly"));
+  hide_poly[3] = true;
+  hide_poly[mesh->totpoly - 1] = true;
+
+  Object object = blender::dna::shallow_zero_initialize();
+  object.type = OB_MESH;
+  object.data = mesh;
+  float obmat[4][4];
+  unit_m4(obmat);
+
+  for (const bool use_hide : {false, true}) {
+    MeshRenderData *mr = mesh_render_data_create(
+        &object, mesh, false, false, false, obmat, true, false, nullptr);
+    mr->use_hide = use_hide;
+    mesh_render_data_update_looptris(mr, MR_ITER_POLY, MR_DATA_LOOPTRI);
+
+    GPUIndexBufBuilder elb;
+    mesh_extract_test_tris_single_mat(mr, &elb);
+
+    /* Triangles are in #MLoopTri order, with the triangles of hidden polygons skipped. */
+    ASSERT_EQ(elb.max_index_len, uint(mr->tri_len * 3));
+    int tri_index = 0;
+    uint index_min = UINT32_MAX;
+    uint index_max = 0;
+    for (int poly_index = 0; poly_index < mr->poly_len; poly_index++) {
+      const bool hidden = use_hide && hide_poly[poly_index];
+      for (int i = 0; i < mr->mpoly[poly_index].totloop - 2; i++, tri_index++) {
+        const MLoopTri &mlt = mr->mlooptri[tri_index];
+        EXPECT_EQ(mlt.poly, poly_index);
+        for (int j = 0; j < 3; j++) {
+          EXPECT_EQ(elb.data[tri_index * 3 + j],
+                    hidden ? mesh_extract_test_restart_index : mlt.tri[j]);
+          if (!hidden) {
+            index_min = min_uu(index_min, mlt.tri[j]);
+            index_max = max_uu(index_max, mlt.tri[j]);
+          }
+        }
+      }
+    }
+    EXPECT_EQ(tri_index, mr->tri_len);
+    EXPECT_EQ(elb.index_min, index_min);
+    EXPECT_EQ(elb.index_max, index_max);
+
+    MEM_freeN(elb.data);
+    mesh_render_data_free(mr);
+  }
+
+  BKE_id_free(nullptr, mesh);
+}
+
+/**
+ * Set this to 1 to activate the benchmark. It is disabled by default, because it takes a long
+ * time and prints a lot.
+ */
+#if 0
+/* Extract the triangles of all polygons in ranges of #MIN_RANGE_LEN polygons on multiple threads,
+ * each with their own builder, like the threaded extraction does. */
+static void mesh_extract_test_tris_single_mat_parallel(const MeshRenderData *mr,
+                                                       GPUIndexBufBuilder *elb)
+{
+  const MeshExtract &extractor = extract_tris_single_mat;
+  extractor.init(mr, nullptr, nullptr, elb);
+
+  const int ranges_len = divide_ceil_u(mr->poly_len, MIN_RANGE_LEN);
+  Array<GPUIndexBufBuilder> range_elbs(ranges_len, *elb);
+  threading::parallel_for(IndexRange(ranges_len), 1, [&](const IndexRange ranges) {
+    for (const int range : ranges) {
+      const IndexRange polys = IndexRange(mr->poly_len).slice(
+          range * MIN_RANGE_LEN, min_ii(MIN_RANGE_LEN, mr->poly_len - range * MIN_RANGE_LEN));
+      for (const int i : polys) {
+        extractor.iter_poly_mesh(mr, &mr->mpoly[i], i, &range_elbs[range]);
+      }
+    }
+  });
+
+  for (GPUIndexBufBuilder &range_elb : range_elbs) {
+    extractor.task_reduce(elb, &range_elb);
+  }
+}
+
+TEST(draw_mesh_extract, benchmark)
+{
+  BKE_idtype_init();
+
+  for (const int size : {1000, 4000}) {
+    Mesh *mesh = mesh_extract_test_mesh_create(size, 3);
+
+    Object object = blender::dna::shallow_zero_initialize();
+    object.type = OB_MESH;
+    object.data = mesh;
+    float obmat[4][4];
+    unit_m4(obmat);
+
+    const std::string name = std::to_string(mesh->totpoly) + " polygons";
+    for (int i = 0; i < 3; i++) {
+      MeshRenderData *mr = mesh_render_data_create(
+          &object, mesh, false, false, false, obmat, true, false, nullptr);
+      {
+        SCOPED_TIMER("looptris, " + name);
+        mesh_render_data_update_looptris(mr, MR_ITER_POLY, MR_DATA_LOOPTRI);
+      }
+
+      GPUIndexBufBuilder elb;
+      {
+        SCOPED_TIMER("tris_single_mat, " + name);
+        mesh_extract_test_tris_single_mat_parallel(mr, &elb);
+      }
+      EXPECT_EQ(elb.index_len, uint(mr->tri_len * 3));
+
+      MEM_freeN(elb.data);
+      mesh_render_data_free(mr);
+    }
+
+    BKE_id_free(nullptr, mesh);
+  }
+}
+#endif
+
+}  // namespace blender::draw
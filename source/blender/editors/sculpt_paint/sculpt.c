@@ -186,7 +186,7 @@ void SCULPT_vertex_normal_get(SculptSession *ss, PBVHVertRef vertex, float no[3]
       const int grid_index = vertex.i / key->grid_area;
       const int vertex_index = vertex.i - grid_index * key->grid_area;
       CCGElem *elem = BKE_pbvh_get_grids(ss->pbvh)[grid_index];
-      copy_v3_v3(no, CCG_elem_no(key, CCG_elem_offset(key, elem, vertex_index)));
+      CCG_elem_no_get(key, CCG_elem_offset(key, elem, vertex_index), no);
       break;
     }
   }
@@ -1455,7 +1455,7 @@ static void paint_mesh_restore_co_task_cb(void *__restrict userdata,
         copy_v3_v3(vd.no, orig_data.no);
       }
       else {
-        copy_v3_v3(vd.fno, orig_data.no);
+        BKE_pbvh_vertex_iter_fno_set(&vd, orig_data.no);
       }
       if (vd.mvert) {
         BKE_pbvh_vert_tag_update_normal(ss->pbvh, vd.vertex);
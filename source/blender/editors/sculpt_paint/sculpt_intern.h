@@ -136,6 +136,16 @@ typedef struct SculptUndoNodeGeometry {
   int totpoly;
 } SculptUndoNodeGeometry;
 
+/* Number of arrays of #SculptUndoNode which are compressed once the undo step is finished. */
+#define SCULPT_UNDO_PACKED_ARRAYS_NUM 9
+
+typedef struct SculptUndoNodePacked {
+  void *data;
+  size_t size;
+  /* Size of the array before compression. */
+  size_t raw_size;
+} SculptUndoNodePacked;
+
 typedef struct SculptUndoNode {
   struct SculptUndoNode *next, *prev;
 
@@ -197,6 +207,9 @@ typedef struct SculptUndoNode {
   /* Sculpt Face Sets */
   int *face_sets;
 
+  /* Compressed arrays of a finished undo step. The array pointer is NULL while it is packed. */
+  SculptUndoNodePacked packed[SCULPT_UNDO_PACKED_ARRAYS_NUM];
+
   size_t undo_size;
 } SculptUndoNode;
 
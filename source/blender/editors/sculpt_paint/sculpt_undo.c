@@ -81,6 +81,8 @@
 #include "bmesh.h"
 #include "sculpt_intern.h"
 
+#include <zstd.h>
+
 /* Implementation of undo system for objects in sculpt mode.
  *
  * Each undo step in sculpt mode consists of list of nodes, each node contains:
@@ -126,6 +128,11 @@ typedef struct UndoSculpt {
   ListBase nodes;
 
   size_t undo_size;
+
+  /* Arrays of the nodes are compressed, see #sculpt_undo_pack_begin. */
+  bool is_packed;
+  /* Background compression of the arrays, NULL when it is finished. */
+  struct TaskPool *pack_pool;
 } UndoSculpt;
 
 typedef struct SculptAttrRef {
@@ -150,6 +157,7 @@ typedef struct SculptUndoStep {
 } SculptUndoStep;
 
 static UndoSculpt *sculpt_undo_get_nodes(void);
+static void sculpt_undosys_step_pack_finish(SculptUndoStep *us);
 static bool sculpt_attribute_ref_equals(SculptAttrRef *a, SculptAttrRef *b);
 static void sculpt_save_active_attribute(Object *ob, SculptAttrRef *attr);
 
@@ -1010,6 +1018,10 @@ static void sculpt_undo_free_list(ListBase *lb)
       MEM_freeN(unode->face_sets);
     }
 
+    for (int i = 0; i < SCULPT_UNDO_PACKED_ARRAYS_NUM; i++) {
+      MEM_SAFE_FREE(unode->packed[i].data);
+    }
+
     MEM_freeN(unode);
 
     unode = unode_next;
@@ -1584,6 +1596,14 @@ void SCULPT_undo_push_begin_ex(Object *ob, const char *name)
     ED_undosys_stack_memfile_id_changed_tag(ustack, ob->data);
   }
 
+  /* Compression of the previous step has had the time between the strokes to finish, get its
+   * actual size so that the memory limit applied after this step is pushed is accurate. */
+  SculptUndoStep *us_prev = (SculptUndoStep *)BKE_undosys_stack_active_with_type(
+      ustack, BKE_UNDOSYS_TYPE_SCULPT);
+  if (us_prev != NULL) {
+    sculpt_undosys_step_pack_finish(us_prev);
+  }
+
   /* Special case, we never read from this. */
   bContext *C = NULL;
 
@@ -1640,6 +1660,203 @@ void SCULPT_undo_push_end_ex(struct Object *ob, const bool use_nested_undo)
   sculpt_save_active_attribute(ob, &us->active_color_end);
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Undo Data Compression
+ *
+ * Arrays of the nodes are only accessed while the stroke is running and when the step is undone
+ * or redone. Once the step is finished they are compressed in a background thread, and only
+ * decompressed again when the step is applied.
+ *
+ * All the arrays consist of 4 byte elements (coordinates, colors, masks and indices) of nearby
+ * vertices, which mostly differ in their lower bytes. Bytes are grouped by their position in the
+ * element before compression, which makes runs of equal bytes out of the upper ones.
+ * \{ */
+
+/* Compression speed matters more than ratio here, the stroke has just finished. */
+#define SCULPT_UNDO_PACK_ZSTD_LEVEL 1
+/* Arrays smaller than this are not worth the overhead. */
+#define SCULPT_UNDO_PACK_MIN_SIZE 1024
+
+static void sculpt_undo_node_arrays_get(SculptUndoNode *unode,
+                                        void **r_arrays[SCULPT_UNDO_PACKED_ARRAYS_NUM])
+{
+  r_arrays[0] = (void **)&unode->co;
+  r_arrays[1] = (void **)&unode->orig_co;
+  r_arrays[2] = (void **)&unode->col;
+  r_arrays[3] = (void **)&unode->mask;
+  r_arrays[4] = (void **)&unode->loop_col;
+  r_arrays[5] = (void **)&unode->orig_loop_col;
+  r_arrays[6] = (void **)&unode->index;
+  r_arrays[7] = (void **)&unode->loop_index;
+  r_arrays[8] = (void **)&unode->face_sets;
+}
+
+static void sculpt_undo_bytes_split(const uchar *src, uchar *dst, const size_t size)
+{
+  const size_t num = size / 4;
+  for (size_t i = 0; i < num; i++) {
+    for (int b = 0; b < 4; b++) {
+      dst[b * num + i] = src[i * 4 + b];
+    }
+  }
+}
+
+static void sculpt_undo_bytes_join(const uchar *src, uchar *dst, const size_t size)
+{
+  const size_t num = size / 4;
+  for (size_t i = 0; i < num; i++) {
+    for (int b = 0; b < 4; b++) {
+      dst[i * 4 + b] = src[b * num + i];
+    }
+  }
+}
+
+static void sculpt_undo_node_pack(SculptUndoNode *unode)
+{
+  void **arrays[SCULPT_UNDO_PACKED_ARRAYS_NUM];
+  sculpt_undo_node_arrays_get(unode, arrays);
+
+  for (int i = 0; i < SCULPT_UNDO_PACKED_ARRAYS_NUM; i++) {
+    void *array = *arrays[i];
+    if (array == NULL) {
+      continue;
+    }
+    const size_t raw_size = MEM_allocN_len(array);
+    if (raw_size < SCULPT_UNDO_PACK_MIN_SIZE || raw_size % 4 != 0) {
+      continue;
+    }
+
+    uchar *split = MEM_mallocN(raw_size, __func__);
+    sculpt_undo_bytes_split(array, split, raw_size);
+
+    const size_t capacity = ZSTD_compressBound(raw_size);
+    void *data = MEM_mallocN(capacity, __func__);
+    const size_t size = ZSTD_compress(
+        data, capacity, split, raw_size, SCULPT_UNDO_PACK_ZSTD_LEVEL);
+    MEM_freeN(split);
+
+    if (ZSTD_isError(size) || size >= raw_size) {
+      MEM_freeN(data);
+      continue;
+    }
+
+    SculptUndoNodePacked *packed = &unode->packed[i];
+    packed->data = MEM_reallocN(data, size);
+    packed->size = size;
+    packed->raw_size = raw_size;
+
+    MEM_freeN(array);
+    *arrays[i] = NULL;
+  }
+}
+
+static void sculpt_undo_node_unpack(SculptUndoNode *unode)
+{
+  void **arrays[SCULPT_UNDO_PACKED_ARRAYS_NUM];
+  sculpt_undo_node_arrays_get(unode, arrays);
+
+  for (int i = 0; i < SCULPT_UNDO_PACKED_ARRAYS_NUM; i++) {
+    SculptUndoNodePacked *packed = &unode->packed[i];
+    if (packed->data == NULL) {
+      continue;
+    }
+    BLI_assert(*arrays[i] == NULL);
+
+    uchar *split = MEM_mallocN(packed->raw_size, __func__);
+    const size_t size = ZSTD_decompress(split, packed->raw_size, packed->data, packed->size);
+    BLI_assert(size == packed->raw_size);
+    UNUSED_VARS_NDEBUG(size);
+
+    uchar *array = MEM_mallocN(packed->raw_size, "SculptUndoNode array");
+    sculpt_undo_bytes_join(split, array, packed->raw_size);
+    MEM_freeN(split);
+
+    MEM_freeN(packed->data);
+    memset(packed, 0, sizeof(*packed));
+
+    *arrays[i] = array;
+  }
+}
+
+static void sculpt_undo_pack_task(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  sculpt_undo_node_pack((SculptUndoNode *)taskdata);
+}
+
+/**
+ * Start compressing arrays of all nodes in the background. Nothing is to access the nodes
+ * until #sculpt_undo_pack_wait or #sculpt_undo_unpack is called.
+ */
+static void sculpt_undo_pack_begin(UndoSculpt *usculpt)
+{
+  BLI_assert(usculpt->pack_pool == NULL);
+  if (BLI_listbase_is_empty(&usculpt->nodes)) {
+    return;
+  }
+
+  usculpt->pack_pool = BLI_task_pool_create_background(NULL, TASK_PRIORITY_LOW);
+  LISTBASE_FOREACH (SculptUndoNode *, unode, &usculpt->nodes) {
+    BLI_task_pool_push(usculpt->pack_pool, sculpt_undo_pack_task, unode, false, NULL);
+  }
+  usculpt->is_packed = true;
+}
+
+static void sculpt_undo_pack_wait(UndoSculpt *usculpt)
+{
+  if (usculpt->pack_pool == NULL) {
+    return;
+  }
+  BLI_task_pool_work_and_wait(usculpt->pack_pool);
+  BLI_task_pool_free(usculpt->pack_pool);
+  usculpt->pack_pool = NULL;
+}
+
+static void sculpt_undo_unpack_task_cb(void *__restrict userdata,
+                                       const int n,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  SculptUndoNode **nodes = userdata;
+  sculpt_undo_node_unpack(nodes[n]);
+}
+
+static void sculpt_undo_unpack(UndoSculpt *usculpt)
+{
+  sculpt_undo_pack_wait(usculpt);
+  if (!usculpt->is_packed) {
+    return;
+  }
+  usculpt->is_packed = false;
+
+  const int totnode = BLI_listbase_count(&usculpt->nodes);
+  SculptUndoNode **nodes = MEM_malloc_arrayN(totnode, sizeof(*nodes), __func__);
+  int i = 0;
+  LISTBASE_FOREACH (SculptUndoNode *, unode, &usculpt->nodes) {
+    nodes[i++] = unode;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, totnode, nodes, sculpt_undo_unpack_task_cb, &settings);
+
+  MEM_freeN(nodes);
+}
+
+static size_t sculpt_undo_packed_data_size(const UndoSculpt *usculpt)
+{
+  size_t size = usculpt->undo_size;
+  LISTBASE_FOREACH (const SculptUndoNode *, unode, &usculpt->nodes) {
+    for (int i = 0; i < SCULPT_UNDO_PACKED_ARRAYS_NUM; i++) {
+      const SculptUndoNodePacked *packed = &unode->packed[i];
+      if (packed->data != NULL) {
+        size -= packed->raw_size - packed->size;
+      }
+    }
+  }
+  return size;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Implements ED Undo System
  * \{ */
@@ -1725,16 +1942,29 @@ static bool sculpt_undosys_step_encode(struct bContext *UNUSED(C),
     bmain->is_memfile_undo_flush_needed = true;
   }
 
+  sculpt_undo_pack_begin(&us->data);
+
   return true;
 }
 
+static void sculpt_undosys_step_pack_finish(SculptUndoStep *us)
+{
+  if (us->data.pack_pool == NULL) {
+    return;
+  }
+  sculpt_undo_pack_wait(&us->data);
+  us->step.data_size = sculpt_undo_packed_data_size(&us->data);
+}
+
 static void sculpt_undosys_step_decode_undo_impl(struct bContext *C,
                                                  Depsgraph *depsgraph,
                                                  SculptUndoStep *us)
 {
   BLI_assert(us->step.is_applied == true);
 
+  sculpt_undo_unpack(&us->data);
   sculpt_undo_restore_list(C, depsgraph, &us->data.nodes);
+  sculpt_undo_pack_begin(&us->data);
   us->step.is_applied = false;
 }
 
@@ -1744,7 +1974,9 @@ static void sculpt_undosys_step_decode_redo_impl(struct bContext *C,
 {
   BLI_assert(us->step.is_applied == false);
 
+  sculpt_undo_unpack(&us->data);
   sculpt_undo_restore_list(C, depsgraph, &us->data.nodes);
+  sculpt_undo_pack_begin(&us->data);
   us->step.is_applied = true;
 }
 
@@ -1858,6 +2090,7 @@ static void sculpt_undosys_step_decode(
 static void sculpt_undosys_step_free(UndoStep *us_p)
 {
   SculptUndoStep *us = (SculptUndoStep *)us_p;
+  sculpt_undo_pack_wait(&us->data);
   sculpt_undo_free_list(&us->data.nodes);
 }
 
@@ -1909,7 +2142,12 @@ static UndoSculpt *sculpt_undo_get_nodes(void)
 {
   UndoStack *ustack = ED_undo_stack_get();
   UndoStep *us = BKE_undosys_stack_init_or_active_with_type(ustack, BKE_UNDOSYS_TYPE_SCULPT);
-  return sculpt_undosys_step_get_nodes(us);
+  UndoSculpt *usculpt = sculpt_undosys_step_get_nodes(us);
+  /* Without a step being pushed the nodes of the finished one are accessed. */
+  if (usculpt->is_packed) {
+    sculpt_undo_unpack(usculpt);
+  }
+  return usculpt;
 }
 
 /** \} */
@@ -2,9 +2,10 @@
 
 #include "BLI_array.hh"
 #include "BLI_index_mask.hh"
-#include "BLI_kdtree.h"
 #include "BLI_math_vector.h"
 #include "BLI_math_vector.hh"
+#include "BLI_sort.hh"
+#include "BLI_task.hh"
 #include "BLI_vector.hh"
 
 #include "DNA_mesh_types.h"
@@ -13,6 +14,8 @@
 #include "BKE_customdata.h"
 #include "BKE_mesh.h"
 
+#include "atomic_ops.h"
+
 #include "GEO_mesh_merge_by_distance.hh"
 
 //#define USE_WELD_DEBUG
@@ -1356,6 +1359,49 @@ static void customdata_weld(
 /** \name Mesh Vertex Merging
  * \{ */
 
+/**
+ * Split the \a size source elements in ranges which are copied to the result in parallel. The
+ * sizes of the elements in the result are summed up per range first, so that each range is called
+ * with the offset of its first element in the result. Elements can have several sizes, like the
+ * number of polygons and loops they become.
+ */
+template<typename T, typename SizeFn, typename Fn>
+static T weld_parallel_ranges(const int size, const SizeFn &size_fn, const Fn &fn)
+{
+  const int grain_size = 4096;
+  const int ranges_len = divide_ceil_u(size, grain_size);
+  auto source_range = [&](const int range) {
+    return IndexRange(range * grain_size, std::min(grain_size, size - range * grain_size));
+  };
+
+  Array<T> offsets(ranges_len + 1);
+  threading::parallel_for(IndexRange(ranges_len), 1, [&](const IndexRange ranges) {
+    for (const int range : ranges) {
+      T range_size(0);
+      for (const int i : source_range(range)) {
+        range_size += size_fn(i);
+      }
+      offsets[range] = range_size;
+    }
+  });
+
+  T offset(0);
+  for (const int range : IndexRange(ranges_len)) {
+    const T range_size = offsets[range];
+    offsets[range] = offset;
+    offset += range_size;
+  }
+  offsets[ranges_len] = offset;
+
+  threading::parallel_for(IndexRange(ranges_len), 1, [&](const IndexRange ranges) {
+    for (const int range : ranges) {
+      fn(source_range(range), offsets[range]);
+    }
+  });
+
+  return offset;
+}
+
 static Mesh *create_merged_mesh(const Mesh &mesh,
                                 MutableSpan<int> vert_dest_map,
                                 const int removed_vertex_count)
@@ -1381,38 +1427,45 @@ static Mesh *create_merged_mesh(const Mesh &mesh,
   /* Vertices. */
 
   /* Be careful when editing this array, to avoid new allocations it uses the same buffer as
-   * #vert_dest_map. This map will be used to adjust the edges, polys and loops. */
+   * #vert_dest_map. This map will be used to adjust the edges, polys and loops. Each range only
+   * reads and writes its own elements. */
   MutableSpan<int> vert_final = vert_dest_map;
 
-  int dest_index = 0;
-  for (int i = 0; i < totvert; i++) {
-    int source_index = i;
-    int count = 0;
-    while (i < totvert && vert_dest_map[i] == OUT_OF_CONTEXT) {
-      vert_final[i] = dest_index + count;
-      count++;
-      i++;
-    }
-    if (count) {
-      CustomData_copy_data(&mesh.vdata, &result->vdata, source_index, dest_index, count);
-      dest_index += count;
-    }
-    if (i == totvert) {
-      break;
-    }
-    if (vert_dest_map[i] != ELEM_MERGED) {
-      struct WeldGroup *wgroup = &weld_mesh.vert_groups[vert_dest_map[i]];
-      customdata_weld(&mesh.vdata,
-                      &result->vdata,
-                      &weld_mesh.vert_groups_buffer[wgroup->ofs],
-                      wgroup->len,
-                      dest_index);
-      vert_final[i] = dest_index;
-      dest_index++;
-    }
-  }
+  const int verts_len = weld_parallel_ranges<int>(
+      totvert,
+      [&](const int i) { return int(vert_dest_map[i] != ELEM_MERGED); },
+      [&](const IndexRange range, int dest_index) {
+        const int range_end = int(range.one_after_last());
+        for (int i = int(range.start()); i < range_end; i++) {
+          int source_index = i;
+          int count = 0;
+          while (i < range_end && vert_dest_map[i] == OUT_OF_CONTEXT) {
+            vert_final[i] = dest_index + count;
+            count++;
+            i++;
+          }
+          if (count) {
+            CustomData_copy_data(&mesh.vdata, &result->vdata, source_index, dest_index, count);
+            dest_index += count;
+          }
+          if (i == range_end) {
+            break;
+          }
+          if (vert_dest_map[i] != ELEM_MERGED) {
+            struct WeldGroup *wgroup = &weld_mesh.vert_groups[vert_dest_map[i]];
+            customdata_weld(&mesh.vdata,
+                            &result->vdata,
+                            &weld_mesh.vert_groups_buffer[wgroup->ofs],
+                            wgroup->len,
+                            dest_index);
+            vert_final[i] = dest_index;
+            dest_index++;
+          }
+        }
+      });
 
-  BLI_assert(dest_index == result_nverts);
+  BLI_assert(verts_len == result_nverts);
+  UNUSED_VARS_NDEBUG(verts_len);
 
   /* Edges. */
 
@@ -1420,103 +1473,150 @@ static Mesh *create_merged_mesh(const Mesh &mesh,
    * #edge_groups_map. This map will be used to adjust the polys and loops. */
   MutableSpan<int> edge_final = weld_mesh.edge_groups_map;
 
-  dest_index = 0;
-  for (int i = 0; i < totedge; i++) {
-    const int source_index = i;
-    int count = 0;
-    while (i < totedge && weld_mesh.edge_groups_map[i] == OUT_OF_CONTEXT) {
-      edge_final[i] = dest_index + count;
-      count++;
-      i++;
-    }
-    if (count) {
-      CustomData_copy_data(&mesh.edata, &result->edata, source_index, dest_index, count);
-      MEdge *me = &result->medge[dest_index];
-      dest_index += count;
-      for (; count--; me++) {
-        me->v1 = vert_final[me->v1];
-        me->v2 = vert_final[me->v2];
-      }
-    }
-    if (i == totedge) {
-      break;
-    }
-    if (weld_mesh.edge_groups_map[i] != ELEM_MERGED) {
-      struct WeldGroupEdge *wegrp = &weld_mesh.edge_groups[weld_mesh.edge_groups_map[i]];
-      customdata_weld(&mesh.edata,
-                      &result->edata,
-                      &weld_mesh.edge_groups_buffer[wegrp->group.ofs],
-                      wegrp->group.len,
-                      dest_index);
-      MEdge *me = &result->medge[dest_index];
-      me->v1 = vert_final[wegrp->v1];
-      me->v2 = vert_final[wegrp->v2];
-      /* "For now, assume that all merged edges are loose. This flag will be cleared in the
-       * Polys/Loops step". */
-      me->flag |= ME_LOOSEEDGE;
-
-      edge_final[i] = dest_index;
-      dest_index++;
-    }
-  }
+  const int edges_len = weld_parallel_ranges<int>(
+      totedge,
+      [&](const int i) { return int(weld_mesh.edge_groups_map[i] != ELEM_MERGED); },
+      [&](const IndexRange range, int dest_index) {
+        const int range_end = int(range.one_after_last());
+        for (int i = int(range.start()); i < range_end; i++) {
+          const int source_index = i;
+          int count = 0;
+          while (i < range_end && weld_mesh.edge_groups_map[i] == OUT_OF_CONTEXT) {
+            edge_final[i] = dest_index + count;
+            count++;
+            i++;
+          }
+          if (count) {
+            CustomData_copy_data(&mesh.edata, &result->edata, source_index, dest_index, count);
+            MEdge *me = &result->medge[dest_index];
+            dest_index += count;
+            for (; count--; me++) {
+              me->v1 = vert_final[me->v1];
+              me->v2 = vert_final[me->v2];
+            }
+          }
+          if (i == range_end) {
+            break;
+          }
+          if (weld_mesh.edge_groups_map[i] != ELEM_MERGED) {
+            struct WeldGroupEdge *wegrp = &weld_mesh.edge_groups[weld_mesh.edge_groups_map[i]];
+            customdata_weld(&mesh.edata,
+                            &result->edata,
+                            &weld_mesh.edge_groups_buffer[wegrp->group.ofs],
+                            wegrp->group.len,
+                            dest_index);
+            MEdge *me = &result->medge[dest_index];
+            me->v1 = vert_final[wegrp->v1];
+            me->v2 = vert_final[wegrp->v2];
+            /* "For now, assume that all merged edges are loose. This flag will be cleared in the
+             * Polys/Loops step". */
+            me->flag |= ME_LOOSEEDGE;
+
+            edge_final[i] = dest_index;
+            dest_index++;
+          }
+        }
+      });
 
-  BLI_assert(dest_index == result_nedges);
+  BLI_assert(edges_len == result_nedges);
+  UNUSED_VARS_NDEBUG(edges_len);
 
   /* Polys/Loops. */
 
-  MPoly *r_mp = &result->mpoly[0];
-  MLoop *r_ml = &result->mloop[0];
-  int r_i = 0;
-  int loop_cur = 0;
-  Array<int, 64> group_buffer(weld_mesh.max_poly_len);
-  for (const int i : mpoly.index_range()) {
-    const MPoly &mp = mpoly[i];
-    const int loop_start = loop_cur;
+  /* Number of loops of a polygon in the result, zero if it is removed. */
+  auto poly_result_len = [&](const int i) {
     const int poly_ctx = weld_mesh.poly_map[i];
     if (poly_ctx == OUT_OF_CONTEXT) {
-      int mp_loop_len = mp.totloop;
-      CustomData_copy_data(&mesh.ldata, &result->ldata, mp.loopstart, loop_cur, mp_loop_len);
-      loop_cur += mp_loop_len;
-      for (; mp_loop_len--; r_ml++) {
-        r_ml->v = vert_final[r_ml->v];
-        r_ml->e = edge_final[r_ml->e];
-      }
+      return mpoly[i].totloop;
     }
-    else {
-      const WeldPoly &wp = weld_mesh.wpoly[poly_ctx];
-      WeldLoopOfPolyIter iter;
-      if (!weld_iter_loop_of_poly_begin(
-              iter, wp, weld_mesh.wloop, mloop, weld_mesh.loop_map, group_buffer.data())) {
-        continue;
-      }
-
-      if (wp.poly_dst != OUT_OF_CONTEXT) {
-        continue;
-      }
-      while (weld_iter_loop_of_poly_next(iter)) {
-        customdata_weld(
-            &mesh.ldata, &result->ldata, group_buffer.data(), iter.group_len, loop_cur);
-        int v = vert_final[iter.v];
-        int e = edge_final[iter.e];
-        r_ml->v = v;
-        r_ml->e = e;
-        r_ml++;
-        loop_cur++;
-        if (iter.type) {
-          result->medge[e].flag &= ~ME_LOOSEEDGE;
-        }
-        BLI_assert((result->medge[e].flag & ME_LOOSEEDGE) == 0);
-      }
+    const WeldPoly &wp = weld_mesh.wpoly[poly_ctx];
+    WeldLoopOfPolyIter iter;
+    if (!weld_iter_loop_of_poly_begin(
+            iter, wp, weld_mesh.wloop, mloop, weld_mesh.loop_map, nullptr) ||
+        wp.poly_dst != OUT_OF_CONTEXT) {
+      return 0;
+    }
+    int loop_len = 0;
+    while (weld_iter_loop_of_poly_next(iter)) {
+      loop_len++;
     }
+    return loop_len;
+  };
 
-    CustomData_copy_data(&mesh.pdata, &result->pdata, i, r_i, 1);
-    r_mp->loopstart = loop_start;
-    r_mp->totloop = loop_cur - loop_start;
-    r_mp++;
-    r_i++;
-  }
+  /* Merged edges used by polygons are cleared from being loose, edges can be shared by
+   * polygons of different ranges. */
+  auto edge_clear_loose = [&](const int e) {
+    atomic_fetch_and_and_int16(&result->medge[e].flag, short(~ME_LOOSEEDGE));
+  };
 
-  /* New Polygons. */
+  const int2 polys_len = weld_parallel_ranges<int2>(
+      totpoly,
+      [&](const int i) {
+        const int loop_len = poly_result_len(i);
+        return int2(loop_len > 0, loop_len);
+      },
+      [&](const IndexRange range, const int2 offset) {
+        MPoly *r_mp = &result->mpoly[offset[0]];
+        MLoop *r_ml = &result->mloop[offset[1]];
+        int r_i = offset[0];
+        int loop_cur = offset[1];
+        Array<int, 64> group_buffer(weld_mesh.max_poly_len);
+        for (const int i : range) {
+          const MPoly &mp = mpoly[i];
+          const int loop_start = loop_cur;
+          const int poly_ctx = weld_mesh.poly_map[i];
+          if (poly_ctx == OUT_OF_CONTEXT) {
+            int mp_loop_len = mp.totloop;
+            CustomData_copy_data(
+                &mesh.ldata, &result->ldata, mp.loopstart, loop_cur, mp_loop_len);
+            loop_cur += mp_loop_len;
+            for (; mp_loop_len--; r_ml++) {
+              r_ml->v = vert_final[r_ml->v];
+              r_ml->e = edge_final[r_ml->e];
+            }
+          }
+          else {
+            const WeldPoly &wp = weld_mesh.wpoly[poly_ctx];
+            WeldLoopOfPolyIter iter;
+            if (!weld_iter_loop_of_poly_begin(
+                    iter, wp, weld_mesh.wloop, mloop, weld_mesh.loop_map, group_buffer.data())) {
+              continue;
+            }
+
+            if (wp.poly_dst != OUT_OF_CONTEXT) {
+              continue;
+            }
+            while (weld_iter_loop_of_poly_next(iter)) {
+              customdata_weld(
+                  &mesh.ldata, &result->ldata, group_buffer.data(), iter.group_len, loop_cur);
+              int v = vert_final[iter.v];
+              int e = edge_final[iter.e];
+              r_ml->v = v;
+              r_ml->e = e;
+              r_ml++;
+              loop_cur++;
+              if (iter.type) {
+                edge_clear_loose(e);
+              }
+              BLI_assert((result->medge[e].flag & ME_LOOSEEDGE) == 0);
+            }
+          }
+
+          CustomData_copy_data(&mesh.pdata, &result->pdata, i, r_i, 1);
+          r_mp->loopstart = loop_start;
+          r_mp->totloop = loop_cur - loop_start;
+          r_mp++;
+          r_i++;
+        }
+      });
+
+  /* New polygons are only created when polygons are split, which is rare, so they are added
+   * after the others on a single thread. */
+  MPoly *r_mp = &result->mpoly[polys_len[0]];
+  MLoop *r_ml = &result->mloop[polys_len[1]];
+  int r_i = polys_len[0];
+  int loop_cur = polys_len[1];
+  Array<int, 64> group_buffer(weld_mesh.max_poly_len);
   for (const int i : weld_mesh.wpoly.index_range().take_back(weld_mesh.wpoly_new_len)) {
     const WeldPoly &wp = weld_mesh.wpoly[i];
     const int loop_start = loop_cur;
@@ -1538,7 +1638,7 @@ static Mesh *create_merged_mesh(const Mesh &mesh,
       r_ml++;
       loop_cur++;
       if (iter.type) {
-        result->medge[e].flag &= ~ME_LOOSEEDGE;
+        edge_clear_loose(e);
       }
       BLI_assert((result->medge[e].flag & ME_LOOSEEDGE) == 0);
     }
@@ -1561,22 +1661,294 @@ static Mesh *create_merged_mesh(const Mesh &mesh,
 /** \name Merge Map Creation
  * \{ */
 
+struct WeldGridVert {
+  int3 cell;
+  int vert;
+};
+
+static bool weld_grid_cell_less(const int3 &a, const int3 &b)
+{
+  if (a.x != b.x) {
+    return a.x < b.x;
+  }
+  if (a.y != b.y) {
+    return a.y < b.y;
+  }
+  return a.z < b.z;
+}
+
+/**
+ * Size of the cells of the grid used to find vertices in range. All vertices in range of a vertex
+ * have to be in the same or in a neighbor cell, so the cells can't be smaller than the merge
+ * distance. Cell coordinates have to fit in an integer though, so for very small distances the
+ * cells are bigger than needed, which is only slower.
+ */
+static float weld_grid_cell_size(Span<MVert> verts,
+                                 const IndexMask selection,
+                                 const float merge_distance)
+{
+  const float max_co = threading::parallel_reduce(
+      selection.index_range(),
+      4096,
+      0.0f,
+      [&](const IndexRange range, float max) {
+        for (const int i : selection.slice(range)) {
+          const float *co = verts[i].co;
+          max = std::max({max, fabsf(co[0]), fabsf(co[1]), fabsf(co[2])});
+        }
+        return max;
+      },
+      [](const float a, const float b) { return std::max(a, b); });
+  const float cell_size = std::max(merge_distance, max_co / float(1 << 30));
+  return (cell_size > 0.0f) ? cell_size : 1.0f;
+}
+
+/** Selected vertices sorted into the cells of a uniform grid. */
+struct WeldGrid {
+  float cell_size;
+  /** Sorted by cell, and by vertex index in each cell. */
+  Array<WeldGridVert> verts;
+  /** Occupied cells in sorted order, and the ranges of their vertices in #verts. */
+  Vector<int3> cells;
+  Vector<int> cell_offsets;
+
+  int3 cell_from_co(const float co[3]) const
+  {
+    return int3(int(floorf(co[0] / cell_size)),
+                int(floorf(co[1] / cell_size)),
+                int(floorf(co[2] / cell_size)));
+  }
+
+  Span<WeldGridVert> cell_verts(const int cell_index) const
+  {
+    return verts.as_span().slice(cell_offsets[cell_index],
+                                 cell_offsets[cell_index + 1] - cell_offsets[cell_index]);
+  }
+
+  /** \return The vertices in the cell, empty if it isn't occupied. */
+  Span<WeldGridVert> cell_verts(const int3 &cell) const
+  {
+    const int3 *cell_it = std::lower_bound(cells.begin(), cells.end(), cell, weld_grid_cell_less);
+    if (cell_it == cells.end() || *cell_it != cell) {
+      return {};
+    }
+    return cell_verts(int(cell_it - cells.begin()));
+  }
+};
+
+static void weld_grid_build(Span<MVert> verts,
+                            const IndexMask selection,
+                            const float merge_distance,
+                            WeldGrid &r_grid)
+{
+  r_grid.cell_size = weld_grid_cell_size(verts, selection, merge_distance);
+  r_grid.verts.reinitialize(selection.size());
+  threading::parallel_for(selection.index_range(), 4096, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      const int vert = selection[i];
+      r_grid.verts[i].cell = r_grid.cell_from_co(verts[vert].co);
+      r_grid.verts[i].vert = vert;
+    }
+  });
+  parallel_sort(r_grid.verts.begin(),
+                r_grid.verts.end(),
+                [](const WeldGridVert &a, const WeldGridVert &b) {
+                  if (a.cell != b.cell) {
+                    return weld_grid_cell_less(a.cell, b.cell);
+                  }
+                  return a.vert < b.vert;
+                });
+
+  for (const int64_t i : r_grid.verts.index_range()) {
+    if (i == 0 || r_grid.verts[i].cell != r_grid.verts[i - 1].cell) {
+      r_grid.cells.append(r_grid.verts[i].cell);
+      r_grid.cell_offsets.append(int(i));
+    }
+  }
+  r_grid.cell_offsets.append(int(r_grid.verts.size()));
+}
+
+/**
+ * Call \a fn for every selected vertex in range of \a co, which can include \a co itself.
+ * All of them are in the cell of \a co or in one of its neighbors.
+ */
+template<typename Fn>
+static void weld_grid_foreach_vert_in_range(const WeldGrid &grid,
+                                            Span<MVert> verts,
+                                            const float co[3],
+                                            const float merge_dist_sq,
+                                            const Fn &fn)
+{
+  const int3 cell = grid.cell_from_co(co);
+  for (int x = -1; x <= 1; x++) {
+    for (int y = -1; y <= 1; y++) {
+      for (int z = -1; z <= 1; z++) {
+        for (const WeldGridVert &grid_vert : grid.cell_verts(cell + int3(x, y, z))) {
+          if (len_squared_v3v3(co, verts[grid_vert.vert].co) <= merge_dist_sq) {
+            if (!fn(grid_vert.vert)) {
+              return;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+struct WeldOrderNode {
+  float3 co;
+  int vert;
+};
+
+/**
+ * Reorder the nodes the way `kdtree_balance` in `kdtree_impl.h` reorders the nodes of a KD-tree,
+ * with the same partition around the median on each axis in turn. Both halves are independent of
+ * each other, so they are reordered in parallel, which gives the same order.
+ */
+static void weld_kdtree_order_balance(MutableSpan<WeldOrderNode> nodes, const int axis)
+{
+  const int nodes_len = int(nodes.size());
+  if (nodes_len <= 1) {
+    return;
+  }
+
+  /* Quick-sort style sorting around median. */
+  int left = 0;
+  int right = nodes_len - 1;
+  const int median = nodes_len / 2;
+
+  while (right > left) {
+    const float co = nodes[right].co[axis];
+    int i = left - 1;
+    int j = right;
+
+    while (true) {
+      while (nodes[++i].co[axis] < co) { /* pass */
+      }
+      while (nodes[--j].co[axis] > co && j > left) { /* pass */
+      }
+
+      if (i >= j) {
+        break;
+      }
+
+      std::swap(nodes[i], nodes[j]);
+    }
+
+    std::swap(nodes[i], nodes[right]);
+    if (i >= median) {
+      right = i - 1;
+    }
+    if (i <= median) {
+      left = i + 1;
+    }
+  }
+
+  const int next_axis = (axis + 1) % 3;
+  MutableSpan<WeldOrderNode> nodes_left = nodes.take_front(median);
+  MutableSpan<WeldOrderNode> nodes_right = nodes.drop_front(median + 1);
+  threading::parallel_invoke(
+      nodes_len > 4096,
+      [&]() { weld_kdtree_order_balance(nodes_left, next_axis); },
+      [&]() { weld_kdtree_order_balance(nodes_right, next_axis); });
+}
+
+/**
+ * The order of the selected vertices in a balanced KD-tree. Merge targets are picked in this
+ * order, like #BLI_kdtree_3d_calc_duplicates_fast does without `use_index_order`, which is how
+ * they were picked when the KD-tree was also used to find the vertices in range. The tree itself
+ * is not built, only the order of its nodes.
+ */
+static Array<int> weld_kdtree_order(Span<MVert> verts, const IndexMask selection)
+{
+  /* Nodes start in insertion order, which was the order of the selection. */
+  Array<WeldOrderNode> nodes(selection.size());
+  threading::parallel_for(selection.index_range(), 4096, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      nodes[i].co = verts[selection[i]].co;
+      nodes[i].vert = int(selection[i]);
+    }
+  });
+
+  weld_kdtree_order_balance(nodes, 0);
+
+  Array<int> order(selection.size());
+  threading::parallel_for(nodes.index_range(), 4096, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      order[i] = nodes[i].vert;
+    }
+  });
+  return order;
+}
+
+/**
+ * Find the vertices to merge, with the same result as #BLI_kdtree_3d_calc_duplicates_fast
+ * without `use_index_order`: vertices are visited in the order of a balanced KD-tree, and a
+ * vertex which is not merged yet takes all vertices in range which are not merged yet. Merging is
+ * always a single step, a vertex which other vertices are merged to is never merged itself.
+ *
+ * Vertices are found with a uniform grid instead of the KD-tree. Finding which vertices have any
+ * other vertex in range is done in parallel, one cell at a time. Only those vertices are visited
+ * when picking the merge targets, which has to be serial because every choice depends on the
+ * previous ones.
+ */
+static int weld_calc_duplicates(Span<MVert> verts,
+                                const IndexMask selection,
+                                const float merge_distance,
+                                MutableSpan<int> r_vert_dest_map)
+{
+  const float merge_dist_sq = square_f(merge_distance);
+
+  WeldGrid grid;
+  weld_grid_build(verts, selection, merge_distance, grid);
+
+  Array<bool> has_duplicate(verts.size(), false);
+  threading::parallel_for(grid.cells.index_range(), 256, [&](const IndexRange range) {
+    for (const int cell_index : range) {
+      for (const WeldGridVert &grid_vert : grid.cell_verts(cell_index)) {
+        const int vert = grid_vert.vert;
+        weld_grid_foreach_vert_in_range(
+            grid, verts, verts[vert].co, merge_dist_sq, [&](const int other) {
+              if (other == vert) {
+                return true;
+              }
+              has_duplicate[vert] = true;
+              return false;
+            });
+      }
+    }
+  });
+
+  int found = 0;
+  for (const int vert : weld_kdtree_order(verts, selection)) {
+    if (!has_duplicate[vert] || !ELEM(r_vert_dest_map[vert], OUT_OF_CONTEXT, vert)) {
+      continue;
+    }
+    const int found_prev = found;
+    weld_grid_foreach_vert_in_range(
+        grid, verts, verts[vert].co, merge_dist_sq, [&](const int other) {
+          if (other != vert && r_vert_dest_map[other] == OUT_OF_CONTEXT) {
+            r_vert_dest_map[other] = vert;
+            found++;
+          }
+          return true;
+        });
+    if (found != found_prev) {
+      /* Prevent chains of doubles. */
+      r_vert_dest_map[vert] = vert;
+    }
+  }
+  return found;
+}
+
 std::optional<Mesh *> mesh_merge_by_distance_all(const Mesh &mesh,
                                                  const IndexMask selection,
                                                  const float merge_distance)
 {
   Array<int> vert_dest_map(mesh.totvert, OUT_OF_CONTEXT);
 
-  KDTree_3d *tree = BLI_kdtree_3d_new(selection.size());
-
-  for (const int i : selection) {
-    BLI_kdtree_3d_insert(tree, i, mesh.mvert[i].co);
-  }
-
-  BLI_kdtree_3d_balance(tree);
-  const int vert_kill_len = BLI_kdtree_3d_calc_duplicates_fast(
-      tree, merge_distance, false, vert_dest_map.data());
-  BLI_kdtree_3d_free(tree);
+  const int vert_kill_len = weld_calc_duplicates(
+      {mesh.mvert, mesh.totvert}, selection, merge_distance, vert_dest_map);
 
   if (vert_kill_len == 0) {
     return std::nullopt;
@@ -0,0 +1,218 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include "BLI_array.hh"
+#include "BLI_index_mask_ops.hh"
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.hh"
+#include "BLI_rand.hh"
+#include "BLI_vector.hh"
+
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "GEO_mesh_merge_by_distance.hh"
+
+namespace blender::geometry::tests {
+
+class MergeByDistanceTest : public testing::Test {
+ public:
+  static void SetUpTestSuite()
+  {
+    BKE_idtype_init();
+  }
+};
+
+/**
+ * Loose vertices in clusters which overlap each other, so the choice of the merge targets
+ * matters: chains of vertices closer than \a merge_distance to the next one, and random clouds.
+ */
+static Mesh *overlapping_clusters_mesh_new(const float merge_distance)
+{
+  RandomNumberGenerator rng(0);
+  Vector<float3> positions;
+  for (const int chain : IndexRange(8)) {
+    const float3 start(float(chain) * 4.0f * merge_distance, 0.0f, 0.0f);
+    const float3 step = rng.get_unit_float3() * (0.6f * merge_distance);
+    for (const int i : IndexRange(12)) {
+      positions.append(start + step * float(i));
+    }
+  }
+  for (const int cloud : IndexRange(16)) {
+    const float3 center(float(cloud % 4) * 2.0f * merge_distance,
+                        float(cloud / 4) * 2.0f * merge_distance,
+                        merge_distance);
+    for (int i = 0; i < 40; i++) {
+      positions.append(center + rng.get_unit_float3() * (rng.get_float() * 1.5f * merge_distance));
+    }
+  }
+
+  Mesh *mesh = BKE_mesh_new_nomain(positions.size(), 0, 0, 0, 0);
+  for (const int i : positions.index_range()) {
+    copy_v3_v3(mesh->mvert[i].co, positions[i]);
+  }
+  return mesh;
+}
+
+/**
+ * The positions #mesh_merge_by_distance_all is expected to give, with the merge targets picked by
+ * #BLI_kdtree_3d_calc_duplicates_fast, which is how they were picked before the spatial grid
+ * was used. Merged vertices end up at the average of their positions.
+ */
+static Vector<float3> kdtree_merged_positions(const Mesh &mesh,
+                                              const IndexMask selection,
+                                              const float merge_distance)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(selection.size());
+  for (const int i : selection) {
+    BLI_kdtree_3d_insert(tree, i, mesh.mvert[i].co);
+  }
+  BLI_kdtree_3d_balance(tree);
+  Array<int> dest_map(mesh.totvert, -1);
+  BLI_kdtree_3d_calc_duplicates_fast(tree, merge_distance, false, dest_map.data());
+  BLI_kdtree_3d_free(tree);
+
+  Array<float3> sums(mesh.totvert, float3(0.0f));
+  Array<int> counts(mesh.totvert, 0);
+  for (const int i : IndexRange(mesh.totvert)) {
+    const int dest = (dest_map[i] == -1) ? i : dest_map[i];
+    sums[dest] += float3(mesh.mvert[i].co);
+    counts[dest]++;
+  }
+  Vector<float3> positions;
+  for (const int i : IndexRange(mesh.totvert)) {
+    if (counts[i] > 0) {
+      positions.append(sums[i] / float(counts[i]));
+    }
+  }
+  return positions;
+}
+
+static void expect_merged_positions_eq(const Mesh &result, Vector<float3> expected)
+{
+  ASSERT_EQ(result.totvert, expected.size());
+  for (const int i : IndexRange(result.totvert)) {
+    const float3 co = result.mvert[i].co;
+    const int64_t match = std::find_if(expected.begin(),
+                                       expected.end(),
+                                       [&](const float3 &other) {
+                                         return math::distance(co, other) < 1e-5f;
+                                       }) -
+                          expected.begin();
+    ASSERT_LT(match, expected.size());
+    expected.remove_and_reorder(match);
+  }
+}
+
+TEST_F(MergeByDistanceTest, MatchesKDTreeAll)
+{
+  const float merge_distance = 0.1f;
+  Mesh *mesh = overlapping_clusters_mesh_new(merge_distance);
+  const IndexMask selection(mesh->totvert);
+
+  const std::optional<Mesh *> result = mesh_merge_by_distance_all(
+      *mesh, selection, merge_distance);
+  ASSERT_TRUE(result.has_value());
+  expect_merged_positions_eq(**result, kdtree_merged_positions(*mesh, selection, merge_distance));
+
+  BKE_id_free(nullptr, *result);
+  BKE_id_free(nullptr, mesh);
+}
+
+TEST_F(MergeByDistanceTest, MatchesKDTreeSelection)
+{
+  const float merge_distance = 0.1f;
+  Mesh *mesh = overlapping_clusters_mesh_new(merge_distance);
+  Vector<int64_t> indices;
+  const IndexMask selection = index_mask_ops::find_indices_based_on_predicate(
+      IndexMask(mesh->totvert), 4096, indices, [](const int64_t i) { return i % 3 != 1; });
+
+  const std::optional<Mesh *> result = mesh_merge_by_distance_all(
+      *mesh, selection, merge_distance);
+  ASSERT_TRUE(result.has_value());
+  expect_merged_positions_eq(**result, kdtree_merged_positions(*mesh, selection, merge_distance));
+
+  BKE_id_free(nullptr, *result);
+  BKE_id_free(nullptr, mesh);
+}
+
+/**
+ * Grid of `size` by `size` quads with a spacing of one, where every tenth column of vertices is
+ * moved onto the previous column, so that the quads between them collapse.
+ */
+static Mesh *collapsing_grid_mesh_new(const int size)
+{
+  const int verts_len = (size + 1) * (size + 1);
+  const int polys_len = size * size;
+  Mesh *mesh = BKE_mesh_new_nomain(verts_len, 0, 0, polys_len * 4, polys_len);
+
+  for (const int y : IndexRange(size + 1)) {
+    for (const int x : IndexRange(size + 1)) {
+      MVert &vert = mesh->mvert[y * (size + 1) + x];
+      vert.co[0] = float((x % 10 == 1) ? x - 1 : x);
+      vert.co[1] = float(y);
+      vert.co[2] = 0.0f;
+    }
+  }
+
+  for (const int y : IndexRange(size)) {
+    for (const int x : IndexRange(size)) {
+      const int poly_index = y * size + x;
+      MPoly &poly = mesh->mpoly[poly_index];
+      poly.loopstart = poly_index * 4;
+      poly.totloop = 4;
+      mesh->mloop[poly.loopstart + 0].v = y * (size + 1) + x;
+      mesh->mloop[poly.loopstart + 1].v = y * (size + 1) + x + 1;
+      mesh->mloop[poly.loopstart + 2].v = (y + 1) * (size + 1) + x + 1;
+      mesh->mloop[poly.loopstart + 3].v = (y + 1) * (size + 1) + x;
+    }
+  }
+
+  BKE_mesh_calc_edges(mesh, false, false);
+  return mesh;
+}
+
+/* Large enough for vertices, edges and polygons to be copied to the result in several ranges. */
+TEST_F(MergeByDistanceTest, CollapsingGrid)
+{
+  const int size = 300;
+  const int collapsed_columns = size / 10;
+  Mesh *mesh = collapsing_grid_mesh_new(size);
+
+  const std::optional<Mesh *> result = mesh_merge_by_distance_all(
+      *mesh, IndexMask(mesh->totvert), 0.001f);
+  ASSERT_TRUE(result.has_value());
+  Mesh *result_mesh = *result;
+
+  EXPECT_EQ(result_mesh->totvert, (size + 1 - collapsed_columns) * (size + 1));
+  EXPECT_EQ(result_mesh->totedge,
+            (size - collapsed_columns) * (size + 1) + (size + 1 - collapsed_columns) * size);
+  EXPECT_EQ(result_mesh->totpoly, (size - collapsed_columns) * size);
+  EXPECT_EQ(result_mesh->totloop, (size - collapsed_columns) * size * 4);
+  EXPECT_TRUE(BKE_mesh_is_valid(result_mesh));
+
+  /* Polygons stay in order, and only the collapsed quads are removed. */
+  int poly_index = 0;
+  for (const int y : IndexRange(size)) {
+    for (const int x : IndexRange(size)) {
+      if (x % 10 == 0) {
+        continue;
+      }
+      const MPoly &poly = result_mesh->mpoly[poly_index++];
+      ASSERT_EQ(poly.totloop, 4);
+      const float *co = result_mesh->mvert[result_mesh->mloop[poly.loopstart].v].co;
+      EXPECT_EQ(co[0], float((x % 10 == 1) ? x - 1 : x));
+      EXPECT_EQ(co[1], float(y));
+    }
+  }
+
+  BKE_id_free(nullptr, result_mesh);
+  BKE_id_free(nullptr, mesh);
+}
+
+}  // namespace blender::geometry::tests
@@ -786,7 +786,7 @@ void GPU_pbvh_grid_buffers_update(PBVHGPUFormat *vbo_id,
                 buffers->vert_buf, vbo_id->pos, vbo_index, CCG_elem_co(key, elem));
 
             short no_short[3];
-            normal_float_to_short_v3(no_short, CCG_elem_no(key, elem));
+            CCG_elem_no_short_get(key, elem, no_short);
             GPU_vertbuf_attr_set(buffers->vert_buf, vbo_id->nor, vbo_index, no_short);
 
             if (has_mask && show_mask) {
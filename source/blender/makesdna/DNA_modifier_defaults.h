@@ -610,6 +610,7 @@
     .uv_smooth = SUBSURF_UV_SMOOTH_PRESERVE_BOUNDARIES, \
     .quality = 3, \
     .boundary_smooth = SUBSURF_BOUNDARY_SMOOTH_ALL, \
+    .render_dicing_rate = 1.0f, \
     .emCache = NULL, \
     .mCache = NULL, \
   }
@@ -157,6 +157,7 @@ typedef enum {
   eSubsurfModifierFlag_UseCrease = (1 << 4),
   eSubsurfModifierFlag_UseCustomNormals = (1 << 5),
   eSubsurfModifierFlag_UseRecursiveSubdivision = (1 << 6),
+  eSubsurfModifierFlag_UseAdaptiveRenderLevels = (1 << 7),
 } SubsurfModifierFlag;
 
 typedef enum {
@@ -186,6 +187,9 @@ typedef struct SubsurfModifierData {
   short quality;
   short boundary_smooth;
   char _pad[2];
+  /** Desired length of subdivided edges in pixels, for adaptive render levels. */
+  float render_dicing_rate;
+  char _pad1[4];
 
   /* TODO(sergey): Get rid of those with the old CCG subdivision code. */
   void *emCache, *mCache;
@@ -1097,6 +1101,7 @@ typedef enum {
   eMultiresModifierFlag_UseCrease = (1 << 2),
   eMultiresModifierFlag_UseCustomNormals = (1 << 3),
   eMultiresModifierFlag_UseSculptBaseMesh = (1 << 4),
+  eMultiresModifierFlag_UseCompactGrids = (1 << 5),
 } MultiresModifierFlag;
 
 /** DEPRECATED: only used for versioning. */
@@ -1750,6 +1750,24 @@ static void rna_def_modifier_subsurf(BlenderRNA *brna)
   RNA_def_property_ui_text(
       prop, "Render Levels", "Number of subdivisions to perform when rendering");
 
+  prop = RNA_def_property(srna, "use_adaptive_render_levels", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flags", eSubsurfModifierFlag_UseAdaptiveRenderLevels);
+  RNA_def_property_ui_text(prop,
+                           "Adaptive Render Levels",
+                           "Lower the number of subdivisions when rendering based on the size of "
+                           "the mesh faces as seen from the scene camera, with render levels as "
+                           "the upper bound");
+  RNA_def_property_update(prop, 0, "rna_Modifier_dependency_update");
+
+  prop = RNA_def_property(srna, "render_dicing_rate", PROP_FLOAT, PROP_PIXEL);
+  RNA_def_property_float_sdna(prop, NULL, "render_dicing_rate");
+  RNA_def_property_range(prop, 0.1f, 1000.0f);
+  RNA_def_property_ui_range(prop, 0.5f, 100.0f, 10, 2);
+  RNA_def_property_ui_text(prop,
+                           "Dicing Rate",
+                           "Desired size of subdivided edges in pixels when rendering with "
+                           "adaptive render levels");
+
   prop = RNA_def_property(srna, "show_only_control_edges", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_boolean_sdna(prop, NULL, "flags", eSubsurfModifierFlag_ControlEdges);
   RNA_def_property_ui_text(prop, "Optimal Display", "Skip displaying interior subdivided edges");
@@ -1991,6 +2009,14 @@ static void rna_def_modifier_multires(BlenderRNA *brna)
                            "displacement of higher subdivision levels");
   RNA_def_property_update(prop, 0, "rna_Modifier_update");
 
+  prop = RNA_def_property(srna, "use_compact_grids", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flags", eMultiresModifierFlag_UseCompactGrids);
+  RNA_def_property_ui_text(prop,
+                           "Compact Grids",
+                           "Store normals of the subdivided grids with reduced precision, "
+                           "lowering memory usage of high subdivision levels");
+  RNA_def_property_update(prop, 0, "rna_Modifier_update");
+
   RNA_define_lib_overridable(false);
 }
 
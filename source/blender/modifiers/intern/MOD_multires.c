@@ -172,6 +172,7 @@ static void multires_ccg_settings_init(SubdivToCCGSettings *settings,
   settings->resolution = (1 << level) + 1;
   settings->need_normal = true;
   settings->need_mask = has_mask;
+  settings->use_compact_normal = (mmd->flags & eMultiresModifierFlag_UseCompactGrids);
 }
 
 static Mesh *multires_as_ccg(MultiresModifierData *mmd,
@@ -461,17 +462,19 @@ static void advanced_panel_draw(const bContext *UNUSED(C), Panel *panel)
 
   uiLayoutSetPropSep(layout, true);
 
-  uiLayoutSetActive(layout, !has_displacement);
+  col = uiLayoutColumn(layout, false);
+  uiLayoutSetActive(col, !has_displacement);
 
-  uiItemR(layout, ptr, "quality", 0, NULL, ICON_NONE);
+  uiItemR(col, ptr, "quality", 0, NULL, ICON_NONE);
 
-  col = uiLayoutColumn(layout, false);
-  uiLayoutSetActive(col, true);
   uiItemR(col, ptr, "uv_smooth", 0, NULL, ICON_NONE);
   uiItemR(col, ptr, "boundary_smooth", 0, NULL, ICON_NONE);
 
-  uiItemR(layout, ptr, "use_creases", 0, NULL, ICON_NONE);
-  uiItemR(layout, ptr, "use_custom_normals", 0, NULL, ICON_NONE);
+  uiItemR(col, ptr, "use_creases", 0, NULL, ICON_NONE);
+  uiItemR(col, ptr, "use_custom_normals", 0, NULL, ICON_NONE);
+
+  /* Only affects storage of the grids, so it is not greyed out when there is displacement. */
+  uiItemR(layout, ptr, "use_compact_grids", 0, NULL, ICON_NONE);
 }
 
 static void panelRegister(ARegionType *region_type)
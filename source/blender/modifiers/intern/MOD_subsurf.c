@@ -11,6 +11,7 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_math_matrix.h"
 #include "BLI_string.h"
 #include "BLI_utildefines.h"
 
@@ -22,6 +23,7 @@
 #include "DNA_scene_types.h"
 #include "DNA_screen_types.h"
 
+#include "BKE_camera.h"
 #include "BKE_context.h"
 #include "BKE_editmesh.h"
 #include "BKE_mesh.h"
@@ -43,6 +45,7 @@
 #include "RNA_prototypes.h"
 
 #include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
 #include "DEG_depsgraph_query.h"
 
 #include "MOD_modifiertypes.h"
@@ -103,7 +106,14 @@ static void freeRuntimeData(void *runtime_data_v)
   }
   SubsurfRuntimeData *runtime_data = (SubsurfRuntimeData *)runtime_data_v;
   if (runtime_data->subdiv != NULL) {
-    BKE_subdiv_free(runtime_data->subdiv);
+    if (runtime_data->set_by_draw_code) {
+      BKE_subdiv_free(runtime_data->subdiv);
+    }
+    else {
+      /* Keep topology refiner and evaluator around for the next evaluation of the same
+       * topology, which avoids re-creating them for every frame of a render. */
+      BKE_subdiv_cache_release(runtime_data->subdiv);
+    }
   }
   MEM_freeN(runtime_data);
 }
@@ -140,13 +150,58 @@ static int subdiv_levels_for_modifier_get(const SubsurfModifierData *smd,
   return get_render_subsurf_level(&scene->r, requested_levels, use_render_params);
 }
 
+static bool subdiv_use_adaptive_render_levels(const SubsurfModifierData *smd,
+                                              const ModifierEvalContext *ctx)
+{
+  if ((smd->flags & eSubsurfModifierFlag_UseAdaptiveRenderLevels) == 0) {
+    return false;
+  }
+  /* Applying the modifier should not depend on the camera. */
+  return (ctx->flag & MOD_APPLY_RENDER) && !(ctx->flag & MOD_APPLY_TO_BASE_MESH);
+}
+
+/* Lower the render levels for meshes which are small on screen. */
+static int subdiv_adaptive_levels_get(const SubsurfModifierData *smd,
+                                      const ModifierEvalContext *ctx,
+                                      const Mesh *mesh,
+                                      const int max_level)
+{
+  Scene *scene = DEG_get_evaluated_scene(ctx->depsgraph);
+  Object *camera = scene->camera;
+  if (camera == NULL) {
+    return max_level;
+  }
+
+  SubdivToMeshAdaptiveSettings settings;
+  BKE_render_resolution(&scene->r, false, &settings.winx, &settings.winy);
+  settings.dicing_rate = smd->render_dicing_rate;
+  settings.max_level = max_level;
+
+  CameraParams params;
+  BKE_camera_params_init(&params);
+  BKE_camera_params_from_object(&params, camera);
+  BKE_camera_params_compute_viewplane(
+      &params, settings.winx, settings.winy, scene->r.xasp, scene->r.yasp);
+  BKE_camera_params_compute_matrix(&params);
+
+  float viewmat[4][4];
+  invert_m4_m4(viewmat, camera->obmat);
+  mul_m4_series(settings.object_to_clip, params.winmat, viewmat, ctx->object->obmat);
+
+  return BKE_subdiv_mesh_adaptive_level_get(mesh, &settings);
+}
+
 /* Subdivide into fully qualified mesh. */
 
 static void subdiv_mesh_settings_init(SubdivToMeshSettings *settings,
                                       const SubsurfModifierData *smd,
-                                      const ModifierEvalContext *ctx)
+                                      const ModifierEvalContext *ctx,
+                                      const Mesh *mesh)
 {
-  const int level = subdiv_levels_for_modifier_get(smd, ctx);
+  int level = subdiv_levels_for_modifier_get(smd, ctx);
+  if (subdiv_use_adaptive_render_levels(smd, ctx)) {
+    level = subdiv_adaptive_levels_get(smd, ctx, mesh, level);
+  }
   settings->resolution = (1 << level) + 1;
   settings->use_optimal_display = (smd->flags & eSubsurfModifierFlag_ControlEdges) &&
                                   !(ctx->flag & MOD_APPLY_TO_BASE_MESH);
@@ -159,7 +214,7 @@ static Mesh *subdiv_as_mesh(SubsurfModifierData *smd,
 {
   Mesh *result = mesh;
   SubdivToMeshSettings mesh_settings;
-  subdiv_mesh_settings_init(&mesh_settings, smd, ctx);
+  subdiv_mesh_settings_init(&mesh_settings, smd, ctx, mesh);
   if (mesh_settings.resolution < 3) {
     return result;
   }
@@ -177,6 +232,7 @@ static void subdiv_ccg_settings_init(SubdivToCCGSettings *settings,
   settings->resolution = (1 << level) + 1;
   settings->need_normal = true;
   settings->need_mask = false;
+  settings->use_compact_normal = false;
 }
 
 static Mesh *subdiv_as_ccg(SubsurfModifierData *smd,
@@ -202,7 +258,7 @@ static void subdiv_cache_mesh_wrapper_settings(const ModifierEvalContext *ctx,
                                                SubsurfRuntimeData *runtime_data)
 {
   SubdivToMeshSettings mesh_settings;
-  subdiv_mesh_settings_init(&mesh_settings, smd, ctx);
+  subdiv_mesh_settings_init(&mesh_settings, smd, ctx, mesh);
 
   runtime_data->has_gpu_subdiv = true;
   runtime_data->resolution = mesh_settings.resolution;
@@ -280,6 +336,27 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
   return result;
 }
 
+static void updateDepsgraph(ModifierData *md, const ModifierUpdateDepsgraphContext *ctx)
+{
+  SubsurfModifierData *smd = (SubsurfModifierData *)md;
+  if ((smd->flags & eSubsurfModifierFlag_UseAdaptiveRenderLevels) == 0) {
+    return;
+  }
+  /* Adaptive levels are only used for render, avoid re-evaluating subdivision in the viewport
+   * whenever the camera moves. */
+  if (DEG_get_mode(DEG_get_graph_from_handle(ctx->node)) != DAG_EVAL_RENDER) {
+    return;
+  }
+  /* Adaptive render levels depend on the size of the mesh as seen from the scene camera. */
+  DEG_add_depends_on_transform_relation(ctx->node, "Subsurf Modifier");
+  if (ctx->scene->camera != NULL) {
+    DEG_add_object_relation(
+        ctx->node, ctx->scene->camera, DEG_OB_COMP_TRANSFORM, "Subsurf Modifier Camera");
+    DEG_add_object_relation(
+        ctx->node, ctx->scene->camera, DEG_OB_COMP_PARAMETERS, "Subsurf Modifier Camera");
+  }
+}
+
 static void deformMatrices(ModifierData *md,
                            const ModifierEvalContext *ctx,
                            Mesh *mesh,
@@ -406,6 +483,12 @@ static void panel_draw(const bContext *C, Panel *panel)
     uiLayout *col = uiLayoutColumn(layout, true);
     uiItemR(col, ptr, "levels", 0, IFACE_("Levels Viewport"), ICON_NONE);
     uiItemR(col, ptr, "render_levels", 0, IFACE_("Render"), ICON_NONE);
+
+    uiLayout *row = uiLayoutRowWithHeading(layout, true, IFACE_("Adaptive Render"));
+    uiItemR(row, ptr, "use_adaptive_render_levels", 0, "", ICON_NONE);
+    uiLayout *sub = uiLayoutRow(row, true);
+    uiLayoutSetActive(sub, RNA_boolean_get(ptr, "use_adaptive_render_levels"));
+    uiItemR(sub, ptr, "render_dicing_rate", 0, "", ICON_NONE);
   }
 
   uiItemR(layout, ptr, "show_only_control_edges", 0, NULL, ICON_NONE);
@@ -495,7 +578,7 @@ ModifierTypeInfo modifierType_Subsurf = {
     /* requiredDataMask */ requiredDataMask,
     /* freeData */ freeData,
     /* isDisabled */ isDisabled,
-    /* updateDepsgraph */ NULL,
+    /* updateDepsgraph */ updateDepsgraph,
     /* dependsOnTime */ NULL,
     /* dependsOnNormals */ dependsOnNormals,
     /* foreachIDLink */ NULL,
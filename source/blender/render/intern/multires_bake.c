@@ -621,10 +621,10 @@ static void interp_bilinear_grid(
   v = crn_y - y0;
 
   if (mode == 0) {
-    copy_v3_v3(data[0], CCG_grid_elem_no(key, grid, x0, y0));
-    copy_v3_v3(data[1], CCG_grid_elem_no(key, grid, x1, y0));
-    copy_v3_v3(data[2], CCG_grid_elem_no(key, grid, x1, y1));
-    copy_v3_v3(data[3], CCG_grid_elem_no(key, grid, x0, y1));
+    CCG_grid_elem_no_get(key, grid, x0, y0, data[0]);
+    CCG_grid_elem_no_get(key, grid, x1, y0, data[1]);
+    CCG_grid_elem_no_get(key, grid, x1, y1, data[2]);
+    CCG_grid_elem_no_get(key, grid, x0, y1, data[3]);
   }
   else {
     copy_v3_v3(data[0], CCG_grid_elem_co(key, grid, x0, y0));
@@ -575,6 +575,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-time");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-pretty");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-uuid");
+  BLI_args_print_arg_doc(ba, "--debug-depsgraph-trace");
   BLI_args_print_arg_doc(ba, "--debug-ghost");
   BLI_args_print_arg_doc(ba, "--debug-wintab");
   BLI_args_print_arg_doc(ba, "--debug-gpu");
@@ -999,6 +1000,21 @@ static int arg_handle_debug_mode_generic_set(int UNUSED(argc),
   return 0;
 }
 
+static const char arg_handle_debug_depsgraph_trace_doc[] =
+    "<filepath>\n"
+    "\tRecord evaluation of every dependency graph operation and write it to the file\n"
+    "\tin Chrome trace format on exit.";
+static int arg_handle_debug_depsgraph_trace(int argc, const char **argv, void *UNUSED(data))
+{
+  const char *arg_id = "--debug-depsgraph-trace";
+  if (argc > 1) {
+    DEG_debug_trace_begin(argv[1]);
+    return 1;
+  }
+  printf("\nError: '%s' no args given.\n", arg_id);
+  return 0;
+}
+
 static const char arg_handle_debug_mode_io_doc[] =
     "\n\t"
     "Enable debug messages for I/O (Collada, ...).";
@@ -2207,6 +2223,7 @@ void main_args_setup(bContext *C, bArgs *ba)
                "--debug-depsgraph-uuid",
                CB_EX(arg_handle_debug_mode_generic_set, depsgraph_uuid),
                (void *)G_DEBUG_DEPSGRAPH_UUID);
+  BLI_args_add(ba, NULL, "--debug-depsgraph-trace", CB(arg_handle_debug_depsgraph_trace), NULL);
   BLI_args_add(ba,
                NULL,
                "--debug-gpu-force-workarounds",
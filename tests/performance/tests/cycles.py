@@ -4,6 +4,30 @@ import api
 import os
 
 
+def _set_device(scene, device_type, device_index):
+    import bpy
+
+    scene.cycles.device = 'CPU' if device_type == 'CPU' else 'GPU'
+
+    if scene.cycles.device == 'GPU':
+        # Enable specified GPU in preferences.
+        prefs = bpy.context.preferences
+        cprefs = prefs.addons['cycles'].preferences
+        cprefs.compute_device_type = device_type
+        devices = cprefs.get_devices_for_type(device_type)
+        for device in devices:
+            device.use = False
+
+        index = 0
+        for device in devices:
+            if device.type == device_type:
+                if index == device_index:
+                    device.use = True
+                    break
+                else:
+                    index += 1
+
+
 def _run(args):
     import bpy
     import time
@@ -15,7 +39,6 @@ def _run(args):
     scene.render.engine = 'CYCLES'
     scene.render.filepath = args['render_filepath']
     scene.render.image_settings.file_format = 'PNG'
-    scene.cycles.device = 'CPU' if device_type == 'CPU' else 'GPU'
 
     if scene.cycles.use_adaptive_sampling:
         # Render samples specified in file, no other way to measure
@@ -27,23 +50,7 @@ def _run(args):
         scene.cycles.samples = 16384
         scene.cycles.time_limit = 10.0
 
-    if scene.cycles.device == 'GPU':
-        # Enable specified GPU in preferences.
-        prefs = bpy.context.preferences
-        cprefs = prefs.addons['cycles'].preferences
-        cprefs.compute_device_type = device_type
-        devices = cprefs.get_devices_for_type(device_type)
-        for device in devices:
-            device.use = False
-
-        index = 0
-        for device in devices:
-            if device.type == device_type:
-                if index == device_index:
-                    device.use = True
-                    break
-                else:
-                    index += 1
+    _set_device(scene, device_type, device_index)
 
     # Render
     bpy.ops.render.render(write_still=True)
@@ -51,6 +58,108 @@ def _run(args):
     return None
 
 
+def _run_many_lights(args):
+    import bpy
+    import math
+    import random
+    import time
+
+    # Procedural scene with many small lights, where the choice of light to sample
+    # matters more than the cost of sampling it.
+    bpy.ops.wm.read_factory_settings(use_empty=True)
+    scene = bpy.context.scene
+    scene.render.engine = 'CYCLES'
+    scene.render.resolution_x = 480
+    scene.render.resolution_y = 270
+    scene.render.image_settings.file_format = 'OPEN_EXR'
+    scene.render.image_settings.color_depth = '32'
+    scene.cycles.samples = args['samples']
+    scene.cycles.use_adaptive_sampling = False
+    scene.cycles.use_denoising = False
+    scene.cycles.max_bounces = 1
+    scene.cycles.use_light_tree = args['use_light_tree']
+    _set_device(scene, args['device_type'], args['device_index'])
+
+    random.seed(0)
+    grid = args['grid']
+    spacing = 20.0 / grid
+
+    # Floor.
+    mesh = bpy.data.meshes.new("Floor")
+    mesh.from_pydata([(-12, -12, 0), (12, -12, 0), (12, 12, 0), (-12, 12, 0)], [], [(0, 1, 2, 3)])
+    scene.collection.objects.link(bpy.data.objects.new("Floor", mesh))
+
+    # Emissive triangles.
+    material = bpy.data.materials.new("Emission")
+    material.use_nodes = True
+    nodes = material.node_tree.nodes
+    nodes.clear()
+    emission = nodes.new('ShaderNodeEmission')
+    emission.inputs['Strength'].default_value = 20.0
+    output = nodes.new('ShaderNodeOutputMaterial')
+    material.node_tree.links.new(emission.outputs['Emission'], output.inputs['Surface'])
+
+    verts = []
+    faces = []
+    for i in range(grid):
+        for j in range(grid):
+            x = -10.0 + (i + random.random()) * spacing
+            y = -10.0 + (j + random.random()) * spacing
+            z = 0.2 + random.random() * 2.0
+            size = spacing * 0.1
+            index = len(verts)
+            verts += [(x, y, z), (x + size, y, z), (x, y + size, z)]
+            faces.append((index, index + 1, index + 2))
+    mesh = bpy.data.meshes.new("Emitters")
+    mesh.from_pydata(verts, [], faces)
+    mesh.materials.append(material)
+    scene.collection.objects.link(bpy.data.objects.new("Emitters", mesh))
+
+    # Point lights.
+    for i in range(grid):
+        for j in range(grid):
+            light = bpy.data.lights.new("Point", 'POINT')
+            light.energy = random.uniform(0.5, 5.0)
+            light.color = (random.random(), random.random(), random.random())
+            light.shadow_soft_size = spacing * 0.05
+            ob = bpy.data.objects.new("Point", light)
+            ob.location = (-10.0 + (i + random.random()) * spacing,
+                           -10.0 + (j + random.random()) * spacing,
+                           0.2 + random.random() * 2.0)
+            scene.collection.objects.link(ob)
+
+    camera = bpy.data.objects.new("Camera", bpy.data.cameras.new("Camera"))
+    camera.location = (0.0, -16.0, 8.0)
+    camera.rotation_euler = (math.radians(60.0), 0.0, 0.0)
+    scene.collection.objects.link(camera)
+    scene.camera = camera
+
+    # Render twice with different seeds, the difference between both renders
+    # gives an estimate of the noise.
+    pixels = []
+    render_time = 0.0
+    for seed in range(2):
+        scene.cycles.seed = seed
+        scene.render.filepath = args['render_filepath'] + '_' + str(seed) + '.exr'
+        start_time = time.perf_counter()
+        bpy.ops.render.render(write_still=True)
+        render_time += time.perf_counter() - start_time
+        image = bpy.data.images.load(scene.render.filepath)
+        pixels.append(image.pixels[:])
+        bpy.data.images.remove(image)
+
+    squared_error = 0.0
+    for a, b in zip(pixels[0], pixels[1]):
+        squared_error += (a - b) * (a - b)
+    variance = squared_error / (2.0 * len(pixels[0]))
+    render_time /= 2.0
+
+    # Variance times render time is lower for more efficient sampling.
+    return {'time': render_time,
+            'noise': math.sqrt(variance),
+            'variance_time': variance * render_time}
+
+
 class CyclesTest(api.Test):
     def __init__(self, filepath):
         self.filepath = filepath
@@ -107,6 +216,39 @@ class CyclesTest(api.Test):
         return {'time': time, 'peak_memory': memory}
 
 
+class CyclesManyLightsTest(api.Test):
+    def __init__(self, use_light_tree):
+        self.use_light_tree = use_light_tree
+
+    def name(self):
+        return "many_lights_tree" if self.use_light_tree else "many_lights"
+
+    def category(self):
+        return "cycles"
+
+    def use_device(self):
+        return True
+
+    def run(self, env, device_id):
+        tokens = device_id.split('_')
+        device_type = tokens[0]
+        device_index = int(tokens[1]) if len(tokens) > 1 else 0
+        args = {'device_type': device_type,
+                'device_index': device_index,
+                'use_light_tree': self.use_light_tree,
+                'grid': 64,
+                'samples': 16,
+                'render_filepath': str(env.log_file.parent / env.log_file.stem)}
+
+        result, _ = env.run_in_blender(_run_many_lights, args, ['--factory-startup'])
+        if not result:
+            raise Exception("Error rendering many lights scene")
+
+        return result
+
+
 def generate(env):
     filepaths = env.find_blend_files('cycles/*')
-    return [CyclesTest(filepath) for filepath in filepaths]
+    tests = [CyclesTest(filepath) for filepath in filepaths]
+    tests += [CyclesManyLightsTest(False), CyclesManyLightsTest(True)]
+    return tests